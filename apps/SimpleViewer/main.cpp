@@ -37,7 +37,11 @@
 #include <OptiXRenderer/Renderer.h>
 #endif
 
+#include <GltfLoader/GltfLoader.h>
+#include <MeshCache/MeshCache.h>
 #include <ObjLoader/ObjLoader.h>
+#include <ScanLoader/PlyLoader.h>
+#include <ScanLoader/StlLoader.h>
 #include <StbImageLoader/StbImageLoader.h>
 
 #include <codecvt>
@@ -248,6 +252,22 @@ Images::UID load_image(const std::string& path) {
     return Images::UID::invalid_UID();
 }
 
+SceneNodes::UID load_model(const std::string& path) {
+    auto has_extension = [&](const char* extension) -> bool {
+        size_t extension_length = strlen(extension);
+        return path.size() >= extension_length && _stricmp(path.c_str() + path.size() - extension_length, extension) == 0;
+    };
+
+    if (has_extension(".gltf") || has_extension(".glb"))
+        return GltfLoader::load(path, load_image, StbImageLoader::load_from_memory);
+    else if (has_extension(".ply"))
+        return PlyLoader::load(path);
+    else if (has_extension(".stl"))
+        return StlLoader::load(path, true);
+    else
+        return ObjLoader::load(path, load_image);
+}
+
 // Merges all nodes in the scene sharing the same material and destroys all other nodes.
 // Future work
 // * Only combine meshes within some max distance to each other, fx the diameter of their bounds.
@@ -261,6 +281,7 @@ void mesh_combine_whole_scene(SceneNodes::UID scene_root) {
     assert((int)MeshFlag::Position <= 0xFF);
     assert((int)MeshFlag::Normal <= 0xFF);
     assert((int)MeshFlag::Texcoord <= 0xFF);
+    assert((int)MeshFlag::Tangent <= 0xFF);
     
     std::vector<bool> used_meshes = std::vector<bool>(Meshes::capacity());
     for (Meshes::UID mesh_ID : Meshes::get_iterable())
@@ -284,6 +305,7 @@ void mesh_combine_whole_scene(SceneNodes::UID scene_root) {
         key |= int(mesh.get_positions() ? MeshFlag::Position : MeshFlag::None);
         key |= int(mesh.get_normals() ? MeshFlag::Normal : MeshFlag::None);
         key |= int(mesh.get_texcoords() ? MeshFlag::Texcoord : MeshFlag::None);
+        key |= int(mesh.get_tangents() ? MeshFlag::Tangent : MeshFlag::None);
 
         OrderedModel model = { key, model_ID };
         ordered_models.push_back(model);
@@ -477,7 +499,7 @@ int initialize_scene(Engine& engine) {
         Scenes::create_veach_scene(engine, cam_ID, scene_ID);
     else {
         printf("Loading scene: '%s'\n", g_scene.c_str());
-        SceneNodes::UID obj_root_ID = ObjLoader::load(g_scene, load_image);
+        SceneNodes::UID obj_root_ID = MeshCache::load_cached(g_scene, load_model);
         SceneNodes::set_parent(obj_root_ID, root_node_ID);
         // mesh_combine_whole_scene(root_node_ID);
         detect_and_flag_cutout_materials();
@@ -622,7 +644,7 @@ void print_usage() {
     char* usage =
         "usage simpleviewer:\n"
         "  -h  | --help: Show command line usage for simpleviewer.\n"
-        "  -s  | --scene <model>: Loads the model specified. Reserved names are 'CornellBox', 'MaterialScene', 'SphereScene', 'SphereLightScene', 'TestScene' and 'VeachScene', which loads the corresponding builtin scenes.\n"
+        "  -s  | --scene <model>: Loads the obj, gltf, glb, ply or stl model specified. Reserved names are 'CornellBox', 'MaterialScene', 'SphereScene', 'SphereLightScene', 'TestScene' and 'VeachScene', which loads the corresponding builtin scenes.\n"
 #ifdef OPTIX_FOUND
         "  -p | --path-tracing-only: Launches with the path tracer as the only avaliable renderer.\n"
         "  -r | --rasterizer-only: Launches with the rasterizer as the only avaliable renderer.\n"
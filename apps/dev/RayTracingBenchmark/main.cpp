@@ -0,0 +1,276 @@
+// Ray tracing benchmark.
+// Measures the throughput of the wide BVH ray queries and of the CPU path tracer
+// on the SimpleViewer scenes and obj files.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Scenes/CornellBox.h>
+#include <Scenes/Test.h>
+#include <Scenes/Veach.h>
+
+#include <CPURenderer/Renderer.h>
+
+#include <Cogwheel/Assets/Image.h>
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Assets/Texture.h>
+#include <Cogwheel/Core/Engine.h>
+#include <Cogwheel/Core/Renderer.h>
+#include <Cogwheel/Geometry/WideBVH.h>
+#include <Cogwheel/Math/Distributions.h>
+#include <Cogwheel/Math/RNG.h>
+#include <Cogwheel/Scene/Camera.h>
+#include <Cogwheel/Scene/LightSource.h>
+#include <Cogwheel/Scene/SceneNode.h>
+#include <Cogwheel/Scene/SceneRoot.h>
+
+#include <MeshCache/MeshCache.h>
+#include <ObjLoader/ObjLoader.h>
+#include <StbImageLoader/StbImageLoader.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+using namespace Cogwheel;
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Geometry;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Scene;
+
+// Rays are generated in tiles of 8x8 pixels, so each tile forms a coherent packet.
+static const int tile_size = 8;
+static const int rays_pr_tile = tile_size * tile_size;
+static const int image_width = 640;
+static const int image_height = 480;
+static const int repetitions = 3;
+
+void print_usage() {
+    char* usage =
+        "usage RayTracingBenchmark [scene]*:\n"
+        "  -h | --help: Show command line usage for RayTracingBenchmark.\n"
+        "  scene: CornellBox, TestScene, Veach or a path to an obj file.\n"
+        "         All the SimpleViewer scenes are benchmarked if no scene is given.\n";
+    printf("%s", usage);
+}
+
+// Primary rays through the center of every pixel, ordered by tile.
+std::vector<Ray> create_primary_rays(Cameras::UID camera_ID) {
+    std::vector<Ray> rays;
+    rays.reserve(image_width * image_height);
+    for (int tile_y = 0; tile_y < image_height; tile_y += tile_size)
+        for (int tile_x = 0; tile_x < image_width; tile_x += tile_size)
+            for (int y = tile_y; y < tile_y + tile_size; ++y)
+                for (int x = tile_x; x < tile_x + tile_size; ++x) {
+                    Vector2f viewport_point = Vector2f((x + 0.5f) / image_width, (y + 0.5f) / image_height);
+                    rays.push_back(CameraUtils::ray_from_viewport_point(camera_ID, viewport_point));
+                }
+    return rays;
+}
+
+// Incoherent rays leaving the primary hits in uniformly distributed directions. Rays that missed the scene are reused as is.
+std::vector<Ray> create_secondary_rays(const std::vector<Ray>& primary_rays, const std::vector<RayHit>& primary_hits) {
+    std::vector<Ray> rays(primary_rays.size());
+    for (int r = 0; r < int(rays.size()); ++r) {
+        if (primary_hits[r].is_hit()) {
+            Vector3f direction = Distributions::Sphere::Sample(RNG::sample02(r));
+            Vector3f origin = primary_rays[r].position_at(primary_hits[r].t) + direction * 0.0001f;
+            rays[r] = Ray(origin, direction);
+        } else
+            rays[r] = primary_rays[r];
+    }
+    return rays;
+}
+
+// Runs the query a number of times and reports the best throughput.
+template <typename Query>
+double measure_MRays_pr_second(int ray_count, Query query) {
+    double best_time = 1e30;
+    for (int i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        query();
+        auto end = std::chrono::high_resolution_clock::now();
+        best_time = min(best_time, std::chrono::duration<double>(end - start).count());
+    }
+    return ray_count / best_time / 1000000.0;
+}
+
+template <int Width>
+void benchmark_rays(const WideBVH<Width>& bvh, const std::vector<Ray>& rays, const char* const ray_type) {
+    const int ray_count = int(rays.size());
+    const int tile_count = ray_count / rays_pr_tile;
+    std::vector<float> t_maxs(ray_count, std::numeric_limits<float>::infinity());
+    std::vector<RayHit> hits(ray_count);
+    std::unique_ptr<bool[]> occlusions = std::unique_ptr<bool[]>(new bool[ray_count]);
+
+    double closest_hit_rate = measure_MRays_pr_second(ray_count, [&] {
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (int r = 0; r < ray_count; ++r)
+            hits[r] = bvh.closest_hit(rays[r]);
+    });
+
+    double closest_hit_packet_rate = measure_MRays_pr_second(ray_count, [&] {
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int t = 0; t < tile_count; ++t)
+            bvh.closest_hit(rays.data() + t * rays_pr_tile, t_maxs.data() + t * rays_pr_tile, rays_pr_tile, hits.data() + t * rays_pr_tile);
+    });
+
+    double any_hit_rate = measure_MRays_pr_second(ray_count, [&] {
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (int r = 0; r < ray_count; ++r)
+            occlusions[r] = bvh.any_hit(rays[r]);
+    });
+
+    double any_hit_packet_rate = measure_MRays_pr_second(ray_count, [&] {
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int t = 0; t < tile_count; ++t)
+            bvh.any_hit(rays.data() + t * rays_pr_tile, t_maxs.data() + t * rays_pr_tile, rays_pr_tile, occlusions.get() + t * rays_pr_tile);
+    });
+
+    printf("    BVH%d %s rays: closest hit %.2f, closest hit packets %.2f, any hit %.2f, any hit packets %.2f MRays/s\n",
+           Width, ray_type, closest_hit_rate, closest_hit_packet_rate, any_hit_rate, any_hit_packet_rate);
+}
+
+template <int Width>
+void benchmark(const BVH& bvh, Meshes::UID mesh_ID, Cameras::UID camera_ID) {
+    auto start = std::chrono::high_resolution_clock::now();
+    WideBVH<Width> wide_bvh = WideBVH<Width>(bvh, mesh_ID);
+    double collapse_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    typename WideBVH<Width>::Statistics statistics = wide_bvh.get_statistics();
+    printf("  BVH%d collapsed in %.3fs: %u nodes, %.2f children pr node, %u triangle packs, depth %u\n",
+           Width, collapse_time, statistics.node_count, statistics.average_child_count, statistics.pack_count, statistics.max_depth);
+
+    std::vector<Ray> primary_rays = create_primary_rays(camera_ID);
+    std::vector<RayHit> primary_hits(primary_rays.size());
+    for (int r = 0; r < int(primary_rays.size()); ++r)
+        primary_hits[r] = wide_bvh.closest_hit(primary_rays[r]);
+    std::vector<Ray> secondary_rays = create_secondary_rays(primary_rays, primary_hits);
+
+    benchmark_rays(wide_bvh, primary_rays, "primary");
+    benchmark_rays(wide_bvh, secondary_rays, "secondary");
+}
+
+// Compares the throughput of the CPU path tracer's recursive and wavefront modes.
+void benchmark_path_tracing(Cameras::UID camera_ID) {
+    CPURenderer::Renderer* renderer = CPURenderer::Renderer::initialize();
+    Cameras::set_renderer_ID(camera_ID, renderer->get_ID());
+    renderer->handle_updates();
+
+    const int pixel_count = image_width * image_height;
+    std::vector<RGBA> image(pixel_count);
+    auto render = [&] { renderer->render(camera_ID, image.data(), image_width, image_height); };
+
+    renderer->set_tracing_mode(CPURenderer::Renderer::TracingMode::Recursive);
+    double recursive_rate = measure_MRays_pr_second(pixel_count, render);
+    renderer->set_tracing_mode(CPURenderer::Renderer::TracingMode::Wavefront);
+    double wavefront_rate = measure_MRays_pr_second(pixel_count, render);
+    printf("  Path tracing with %u bounces: recursive %.2f, wavefront %.2f MPaths/s\n", renderer->get_max_bounce_count(), recursive_rate, wavefront_rate);
+
+    delete renderer;
+}
+
+// Combines all models in the scene into a single mesh in world space.
+Meshes::UID flatten_scene() {
+    std::vector<MeshUtils::TransformedMesh> meshes;
+    for (MeshModel model : MeshModels::get_iterable()) {
+        MeshUtils::TransformedMesh mesh = { model.get_mesh().get_ID(), model.get_scene_node().get_global_transform() };
+        meshes.push_back(mesh);
+    }
+    return MeshUtils::combine("Scene", meshes.data(), meshes.data() + meshes.size(), MeshFlag::Position);
+}
+
+void benchmark_scene(const std::string& scene) {
+    Core::Renderers::allocate(1u);
+    Cameras::allocate(1u);
+    Images::allocate(8u);
+    LightSources::allocate(8u);
+    Materials::allocate(8u);
+    Meshes::allocate(8u);
+    MeshModels::allocate(8u);
+    SceneNodes::allocate(8u);
+    SceneRoots::allocate(1u);
+    Textures::allocate(8u);
+
+    { // Create the scene. Scenes that need an engine get one, but it is never ticked.
+        Core::Engine engine("");
+        SceneRoots::UID scene_ID = SceneRoots::create("Benchmark scene", RGB::white());
+        SceneNodes::UID root_node_ID = SceneRoots::get_root_node(scene_ID);
+
+        Matrix4x4f projection_matrix, inverse_projection_matrix;
+        CameraUtils::compute_perspective_projection(0.1f, 100.0f, PI<float>() / 4.0f, float(image_width) / image_height,
+                                                    projection_matrix, inverse_projection_matrix);
+        Cameras::UID camera_ID = Cameras::create("Camera", scene_ID, projection_matrix, inverse_projection_matrix);
+
+        bool load_model_from_file = false;
+        if (scene.compare("CornellBox") == 0)
+            Scenes::create_cornell_box(camera_ID, root_node_ID);
+        else if (scene.compare("TestScene") == 0)
+            Scenes::create_test_scene(engine, camera_ID, root_node_ID);
+        else if (scene.compare("Veach") == 0)
+            Scenes::create_veach_scene(engine, camera_ID, scene_ID);
+        else {
+            SceneNodes::UID obj_root_ID = MeshCache::load_cached(scene, [](const std::string& path) { return ObjLoader::load(path, StbImageLoader::load); });
+            SceneNodes::set_parent(obj_root_ID, root_node_ID);
+            load_model_from_file = true;
+        }
+
+        Meshes::UID mesh_ID = flatten_scene();
+        Mesh mesh = mesh_ID;
+        printf("%s: %u triangles\n", scene.c_str(), mesh.get_primitive_count());
+
+        if (load_model_from_file) {
+            // Look at the model from the front.
+            AABB bounds = Meshes::compute_bounds(mesh_ID);
+            Transform camera_transform = Cameras::get_transform(camera_ID);
+            camera_transform.translation = bounds.center() - Vector3f::forward() * magnitude(bounds.size());
+            camera_transform.look_at(bounds.center());
+            Cameras::set_transform(camera_ID, camera_transform);
+        }
+
+        BVH bvh = BVH(mesh_ID);
+        BVH::Statistics statistics = bvh.get_statistics();
+        printf("  BVH built in %.3fs: %u nodes, SAH cost %.2f\n", statistics.build_time_in_seconds, statistics.node_count, statistics.SAH_cost);
+
+        benchmark<4>(bvh, mesh_ID, camera_ID);
+        benchmark<8>(bvh, mesh_ID, camera_ID);
+
+        benchmark_path_tracing(camera_ID);
+    }
+
+    Core::Renderers::deallocate();
+    Cameras::deallocate();
+    Images::deallocate();
+    LightSources::deallocate();
+    Materials::deallocate();
+    Meshes::deallocate();
+    MeshModels::deallocate();
+    SceneNodes::deallocate();
+    SceneRoots::deallocate();
+    Textures::deallocate();
+}
+
+int main(int argc, char** argv) {
+    printf("Ray tracing benchmark with %d threads\n", omp_get_max_threads());
+
+    if (argc > 1 && (std::string(argv[1]).compare("-h") == 0 || std::string(argv[1]).compare("--help") == 0)) {
+        print_usage();
+        return 0;
+    }
+
+    if (argc == 1) {
+        benchmark_scene("CornellBox");
+        benchmark_scene("TestScene");
+        benchmark_scene("Veach");
+    } else
+        for (int i = 1; i < argc; ++i)
+            benchmark_scene(argv[i]);
+}
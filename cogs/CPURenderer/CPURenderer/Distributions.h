@@ -0,0 +1,142 @@
+// CPU renderer distributions for monte carlo integration.
+// ------------------------------------------------------------------------------------------------
+// Copyright (C) 2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License.
+// See LICENSE.txt for more detail.
+// ------------------------------------------------------------------------------------------------
+
+#ifndef _CPURENDERER_DISTRIBUTIONS_H_
+#define _CPURENDERER_DISTRIBUTIONS_H_
+
+#include <Cogwheel/Math/Distributions.h>
+#include <Cogwheel/Math/Utils.h>
+
+namespace CPURenderer {
+namespace Distributions {
+
+using Cogwheel::Math::PI;
+using Cogwheel::Math::Vector2f;
+using Cogwheel::Math::Vector3f;
+
+using Cogwheel::Math::Distributions::DirectionalSample;
+namespace Cosine = Cogwheel::Math::Distributions::Cosine;
+
+//=================================================================================================
+// Uniform cone distribution.
+//=================================================================================================
+namespace Cone {
+
+inline float PDF(float cos_theta_max) {
+    return 1.0f / (2.0f * PI<float>() * (1.0f - cos_theta_max));
+}
+
+inline DirectionalSample sample(float cos_theta_max, Vector2f random_sample) {
+    float cos_theta = (1.0f - random_sample.x) + random_sample.x * cos_theta_max;
+    float sin_theta = sqrtf(fmaxf(1.0f - cos_theta * cos_theta, 0.0f));
+    float phi = 2.0f * PI<float>() * random_sample.y;
+
+    DirectionalSample res;
+    res.direction = Vector3f(cosf(phi) * sin_theta, sinf(phi) * sin_theta, cos_theta);
+    res.PDF = PDF(cos_theta_max);
+    return res;
+}
+
+} // NS Cone
+
+//=================================================================================================
+// Sampling of the visible normal distribution function for GGX.
+// Importance Sampling Microfacet-Based BSDFs with the Distribution of Visible Normals, Heitz 14.
+// Understanding the Masking-Shadowing Function in Microfacet-Based BRDFs, Heitz 14.
+//=================================================================================================
+namespace VNDF_GGX {
+
+// Understanding the Masking-Shadowing Function in Microfacet-Based BRDFs, Equation 72.
+inline float lambda(float alpha, float cos_theta) {
+    float cos_theta_sqrd = cos_theta * cos_theta;
+    float tan_theta_sqrd = fmaxf(1.0f - cos_theta_sqrd, 0.0f) / cos_theta_sqrd;
+    float recip_a_sqrd = alpha * alpha * tan_theta_sqrd;
+    return 0.5f * (-1.0f + sqrtf(1.0f + recip_a_sqrd));
+}
+
+inline float masking(float alpha, float cos_theta) {
+    return 1.0f / (1.0f + lambda(alpha, cos_theta));
+}
+
+// Understanding the Masking-Shadowing Function in Microfacet-Based BRDFs, supplemental 1, page 19.
+inline Vector2f sample11(float cos_theta, Vector2f random_sample) {
+    float cos_theta_sqrd = cos_theta * cos_theta;
+    // Special case (normal incidence)
+    if (cos_theta_sqrd > 0.99999f) {
+        float r = sqrtf(random_sample.x / (1 - random_sample.x));
+        float phi = 6.28318530718f * random_sample.y;
+        return Vector2f(r * cosf(phi), r * sinf(phi));
+    }
+
+    float U1 = random_sample.x;
+    float U2 = random_sample.y;
+
+    // GGX masking term with alpha of 1.0.
+    float tan_theta_sqrd = fmaxf(1.0f - cos_theta_sqrd, 0.0f) / cos_theta_sqrd;
+    float tan_theta = sqrtf(tan_theta_sqrd);
+    float a = 1.0f / tan_theta;
+    float G1 = 2.0f / (1.0f + sqrtf(1.0f + 1.0f / (a*a)));
+
+    // Sample slope_x
+    float A = 2.0f * U1 / G1 - 1.0f;
+    float tmp = 1.0f / (A * A - 1.0f);
+    float B = tan_theta;
+    float D = sqrtf(fmaxf(B * B * tmp * tmp - (A * A - B * B) * tmp, 0.0f));
+    float slope_x_1 = B * tmp - D;
+    float slope_x_2 = B * tmp + D;
+    Vector2f slope;
+    slope.x = (A < 0.0f || slope_x_2 > 1.0f / tan_theta) ? slope_x_1 : slope_x_2;
+
+    // Sample slope_y
+    float S;
+    if (U2 > 0.5f) {
+        S = 1.0f;
+        U2 = 2.0f * (U2 - 0.5f);
+    } else {
+        S = -1.0f;
+        U2 = 2.0f * (0.5f - U2);
+    }
+
+    float z = (U2*(U2*(U2*0.27385f - 0.73369f) + 0.46341f)) / (U2*(U2*(U2*0.093073f + 0.309420f) - 1.0f) + 0.597999f);
+    slope.y = S * z * sqrtf(1.0f + slope.x * slope.x);
+    return slope;
+}
+
+// Understanding the Masking-Shadowing Function in Microfacet-Based BRDFs, supplemental 1, page 4.
+inline Vector3f sample_halfway(float alpha, Vector3f wo, Vector2f random_sample) {
+    // Stretch wo
+    Vector3f stretched_wo = normalize(Vector3f(alpha * wo.x, alpha * wo.y, wo.z));
+
+    // Sample P22_{wo}(x_slope, y_slope, 1, 1)
+    Vector2f slope = sample11(stretched_wo.z, random_sample);
+
+    // Rotate
+    float sin_theta = sqrtf(fmaxf(1.0f - stretched_wo.z * stretched_wo.z, 0.0f));
+    float cos_phi = sin_theta == 0.0f ? 1.0f : Cogwheel::Math::clamp(stretched_wo.x / sin_theta, -1.0f, 1.0f);
+    float sin_phi = sin_theta == 0.0f ? 0.0f : Cogwheel::Math::clamp(stretched_wo.y / sin_theta, -1.0f, 1.0f);
+    float tmp = cos_phi * slope.x - sin_phi * slope.y;
+    slope.y = sin_phi * slope.x + cos_phi * slope.y;
+    slope.x = tmp;
+
+    // Unstretch and compute normal.
+    return normalize(Vector3f(-slope.x * alpha, -slope.y * alpha, 1.0f));
+}
+
+// Importance Sampling Microfacet-Based BSDFs with the Distribution of Visible Normals, equation 2
+inline float PDF(float alpha, Vector3f wo, Vector3f halfway) {
+    float G1 = masking(alpha, wo.z);
+    float D = Cogwheel::Math::Distributions::GGX::D(alpha, fabsf(halfway.z));
+    return G1 * fabsf(dot(wo, halfway)) * D / wo.z;
+}
+
+} // NS VNDF_GGX
+
+} // NS Distributions
+} // NS CPURenderer
+
+#endif // _CPURENDERER_DISTRIBUTIONS_H_
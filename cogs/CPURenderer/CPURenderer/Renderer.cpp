@@ -0,0 +1,825 @@
+// CPU path tracing renderer.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <CPURenderer/Renderer.h>
+
+#include <CPURenderer/Shading/LightSources/LightSources.h>
+#include <CPURenderer/Shading/ShadingModels/DefaultShading.h>
+#include <CPURenderer/Types.h>
+
+#include <Cogwheel/Assets/Image.h>
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Assets/Texture.h>
+#include <Cogwheel/Geometry/SceneBVH.h>
+#include <Cogwheel/Math/AABB.h>
+#include <Cogwheel/Math/MortonEncode.h>
+#include <Cogwheel/Math/RNG.h>
+#include <Cogwheel/Math/TBN.h>
+#include <Cogwheel/Math/Utils.h>
+#include <Cogwheel/Scene/Camera.h>
+#include <Cogwheel/Scene/LightSource.h>
+#include <Cogwheel/Scene/SceneNode.h>
+#include <Cogwheel/Scene/SceneRoot.h>
+
+#include <assert.h>
+#include <vector>
+
+#include <omp.h>
+
+using namespace Cogwheel;
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Core;
+using namespace Cogwheel::Geometry;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Scene;
+
+namespace CPURenderer {
+
+// Pixels are rendered in tiles of 16x16 pixels, which are handed out to the threads one at a time.
+static const int tile_size = 16;
+
+// The number of light samples that the light source used for next event estimation is chosen from.
+static const int light_sample_count = 3;
+
+static inline Material convert_material(Materials::UID material_ID) {
+    Material material;
+    material.tint = Materials::get_tint(material_ID);
+    material.tint_texture_ID = Materials::get_tint_texture_ID(material_ID);
+    material.roughness = Materials::get_roughness(material_ID);
+    material.specularity = Materials::get_specularity(material_ID);
+    material.metallic = Materials::get_metallic(material_ID);
+    material.coverage = Materials::get_coverage(material_ID);
+    material.coverage_texture_ID = Materials::get_coverage_texture_ID(material_ID);
+    return material;
+}
+
+// NOTE Cogwheel's light sources are explicitly qualified, as CPURenderer::LightSources hides them.
+static inline Light convert_light(Scene::LightSources::UID light_ID) {
+    Light light;
+    Transform transform = SceneNodes::get_global_transform(Scene::LightSources::get_node_ID(light_ID));
+    switch (Scene::LightSources::get_type(light_ID)) {
+    case Scene::LightSources::Type::Sphere:
+        light.type = Light::Type::Sphere;
+        light.sphere.position = transform.translation;
+        light.sphere.power = Scene::LightSources::get_sphere_light_power(light_ID);
+        light.sphere.radius = Scene::LightSources::get_sphere_light_radius(light_ID);
+        break;
+    case Scene::LightSources::Type::Directional:
+        light.type = Light::Type::Directional;
+        light.directional.direction = transform.rotation.forward();
+        light.directional.radiance = Scene::LightSources::get_directional_light_radiance(light_ID);
+        break;
+    }
+    return light;
+}
+
+static inline EnvironmentLight convert_environment(SceneRoots::UID scene_ID) {
+    EnvironmentLight environment = { SceneRoots::get_environment_light(scene_ID), SceneRoots::get_environment_tint(scene_ID) };
+    return environment;
+}
+
+// Returns the vertex indices of a triangle. Triangle soups have no index buffer and store their triangles as consecutive vertices.
+static inline Vector3ui get_primitive(Meshes::UID mesh_ID, unsigned int primitive_index) {
+    const Vector3ui* primitives = Meshes::get_primitives(mesh_ID);
+    if (primitives == nullptr || Meshes::get_primitive_count(mesh_ID) == 0)
+        return Vector3ui(3 * primitive_index, 3 * primitive_index + 1, 3 * primitive_index + 2);
+    return primitives[primitive_index];
+}
+
+static inline bool is_black(RGB color) {
+    return color.r <= 0.0f && color.g <= 0.0f && color.b <= 0.0f;
+}
+
+//----------------------------------------------------------------------------
+// Renderer implementation.
+//----------------------------------------------------------------------------
+
+struct Renderer::Implementation {
+
+    Renderers::UID owning_renderer_ID;
+
+    // Per camera members.
+    struct CameraState {
+        Vector2i screensize;
+        std::vector<RGB> accumulation_buffer;
+        unsigned int accumulations;
+        Matrix4x4f inverse_view_projection_matrix;
+
+        inline void clear() {
+            screensize = Vector2i::zero();
+            accumulation_buffer.clear();
+            accumulation_buffer.shrink_to_fit();
+            accumulations = 0u;
+            inverse_view_projection_matrix = Matrix4x4f::identity();
+        }
+    };
+    std::vector<CameraState> per_camera_state;
+
+    // Scene members.
+    SceneBVH scene_bvh;
+    float scene_epsilon;
+    unsigned int max_bounce_count;
+    TracingMode tracing_mode;
+
+    std::vector<Material> materials; // Indexed by material ID.
+    bool has_partial_coverage; // True if any material is not fully opaque, in which case shadow rays need to accumulate coverage.
+
+    std::vector<Light> lights;
+    std::vector<EnvironmentLight> environments; // Indexed by scene ID.
+
+    Implementation(Renderers::UID renderer_ID)
+        : owning_renderer_ID(renderer_ID), scene_epsilon(0.0001f), max_bounce_count(4u), tracing_mode(TracingMode::Recursive), has_partial_coverage(false) {
+
+        per_camera_state.resize(1);
+        per_camera_state[0].clear(); // Clear sentinel camera state.
+
+        // Convert the assets and lights that were created before the renderer.
+        materials.resize(max(1u, Materials::capacity()));
+        materials[0] = convert_material(Materials::UID::invalid_UID());
+        for (Materials::UID material_ID : Materials::get_iterable())
+            materials[material_ID] = convert_material(material_ID);
+        update_partial_coverage();
+
+        for (Scene::LightSources::UID light_ID : Scene::LightSources::get_iterable())
+            lights.push_back(convert_light(light_ID));
+
+        environments.resize(SceneRoots::capacity());
+        for (SceneRoots::UID scene_ID : SceneRoots::get_iterable())
+            environments[scene_ID] = convert_environment(scene_ID);
+    }
+
+    void update_partial_coverage() {
+        has_partial_coverage = false;
+        for (Materials::UID material_ID : Materials::get_iterable()) {
+            const Material& material = materials[material_ID];
+            has_partial_coverage |= material.coverage < 1.0f || material.coverage_texture_ID != Textures::UID::invalid_UID();
+        }
+    }
+
+    void handle_updates() {
+        bool should_reset_accumulations = false;
+
+        { // Camera updates.
+            for (Cameras::UID cam_ID : Cameras::get_changed_cameras()) {
+                auto camera_changes = Cameras::get_changes(cam_ID);
+                bool uses_cpu_renderer = camera_changes != Cameras::Change::Destroyed && owning_renderer_ID == Cameras::get_renderer_ID(cam_ID);
+                if (!uses_cpu_renderer) {
+                    // Release the accumulation buffer of destroyed cameras and cameras that switched to another renderer.
+                    if (cam_ID < per_camera_state.size())
+                        per_camera_state[cam_ID].clear();
+                } else if (camera_changes.any_set(Cameras::Change::Created, Cameras::Change::Renderer)) {
+                    if (per_camera_state.size() <= cam_ID)
+                        per_camera_state.resize(Cameras::capacity());
+                    per_camera_state[cam_ID].clear();
+                }
+            }
+        }
+
+        { // Mesh, model and transform updates.
+            unsigned int rebuild_count = scene_bvh.get_statistics().rebuild_count;
+            scene_bvh.handle_updates();
+            const SceneBVH::Statistics& statistics = scene_bvh.get_statistics();
+            if (statistics.rebuild_count != rebuild_count || statistics.refit_model_count != 0)
+                should_reset_accumulations = true;
+
+            // Shading reads the vertex attributes directly from the meshes, so any mesh update changes the image.
+            if (!Meshes::get_changed_meshes().is_empty())
+                should_reset_accumulations = true;
+
+            for (MeshModels::UID model_ID : MeshModels::get_changed_models())
+                if (MeshModels::get_changes(model_ID).is_set(MeshModels::Change::Material))
+                    should_reset_accumulations = true;
+        }
+
+        { // Image and texture updates.
+            // Textures are sampled directly from the images, so updates only invalidate the accumulated images.
+            if (!Images::get_changed_images().is_empty() || !Textures::get_changed_textures().is_empty())
+                should_reset_accumulations = true;
+        }
+
+        { // Material updates.
+            if (!Materials::get_changed_materials().is_empty()) {
+                if (materials.size() < Materials::capacity()) {
+                    materials.resize(Materials::capacity());
+                    for (Materials::UID material_ID : Materials::get_iterable())
+                        materials[material_ID] = convert_material(material_ID);
+                } else
+                    for (Materials::UID material_ID : Materials::get_changed_materials())
+                        if (Materials::get_changes(material_ID).not_set(Materials::Change::Destroyed))
+                            materials[material_ID] = convert_material(material_ID);
+
+                update_partial_coverage();
+
+                should_reset_accumulations = true;
+            }
+        }
+
+        { // Light updates.
+            // The light sources are few, so they are all reconverted if any of them or their scene nodes changed.
+            bool lights_changed = !Scene::LightSources::get_changed_lights().is_empty();
+            if (!lights_changed)
+                for (SceneNodes::UID node_ID : SceneNodes::get_changed_nodes())
+                    if (SceneNodes::get_changes(node_ID).is_set(SceneNodes::Change::Transform))
+                        for (Scene::LightSources::UID light_ID : Scene::LightSources::get_iterable())
+                            lights_changed |= Scene::LightSources::get_node_ID(light_ID) == node_ID;
+
+            if (lights_changed) {
+                lights.clear();
+                for (Scene::LightSources::UID light_ID : Scene::LightSources::get_iterable())
+                    lights.push_back(convert_light(light_ID));
+                should_reset_accumulations = true;
+            }
+        }
+
+        { // Scene root updates.
+            for (SceneRoots::UID scene_ID : SceneRoots::get_changed_scenes()) {
+                if (environments.size() < SceneRoots::capacity())
+                    environments.resize(SceneRoots::capacity());
+
+                if (SceneRoots::get_changes(scene_ID).is_set(SceneRoots::Change::Destroyed))
+                    environments[scene_ID] = { nullptr, RGB::black() };
+                else
+                    environments[scene_ID] = convert_environment(scene_ID);
+                should_reset_accumulations = true;
+            }
+        }
+
+        if (should_reset_accumulations)
+            for (auto& camera_state : per_camera_state)
+                camera_state.accumulations = 0u;
+    }
+
+    //------------------------------------------------------------------------
+    // Surface interaction.
+    //------------------------------------------------------------------------
+
+    inline Vector2f compute_texcoord(Meshes::UID mesh_ID, Vector3ui primitive, float u, float v) const {
+        const Vector2f* texcoords = Meshes::get_texcoords(mesh_ID);
+        if (texcoords == nullptr)
+            return Vector2f::zero();
+        return texcoords[primitive.x] * (1.0f - u - v) + texcoords[primitive.y] * u + texcoords[primitive.z] * v;
+    }
+
+    // Returns the coverage of the material at the intersection.
+    inline float coverage(const SceneRayHit& hit) const {
+        Meshes::UID mesh_ID = MeshModels::get_mesh_ID(hit.model_ID);
+        const Material& material = materials[MeshModels::get_material_ID(hit.model_ID)];
+        if (material.coverage_texture_ID == Textures::UID::invalid_UID())
+            return material.coverage;
+        Vector3ui primitive = get_primitive(mesh_ID, hit.hit.primitive_index);
+        return Shading::ShadingModels::DefaultShading::coverage(material, compute_texcoord(mesh_ID, primitive, hit.hit.u, hit.hit.v));
+    }
+
+    // Traces a shadow ray and returns the fraction of light that is transmitted along the ray.
+    RGB trace_shadow_ray(Vector3f origin, Vector3f direction, float distance) const {
+        float t_max = distance - 2.0f * scene_epsilon;
+        Ray ray = Ray(origin + direction * scene_epsilon, direction);
+        if (!has_partial_coverage)
+            return scene_bvh.any_hit(ray, t_max) ? RGB::black() : RGB::white();
+
+        // Attenuate the light by the coverage of all surfaces along the ray.
+        float attenuation = 1.0f;
+        SceneRayHit hit = scene_bvh.closest_hit(ray, t_max);
+        while (hit.is_hit()) {
+            attenuation *= 1.0f - coverage(hit);
+            if (attenuation < 0.0000001f)
+                return RGB::black();
+            float t_offset = hit.hit.t + scene_epsilon;
+            ray.origin = ray.position_at(t_offset);
+            t_max -= t_offset;
+            hit = scene_bvh.closest_hit(ray, t_max);
+        }
+        return RGB(attenuation);
+    }
+
+    // Finds the closest analytical area light along the ray in front of t_max. Returns -1 if no light was hit.
+    inline int intersect_area_lights(Ray ray, float& t_max) const {
+        int light_index = -1;
+        for (int l = 0; l < int(lights.size()); ++l) {
+            const Light& light = lights[l];
+            if (light.type != Light::Type::Sphere || light.sphere.radius <= 0.0f)
+                continue;
+            float t = LightSources::ray_sphere(ray.origin, ray.direction, light.sphere.position, light.sphere.radius);
+            if (0.0f < t && t < t_max) {
+                t_max = t;
+                light_index = l;
+            }
+        }
+        return light_index;
+    }
+
+    //------------------------------------------------------------------------
+    // Light sampling.
+    //------------------------------------------------------------------------
+
+    // Samples a single light source and evaluates the material's response to the light,
+    // which is stored in the light sample's radiance.
+    LightSample sample_single_light(const Shading::ShadingModels::DefaultShading& material, const TBN& world_shading_tbn,
+                                    Vector3f position, Vector3f wo, bool apply_MIS, float light_index_w, RNG::LinearCongruential& rng,
+                                    const Light* const lights, int light_count) const {
+        int light_index = min(light_count - 1, int(light_index_w * light_count));
+        const Light& light = lights[light_index];
+        LightSample light_sample = LightSources::sample_radiance(light, position, rng.sample2f());
+        if (!is_PDF_valid(light_sample.PDF)) {
+            light_sample.radiance = RGB::black();
+            return light_sample;
+        }
+        light_sample.radiance *= float(light_count); // Scale up radiance to account for only sampling one light.
+
+        float N_dot_L = dot(world_shading_tbn.get_normal(), light_sample.direction_to_light);
+        light_sample.radiance *= fabsf(N_dot_L) / light_sample.PDF;
+
+        // Apply MIS weights if the light isn't a delta function and if a new material ray will be spawned, i.e. it isn't the final bounce.
+        const Vector3f shading_light_direction = world_shading_tbn * light_sample.direction_to_light;
+        BSDFResponse bsdf_response = material.evaluate_with_PDF(wo, shading_light_direction);
+        bool delta_light = LightSources::is_delta_light(light, position);
+        if (apply_MIS && !delta_light)
+            light_sample.radiance *= RNG::power_heuristic(light_sample.PDF, bsdf_response.PDF);
+        else {
+            // BIAS Nearly specular materials and delta lights will lead to insane fireflies, so we clamp them here.
+            bsdf_response.weight.r = fminf(bsdf_response.weight.r, 32.0f);
+            bsdf_response.weight.g = fminf(bsdf_response.weight.g, 32.0f);
+            bsdf_response.weight.b = fminf(bsdf_response.weight.b, 32.0f);
+        }
+
+        // Inline the material response into the light sample's radiance.
+        light_sample.radiance *= bsdf_response.weight;
+
+        return light_sample;
+    }
+
+    // Take multiple light samples and from that set pick one based on the contribution of the light scaled by the material.
+    // Basic Resampled importance sampling: http://scholarsarchive.byu.edu/cgi/viewcontent.cgi?article=1662&context=etd.
+    LightSample reestimated_light_samples(const Shading::ShadingModels::DefaultShading& material, const TBN& world_shading_tbn,
+                                          Vector3f position, Vector3f wo, bool apply_MIS, RNG::LinearCongruential& rng,
+                                          const Light* const lights, int light_count) const {
+        float light_sample_w = rng.sample1f();
+        LightSample light_sample = sample_single_light(material, world_shading_tbn, position, wo, apply_MIS, light_sample_w, rng, lights, light_count);
+        for (int s = 1; s < light_sample_count; ++s) {
+            light_sample_w += 1.0f / light_sample_count;
+            if (light_sample_w > 1.0f) light_sample_w -= 1.0f;
+            LightSample new_light_sample = sample_single_light(material, world_shading_tbn, position, wo, apply_MIS, light_sample_w, rng, lights, light_count);
+            float light_weight = light_sample.radiance.r + light_sample.radiance.g + light_sample.radiance.b;
+            float new_light_weight = new_light_sample.radiance.r + new_light_sample.radiance.g + new_light_sample.radiance.b;
+            if (new_light_weight <= 0.0f)
+                continue;
+            float new_light_probability = new_light_weight / (light_weight + new_light_weight);
+            if (rng.sample1f() < new_light_probability) {
+                light_sample = new_light_sample;
+                light_sample.radiance /= new_light_probability;
+            } else
+                light_sample.radiance /= 1.0f - new_light_probability;
+        }
+        light_sample.radiance /= float(light_sample_count);
+
+        return light_sample;
+    }
+
+    //------------------------------------------------------------------------
+    // Path tracing.
+    //------------------------------------------------------------------------
+
+    struct PathState {
+        Ray ray;
+        RGB throughput;
+        float bsdf_MIS_PDF;
+        unsigned int bounces;
+        unsigned int pixel_index;
+        RNG::LinearCongruential rng;
+    };
+
+    // The closest intersection along a path, which is either a surface or an analytical area light.
+    struct PathIntersection {
+        SceneRayHit hit;
+        int light_index; // -1 if no area light was hit.
+
+        inline bool is_surface() const { return light_index < 0 && hit.is_hit(); }
+    };
+
+    // Light sampled at a surface. The radiance includes the path throughput and is scaled by the transmission along the ray.
+    struct ShadowRay {
+        Vector3f origin;
+        Vector3f direction;
+        float distance;
+        RGB radiance;
+    };
+
+    inline PathState create_camera_path(int x, int y, int width, int height, unsigned int accumulations,
+                                        Vector3f camera_position, const Matrix4x4f& inverse_view_projection_matrix) const {
+        PathState path;
+        path.rng = RNG::LinearCongruential(RNG::reverse_bits(RNG::teschner_hash(x, y) ^ 83492791 ^ accumulations));
+
+        // Generate the camera ray. The first sample is taken through the pixel center.
+        Vector2f screen_pos_offset = path.rng.sample2f(); // Always advance the rng by two samples, even if we ignore them.
+        Vector2f screen_pos = Vector2f(float(x), float(y)) + (accumulations == 0u ? Vector2f(0.5f, 0.5f) : screen_pos_offset);
+        Vector4f normalized_projected_pos = Vector4f(screen_pos.x / width * 2.0f - 1.0f, screen_pos.y / height * 2.0f - 1.0f, -1.0f, 1.0f);
+        Vector4f projected_world_pos = inverse_view_projection_matrix * normalized_projected_pos;
+        Vector3f ray_target = Vector3f(projected_world_pos.x, projected_world_pos.y, projected_world_pos.z) / projected_world_pos.w;
+        path.ray = Ray(camera_position, normalize(ray_target - camera_position));
+
+        path.throughput = RGB::white();
+        path.bsdf_MIS_PDF = 0.0f;
+        path.bounces = 0u;
+        path.pixel_index = x + y * width;
+        return path;
+    }
+
+    inline PathIntersection intersect(Ray ray) const {
+        PathIntersection intersection;
+        intersection.hit = scene_bvh.closest_hit(Ray(ray.origin + ray.direction * scene_epsilon, ray.direction));
+        float t = intersection.hit.hit.t;
+        intersection.light_index = intersect_area_lights(ray, t);
+        return intersection;
+    }
+
+    // Computes the contribution of a light source hit by a BSDF sampled ray.
+    // If next event estimation was applied at the previous intersection, then the contribution is MIS weighted.
+    inline RGB MIS_weight_light_hit(RGB radiance, float light_PDF, float bsdf_MIS_PDF, bool next_event_estimated) const {
+        if (bsdf_MIS_PDF > 0.0f)
+            radiance *= RNG::power_heuristic(bsdf_MIS_PDF, light_PDF);
+        else if (next_event_estimated)
+            // Previous bounce used next event estimation, but did not calculate MIS, so don't apply light contribution.
+            radiance = RGB::black();
+        return radiance;
+    }
+
+    // Radiance from the area light or environment that terminated the path.
+    inline RGB evaluate_emission(const PathState& path, const PathIntersection& intersection, const Light* const lights, int light_count,
+                                 const EnvironmentLight& environment) const {
+        bool next_event_estimated = path.bounces != 0u && light_count != 0;
+        Ray ray = path.ray;
+
+        if (intersection.light_index >= 0) {
+            const SphereLight& light = lights[intersection.light_index].sphere;
+            RGB light_radiance = LightSources::evaluate(light, ray.origin);
+            float light_PDF = LightSources::PDF(light, ray.origin, ray.direction);
+            return MIS_weight_light_hit(light_radiance, light_PDF, path.bsdf_MIS_PDF, next_event_estimated);
+        }
+
+        if (environment.map == nullptr)
+            return environment.tint;
+        return MIS_weight_light_hit(LightSources::evaluate(environment, ray.direction),
+                                    LightSources::PDF(environment, ray.direction), path.bsdf_MIS_PDF, next_event_estimated);
+    }
+
+    // Shades the surface hit by the path. A light source is sampled and returned as a shadow ray and the path is continued
+    // in a direction sampled from the BSDF.
+    // Returns false if the path is terminated.
+    bool shade(PathState& path, const SceneRayHit& hit, const Light* const lights, int light_count, ShadowRay& shadow_ray) const {
+        shadow_ray.radiance = RGB::black();
+
+        Ray offset_ray = Ray(path.ray.origin + path.ray.direction * scene_epsilon, path.ray.direction);
+        Vector3f position = offset_ray.position_at(hit.hit.t);
+
+        Meshes::UID mesh_ID = MeshModels::get_mesh_ID(hit.model_ID);
+        Vector3ui primitive = get_primitive(mesh_ID, hit.hit.primitive_index);
+        Vector2f texcoord = compute_texcoord(mesh_ID, primitive, hit.hit.u, hit.hit.v);
+        const Material& material_parameters = materials[MeshModels::get_material_ID(hit.model_ID)];
+
+        // Stochastically pass through partially covered surfaces.
+        float material_coverage = Shading::ShadingModels::DefaultShading::coverage(material_parameters, texcoord);
+        if (material_coverage < 1.0f && path.rng.sample1f() > material_coverage) {
+            path.ray.origin = position;
+            return true;
+        }
+
+        // Compute the world space shading normal facing the ray.
+        const Vector3f* normals = Meshes::get_normals(mesh_ID);
+        Vector3f normal;
+        if (normals != nullptr)
+            normal = normals[primitive.x] * (1.0f - hit.hit.u - hit.hit.v) + normals[primitive.y] * hit.hit.u + normals[primitive.z] * hit.hit.v;
+        else {
+            const Vector3f* positions = Meshes::get_positions(mesh_ID);
+            normal = cross(positions[primitive.y] - positions[primitive.x], positions[primitive.z] - positions[primitive.x]);
+        }
+        Transform transform = SceneNodes::get_global_transform(MeshModels::get_scene_node_ID(hit.model_ID));
+        Vector3f world_normal = normalize(transform.rotation * normal);
+        if (dot(world_normal, path.ray.direction) > 0.0f)
+            world_normal = -world_normal;
+
+        const TBN world_shading_tbn = TBN(world_normal);
+        Vector3f wo = world_shading_tbn * -path.ray.direction;
+        const Shading::ShadingModels::DefaultShading material = Shading::ShadingModels::DefaultShading(material_parameters, fabsf(wo.z), texcoord);
+
+        // Sample a light source.
+        if (light_count != 0) {
+            bool apply_MIS = path.bounces + 1u < max_bounce_count;
+            LightSample light_sample = reestimated_light_samples(material, world_shading_tbn, position, wo, apply_MIS, path.rng, lights, light_count);
+            shadow_ray.origin = position;
+            shadow_ray.direction = light_sample.direction_to_light;
+            shadow_ray.distance = light_sample.distance;
+            shadow_ray.radiance = path.throughput * light_sample.radiance;
+        }
+
+        // Sample BSDF.
+        BSDFSample bsdf_sample = material.sample_all(wo, path.rng.sample3f());
+        if (!is_PDF_valid(bsdf_sample.PDF))
+            return false;
+        path.throughput *= bsdf_sample.weight * (fabsf(bsdf_sample.direction.z) / bsdf_sample.PDF); // f * ||cos(theta)|| / pdf
+        path.bsdf_MIS_PDF = bsdf_sample.PDF;
+        path.ray = Ray(position, normalize(bsdf_sample.direction * world_shading_tbn));
+
+        ++path.bounces;
+        return path.bounces < max_bounce_count && !is_black(path.throughput);
+    }
+
+    // Traces the path to completion and returns the radiance along the camera ray.
+    RGB path_trace(PathState path, const Light* const lights, int light_count, const EnvironmentLight& environment) const {
+        RGB radiance = RGB::black();
+        bool is_active = true;
+        while (is_active) {
+            PathIntersection intersection = intersect(path.ray);
+            if (!intersection.is_surface()) {
+                radiance += path.throughput * evaluate_emission(path, intersection, lights, light_count, environment);
+                break;
+            }
+
+            ShadowRay shadow_ray;
+            is_active = shade(path, intersection.hit, lights, light_count, shadow_ray);
+            if (!is_black(shadow_ray.radiance))
+                radiance += shadow_ray.radiance * trace_shadow_ray(shadow_ray.origin, shadow_ray.direction, shadow_ray.distance);
+        }
+        return radiance;
+    }
+
+    //------------------------------------------------------------------------
+    // Wavefront path tracing.
+    //------------------------------------------------------------------------
+
+    // Sorting key of a path with the ray direction octant in the upper 3 bits and the 27 bit Morton code of the ray origin
+    // below it. The key is stored in the upper 32 bits and the index of the path in the lower 32 bits.
+    static inline unsigned long long path_sort_key(Ray ray, Vector3f origin_offset, Vector3f origin_scale, unsigned int path_index) {
+        unsigned int octant = (ray.direction.x < 0.0f ? 1u : 0u) | (ray.direction.y < 0.0f ? 2u : 0u) | (ray.direction.z < 0.0f ? 4u : 0u);
+        Vector3f grid_position = (ray.origin - origin_offset) * origin_scale;
+        unsigned int x = (unsigned int)fmaxf(fminf(grid_position.x, 511.0f), 0.0f);
+        unsigned int y = (unsigned int)fmaxf(fminf(grid_position.y, 511.0f), 0.0f);
+        unsigned int z = (unsigned int)fmaxf(fminf(grid_position.z, 511.0f), 0.0f);
+        unsigned int key = (octant << 27u) | morton_encode(x, y, z);
+        return ((unsigned long long)key << 32) | path_index;
+    }
+
+    // Sorts the 30 bit keys in the upper 32 bits of the path keys using a three pass radix sort.
+    static void radix_sort_path_keys(std::vector<unsigned long long>& keys, std::vector<unsigned long long>& sorted_keys) {
+        sorted_keys.resize(keys.size());
+        for (int pass = 0; pass < 3; ++pass) {
+            const int shift = 32 + pass * 10;
+            unsigned int offsets[1024] = {};
+            for (unsigned long long key : keys)
+                ++offsets[(key >> shift) & 1023];
+            unsigned int offset = 0u;
+            for (unsigned int& bin_offset : offsets) {
+                unsigned int count = bin_offset;
+                bin_offset = offset;
+                offset += count;
+            }
+            for (unsigned long long key : keys)
+                sorted_keys[offsets[(key >> shift) & 1023]++] = key;
+            keys.swap(sorted_keys);
+        }
+    }
+
+    // Traces all paths one bounce at a time and adds their radiance to the radiance buffer.
+    // Before each bounce the paths are sorted by ray direction and origin, so consecutive rays in the stream traverse
+    // the same parts of the hierarchies. The surface hits are then shaded grouped by material and the resulting shadow rays
+    // are traced in path order, which leaves them sorted by origin as well.
+    void wavefront_path_trace(std::vector<PathState>& paths, const Light* const lights, int light_count,
+                              const EnvironmentLight& environment, RGB* const radiance_buffer) const {
+        std::vector<PathState> sorted_paths;
+        std::vector<unsigned long long> keys, sorted_keys;
+        std::vector<PathIntersection> intersections;
+        std::vector<ShadowRay> shadow_rays;
+        std::vector<unsigned char> is_active;
+        std::vector<unsigned int> material_offsets;
+        std::vector<unsigned int> shading_order;
+
+        while (!paths.empty()) {
+            const int path_count = int(paths.size());
+
+            { // Sort the paths by ray direction octant and origin Morton code.
+                AABB origin_bounds = AABB::invalid();
+                for (const PathState& path : paths)
+                    origin_bounds.grow_to_contain(path.ray.origin);
+                Vector3f origin_size = origin_bounds.size();
+                Vector3f origin_scale = Vector3f(origin_size.x > 0.0f ? 511.0f / origin_size.x : 0.0f,
+                                                 origin_size.y > 0.0f ? 511.0f / origin_size.y : 0.0f,
+                                                 origin_size.z > 0.0f ? 511.0f / origin_size.z : 0.0f);
+
+                keys.resize(path_count);
+                #pragma omp parallel for schedule(static)
+                for (int p = 0; p < path_count; ++p)
+                    keys[p] = path_sort_key(paths[p].ray, origin_bounds.minimum, origin_scale, p);
+                radix_sort_path_keys(keys, sorted_keys);
+
+                sorted_paths.resize(path_count);
+                #pragma omp parallel for schedule(static)
+                for (int p = 0; p < path_count; ++p)
+                    sorted_paths[p] = paths[(unsigned int)keys[p]];
+                paths.swap(sorted_paths);
+            }
+
+            // Trace the sorted rays as a stream.
+            intersections.resize(path_count);
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (int p = 0; p < path_count; ++p)
+                intersections[p] = intersect(paths[p].ray);
+
+            // Terminate paths that hit a light source or left the scene.
+            is_active.resize(path_count);
+            shadow_rays.resize(path_count);
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (int p = 0; p < path_count; ++p) {
+                is_active[p] = intersections[p].is_surface();
+                shadow_rays[p].radiance = RGB::black();
+                if (!is_active[p]) {
+                    const PathState& path = paths[p];
+                    radiance_buffer[path.pixel_index] += path.throughput * evaluate_emission(path, intersections[p], lights, light_count, environment);
+                }
+            }
+
+            { // Order the surface hits by material with a counting sort.
+                material_offsets.assign(materials.size() + 1, 0u);
+                for (int p = 0; p < path_count; ++p)
+                    if (is_active[p])
+                        ++material_offsets[MeshModels::get_material_ID(intersections[p].hit.model_ID) + 1];
+                for (unsigned int m = 1; m < material_offsets.size(); ++m)
+                    material_offsets[m] += material_offsets[m - 1];
+                shading_order.resize(material_offsets.back());
+                for (int p = 0; p < path_count; ++p)
+                    if (is_active[p])
+                        shading_order[material_offsets[MeshModels::get_material_ID(intersections[p].hit.model_ID)]++] = p;
+            }
+
+            // Shade the surface hits grouped by material.
+            const int shading_count = int(shading_order.size());
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (int i = 0; i < shading_count; ++i) {
+                unsigned int p = shading_order[i];
+                is_active[p] = shade(paths[p], intersections[p].hit, lights, light_count, shadow_rays[p]);
+            }
+
+            // Trace the shadow rays as a stream.
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (int p = 0; p < path_count; ++p) {
+                const ShadowRay& shadow_ray = shadow_rays[p];
+                if (!is_black(shadow_ray.radiance))
+                    radiance_buffer[paths[p].pixel_index] += shadow_ray.radiance * trace_shadow_ray(shadow_ray.origin, shadow_ray.direction, shadow_ray.distance);
+            }
+
+            // Remove the terminated paths.
+            int active_path_count = 0;
+            for (int p = 0; p < path_count; ++p)
+                if (is_active[p])
+                    paths[active_path_count++] = paths[p];
+            paths.resize(active_path_count);
+        }
+    }
+
+    unsigned int render(Cameras::UID camera_ID, RGBA* output, int width, int height) {
+        if (Cameras::get_renderer_ID(camera_ID) != owning_renderer_ID)
+            return 0u;
+
+        if (per_camera_state.size() <= camera_ID)
+            per_camera_state.resize(Cameras::capacity());
+        CameraState& camera_state = per_camera_state[camera_ID];
+
+        { // Update camera state.
+            // Resize screen buffers if necessary.
+            if (camera_state.screensize != Vector2i(width, height)) {
+                camera_state.accumulation_buffer.resize(width * height);
+                camera_state.screensize = Vector2i(width, height);
+                camera_state.accumulations = 0u;
+            }
+
+            // Check if the camera transforms changed and, if so, reset accumulation.
+            Matrix4x4f inverse_view_projection_matrix = Cameras::get_inverse_view_projection_matrix(camera_ID);
+            if (camera_state.inverse_view_projection_matrix != inverse_view_projection_matrix) {
+                camera_state.inverse_view_projection_matrix = inverse_view_projection_matrix;
+                camera_state.accumulations = 0u;
+            }
+        }
+
+        // Gather the light sources of the camera's scene. The environment light is appended if it can be sampled.
+        SceneRoots::UID scene_ID = Cameras::get_scene_ID(camera_ID);
+        EnvironmentLight environment = { nullptr, RGB::black() };
+        if (scene_ID < environments.size())
+            environment = environments[scene_ID];
+        std::vector<Light> scene_lights = lights;
+        if (environment.map != nullptr) {
+            Light light;
+            light.type = Light::Type::Environment;
+            light.environment = environment;
+            scene_lights.push_back(light);
+        }
+        const Light* const scene_lights_ptr = scene_lights.data();
+        const int light_count = int(scene_lights.size());
+
+        const Vector3f camera_position = Cameras::get_transform(camera_ID).translation;
+        const Matrix4x4f inverse_view_projection_matrix = camera_state.inverse_view_projection_matrix;
+        const unsigned int accumulations = camera_state.accumulations;
+        RGB* const accumulation_buffer = camera_state.accumulation_buffer.data();
+
+        const int tile_count_x = (width + tile_size - 1) / tile_size;
+        const int tile_count = tile_count_x * ((height + tile_size - 1) / tile_size);
+
+        if (tracing_mode == TracingMode::Recursive) {
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (int t = 0; t < tile_count; ++t) {
+                int tile_x = (t % tile_count_x) * tile_size;
+                int tile_y = (t / tile_count_x) * tile_size;
+                int tile_end_x = min(tile_x + tile_size, width);
+                int tile_end_y = min(tile_y + tile_size, height);
+                for (int y = tile_y; y < tile_end_y; ++y)
+                    for (int x = tile_x; x < tile_end_x; ++x) {
+                        PathState path = create_camera_path(x, y, width, height, accumulations, camera_position, inverse_view_projection_matrix);
+                        RGB radiance = path_trace(path, scene_lights_ptr, light_count, environment);
+
+                        int pixel_index = path.pixel_index;
+                        RGB accumulated_radiance = lerp(accumulation_buffer[pixel_index], radiance, 1.0f / (accumulations + 1.0f));
+                        accumulation_buffer[pixel_index] = accumulated_radiance;
+                        output[pixel_index] = RGBA(accumulated_radiance, 1.0f);
+                    }
+            }
+        } else {
+            const int pixel_count = width * height;
+            std::vector<PathState> paths(pixel_count);
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < pixel_count; ++i)
+                paths[i] = create_camera_path(i % width, i / width, width, height, accumulations, camera_position, inverse_view_projection_matrix);
+
+            std::vector<RGB> radiance_buffer(pixel_count, RGB::black());
+            wavefront_path_trace(paths, scene_lights_ptr, light_count, environment, radiance_buffer.data());
+
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < pixel_count; ++i) {
+                RGB accumulated_radiance = lerp(accumulation_buffer[i], radiance_buffer[i], 1.0f / (accumulations + 1.0f));
+                accumulation_buffer[i] = accumulated_radiance;
+                output[i] = RGBA(accumulated_radiance, 1.0f);
+            }
+        }
+
+        return ++camera_state.accumulations;
+    }
+};
+
+// ------------------------------------------------------------------------------------------------
+// Renderer
+// ------------------------------------------------------------------------------------------------
+
+Renderer* Renderer::initialize() {
+    return new Renderer();
+}
+
+Renderer::Renderer() {
+    m_renderer_ID = Renderers::create("CPURenderer");
+    m_impl = new Implementation(m_renderer_ID);
+}
+
+Renderer::~Renderer() {
+    Renderers::destroy(m_renderer_ID);
+    delete m_impl;
+}
+
+float Renderer::get_scene_epsilon() const {
+    return m_impl->scene_epsilon;
+}
+
+void Renderer::set_scene_epsilon(float scene_epsilon) {
+    m_impl->scene_epsilon = scene_epsilon;
+    for (auto& camera_state : m_impl->per_camera_state)
+        camera_state.accumulations = 0u;
+}
+
+unsigned int Renderer::get_max_bounce_count() const {
+    return m_impl->max_bounce_count;
+}
+
+void Renderer::set_max_bounce_count(unsigned int bounce_count) {
+    m_impl->max_bounce_count = bounce_count;
+    for (auto& camera_state : m_impl->per_camera_state)
+        camera_state.accumulations = 0u;
+}
+
+Renderer::TracingMode Renderer::get_tracing_mode() const {
+    return m_impl->tracing_mode;
+}
+
+void Renderer::set_tracing_mode(TracingMode tracing_mode) {
+    m_impl->tracing_mode = tracing_mode;
+}
+
+void Renderer::handle_updates() {
+    m_impl->handle_updates();
+}
+
+unsigned int Renderer::render(Cameras::UID camera_ID, RGBA* output, int width, int height) {
+    return m_impl->render(camera_ID, output, width, height);
+}
+
+} // NS CPURenderer
@@ -0,0 +1,82 @@
+// CPU path tracing renderer.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _CPURENDERER_RENDERER_H_
+#define _CPURENDERER_RENDERER_H_
+
+#include <Cogwheel/Core/Renderer.h>
+#include <Cogwheel/Math/Color.h>
+#include <Cogwheel/Scene/Camera.h>
+
+namespace CPURenderer {
+
+//----------------------------------------------------------------------------
+// CPU path tracer.
+// Renders the cameras whose renderer ID matches the renderer's ID and keeps
+// its scene representation in sync with the meshes, models, scene nodes,
+// materials, textures, light sources and scene roots through their change
+// notifications, so handle_updates() must be called once pr tick before the
+// notifications are reset.
+// The shading and light sampling mirrors the OptiX renderer's path tracer,
+// i.e. the default shading model, sphere, directional and environment lights
+// with multiple importance sampling and progressive accumulation pr camera.
+// The image is split into tiles that are handed out dynamically to the
+// threads, so idle threads pick up the remaining work.
+// In wavefront mode all paths are instead advanced one bounce at a time.
+// The rays of a bounce are sorted by direction octant and origin Morton
+// code and traced as a stream, and the surface hits are shaded grouped by
+// material, which keeps the caches warm on incoherent bounces.
+// Future work
+// * Support for more than one scene pr renderer.
+// * Refit the BVHs of deforming meshes.
+// * Trace coherent primary rays as packets.
+//----------------------------------------------------------------------------
+class Renderer final {
+public:
+    enum class TracingMode : unsigned char {
+        Recursive, // Traces each pixel's path to completion.
+        Wavefront  // Traces all paths one bounce at a time.
+    };
+
+    static Renderer* initialize();
+    ~Renderer();
+
+    inline Cogwheel::Core::Renderers::UID get_ID() const { return m_renderer_ID; }
+
+    float get_scene_epsilon() const;
+    void set_scene_epsilon(float scene_epsilon);
+
+    unsigned int get_max_bounce_count() const;
+    void set_max_bounce_count(unsigned int bounce_count);
+
+    TracingMode get_tracing_mode() const;
+    void set_tracing_mode(TracingMode tracing_mode);
+
+    void handle_updates();
+
+    // Adds a sample pr pixel to the accumulated image of the camera and writes the accumulated image to the output.
+    // Returns the number of accumulated samples pr pixel, or 0 if the camera isn't rendered by this renderer.
+    unsigned int render(Cogwheel::Scene::Cameras::UID camera_ID, Cogwheel::Math::RGBA* output, int width, int height);
+
+private:
+
+    Renderer();
+
+    // Delete copy constructors to avoid having multiple versions of the same renderer.
+    Renderer(Renderer& other) = delete;
+    Renderer& operator=(const Renderer& rhs) = delete;
+
+    Cogwheel::Core::Renderers::UID m_renderer_ID;
+
+    struct Implementation;
+    Implementation* m_impl;
+};
+
+} // NS CPURenderer
+
+#endif // _CPURENDERER_RENDERER_H_
@@ -0,0 +1,98 @@
+// CPU renderer functions for the GGX microfacet BRDF.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _CPURENDERER_BSDFS_GGX_H_
+#define _CPURENDERER_BSDFS_GGX_H_
+
+#include <CPURenderer/Distributions.h>
+#include <CPURenderer/Types.h>
+
+namespace CPURenderer {
+namespace Shading {
+namespace BSDFs {
+
+//----------------------------------------------------------------------------
+// GGX BRDF, Walter et al 07, with the height correlated Smith masking and
+// shadowing term and sampling of the visible normals.
+// Sources:
+// * Understanding the Masking-Shadowing Function in Microfacet-Based BRDFs, Heitz 14.
+// * Importance Sampling Microfacet-Based BSDFs with the Distribution of Visible Normals, Heitz 14.
+//----------------------------------------------------------------------------
+namespace GGX {
+
+using namespace Cogwheel::Math;
+
+inline float alpha_from_roughness(float roughness) {
+    return fmaxf(0.00000000001f, roughness * roughness);
+}
+
+inline RGB schlick_fresnel(RGB incident_specular, float abs_cos_theta) {
+    float t = 1.0f - abs_cos_theta;
+    float t2 = t * t;
+    t = t2 * t2 * t;
+    return incident_specular * (1.0f - t) + t;
+}
+
+// Height correlated smith geometric term. Equation 99 in Heitz 14.
+inline float height_correlated_smith_G(float alpha, Vector3f wo, Vector3f wi) {
+    return 1.0f / (1.0f + Distributions::VNDF_GGX::lambda(alpha, wo.z) + Distributions::VNDF_GGX::lambda(alpha, wi.z));
+}
+
+inline RGB evaluate(float alpha, RGB specularity, Vector3f wo, Vector3f wi) {
+    Vector3f halfway = normalize(wo + wi);
+    float G = height_correlated_smith_G(alpha, wo, wi);
+    float D = Cogwheel::Math::Distributions::GGX::D(alpha, halfway.z);
+    RGB F = schlick_fresnel(specularity, dot(wo, halfway));
+    return F * (D * G / (4.0f * wo.z * wi.z));
+}
+
+inline float PDF(float alpha, Vector3f wo, Vector3f halfway) {
+    return Distributions::VNDF_GGX::PDF(alpha, wo, halfway) / (4.0f * dot(wo, halfway));
+}
+
+inline BSDFResponse evaluate_with_PDF(float alpha, RGB specularity, Vector3f wo, Vector3f wi, Vector3f halfway) {
+    float lambda_wo = Distributions::VNDF_GGX::lambda(alpha, wo.z);
+    float lambda_wi = Distributions::VNDF_GGX::lambda(alpha, wi.z);
+
+    float D_over_4 = Cogwheel::Math::Distributions::GGX::D(alpha, halfway.z) / 4.0f;
+
+    RGB F = schlick_fresnel(specularity, dot(wo, halfway));
+
+    float recip_G2 = 1.0f + lambda_wo + lambda_wi; // reciprocal height_correlated_smith_G
+
+    BSDFResponse res;
+    res.weight = F * (D_over_4 / (recip_G2 * wo.z * wi.z));
+    float recip_G1 = 1.0f + lambda_wo;
+    res.PDF = D_over_4 / (recip_G1 * wo.z);
+    return res;
+}
+
+inline BSDFResponse evaluate_with_PDF(float alpha, RGB specularity, Vector3f wo, Vector3f wi) {
+    return evaluate_with_PDF(alpha, specularity, wo, wi, normalize(wo + wi));
+}
+
+inline BSDFSample sample(float alpha, RGB specularity, Vector3f wo, Vector2f random_sample) {
+    BSDFSample bsdf_sample;
+
+    Vector3f halfway = Distributions::VNDF_GGX::sample_halfway(alpha, wo, random_sample);
+    bsdf_sample.direction = reflect(-wo, halfway);
+
+    BSDFResponse response = evaluate_with_PDF(alpha, specularity, wo, bsdf_sample.direction, halfway);
+    bsdf_sample.PDF = response.PDF;
+    bsdf_sample.weight = response.weight;
+
+    bool discard_sample = bsdf_sample.PDF < 0.00001f || bsdf_sample.direction.z < 0.00001f; // Discard samples if the pdf is too low (precision issues) or if the new direction points into the surface (energy loss).
+    return discard_sample ? BSDFSample::none() : bsdf_sample;
+}
+
+} // NS GGX
+} // NS BSDFs
+} // NS Shading
+} // NS CPURenderer
+
+#endif // _CPURENDERER_BSDFS_GGX_H_
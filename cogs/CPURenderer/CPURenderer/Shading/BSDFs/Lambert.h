@@ -0,0 +1,51 @@
+// CPU renderer functions for the Lambert BSDF.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _CPURENDERER_BSDFS_LAMBERT_H_
+#define _CPURENDERER_BSDFS_LAMBERT_H_
+
+#include <CPURenderer/Distributions.h>
+#include <CPURenderer/Types.h>
+
+namespace CPURenderer {
+namespace Shading {
+namespace BSDFs {
+namespace Lambert {
+
+using namespace Cogwheel::Math;
+
+inline RGB evaluate(RGB tint) {
+    return tint / PI<float>();
+}
+
+inline float PDF(Vector3f wo, Vector3f wi) {
+    return Distributions::Cosine::PDF(wi.z);
+}
+
+inline BSDFResponse evaluate_with_PDF(RGB tint, Vector3f wo, Vector3f wi) {
+    BSDFResponse response;
+    response.weight = evaluate(tint);
+    response.PDF = PDF(wo, wi);
+    return response;
+}
+
+inline BSDFSample sample(RGB tint, Vector2f random_sample) {
+    Distributions::DirectionalSample cosine_sample = Distributions::Cosine::sample(random_sample);
+    BSDFSample bsdf_sample;
+    bsdf_sample.direction = cosine_sample.direction;
+    bsdf_sample.PDF = cosine_sample.PDF;
+    bsdf_sample.weight = evaluate(tint);
+    return bsdf_sample;
+}
+
+} // NS Lambert
+} // NS BSDFs
+} // NS Shading
+} // NS CPURenderer
+
+#endif // _CPURENDERER_BSDFS_LAMBERT_H_
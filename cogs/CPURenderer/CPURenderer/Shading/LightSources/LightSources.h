@@ -0,0 +1,164 @@
+// CPU renderer light source sampling and evaluation.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _CPURENDERER_LIGHT_SOURCES_H_
+#define _CPURENDERER_LIGHT_SOURCES_H_
+
+#include <CPURenderer/Distributions.h>
+#include <CPURenderer/Types.h>
+
+#include <Cogwheel/Math/TBN.h>
+
+namespace CPURenderer {
+namespace LightSources {
+
+using namespace Cogwheel::Math;
+
+// Intersection of ray and sphere.
+// Returns the distance to the sphere or negative if no hit.
+inline float ray_sphere(Vector3f ray_origin, Vector3f ray_direction, Vector3f sphere_center, float sphere_radius) {
+    Vector3f direction_to_sphere = ray_origin - sphere_center;
+    float b = dot(direction_to_sphere, ray_direction);
+    float c = dot(direction_to_sphere, direction_to_sphere) - sphere_radius * sphere_radius;
+    float disc = b * b - c;
+    if (disc > 0.0f)
+        return -b - sqrtf(disc);
+    else
+        return -1e30f;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Sphere light.
+// ------------------------------------------------------------------------------------------------
+
+inline float surface_area(const SphereLight& light) {
+    return 4.0f * PI<float>() * light.radius * light.radius;
+}
+
+// Returns true if the sphere light should be interpreted as a delta light / point light.
+inline bool is_delta_light(const SphereLight& light, Vector3f position) {
+    Vector3f vector_to_light = light.position - position;
+    float sin_theta_squared = light.radius * light.radius / dot(vector_to_light, vector_to_light);
+    return sin_theta_squared <= 0.0f;
+}
+
+inline LightSample sample_radiance(const SphereLight& light, Vector3f position, Vector2f random_sample) {
+    // Sample Sphere light by sampling a cone with the angle subtended by the sphere.
+    Vector3f vector_to_light = light.position - position;
+
+    float sin_theta_squared = light.radius * light.radius / dot(vector_to_light, vector_to_light);
+
+    LightSample light_sample;
+    if (sin_theta_squared <= 0.0f) {
+        // If the subtended angle is too small, then sampling produces NaN's, so just fall back to a point light.
+        light_sample.distance = magnitude(vector_to_light);
+        light_sample.direction_to_light = vector_to_light / light_sample.distance;
+        light_sample.radiance = light.power / (4.0f * PI<float>() * light_sample.distance * light_sample.distance);
+        light_sample.distance -= 1.1f * light.radius; // Reduce distance by slightly more than the radius to avoid self intersections.
+        light_sample.PDF = 1.0f;
+    } else {
+        // Sample the cone and project the sample onto the sphere.
+        float cos_theta = sqrtf(fmaxf(1.0f - sin_theta_squared, 0.0f));
+
+        Distributions::DirectionalSample cone_sample = Distributions::Cone::sample(cos_theta, random_sample);
+
+        const TBN tbn = TBN(normalize(vector_to_light));
+        light_sample.direction_to_light = cone_sample.direction * tbn;
+        light_sample.PDF = cone_sample.PDF;
+        light_sample.distance = ray_sphere(position, light_sample.direction_to_light, light.position, light.radius);
+        if (light_sample.distance <= 0.0f)
+            // The ray missed the sphere, but since it was sampled to be inside the sphere, just assume that it hit at a grazing angle.
+            light_sample.distance = dot(vector_to_light, light_sample.direction_to_light);
+
+        light_sample.radiance = light.power / (PI<float>() * surface_area(light));
+    }
+
+    return light_sample;
+}
+
+inline float PDF(const SphereLight& light, Vector3f lit_position, Vector3f direction_to_light) {
+    Vector3f vector_to_light_center = light.position - lit_position;
+
+    float sin_theta_squared = light.radius * light.radius / dot(vector_to_light_center, vector_to_light_center);
+    if (sin_theta_squared <= 0.0f)
+        return 0.0f;
+
+    float cos_theta_max = sqrtf(fmaxf(1.0f - sin_theta_squared, 0.0f));
+    float cos_theta = dot(direction_to_light, normalize(vector_to_light_center));
+    return cos_theta >= cos_theta_max ? Distributions::Cone::PDF(cos_theta_max) : 0.0f;
+}
+
+inline RGB evaluate(const SphereLight& light, Vector3f position) {
+    float divisor = is_delta_light(light, position) ? (4.0f * PI<float>()) : (PI<float>() * surface_area(light));
+    return light.power / divisor;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Directional light.
+// ------------------------------------------------------------------------------------------------
+
+inline LightSample sample_radiance(const DirectionalLight& light) {
+    LightSample sample;
+    sample.radiance = light.radiance;
+    sample.PDF = 1.0f;
+    sample.direction_to_light = -light.direction;
+    sample.distance = 1e30f;
+    return sample;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Environment light.
+// ------------------------------------------------------------------------------------------------
+
+inline LightSample sample_radiance(const EnvironmentLight& light, Vector2f random_sample) {
+    LightSample sample = light.map->sample(random_sample);
+    sample.radiance *= light.tint;
+    return sample;
+}
+
+inline float PDF(const EnvironmentLight& light, Vector3f direction_to_light) {
+    return light.map->PDF(direction_to_light);
+}
+
+inline RGB evaluate(const EnvironmentLight& light, Vector3f direction_to_light) {
+    return light.map->evaluate(direction_to_light) * light.tint;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Functions with generalized parameters.
+// ------------------------------------------------------------------------------------------------
+
+inline bool is_delta_light(const Light& light, Vector3f position) {
+    switch (light.type) {
+    case Light::Type::Sphere:
+        return is_delta_light(light.sphere, position);
+    case Light::Type::Directional:
+        return true;
+    case Light::Type::Environment:
+        return false;
+    }
+    return false;
+}
+
+inline LightSample sample_radiance(const Light& light, Vector3f position, Vector2f random_sample) {
+    switch (light.type) {
+    case Light::Type::Sphere:
+        return sample_radiance(light.sphere, position, random_sample);
+    case Light::Type::Directional:
+        return sample_radiance(light.directional);
+    case Light::Type::Environment:
+        return sample_radiance(light.environment, random_sample);
+    }
+    LightSample none = { RGB::black(), 0.0f, Vector3f::zero(), 0.0f };
+    return none;
+}
+
+} // NS LightSources
+} // NS CPURenderer
+
+#endif // _CPURENDERER_LIGHT_SOURCES_H_
@@ -0,0 +1,182 @@
+// CPU renderer default shading model.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _CPURENDERER_SHADING_MODEL_DEFAULT_SHADING_H_
+#define _CPURENDERER_SHADING_MODEL_DEFAULT_SHADING_H_
+
+#include <CPURenderer/Shading/BSDFs/GGX.h>
+#include <CPURenderer/Shading/BSDFs/Lambert.h>
+
+#include <Cogwheel/Assets/Shading/Fittings.h>
+#include <Cogwheel/Assets/Texture.h>
+
+namespace CPURenderer {
+namespace Shading {
+namespace ShadingModels {
+
+// ---------------------------------------------------------------------------
+// The default shading material.
+// Default shading consist of a diffuse base with a specular layer on top.
+// The diffuse tint is weighted by contribution, or rho, of the specular term.
+// Mirrors OptiXRenderer's DefaultShading, so both renderers converge to the
+// same image. The GPU's rho texture is replaced by Cogwheel's rho fittings.
+// ---------------------------------------------------------------------------
+class DefaultShading {
+private:
+    Cogwheel::Math::RGB m_diffuse_tint;
+    float m_roughness;
+    Cogwheel::Math::RGB m_specularity;
+
+    static inline Cogwheel::Math::RGB compute_specular_rho(Cogwheel::Math::RGB specularity, float abs_cos_theta, float roughness) {
+        using namespace Cogwheel::Math;
+        float base_specular_rho = Cogwheel::Assets::Shading::Rho::sample_GGX_with_fresnel(abs_cos_theta, roughness);
+        float full_specular_rho = Cogwheel::Assets::Shading::Rho::sample_GGX(abs_cos_theta, roughness);
+        return RGB(lerp(base_specular_rho, full_specular_rho, specularity.r),
+                   lerp(base_specular_rho, full_specular_rho, specularity.g),
+                   lerp(base_specular_rho, full_specular_rho, specularity.b));
+    }
+
+    static inline float compute_specular_probability(Cogwheel::Math::RGB diffuse_rho, Cogwheel::Math::RGB specular_rho) {
+        float diffuse_weight = diffuse_rho.r + diffuse_rho.g + diffuse_rho.b;
+        float specular_weight = specular_rho.r + specular_rho.g + specular_rho.b;
+        return specular_weight / (diffuse_weight + specular_weight);
+    }
+
+public:
+
+    DefaultShading(const Material& material, float abs_cos_theta, Cogwheel::Math::Vector2f texcoord)
+        : m_roughness(material.roughness) {
+        using namespace Cogwheel::Math;
+
+        float metallic = material.metallic;
+        float dielectric_specularity = material.specularity * 0.08f; // See Physically-Based Shading at Disney bottom of page 8.
+
+        RGB tint = material.tint;
+        if (material.tint_texture_ID != Cogwheel::Assets::Textures::UID::invalid_UID())
+            tint *= Cogwheel::Assets::sample2D(material.tint_texture_ID, texcoord).rgb();
+
+        m_specularity = lerp(RGB(dielectric_specularity), tint, metallic);
+        RGB specular_rho = compute_specular_rho(m_specularity, abs_cos_theta, m_roughness);
+        m_diffuse_tint = tint * (RGB::white() - specular_rho);
+        m_diffuse_tint *= 1.0f - 0.5f * metallic; // Remove diffuse strength on metals. Ideally metals would be 100 specular, but GGX does not model multiple bounces, so we fake it by using the diffuse BRDF.
+    }
+
+    static inline float coverage(const Material& material, Cogwheel::Math::Vector2f texcoord) {
+        float coverage = material.coverage;
+        if (material.coverage_texture_ID != Cogwheel::Assets::Textures::UID::invalid_UID())
+            coverage *= Cogwheel::Assets::sample2D(material.coverage_texture_ID, texcoord).r;
+        return coverage;
+    }
+
+    Cogwheel::Math::RGB evaluate(Cogwheel::Math::Vector3f wo, Cogwheel::Math::Vector3f wi) const {
+        using namespace Cogwheel::Math;
+
+        bool is_same_hemisphere = wi.z * wo.z >= 0.00000001f;
+        if (!is_same_hemisphere)
+            return RGB::black();
+
+        // Flip directions if on the backside of the material.
+        if (wo.z < 0.0f) {
+            wi.z = -wi.z;
+            wo.z = -wo.z;
+        }
+
+        float ggx_alpha = BSDFs::GGX::alpha_from_roughness(m_roughness);
+        RGB specular = BSDFs::GGX::evaluate(ggx_alpha, m_specularity, wo, wi);
+        RGB diffuse = BSDFs::Lambert::evaluate(m_diffuse_tint);
+        return diffuse + specular;
+    }
+
+    float PDF(Cogwheel::Math::Vector3f wo, Cogwheel::Math::Vector3f wi) const {
+        using namespace Cogwheel::Math;
+
+        float abs_cos_theta = fabsf(wo.z);
+        RGB specular_rho = compute_specular_rho(m_specularity, abs_cos_theta, m_roughness);
+        float specular_probability = compute_specular_probability(m_diffuse_tint, specular_rho);
+
+        // Merge PDFs based on the specular probability.
+        float diffuse_PDF = BSDFs::Lambert::PDF(wo, wi);
+        float ggx_alpha = BSDFs::GGX::alpha_from_roughness(m_roughness);
+        float specular_PDF = BSDFs::GGX::PDF(ggx_alpha, wo, normalize(wo + wi));
+        return lerp(diffuse_PDF, specular_PDF, specular_probability);
+    }
+
+    BSDFResponse evaluate_with_PDF(Cogwheel::Math::Vector3f wo, Cogwheel::Math::Vector3f wi) const {
+        using namespace Cogwheel::Math;
+
+        bool is_same_hemisphere = wi.z * wo.z >= 0.00000001f;
+        if (!is_same_hemisphere)
+            return BSDFResponse::none();
+
+        // Flip directions if on the backside of the material.
+        if (wo.z < 0.0f) {
+            wi.z = -wi.z;
+            wo.z = -wo.z;
+        }
+
+        const float ggx_alpha = BSDFs::GGX::alpha_from_roughness(m_roughness);
+        BSDFResponse specular_eval = BSDFs::GGX::evaluate_with_PDF(ggx_alpha, m_specularity, wo, wi);
+        BSDFResponse diffuse_eval = BSDFs::Lambert::evaluate_with_PDF(m_diffuse_tint, wo, wi);
+
+        BSDFResponse res;
+        res.weight = diffuse_eval.weight + specular_eval.weight;
+
+        RGB specular_rho = compute_specular_rho(m_specularity, wo.z, m_roughness);
+        const float specular_probability = compute_specular_probability(m_diffuse_tint, specular_rho);
+        res.PDF = lerp(diffuse_eval.PDF, specular_eval.PDF, specular_probability);
+
+        return res;
+    }
+
+    // Samples either the diffuse or the specular layer and evaluates the contribution of the other layer in the sampled direction.
+    BSDFSample sample_all(Cogwheel::Math::Vector3f wo, Cogwheel::Math::Vector3f random_sample) const {
+        using namespace Cogwheel::Math;
+
+        // Sample BSDFs based on the contribution of each BRDF.
+        float abs_cos_theta = fabsf(wo.z);
+        RGB specular_rho = compute_specular_rho(m_specularity, abs_cos_theta, m_roughness);
+        float specular_probability = compute_specular_probability(m_diffuse_tint, specular_rho);
+        bool sample_specular = random_sample.z < specular_probability;
+
+        const float ggx_alpha = BSDFs::GGX::alpha_from_roughness(m_roughness);
+        Vector2f random_sample_2D = Vector2f(random_sample.x, random_sample.y);
+
+        BSDFSample bsdf_sample;
+        if (sample_specular) {
+            bsdf_sample = BSDFs::GGX::sample(ggx_alpha, m_specularity, wo, random_sample_2D);
+            bsdf_sample.PDF *= specular_probability;
+
+            // Evaluate diffuse layer as well.
+            BSDFResponse diffuse_response = BSDFs::Lambert::evaluate_with_PDF(m_diffuse_tint, wo, bsdf_sample.direction);
+            bsdf_sample.weight += diffuse_response.weight;
+            bsdf_sample.PDF += (1.0f - specular_probability) * diffuse_response.PDF;
+        } else {
+            bsdf_sample = BSDFs::Lambert::sample(m_diffuse_tint, random_sample_2D);
+            bsdf_sample.PDF *= (1.0f - specular_probability);
+
+            // Evaluate specular layer as well.
+            BSDFResponse glossy_response = BSDFs::GGX::evaluate_with_PDF(ggx_alpha, m_specularity, wo, bsdf_sample.direction);
+            bsdf_sample.weight += glossy_response.weight;
+            bsdf_sample.PDF += specular_probability * glossy_response.PDF;
+        }
+
+        return bsdf_sample;
+    }
+
+    // Estimate the directional-hemispherical reflectance function.
+    Cogwheel::Math::RGB rho(float abs_cos_theta) const {
+        Cogwheel::Math::RGB specular_rho = compute_specular_rho(m_specularity, abs_cos_theta, m_roughness);
+        return m_diffuse_tint + specular_rho;
+    }
+};
+
+} // NS ShadingModels
+} // NS Shading
+} // NS CPURenderer
+
+#endif // _CPURENDERER_SHADING_MODEL_DEFAULT_SHADING_H_
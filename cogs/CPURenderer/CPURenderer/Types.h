@@ -0,0 +1,96 @@
+// CPU renderer types.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _CPURENDERER_TYPES_H_
+#define _CPURENDERER_TYPES_H_
+
+#include <Cogwheel/Assets/InfiniteAreaLight.h>
+#include <Cogwheel/Assets/Texture.h>
+#include <Cogwheel/Math/Color.h>
+#include <Cogwheel/Math/Vector.h>
+
+namespace CPURenderer {
+
+using Cogwheel::Assets::LightSample;
+
+//----------------------------------------------------------------------------
+// Material parameters of the default shading model.
+//----------------------------------------------------------------------------
+struct Material final {
+    Cogwheel::Math::RGB tint;
+    Cogwheel::Assets::Textures::UID tint_texture_ID;
+    float roughness;
+    float specularity;
+    float metallic;
+    float coverage;
+    Cogwheel::Assets::Textures::UID coverage_texture_ID;
+};
+
+//----------------------------------------------------------------------------
+// BSDF response and samples.
+//----------------------------------------------------------------------------
+struct BSDFResponse final {
+    Cogwheel::Math::RGB weight;
+    float PDF;
+
+    static inline BSDFResponse none() {
+        BSDFResponse response = { Cogwheel::Math::RGB::black(), 0.0f };
+        return response;
+    }
+};
+
+struct BSDFSample final {
+    Cogwheel::Math::RGB weight;
+    float PDF;
+    Cogwheel::Math::Vector3f direction;
+
+    static inline BSDFSample none() {
+        BSDFSample sample = { Cogwheel::Math::RGB::black(), 0.0f, Cogwheel::Math::Vector3f::zero() };
+        return sample;
+    }
+};
+
+inline bool is_PDF_valid(float PDF) {
+    return PDF > 0.000001f;
+}
+
+//----------------------------------------------------------------------------
+// Light sources.
+// The environment light is not stored as a light, but is appended to the
+// light sources by the renderer if the scene has an environment map.
+//----------------------------------------------------------------------------
+struct SphereLight final {
+    Cogwheel::Math::Vector3f position;
+    Cogwheel::Math::RGB power;
+    float radius;
+};
+
+struct DirectionalLight final {
+    Cogwheel::Math::Vector3f direction;
+    Cogwheel::Math::RGB radiance;
+};
+
+struct EnvironmentLight final {
+    const Cogwheel::Assets::InfiniteAreaLight* map;
+    Cogwheel::Math::RGB tint;
+};
+
+struct Light final {
+    enum class Type : unsigned char { Sphere, Directional, Environment };
+
+    Type type;
+    union {
+        SphereLight sphere;
+        DirectionalLight directional;
+        EnvironmentLight environment;
+    };
+};
+
+} // NS CPURenderer
+
+#endif // _CPURENDERER_TYPES_H_
@@ -7,9 +7,15 @@
 // ---------------------------------------------------------------------------
 
 #include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Math/Conversions.h>
+#include <Cogwheel/Math/Utils.h>
 
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <cmath>
+#include <memory>
+#include <vector>
 
 using namespace Cogwheel::Math;
 
@@ -20,6 +26,8 @@ Meshes::UIDGenerator Meshes::m_UID_generator = UIDGenerator(0u);
 std::string* Meshes::m_names = nullptr;
 Meshes::Buffers* Meshes::m_buffers = nullptr;
 AABB* Meshes::m_bounds = nullptr;
+std::vector<Meshes::LOD>* Meshes::m_LODs = nullptr;
+Meshes::DirtyRanges* Meshes::m_dirty_ranges = nullptr;
 
 Core::ChangeSet<Meshes::Changes, Meshes::UID> Meshes::m_changes;
 
@@ -33,6 +41,8 @@ void Meshes::allocate(unsigned int capacity) {
     m_names = new std::string[capacity];
     m_buffers = new Buffers[capacity];
     m_bounds = new AABB[capacity];
+    m_LODs = new std::vector<LOD>[capacity];
+    m_dirty_ranges = new DirtyRanges[capacity];
     m_changes = Core::ChangeSet<Changes, UID>(capacity);
 
     // Allocate dummy element at 0.
@@ -52,10 +62,13 @@ void Meshes::deallocate() {
         delete[] buffers.positions;
         delete[] buffers.normals;
         delete[] buffers.texcoords;
+        delete[] buffers.tangents;
     }
     delete[] m_names; m_names = nullptr;
     delete[] m_buffers; m_buffers = nullptr;
     delete[] m_bounds; m_bounds = nullptr;
+    delete[] m_LODs; m_LODs = nullptr;
+    delete[] m_dirty_ranges; m_dirty_ranges = nullptr;
     
     m_changes.resize(0);
 
@@ -74,11 +87,15 @@ void Meshes::reserve_mesh_data(unsigned int new_capacity, unsigned int old_capac
     assert(m_names != nullptr);
     assert(m_buffers != nullptr);
     assert(m_bounds != nullptr);
+    assert(m_LODs != nullptr);
+    assert(m_dirty_ranges != nullptr);
 
     const unsigned int copyable_elements = new_capacity < old_capacity ? new_capacity : old_capacity;
     m_names = resize_and_copy_array(m_names, new_capacity, copyable_elements);
     m_buffers = resize_and_copy_array(m_buffers, new_capacity, copyable_elements);
     m_bounds = resize_and_copy_array(m_bounds, new_capacity, copyable_elements);
+    m_LODs = resize_and_copy_array(m_LODs, new_capacity, copyable_elements);
+    m_dirty_ranges = resize_and_copy_array(m_dirty_ranges, new_capacity, copyable_elements);
     m_changes.resize(new_capacity);
 }
 
@@ -106,7 +123,10 @@ Meshes::UID Meshes::create(const std::string& name, unsigned int primitive_count
     m_buffers[id].positions = (buffer_bitmask & MeshFlag::Position) ? new Math::Vector3f[vertex_count] : nullptr;
     m_buffers[id].normals = (buffer_bitmask & MeshFlag::Normal) ? new Math::Vector3f[vertex_count] : nullptr;
     m_buffers[id].texcoords = (buffer_bitmask & MeshFlag::Texcoord) ? new Math::Vector2f[vertex_count] : nullptr;
+    m_buffers[id].tangents = (buffer_bitmask & MeshFlag::Tangent) ? new Math::Vector4f[vertex_count] : nullptr;
     m_bounds[id] = AABB::invalid();
+    m_LODs[id].clear();
+    m_dirty_ranges[id] = {};
     m_changes.set_change(id, Change::Created);
 
     return id;
@@ -120,8 +140,13 @@ void Meshes::destroy(Meshes::UID mesh_ID) {
         delete[] buffers.positions;
         delete[] buffers.normals;
         delete[] buffers.texcoords;
+        delete[] buffers.tangents;
 
         m_changes.set_change(mesh_ID, Change::Destroyed);
+
+        for (LOD lod : m_LODs[mesh_ID])
+            destroy(lod.mesh_ID);
+        m_LODs[mesh_ID].clear();
     }
 }
 
@@ -136,70 +161,238 @@ AABB Meshes::compute_bounds(Meshes::UID mesh_ID) {
     return bounds;
 }
 
+void Meshes::reset_change_notifications() {
+    for (UID mesh_ID : m_changes.get_changed_resources())
+        m_dirty_ranges[mesh_ID] = {};
+    m_changes.reset_change_notifications();
+}
+
+static inline int dirty_range_index(Meshes::Change buffer_update) {
+    switch (buffer_update) {
+    case Meshes::Change::IndicesUpdated: return 0;
+    case Meshes::Change::PositionsUpdated: return 1;
+    case Meshes::Change::NormalsUpdated: return 2;
+    case Meshes::Change::TexcoordsUpdated: return 3;
+    case Meshes::Change::TangentsUpdated: return 4;
+    default: return -1;
+    }
+}
+
+void Meshes::flag_as_updated(Meshes::UID mesh_ID, Change buffer_update, unsigned int begin, unsigned int end) {
+    if (end <= begin)
+        return;
+
+    DirtyRange& range = m_dirty_ranges[mesh_ID].buffers[dirty_range_index(buffer_update)];
+    if (range.is_empty())
+        range = { begin, end };
+    else
+        range = { std::min(range.begin, begin), std::max(range.end, end) };
+    m_changes.add_change(mesh_ID, buffer_update);
+}
+
+Vector3ui* Meshes::map_primitives(Meshes::UID mesh_ID, unsigned int first_primitive, unsigned int primitive_count) {
+    unsigned int end = std::min(first_primitive + primitive_count, get_primitive_count(mesh_ID));
+    flag_as_updated(mesh_ID, Change::IndicesUpdated, first_primitive, end);
+    return m_buffers[mesh_ID].primitives;
+}
+
+Vector3f* Meshes::map_positions(Meshes::UID mesh_ID, unsigned int first_vertex, unsigned int vertex_count) {
+    assert(m_buffers[mesh_ID].positions != nullptr);
+    unsigned int end = std::min(first_vertex + vertex_count, get_vertex_count(mesh_ID));
+    flag_as_updated(mesh_ID, Change::PositionsUpdated, first_vertex, end);
+    return m_buffers[mesh_ID].positions;
+}
+
+Vector3f* Meshes::map_normals(Meshes::UID mesh_ID, unsigned int first_vertex, unsigned int vertex_count) {
+    assert(m_buffers[mesh_ID].normals != nullptr);
+    unsigned int end = std::min(first_vertex + vertex_count, get_vertex_count(mesh_ID));
+    flag_as_updated(mesh_ID, Change::NormalsUpdated, first_vertex, end);
+    return m_buffers[mesh_ID].normals;
+}
+
+Vector2f* Meshes::map_texcoords(Meshes::UID mesh_ID, unsigned int first_vertex, unsigned int vertex_count) {
+    assert(m_buffers[mesh_ID].texcoords != nullptr);
+    unsigned int end = std::min(first_vertex + vertex_count, get_vertex_count(mesh_ID));
+    flag_as_updated(mesh_ID, Change::TexcoordsUpdated, first_vertex, end);
+    return m_buffers[mesh_ID].texcoords;
+}
+
+Vector4f* Meshes::map_tangents(Meshes::UID mesh_ID, unsigned int first_vertex, unsigned int vertex_count) {
+    assert(m_buffers[mesh_ID].tangents != nullptr);
+    unsigned int end = std::min(first_vertex + vertex_count, get_vertex_count(mesh_ID));
+    flag_as_updated(mesh_ID, Change::TangentsUpdated, first_vertex, end);
+    return m_buffers[mesh_ID].tangents;
+}
+
+Meshes::DirtyRange Meshes::get_dirty_range(Meshes::UID mesh_ID, Change buffer_update) {
+    int index = dirty_range_index(buffer_update);
+    if (index < 0) {
+        DirtyRange empty_range = {};
+        return empty_range;
+    }
+    return m_dirty_ranges[mesh_ID].buffers[index];
+}
+
+void Meshes::set_LODs(Meshes::UID mesh_ID, const std::vector<LOD>& LODs) {
+    for (LOD lod : m_LODs[mesh_ID]) {
+        bool is_reused = std::any_of(LODs.begin(), LODs.end(), [=](LOD new_lod) { return new_lod.mesh_ID == lod.mesh_ID; });
+        if (!is_reused)
+            destroy(lod.mesh_ID);
+    }
+    m_LODs[mesh_ID] = LODs;
+}
+
 //-----------------------------------------------------------------------------
 // Mesh utils.
 //-----------------------------------------------------------------------------
 
 namespace MeshUtils {
 
-Meshes::UID combine(const std::string& name,
-                    const TransformedMesh* const meshes_begin,
-                    const TransformedMesh* const meshes_end,
-                    MeshFlags flags) {
-
-    auto meshes = Core::Iterable<const TransformedMesh* const>(meshes_begin, meshes_end);
+// Transforms a batch of positions by a transform.
+// The transform is converted to a scaled rotation matrix up front, such that the inner loop
+// is a branchless multiply-add over the vertices, which the compiler can vectorize.
+static inline void transform_positions(Transform transform, const Vector3f* positions_begin, const Vector3f* positions_end, Vector3f* transformed_positions) {
+    const Matrix3x3f m = to_matrix3x3(transform.rotation) * transform.scale;
+    const Vector3f t = transform.translation;
+    const Vector3f row0 = m.get_row(0), row1 = m.get_row(1), row2 = m.get_row(2);
+    const int count = int(positions_end - positions_begin);
+    for (int i = 0; i < count; ++i) {
+        const Vector3f p = positions_begin[i];
+        transformed_positions[i] = Vector3f(row0.x * p.x + row0.y * p.y + row0.z * p.z + t.x,
+                                            row1.x * p.x + row1.y * p.y + row1.z * p.z + t.y,
+                                            row2.x * p.x + row2.y * p.y + row2.z * p.z + t.z);
+    }
+}
 
-    unsigned int primitive_count = 0u;
-    unsigned int vertex_count = 0u;
-    for (TransformedMesh transformed_mesh : meshes) {
-        Mesh mesh = transformed_mesh.mesh_ID;
-        primitive_count += mesh.get_primitive_count();
-        vertex_count += mesh.get_vertex_count();
+// Rotates a batch of normals by the rotation part of a transform.
+static inline void rotate_normals(Quaternionf rotation, const Vector3f* normals_begin, const Vector3f* normals_end, Vector3f* rotated_normals) {
+    const Matrix3x3f m = to_matrix3x3(rotation);
+    const Vector3f row0 = m.get_row(0), row1 = m.get_row(1), row2 = m.get_row(2);
+    const int count = int(normals_end - normals_begin);
+    for (int i = 0; i < count; ++i) {
+        const Vector3f n = normals_begin[i];
+        rotated_normals[i] = Vector3f(row0.x * n.x + row0.y * n.y + row0.z * n.z,
+                                      row1.x * n.x + row1.y * n.y + row1.z * n.z,
+                                      row2.x * n.x + row2.y * n.y + row2.z * n.z);
     }
+}
 
-    // Determine shared buffers.
-    for (TransformedMesh transformed_mesh : meshes) {
-        Mesh mesh = transformed_mesh.mesh_ID;
-        flags &= mesh.get_flags();
+// Rotates a batch of tangents by the rotation part of a transform. The handedness is left untouched.
+static inline void rotate_tangents(Quaternionf rotation, const Vector4f* tangents_begin, const Vector4f* tangents_end, Vector4f* rotated_tangents) {
+    const Matrix3x3f m = to_matrix3x3(rotation);
+    const Vector3f row0 = m.get_row(0), row1 = m.get_row(1), row2 = m.get_row(2);
+    const int count = int(tangents_end - tangents_begin);
+    for (int i = 0; i < count; ++i) {
+        const Vector4f t = tangents_begin[i];
+        rotated_tangents[i] = Vector4f(row0.x * t.x + row0.y * t.y + row0.z * t.z,
+                                       row1.x * t.x + row1.y * t.y + row1.z * t.z,
+                                       row2.x * t.x + row2.y * t.y + row2.z * t.z,
+                                       t.w);
     }
+}
 
-    Mesh merged_mesh = Mesh(Meshes::create(name, primitive_count, vertex_count, flags));
+Meshes::UID combine(const std::string& name,
+                    const TransformedMesh* const meshes_begin,
+                    const TransformedMesh* const meshes_end,
+                    MeshFlags flags) {
 
-    { // Always combine primitives.
-        Vector3ui* primitives = merged_mesh.get_primitives();
-        unsigned int primitive_offset = 0u;
-        for (TransformedMesh transformed_mesh : meshes) {
-            Mesh mesh = transformed_mesh.mesh_ID;
-            for (Vector3ui primitive : mesh.get_primitive_iterable())
-                *(primitives++) = primitive + primitive_offset;
-            primitive_offset += mesh.get_vertex_count();
-        }
+    const int mesh_count = int(meshes_end - meshes_begin);
+
+    // Compute the offsets of each mesh into the combined mesh by an exclusive prefix sum
+    // over the primitive and vertex counts and determine the shared buffers.
+    std::vector<unsigned int> primitive_offsets(mesh_count + 1);
+    std::vector<unsigned int> vertex_offsets(mesh_count + 1);
+    primitive_offsets[0] = vertex_offsets[0] = 0u;
+    for (int m = 0; m < mesh_count; ++m) {
+        Mesh mesh = meshes_begin[m].mesh_ID;
+        primitive_offsets[m + 1] = primitive_offsets[m] + mesh.get_primitive_count();
+        vertex_offsets[m + 1] = vertex_offsets[m] + mesh.get_vertex_count();
+        flags &= mesh.get_flags();
     }
 
-    if (flags & MeshFlag::Position) {
-        Vector3f* positions = merged_mesh.get_positions();
-        for (TransformedMesh transformed_mesh : meshes) {
-            Mesh mesh = transformed_mesh.mesh_ID;
-            for (Vector3f position : mesh.get_position_iterable())
-                *(positions++) = transformed_mesh.transform * position;
+    Mesh merged_mesh = Mesh(Meshes::create(name, primitive_offsets[mesh_count], vertex_offsets[mesh_count], flags));
+
+    // Split the meshes into chunks of primitives and vertices, so large meshes are distributed across all threads
+    // and not just a handful of small ones.
+    struct Chunk {
+        int mesh_index;
+        unsigned int begin, end;
+    };
+    const unsigned int chunk_size = 16384u;
+    auto create_chunks = [=](const std::vector<unsigned int>& offsets) -> std::vector<Chunk> {
+        std::vector<Chunk> chunks;
+        chunks.reserve(offsets[mesh_count] / chunk_size + mesh_count);
+        for (int m = 0; m < mesh_count; ++m) {
+            unsigned int element_count = offsets[m + 1] - offsets[m];
+            for (unsigned int begin = 0; begin < element_count; begin += chunk_size) {
+                Chunk chunk = { m, begin, min(begin + chunk_size, element_count) };
+                chunks.push_back(chunk);
+            }
         }
-    }
+        return chunks;
+    };
 
-    if (flags & MeshFlag::Normal) {
-        Vector3f* normals = merged_mesh.get_normals();
-        for (TransformedMesh transformed_mesh : meshes) {
-            Mesh mesh = transformed_mesh.mesh_ID;
-            for (Vector3f normal : mesh.get_normal_iterable())
-                *(normals++) = transformed_mesh.transform.rotation * normal;
+    { // Always combine primitives.
+        std::vector<Chunk> chunks = create_chunks(primitive_offsets);
+        Vector3ui* merged_primitives = merged_mesh.get_primitives();
+        #pragma omp parallel for schedule(dynamic, 4)
+        for (int c = 0; c < int(chunks.size()); ++c) {
+            Chunk chunk = chunks[c];
+            Mesh mesh = meshes_begin[chunk.mesh_index].mesh_ID;
+            const Vector3ui* primitives = mesh.get_primitives();
+            Vector3ui* merged_primitives_itr = merged_primitives + primitive_offsets[chunk.mesh_index];
+            unsigned int vertex_offset = vertex_offsets[chunk.mesh_index];
+            if (vertex_offset == 0u)
+                // The indices are local to the combined mesh as well and can be copied directly.
+                std::memcpy(merged_primitives_itr + chunk.begin, primitives + chunk.begin, sizeof(Vector3ui) * (chunk.end - chunk.begin));
+            else
+                for (unsigned int p = chunk.begin; p < chunk.end; ++p)
+                    merged_primitives_itr[p] = primitives[p] + vertex_offset;
         }
     }
 
-    if (flags & MeshFlag::Texcoord) {
-        Vector2f* texcoords = merged_mesh.get_texcoords();
-        for (TransformedMesh transformed_mesh : meshes) {
+    if (flags.any_set(MeshFlag::AllBuffers, MeshFlag::Tangent)) {
+        std::vector<Chunk> chunks = create_chunks(vertex_offsets);
+        Vector3f* merged_positions = merged_mesh.get_positions();
+        Vector3f* merged_normals = merged_mesh.get_normals();
+        Vector2f* merged_texcoords = merged_mesh.get_texcoords();
+        Vector4f* merged_tangents = merged_mesh.get_tangents();
+
+        #pragma omp parallel for schedule(dynamic, 4)
+        for (int c = 0; c < int(chunks.size()); ++c) {
+            Chunk chunk = chunks[c];
+            TransformedMesh transformed_mesh = meshes_begin[chunk.mesh_index];
             Mesh mesh = transformed_mesh.mesh_ID;
-            memcpy(texcoords, mesh.get_texcoords(), sizeof(Vector2f) * mesh.get_vertex_count());
-            texcoords += mesh.get_vertex_count();
+            unsigned int vertex_offset = vertex_offsets[chunk.mesh_index] + chunk.begin;
+            unsigned int vertex_count = chunk.end - chunk.begin;
+            bool is_identity = transformed_mesh.transform == Transform::identity();
+
+            if (flags & MeshFlag::Position) {
+                const Vector3f* positions = mesh.get_positions() + chunk.begin;
+                if (is_identity)
+                    std::memcpy(merged_positions + vertex_offset, positions, sizeof(Vector3f) * vertex_count);
+                else
+                    transform_positions(transformed_mesh.transform, positions, positions + vertex_count, merged_positions + vertex_offset);
+            }
+
+            if (flags & MeshFlag::Normal) {
+                const Vector3f* normals = mesh.get_normals() + chunk.begin;
+                if (is_identity)
+                    std::memcpy(merged_normals + vertex_offset, normals, sizeof(Vector3f) * vertex_count);
+                else
+                    rotate_normals(transformed_mesh.transform.rotation, normals, normals + vertex_count, merged_normals + vertex_offset);
+            }
+
+            if (flags & MeshFlag::Texcoord)
+                std::memcpy(merged_texcoords + vertex_offset, mesh.get_texcoords() + chunk.begin, sizeof(Vector2f) * vertex_count);
+
+            if (flags & MeshFlag::Tangent) {
+                const Vector4f* tangents = mesh.get_tangents() + chunk.begin;
+                if (is_identity)
+                    std::memcpy(merged_tangents + vertex_offset, tangents, sizeof(Vector4f) * vertex_count);
+                else
+                    rotate_tangents(transformed_mesh.transform.rotation, tangents, tangents + vertex_count, merged_tangents + vertex_offset);
+            }
         }
     }
 
@@ -221,31 +414,345 @@ void compute_hard_normals(Vector3f* positions_begin, Vector3f* positions_end, Ve
     }
 }
 
-void compute_normals(Vector3ui* primitives_begin, Vector3ui* primitives_end,
-                     Vector3f* normals_begin, Vector3f* normals_end, Vector3f* positions_begin) {
-    std::fill(normals_begin, normals_end, Vector3f::zero());
+VertexAdjacency compute_vertex_adjacency(const Vector3ui* primitives_begin, const Vector3ui* primitives_end, unsigned int vertex_count) {
+    const int primitive_count = int(primitives_end - primitives_begin);
+    const unsigned int* indices = (const unsigned int*)(const void*)primitives_begin;
+    const int index_count = primitive_count * 3;
+
+    // Count the number of corners referencing each vertex.
+    std::unique_ptr<std::atomic<unsigned int>[]> counters(new std::atomic<unsigned int>[vertex_count]);
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < int(vertex_count); ++v)
+        counters[v].store(0u, std::memory_order_relaxed);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < index_count; ++i)
+        counters[indices[i]].fetch_add(1u, std::memory_order_relaxed);
+
+    // Exclusive prefix sum of the counts gives the offset of each vertex' corners.
+    VertexAdjacency adjacency;
+    adjacency.corner_offsets.resize(vertex_count + 1);
+    unsigned int corner_offset = 0u;
+    for (unsigned int v = 0; v < vertex_count; ++v) {
+        adjacency.corner_offsets[v] = corner_offset;
+        corner_offset += counters[v].load(std::memory_order_relaxed);
+        counters[v].store(adjacency.corner_offsets[v], std::memory_order_relaxed);
+    }
+    adjacency.corner_offsets[vertex_count] = corner_offset;
+
+    // Scatter the corners to their vertices.
+    adjacency.corners.resize(index_count);
+    unsigned int* corners = adjacency.corners.data();
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < index_count; ++i) {
+        unsigned int corner_index = counters[indices[i]].fetch_add(1u, std::memory_order_relaxed);
+        corners[corner_index] = i;
+    }
+
+    // The scatter order depends on thread scheduling, so sort the corners of each vertex.
+    const unsigned int* corner_offsets = adjacency.corner_offsets.data();
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < int(vertex_count); ++v)
+        std::sort(corners + corner_offsets[v], corners + corner_offsets[v + 1]);
 
-    while (primitives_begin < primitives_end) {
-        Vector3ui primitive = *primitives_begin++;
+    return adjacency;
+}
 
-        Vector3f p0 = positions_begin[primitive.x];
-        Vector3f p1 = positions_begin[primitive.y];
-        Vector3f p2 = positions_begin[primitive.z];
+// Computes the weighted normal of a primitive at one of its corners.
+static inline Vector3f weighted_corner_normal(const Vector3ui* primitives, const Vector3f* positions, 
+                                              unsigned int corner, NormalWeighting weighting) {
+    Vector3ui primitive = primitives[corner / 3];
+    unsigned int c = corner % 3;
+    Vector3f p0 = positions[primitive[c]];
+    Vector3f p1 = positions[primitive[(c + 1) % 3]];
+    Vector3f p2 = positions[primitive[(c + 2) % 3]];
+    Vector3f edge1 = p1 - p0;
+    Vector3f edge2 = p2 - p0;
+    Vector3f normal = cross(edge1, edge2); // Magnitude is twice the area of the primitive.
+
+    if (weighting == NormalWeighting::Area)
+        return normal;
+
+    float normal_length = magnitude(normal);
+    if (normal_length == 0.0f)
+        return Vector3f::zero();
+    float cos_theta = dot(edge1, edge2) / sqrt(magnitude_squared(edge1) * magnitude_squared(edge2));
+    float angle = acosf(clamp(cos_theta, -1.0f, 1.0f));
+    return normal * (angle / normal_length);
+}
 
-        Vector3f normal = cross(p1 - p0, p2 - p0);
-        normals_begin[primitive.x] += normal;
-        normals_begin[primitive.y] += normal;
-        normals_begin[primitive.z] += normal;
-    }
+// Normalizes a normal, falling back to a valid but arbitrary normal if the vertex isn't referenced by any primitive with a non-zero area.
+static inline Vector3f safe_normalize(Vector3f normal) {
+    float length_squared = magnitude_squared(normal);
+    return length_squared > 0.0f ? normal / sqrt(length_squared) : Vector3f::forward();
+}
 
-    std::for_each(normals_begin, normals_end, [](Vector3f& n) { n = normalize(n); });
+void compute_normals(Vector3ui* primitives_begin, Vector3ui* primitives_end,
+                     Vector3f* normals_begin, Vector3f* normals_end, Vector3f* positions_begin,
+                     NormalWeighting weighting) {
+    const int vertex_count = int(normals_end - normals_begin);
+    VertexAdjacency adjacency = compute_vertex_adjacency(primitives_begin, primitives_end, vertex_count);
+
+    // Gather the weighted normals of the adjacent primitives pr vertex. 
+    // As each vertex is written by exactly one thread there are no race conditions.
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < vertex_count; ++v) {
+        Vector3f normal = Vector3f::zero();
+        for (unsigned int corner : adjacency.get_corners(v))
+            normal += weighted_corner_normal(primitives_begin, positions_begin, corner, weighting);
+        normals_begin[v] = safe_normalize(normal);
+    }
 }
 
-void compute_normals(Meshes::UID mesh_ID) {
+void compute_normals(Meshes::UID mesh_ID, NormalWeighting weighting) {
     Mesh mesh = mesh_ID;
     compute_normals(mesh.get_primitives(), mesh.get_primitives() + mesh.get_primitive_count(),
                     mesh.get_normals(), mesh.get_normals() + mesh.get_vertex_count(),
-                    mesh.get_positions());
+                    mesh.get_positions(), weighting);
+}
+
+// Replaces the counts with their exclusive prefix sum and returns the total count.
+static unsigned int exclusive_prefix_sum(std::vector<unsigned int>& counts) {
+    unsigned int sum = 0u;
+    for (unsigned int& count : counts) {
+        unsigned int c = count;
+        count = sum;
+        sum += c;
+    }
+    return sum;
+}
+
+// Creates a copy of a mesh where vertices are split according to the corners referencing them.
+// Vertex v is split into the vertices [new_vertex_offsets[v], new_vertex_offsets[v+1]), 
+// and the corners of v reference the new vertex new_vertex_offsets[v] + corner_vertex_indices[corner].
+// Vertex attributes are copied from the source vertex. Attributes missing in the source mesh are 
+// left for the caller to fill in, except for unreferenced vertices, where they are set to a default.
+static Mesh create_split_mesh(Mesh mesh, MeshFlags flags, const VertexAdjacency& adjacency,
+                              const std::vector<unsigned int>& corner_vertex_indices,
+                              const std::vector<unsigned int>& new_vertex_offsets) {
+    const int vertex_count = int(mesh.get_vertex_count());
+    Mesh new_mesh = Meshes::create(mesh.get_name(), mesh.get_primitive_count(), new_vertex_offsets[vertex_count], flags);
+
+    const Vector3f* positions = mesh.get_positions();
+    const Vector3f* normals = mesh.get_normals();
+    const Vector2f* texcoords = mesh.get_texcoords();
+    const Vector4f* tangents = mesh.get_tangents();
+    Vector3ui* new_primitives = new_mesh.get_primitives();
+    Vector3f* new_positions = new_mesh.get_positions();
+    Vector3f* new_normals = new_mesh.get_normals();
+    Vector2f* new_texcoords = new_mesh.get_texcoords();
+    Vector4f* new_tangents = new_mesh.get_tangents();
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < vertex_count; ++v) {
+        unsigned int new_vertex_begin = new_vertex_offsets[v];
+        unsigned int new_vertex_end = new_vertex_offsets[v + 1];
+        bool is_referenced = adjacency.get_corner_count(v) > 0;
+        for (unsigned int new_v = new_vertex_begin; new_v < new_vertex_end; ++new_v) {
+            if (new_positions)
+                new_positions[new_v] = positions[v];
+            if (new_normals && (normals || !is_referenced))
+                new_normals[new_v] = normals ? normals[v] : Vector3f::forward();
+            if (new_texcoords && (texcoords || !is_referenced))
+                new_texcoords[new_v] = texcoords ? texcoords[v] : Vector2f::zero();
+            if (new_tangents && (tangents || !is_referenced))
+                new_tangents[new_v] = tangents ? tangents[v] : Vector4f(1.0f, 0.0f, 0.0f, 1.0f);
+        }
+        for (unsigned int corner : adjacency.get_corners(v))
+            new_primitives[corner / 3][corner % 3] = new_vertex_begin + corner_vertex_indices[corner];
+    }
+
+    new_mesh.set_bounds(mesh.get_bounds());
+
+    return new_mesh;
+}
+
+Meshes::UID compute_normals_with_creases(Meshes::UID mesh_ID, float crease_angle_in_radians, NormalWeighting weighting) {
+    Mesh mesh = mesh_ID;
+    const Vector3ui* primitives = mesh.get_primitives();
+    const Vector3f* positions = mesh.get_positions();
+    const int primitive_count = int(mesh.get_primitive_count());
+    const int vertex_count = int(mesh.get_vertex_count());
+    const float cos_crease_angle = cos(crease_angle_in_radians);
+
+    VertexAdjacency adjacency = compute_vertex_adjacency(mesh.get_ID());
+
+    // Normalized primitive normals used for testing the crease angle.
+    std::vector<Vector3f> primitive_normals(primitive_count);
+    #pragma omp parallel for schedule(static)
+    for (int p = 0; p < primitive_count; ++p) {
+        Vector3ui primitive = primitives[p];
+        Vector3f p0 = positions[primitive.x], p1 = positions[primitive.y], p2 = positions[primitive.z];
+        primitive_normals[p] = safe_normalize(cross(p1 - p0, p2 - p0));
+    }
+
+    // Compute the normal of each corner from the adjacent primitives that are within the crease angle 
+    // of the corner's own primitive. Then find the unique normals around each vertex, 
+    // as each of those requires a vertex in the output mesh.
+    std::vector<Vector3f> corner_normals(primitive_count * 3);
+    std::vector<unsigned int> corner_vertex_indices(primitive_count * 3); // Index of the corner's vertex relative to the first new vertex created from the old vertex.
+    std::vector<unsigned int> new_vertex_offsets(vertex_count + 1);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < vertex_count; ++v) {
+        auto vertex_corners = adjacency.get_corners(v);
+        unsigned int unique_normal_count = 0;
+        for (const unsigned int* corner_itr = vertex_corners.begin(); corner_itr != vertex_corners.end(); ++corner_itr) {
+            Vector3f corner_primitive_normal = primitive_normals[*corner_itr / 3];
+            Vector3f normal = Vector3f::zero();
+            for (unsigned int other_corner : vertex_corners)
+                if (dot(corner_primitive_normal, primitive_normals[other_corner / 3]) >= cos_crease_angle)
+                    normal += weighted_corner_normal(primitives, positions, other_corner, weighting);
+            normal = safe_normalize(normal);
+            corner_normals[*corner_itr] = normal;
+
+            // Corners are processed in order, so the first corner with a given normal determines the new vertex index.
+            const unsigned int* matching_corner_itr = vertex_corners.begin();
+            while (corner_normals[*matching_corner_itr] != normal)
+                ++matching_corner_itr;
+            if (matching_corner_itr == corner_itr)
+                corner_vertex_indices[*corner_itr] = unique_normal_count++;
+            else
+                corner_vertex_indices[*corner_itr] = corner_vertex_indices[*matching_corner_itr];
+        }
+        // Unreferenced vertices are kept as is.
+        new_vertex_offsets[v] = max(1u, unique_normal_count);
+    }
+    exclusive_prefix_sum(new_vertex_offsets);
+
+    MeshFlags flags = mesh.get_flags() | MeshFlag::Normal;
+    Mesh new_mesh = create_split_mesh(mesh, flags, adjacency, corner_vertex_indices, new_vertex_offsets);
+
+    // Assign the crease normals.
+    Vector3f* new_normals = new_mesh.get_normals();
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < vertex_count; ++v)
+        for (unsigned int corner : adjacency.get_corners(v))
+            new_normals[new_vertex_offsets[v] + corner_vertex_indices[corner]] = corner_normals[corner];
+
+    return new_mesh.get_ID();
+}
+
+// Returns an arbitrary unit vector perpendicular to the normal.
+static inline Vector3f perpendicular_unit_vector(Vector3f normal) {
+    Vector3f axis = abs(normal.x) < 0.9f ? Vector3f::right() : Vector3f::up();
+    return safe_normalize(cross(normal, axis));
+}
+
+Meshes::UID compute_tangents(Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+    assert(mesh.get_normals() != nullptr && mesh.get_texcoords() != nullptr);
+    const Vector3ui* primitives = mesh.get_primitives();
+    const Vector3f* positions = mesh.get_positions();
+    const Vector3f* normals = mesh.get_normals();
+    const Vector2f* texcoords = mesh.get_texcoords();
+    const int primitive_count = int(mesh.get_primitive_count());
+    const int vertex_count = int(mesh.get_vertex_count());
+
+    // Compute the tangent and handedness of every primitive corner. 
+    // The tangent is projected onto the tangent plane of the vertex and weighted by the corner angle.
+    // Corners with degenerate texcoords get a zero tangent and a zero handedness, which marks them as wildcards.
+    std::vector<Vector4f> corner_tangents(primitive_count * 3);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int p = 0; p < primitive_count; ++p) {
+        Vector3ui primitive = primitives[p];
+        Vector3f p0 = positions[primitive.x], p1 = positions[primitive.y], p2 = positions[primitive.z];
+        Vector2f uv0 = texcoords[primitive.x], uv1 = texcoords[primitive.y], uv2 = texcoords[primitive.z];
+
+        Vector3f edge1 = p1 - p0, edge2 = p2 - p0;
+        Vector2f uv_edge1 = uv1 - uv0, uv_edge2 = uv2 - uv0;
+        float determinant = uv_edge1.x * uv_edge2.y - uv_edge2.x * uv_edge1.y;
+        // Only the direction of the tangent is needed, so multiply by the sign of the determinant instead of dividing by it.
+        float handedness = determinant < 0.0f ? -1.0f : 1.0f;
+        Vector3f primitive_tangent = (edge1 * uv_edge2.y - edge2 * uv_edge1.y) * handedness;
+        bool is_degenerate = determinant == 0.0f || magnitude_squared(primitive_tangent) == 0.0f;
+
+        for (int c = 0; c < 3; ++c) {
+            unsigned int corner = p * 3 + c;
+            if (is_degenerate) {
+                corner_tangents[corner] = Vector4f::zero();
+                continue;
+            }
+
+            Vector3f normal = normals[primitive[c]];
+            Vector3f tangent = primitive_tangent - normal * dot(normal, primitive_tangent);
+            float tangent_length = magnitude(tangent);
+            if (tangent_length == 0.0f) {
+                corner_tangents[corner] = Vector4f(0.0f, 0.0f, 0.0f, handedness);
+                continue;
+            }
+
+            Vector3f e0 = positions[primitive[(c + 1) % 3]] - positions[primitive[c]];
+            Vector3f e1 = positions[primitive[(c + 2) % 3]] - positions[primitive[c]];
+            float cos_theta = dot(e0, e1) / sqrt(magnitude_squared(e0) * magnitude_squared(e1));
+            float angle = acosf(clamp(cos_theta, -1.0f, 1.0f));
+            corner_tangents[corner] = Vector4f(tangent * (angle / tangent_length), handedness);
+        }
+    }
+
+    // Group the corners around each vertex by handedness. Each group with a handedness requires its own vertex.
+    VertexAdjacency adjacency = compute_vertex_adjacency(mesh.get_ID());
+    std::vector<unsigned int> corner_vertex_indices(primitive_count * 3);
+    std::vector<unsigned int> new_vertex_offsets(vertex_count + 1);
+    std::vector<Vector4f> vertex_tangents(vertex_count * 2); // Right and left handed tangent pr vertex.
+    unsigned int split_vertex_count = 0u;
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+:split_vertex_count)
+    for (int v = 0; v < vertex_count; ++v) {
+        Vector3f tangent_sums[2] = { Vector3f::zero(), Vector3f::zero() };
+        bool has_handedness[2] = { false, false };
+        for (unsigned int corner : adjacency.get_corners(v)) {
+            Vector4f corner_tangent = corner_tangents[corner];
+            if (corner_tangent.w != 0.0f) {
+                int group = corner_tangent.w < 0.0f ? 1 : 0;
+                tangent_sums[group] += Vector3f(corner_tangent.x, corner_tangent.y, corner_tangent.z);
+                has_handedness[group] = true;
+            }
+        }
+
+        // Wildcard corners join the right handed group, unless the vertex is only referenced by left handed corners.
+        int wildcard_group = has_handedness[1] && !has_handedness[0] ? 1 : 0;
+        for (unsigned int corner : adjacency.get_corners(v)) {
+            float w = corner_tangents[corner].w;
+            int group = w == 0.0f ? wildcard_group : (w < 0.0f ? 1 : 0);
+            corner_vertex_indices[corner] = (has_handedness[0] && has_handedness[1]) ? group : 0u;
+        }
+
+        // Orthonormalize the tangents wrt the vertex normal. 
+        // The first tangent of a vertex is stored first, regardless of its handedness.
+        Vector3f normal = normals[v];
+        unsigned int tangent_count = 0;
+        for (int group = 0; group < 2; ++group) {
+            bool is_wildcard_group = group == wildcard_group;
+            if (!has_handedness[group] && !is_wildcard_group)
+                continue;
+            Vector3f tangent = tangent_sums[group] - normal * dot(normal, tangent_sums[group]);
+            float tangent_length = magnitude(tangent);
+            tangent = tangent_length > 0.0f ? tangent / tangent_length : perpendicular_unit_vector(normal);
+            vertex_tangents[2 * v + tangent_count++] = Vector4f(tangent, group == 0 ? 1.0f : -1.0f);
+        }
+
+        new_vertex_offsets[v] = tangent_count;
+        split_vertex_count += tangent_count - 1;
+    }
+
+    if (split_vertex_count == 0 && mesh.get_tangents() != nullptr) {
+        // No vertices need splitting, so the tangents can be stored in place.
+        Vector4f* tangents = mesh.get_tangents();
+        #pragma omp parallel for schedule(static)
+        for (int v = 0; v < vertex_count; ++v)
+            tangents[v] = vertex_tangents[2 * v];
+        return mesh.get_ID();
+    }
+
+    exclusive_prefix_sum(new_vertex_offsets);
+    Mesh new_mesh = create_split_mesh(mesh, mesh.get_flags() | MeshFlag::Tangent, adjacency, corner_vertex_indices, new_vertex_offsets);
+
+    Vector4f* new_tangents = new_mesh.get_tangents();
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < vertex_count; ++v)
+        for (unsigned int new_v = new_vertex_offsets[v]; new_v < new_vertex_offsets[v + 1]; ++new_v)
+            new_tangents[new_v] = vertex_tangents[2 * v + new_v - new_vertex_offsets[v]];
+
+    return new_mesh.get_ID();
 }
 
 } // NS MeshUtils
@@ -17,14 +17,19 @@
 #include <Cogwheel/Math/Transform.h>
 #include <Cogwheel/Math/Vector.h>
 
+#include <vector>
+
 namespace Cogwheel {
 namespace Assets {
 
+// Tangents are derived from the other buffers and are therefore not part of AllBuffers, 
+// but have to be requested explicitly.
 enum class MeshFlag : unsigned char {
     None       = 0u,
     Position   = 1u << 0u,
     Normal     = 1u << 1u,
     Texcoord   = 1u << 2u,
+    Tangent    = 1u << 3u,
     AllBuffers = Position | Normal | Texcoord
 };
 typedef Core::Bitmask<MeshFlag> MeshFlags;
@@ -33,8 +38,7 @@ typedef Core::Bitmask<MeshFlag> MeshFlags;
 // Container for mesh properties and their bufers.
 // Future work:
 // * Verify that creating and destroying meshes don't leak!
-// * Array access functions should probably map the data as read- or writable
-//   and set appropiate change flags.
+// * Map functions for reading, so the plain buffer getters can be removed.
 //----------------------------------------------------------------------------
 class Meshes final {
 public:
@@ -69,10 +73,30 @@ public:
     static inline Math::Vector3f* get_positions(Meshes::UID mesh_ID) { return m_buffers[mesh_ID].positions; }
     static inline Math::Vector3f* get_normals(Meshes::UID mesh_ID) { return m_buffers[mesh_ID].normals; }
     static inline Math::Vector2f* get_texcoords(Meshes::UID mesh_ID) { return m_buffers[mesh_ID].texcoords; }
+    static inline Math::Vector4f* get_tangents(Meshes::UID mesh_ID) { return m_buffers[mesh_ID].tangents; }
     static inline Math::AABB get_bounds(Meshes::UID mesh_ID) { return m_bounds[mesh_ID]; }
     static inline void set_bounds(Meshes::UID mesh_ID, Math::AABB bounds) { m_bounds[mesh_ID] = bounds; }
     static Math::AABB compute_bounds(Meshes::UID mesh_ID);
 
+    //-------------------------------------------------------------------------
+    // Level of detail.
+    // The LOD chain of a mesh is ordered from most to least detailed, 
+    // where LOD 0 is the first simplified level and not the mesh itself.
+    // The LOD meshes are owned by their base mesh and destroyed along with it.
+    //-------------------------------------------------------------------------
+    struct LOD {
+        Meshes::UID mesh_ID;
+        float error; // Approximate geometric error of the LOD relative to the base mesh, in object space.
+    };
+
+    static inline unsigned int get_LOD_count(Meshes::UID mesh_ID) { return (unsigned int)m_LODs[mesh_ID].size(); }
+    static inline LOD get_LOD(Meshes::UID mesh_ID, unsigned int level) { return m_LODs[mesh_ID][level]; }
+    static inline Core::Iterable<std::vector<LOD>::const_iterator> get_LOD_iterable(Meshes::UID mesh_ID) {
+        return Core::Iterable<std::vector<LOD>::const_iterator>(m_LODs[mesh_ID].cbegin(), m_LODs[mesh_ID].cend());
+    }
+    // Sets the LOD chain of a mesh. Any previous LOD meshes are destroyed.
+    static void set_LODs(Meshes::UID mesh_ID, const std::vector<LOD>& LODs);
+
     //-------------------------------------------------------------------------
     // Changes since last game loop tick.
     //-------------------------------------------------------------------------
@@ -80,7 +104,13 @@ public:
         None = 0u,
         Created = 1u << 0u,
         Destroyed = 1u << 1u,
-        All = Created | Destroyed,
+        IndicesUpdated = 1u << 2u,
+        PositionsUpdated = 1u << 3u,
+        NormalsUpdated = 1u << 4u,
+        TexcoordsUpdated = 1u << 5u,
+        TangentsUpdated = 1u << 6u,
+        BuffersUpdated = IndicesUpdated | PositionsUpdated | NormalsUpdated | TexcoordsUpdated | TangentsUpdated,
+        All = Created | Destroyed | BuffersUpdated,
     };
     typedef Core::Bitmask<Change> Changes;
 
@@ -89,10 +119,42 @@ public:
     typedef std::vector<UID>::iterator ChangedIterator;
     static inline Core::Iterable<ChangedIterator> get_changed_meshes() { return m_changes.get_changed_resources(); }
 
-    static void reset_change_notifications() { m_changes.reset_change_notifications(); }
+    static void reset_change_notifications();
+
+    //-------------------------------------------------------------------------
+    // Buffer updates.
+    // Buffers that are modified after the mesh has been created should be mapped
+    // for writing, which flags the buffer as updated and grows its dirty range to
+    // contain the mapped elements. Consumers can then reupload or refit only the
+    // dirty range instead of the whole mesh.
+    // Primitive ranges are given in primitives and vertex attribute ranges in vertices.
+    // Mapping positions does not update the bounds, use compute_bounds for that.
+    //-------------------------------------------------------------------------
+    struct DirtyRange {
+        unsigned int begin;
+        unsigned int end;
+
+        inline bool is_empty() const { return end <= begin; }
+        inline unsigned int size() const { return is_empty() ? 0u : end - begin; }
+    };
+
+    static Math::Vector3ui* map_primitives(Meshes::UID mesh_ID, unsigned int first_primitive, unsigned int primitive_count);
+    static Math::Vector3f* map_positions(Meshes::UID mesh_ID, unsigned int first_vertex, unsigned int vertex_count);
+    static Math::Vector3f* map_normals(Meshes::UID mesh_ID, unsigned int first_vertex, unsigned int vertex_count);
+    static Math::Vector2f* map_texcoords(Meshes::UID mesh_ID, unsigned int first_vertex, unsigned int vertex_count);
+    static Math::Vector4f* map_tangents(Meshes::UID mesh_ID, unsigned int first_vertex, unsigned int vertex_count);
+    static inline Math::Vector3ui* map_primitives(Meshes::UID mesh_ID) { return map_primitives(mesh_ID, 0u, get_primitive_count(mesh_ID)); }
+    static inline Math::Vector3f* map_positions(Meshes::UID mesh_ID) { return map_positions(mesh_ID, 0u, get_vertex_count(mesh_ID)); }
+    static inline Math::Vector3f* map_normals(Meshes::UID mesh_ID) { return map_normals(mesh_ID, 0u, get_vertex_count(mesh_ID)); }
+    static inline Math::Vector2f* map_texcoords(Meshes::UID mesh_ID) { return map_texcoords(mesh_ID, 0u, get_vertex_count(mesh_ID)); }
+    static inline Math::Vector4f* map_tangents(Meshes::UID mesh_ID) { return map_tangents(mesh_ID, 0u, get_vertex_count(mesh_ID)); }
+
+    // Returns the dirty range of the buffer corresponding to the update change, e.g. Change::PositionsUpdated.
+    static DirtyRange get_dirty_range(Meshes::UID mesh_ID, Change buffer_update);
 
 private:
     static void reserve_mesh_data(unsigned int new_capacity, unsigned int old_capacity);
+    static void flag_as_updated(Meshes::UID mesh_ID, Change buffer_update, unsigned int begin, unsigned int end);
 
     struct Buffers {
         unsigned int primitive_count;
@@ -102,6 +164,12 @@ private:
         Math::Vector3f* positions;
         Math::Vector3f* normals;
         Math::Vector2f* texcoords;
+        Math::Vector4f* tangents;
+    };
+
+    // Dirty ranges of the index, position, normal, texcoord and tangent buffers.
+    struct DirtyRanges {
+        DirtyRange buffers[5];
     };
 
     static UIDGenerator m_UID_generator;
@@ -109,6 +177,8 @@ private:
 
     static Buffers* m_buffers;
     static Math::AABB* m_bounds;
+    static std::vector<LOD>* m_LODs;
+    static DirtyRanges* m_dirty_ranges;
 
     static Core::ChangeSet<Changes, UID> m_changes;
 };
@@ -147,15 +217,27 @@ public:
     inline Core::Iterable<Math::Vector3f*> get_normal_iterable() { return Core::Iterable<Math::Vector3f*>(get_normals(), get_vertex_count()); }
     inline Math::Vector2f* get_texcoords() { return Meshes::get_texcoords(m_ID); }
     inline Core::Iterable<Math::Vector2f*> get_texcoord_iterable() { return Core::Iterable<Math::Vector2f*>(get_texcoords(), get_vertex_count()); }
+    inline Math::Vector4f* get_tangents() { return Meshes::get_tangents(m_ID); }
+    inline Core::Iterable<Math::Vector4f*> get_tangent_iterable() { return Core::Iterable<Math::Vector4f*>(get_tangents(), get_vertex_count()); }
+    inline Math::Vector3ui* map_primitives(unsigned int first_primitive, unsigned int primitive_count) { return Meshes::map_primitives(m_ID, first_primitive, primitive_count); }
+    inline Math::Vector3f* map_positions(unsigned int first_vertex, unsigned int vertex_count) { return Meshes::map_positions(m_ID, first_vertex, vertex_count); }
+    inline Math::Vector3f* map_normals(unsigned int first_vertex, unsigned int vertex_count) { return Meshes::map_normals(m_ID, first_vertex, vertex_count); }
+    inline Math::Vector2f* map_texcoords(unsigned int first_vertex, unsigned int vertex_count) { return Meshes::map_texcoords(m_ID, first_vertex, vertex_count); }
+    inline Math::Vector4f* map_tangents(unsigned int first_vertex, unsigned int vertex_count) { return Meshes::map_tangents(m_ID, first_vertex, vertex_count); }
+    inline Meshes::DirtyRange get_dirty_range(Meshes::Change buffer_update) { return Meshes::get_dirty_range(m_ID, buffer_update); }
     inline Math::AABB get_bounds() { return Meshes::get_bounds(m_ID); }
     inline void set_bounds(Math::AABB bounds) { Meshes::set_bounds(m_ID, bounds); }
 
     inline Math::AABB compute_bounds() { return Meshes::compute_bounds(m_ID); }
 
+    inline unsigned int get_LOD_count() const { return Meshes::get_LOD_count(m_ID); }
+    inline Meshes::LOD get_LOD(unsigned int level) const { return Meshes::get_LOD(m_ID, level); }
+
     inline MeshFlags get_flags() {
         MeshFlags mesh_flags = get_positions() ? MeshFlag::Position : MeshFlag::None;
         mesh_flags |= get_normals() ? MeshFlag::Normal : MeshFlag::None;
         mesh_flags |= get_texcoords() ? MeshFlag::Texcoord : MeshFlag::None;
+        mesh_flags |= get_tangents() ? MeshFlag::Tangent : MeshFlag::None;
         return mesh_flags;
     }
 
@@ -170,7 +252,6 @@ private:
 // Future work:
 // * Forsyth index sorting. https://code.google.com/archive/p/vcacne/
 // * What about vertex sorting? Base it on a morton curve or order of appearance in the index array.
-// * Utility function for computing tangents and normals on bump mapped surfaces. Possibly splitting the mesh.
 //----------------------------------------------------------------------------
 namespace MeshUtils {
 
@@ -200,11 +281,64 @@ inline Meshes::UID combine(const std::string& name,
 // This function assumes that the positions are used to describe triangles.
 void compute_hard_normals(Math::Vector3f* positions_begin, Math::Vector3f* positions_end, Math::Vector3f* normals_begin);
 
-// Computes a list of hard normals from a list of triangle positions.
-// This function assumes that the positions are used to describe triangles.
+//-------------------------------------------------------------------------
+// Vertex to primitive adjacency.
+// Stored in compressed sparse row format, such that the primitive corners referencing 
+// vertex v are found in corners[corner_offsets[v]] to corners[corner_offsets[v+1]].
+// A corner is encoded as primitive_index * 3 + vertex index in the primitive.
+// The corners of each vertex are sorted to make traversal deterministic.
+//-------------------------------------------------------------------------
+struct VertexAdjacency {
+    std::vector<unsigned int> corner_offsets;
+    std::vector<unsigned int> corners;
+
+    inline unsigned int get_corner_count(unsigned int vertex_index) const { return corner_offsets[vertex_index + 1] - corner_offsets[vertex_index]; }
+    inline Core::Iterable<const unsigned int*> get_corners(unsigned int vertex_index) const {
+        return Core::Iterable<const unsigned int*>(corners.data() + corner_offsets[vertex_index], corners.data() + corner_offsets[vertex_index + 1]);
+    }
+};
+
+// Builds the vertex to primitive adjacency in parallel using a counting sort.
+VertexAdjacency compute_vertex_adjacency(const Math::Vector3ui* primitives_begin, const Math::Vector3ui* primitives_end, unsigned int vertex_count);
+inline VertexAdjacency compute_vertex_adjacency(Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+    return compute_vertex_adjacency(mesh.get_primitives(), mesh.get_primitives() + mesh.get_primitive_count(), mesh.get_vertex_count());
+}
+
+//-------------------------------------------------------------------------
+// Normal computation.
+//-------------------------------------------------------------------------
+enum class NormalWeighting {
+    Area,  // Primitive normals are weighted by the area of the primitive.
+    Angle  // Primitive normals are weighted by the angle of the primitive at the vertex. Mostly independent of tessellation.
+};
+
+// Computes a list of smooth normals from a list of triangles.
+// The normals are computed in parallel by gathering the weighted primitive normals around each vertex.
 void compute_normals(Math::Vector3ui* primitives_begin, Math::Vector3ui* primitives_end,
-                     Math::Vector3f* normals_begin, Math::Vector3f* normals_end, Math::Vector3f* positions_begin);
-void compute_normals(Meshes::UID mesh_ID);
+                     Math::Vector3f* normals_begin, Math::Vector3f* normals_end, Math::Vector3f* positions_begin,
+                     NormalWeighting weighting = NormalWeighting::Area);
+void compute_normals(Meshes::UID mesh_ID, NormalWeighting weighting = NormalWeighting::Area);
+
+// Computes normals for a mesh, where edges with a dihedral angle above the crease angle are kept hard.
+// Vertices on hard edges are split, so a new mesh is created with the new normals.
+// The input mesh is left untouched.
+Meshes::UID compute_normals_with_creases(Meshes::UID mesh_ID, float crease_angle_in_radians, 
+                                         NormalWeighting weighting = NormalWeighting::Area);
+
+//-------------------------------------------------------------------------
+// Tangent computation.
+//-------------------------------------------------------------------------
+
+// Computes MikkTSpace style tangents for a mesh with normals and texcoords.
+// The tangents are stored as [tangent.x, tangent.y, tangent.z, sign], where the bitangent is
+// given by sign * cross(normal, tangent).xyz.
+// The tangents of the primitives around a vertex are weighted by their angle at the vertex and 
+// orthogonalized wrt the vertex normal. Vertices where primitives with mirrored texcoords meet 
+// are split into a vertex pr handedness.
+// If the mesh already has a tangent buffer and no vertices need to be split, then the tangents 
+// are computed in place and the input mesh is returned. Otherwise a new mesh is created.
+Meshes::UID compute_tangents(Meshes::UID mesh_ID);
 
 // Expands a buffer and a list of triangle vertex indices into a non-indexed buffer.
 // Useful for expanding meshes that uses indexing into a mesh that does not.
@@ -233,17 +367,17 @@ typename std::iterator_traits<RandomAccessIterator>::value_type*
 
 //----------------------------------------------------------------------------
 // Utility tests for verifying the validity of a mesh.
+// See MeshValidation.h for a parallel validator that reports the offending primitives.
 //----------------------------------------------------------------------------
 namespace MeshTests {
 
 // Tests that the normals corrospond to the winding order,
 // i.e. that the front face defined by the winding order 
 // is facing the same general direction as the normals.
-// TODO optional function that all invalid primitives are passed to.
 // Returns the number of primitives whose winding order did not correspond to their vertex normals.
 unsigned int normals_correspond_to_winding_order(Meshes::UID mesh_ID);
 
-// TODO callback function that receives found degenerate primitives.
+// Returns the number of primitives with repeated indices or edges shorter than sqrt(epsilon_squared).
 unsigned int count_degenerate_primitives(Meshes::UID mesh_ID, float epsilon_squared = 0.000001f);
 
 // Tests that no indices index out of bounds.
@@ -0,0 +1,266 @@
+// Cogwheel mesh clustering utilities.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Assets/MeshClustering.h>
+#include <Cogwheel/Math/MortonEncode.h>
+#include <Cogwheel/Math/Utils.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Assets {
+namespace MeshUtils {
+
+// Clusters built from a contiguous block of Morton sorted primitives.
+// The offsets in the clusters are relative to the block.
+struct ClusterBlock {
+    std::vector<MeshCluster> clusters;
+    std::vector<unsigned int> vertex_indices;
+    std::vector<unsigned char> local_primitives;
+};
+
+static void cluster_block(const Vector3ui* primitives, const unsigned long long* sorted_keys_begin, const unsigned long long* sorted_keys_end,
+                          ClusterBlock& block) {
+    MeshCluster cluster = {};
+    auto flush_cluster = [&]() {
+        if (cluster.primitive_count == 0)
+            return;
+        block.clusters.push_back(cluster);
+        cluster.vertex_offset = (unsigned int)(block.vertex_indices.size());
+        cluster.primitive_offset = (unsigned int)(block.local_primitives.size() / 3);
+        cluster.vertex_count = cluster.primitive_count = 0u;
+    };
+
+    for (const unsigned long long* key_itr = sorted_keys_begin; key_itr != sorted_keys_end; ++key_itr) {
+        Vector3ui primitive = primitives[(unsigned int)(*key_itr)];
+
+        // Find the cluster local indices of the primitive's vertices, or -1 if the vertex isn't in the cluster yet.
+        // Linear search is fine, as clusters contain at most 64 vertices.
+        int local_indices[3];
+        unsigned int new_vertex_count = 0;
+        for (int c = 0; c < 3; ++c) {
+            const unsigned int* cluster_vertices = block.vertex_indices.data() + cluster.vertex_offset;
+            const unsigned int* vertex_itr = std::find(cluster_vertices, cluster_vertices + cluster.vertex_count, primitive[c]);
+            local_indices[c] = vertex_itr == cluster_vertices + cluster.vertex_count ? -1 : int(vertex_itr - cluster_vertices);
+            // Vertices that are repeated inside the primitive should only be counted once.
+            bool repeated = (c > 0 && primitive[c] == primitive[0]) || (c > 1 && primitive[c] == primitive[1]);
+            if (local_indices[c] < 0 && !repeated)
+                ++new_vertex_count;
+        }
+
+        if (cluster.vertex_count + new_vertex_count > MeshClusters::max_vertex_count ||
+            cluster.primitive_count == MeshClusters::max_primitive_count) {
+            flush_cluster();
+            local_indices[0] = local_indices[1] = local_indices[2] = -1;
+        }
+
+        for (int c = 0; c < 3; ++c) {
+            if (local_indices[c] < 0) {
+                const unsigned int* cluster_vertices = block.vertex_indices.data() + cluster.vertex_offset;
+                const unsigned int* vertex_itr = std::find(cluster_vertices, cluster_vertices + cluster.vertex_count, primitive[c]);
+                local_indices[c] = int(vertex_itr - cluster_vertices);
+                if (local_indices[c] == int(cluster.vertex_count)) {
+                    block.vertex_indices.push_back(primitive[c]);
+                    ++cluster.vertex_count;
+                }
+            }
+            block.local_primitives.push_back((unsigned char)local_indices[c]);
+        }
+        ++cluster.primitive_count;
+    }
+
+    flush_cluster();
+}
+
+// Computes a bounding sphere using Ritter's algorithm.
+static void compute_bounding_sphere(const MeshClusters& clusters, const MeshCluster& cluster, const Vector3f* positions,
+                                    Vector3f& center, float& radius) {
+    const unsigned int* vertex_indices = clusters.vertex_indices.data() + cluster.vertex_offset;
+
+    // Find the pair of axis aligned extremal points that are furthest apart and use it as the initial sphere.
+    unsigned int min_vertex[3] = { vertex_indices[0], vertex_indices[0], vertex_indices[0] };
+    unsigned int max_vertex[3] = { vertex_indices[0], vertex_indices[0], vertex_indices[0] };
+    for (unsigned int v = 1; v < cluster.vertex_count; ++v) {
+        Vector3f position = positions[vertex_indices[v]];
+        for (int a = 0; a < 3; ++a) {
+            if (position[a] < positions[min_vertex[a]][a]) min_vertex[a] = vertex_indices[v];
+            if (position[a] > positions[max_vertex[a]][a]) max_vertex[a] = vertex_indices[v];
+        }
+    }
+
+    int widest_axis = 0;
+    float widest_distance_squared = -1.0f;
+    for (int a = 0; a < 3; ++a) {
+        float distance_squared = magnitude_squared(positions[max_vertex[a]] - positions[min_vertex[a]]);
+        if (distance_squared > widest_distance_squared) {
+            widest_distance_squared = distance_squared;
+            widest_axis = a;
+        }
+    }
+
+    center = (positions[min_vertex[widest_axis]] + positions[max_vertex[widest_axis]]) * 0.5f;
+    radius = sqrt(widest_distance_squared) * 0.5f;
+
+    // Grow the sphere to contain all the points.
+    for (unsigned int v = 0; v < cluster.vertex_count; ++v) {
+        Vector3f position = positions[vertex_indices[v]];
+        float distance = magnitude(position - center);
+        if (distance > radius) {
+            float new_radius = (radius + distance) * 0.5f;
+            center += (position - center) * ((new_radius - radius) / distance);
+            radius = new_radius;
+        }
+    }
+}
+
+// Computes the normal cone of the cluster, see Arseny Kapoulkine's meshoptimizer.
+static void compute_normal_cone(const MeshClusters& clusters, MeshCluster& cluster, const Vector3f* positions) {
+    Vector3f normal_sum = Vector3f::zero();
+    for (unsigned int p = 0; p < cluster.primitive_count; ++p) {
+        Vector3f p0 = positions[clusters.get_mesh_vertex_index(cluster, p, 0)];
+        Vector3f p1 = positions[clusters.get_mesh_vertex_index(cluster, p, 1)];
+        Vector3f p2 = positions[clusters.get_mesh_vertex_index(cluster, p, 2)];
+        Vector3f normal = cross(p1 - p0, p2 - p0);
+        float normal_length = magnitude(normal);
+        if (normal_length > 0.0f)
+            normal_sum += normal / normal_length;
+    }
+
+    float normal_sum_length = magnitude(normal_sum);
+    cluster.cone_axis = normal_sum_length > 0.0f ? normal_sum / normal_sum_length : Vector3f::forward();
+    cluster.cone_apex = cluster.sphere_center;
+    cluster.cone_cos_angle = -1.0f;
+    if (normal_sum_length == 0.0f)
+        return;
+
+    float min_cos_angle = 1.0f;
+    for (unsigned int p = 0; p < cluster.primitive_count; ++p) {
+        Vector3f p0 = positions[clusters.get_mesh_vertex_index(cluster, p, 0)];
+        Vector3f p1 = positions[clusters.get_mesh_vertex_index(cluster, p, 1)];
+        Vector3f p2 = positions[clusters.get_mesh_vertex_index(cluster, p, 2)];
+        Vector3f normal = cross(p1 - p0, p2 - p0);
+        float normal_length = magnitude(normal);
+        if (normal_length > 0.0f)
+            min_cos_angle = min(min_cos_angle, dot(normal / normal_length, cluster.cone_axis));
+    }
+
+    // No backface culling is possible if the normals span more than a hemisphere.
+    if (min_cos_angle <= 0.0f)
+        return;
+
+    // Move the apex backwards along the axis, until it lies behind the planes of all the primitives.
+    float max_t = 0.0f;
+    for (unsigned int p = 0; p < cluster.primitive_count; ++p) {
+        Vector3f p0 = positions[clusters.get_mesh_vertex_index(cluster, p, 0)];
+        Vector3f p1 = positions[clusters.get_mesh_vertex_index(cluster, p, 1)];
+        Vector3f p2 = positions[clusters.get_mesh_vertex_index(cluster, p, 2)];
+        Vector3f normal = cross(p1 - p0, p2 - p0);
+        float normal_length = magnitude(normal);
+        if (normal_length == 0.0f)
+            continue;
+        normal /= normal_length;
+        float t = dot(cluster.sphere_center - p0, normal) / dot(cluster.cone_axis, normal);
+        max_t = max(max_t, t);
+    }
+
+    cluster.cone_apex = cluster.sphere_center - cluster.cone_axis * max_t;
+    cluster.cone_cos_angle = min_cos_angle;
+}
+
+MeshClusters build_clusters(Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+    const Vector3ui* primitives = mesh.get_primitives();
+    const Vector3f* positions = mesh.get_positions();
+    const int primitive_count = int(mesh.get_primitive_count());
+
+    MeshClusters clusters;
+    if (primitive_count == 0)
+        return clusters;
+
+    // Compute the primitive centroids and their bounds.
+    std::vector<Vector3f> centroids(primitive_count);
+    #pragma omp parallel for schedule(static)
+    for (int p = 0; p < primitive_count; ++p) {
+        Vector3ui primitive = primitives[p];
+        centroids[p] = (positions[primitive.x] + positions[primitive.y] + positions[primitive.z]) / 3.0f;
+    }
+    AABB centroid_bounds = AABB::invalid();
+    for (int p = 0; p < primitive_count; ++p)
+        centroid_bounds.grow_to_contain(centroids[p]);
+
+    // Sort the primitives along a Morton curve. The primitive index is stored in the low bits of the key.
+    Vector3f centroid_scale = 1023.0f / max(centroid_bounds.size(), Vector3f(1e-30f));
+    std::vector<unsigned long long> sorted_keys(primitive_count);
+    #pragma omp parallel for schedule(static)
+    for (int p = 0; p < primitive_count; ++p) {
+        Vector3f normalized_centroid = (centroids[p] - centroid_bounds.minimum) * centroid_scale;
+        unsigned int morton_code = morton_encode((unsigned int)(normalized_centroid.x), (unsigned int)(normalized_centroid.y), (unsigned int)(normalized_centroid.z));
+        sorted_keys[p] = ((unsigned long long)morton_code << 32) | (unsigned int)(p);
+    }
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+
+    // Cluster blocks of the sorted primitives in parallel.
+    // The block size is a multiple of the max primitive count, so only the last cluster in a block can be underfull due to blocking.
+    const int block_size = MeshClusters::max_primitive_count * 32;
+    const int block_count = ceil_divide(primitive_count, block_size);
+    std::vector<ClusterBlock> blocks(block_count);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < block_count; ++b) {
+        const unsigned long long* keys_begin = sorted_keys.data() + b * block_size;
+        const unsigned long long* keys_end = sorted_keys.data() + min((b + 1) * block_size, primitive_count);
+        cluster_block(primitives, keys_begin, keys_end, blocks[b]);
+    }
+
+    // Concatenate the blocks.
+    std::vector<unsigned int> cluster_offsets(block_count + 1), vertex_offsets(block_count + 1), primitive_offsets(block_count + 1);
+    cluster_offsets[0] = vertex_offsets[0] = primitive_offsets[0] = 0u;
+    for (int b = 0; b < block_count; ++b) {
+        cluster_offsets[b + 1] = cluster_offsets[b] + (unsigned int)(blocks[b].clusters.size());
+        vertex_offsets[b + 1] = vertex_offsets[b] + (unsigned int)(blocks[b].vertex_indices.size());
+        primitive_offsets[b + 1] = primitive_offsets[b] + (unsigned int)(blocks[b].local_primitives.size() / 3);
+    }
+    clusters.clusters.resize(cluster_offsets[block_count]);
+    clusters.vertex_indices.resize(vertex_offsets[block_count]);
+    clusters.local_primitives.resize(primitive_offsets[block_count] * 3);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < block_count; ++b) {
+        const ClusterBlock& block = blocks[b];
+        std::copy(block.vertex_indices.begin(), block.vertex_indices.end(), clusters.vertex_indices.begin() + vertex_offsets[b]);
+        std::copy(block.local_primitives.begin(), block.local_primitives.end(), clusters.local_primitives.begin() + primitive_offsets[b] * 3);
+        for (unsigned int c = 0; c < block.clusters.size(); ++c) {
+            MeshCluster cluster = block.clusters[c];
+            cluster.vertex_offset += vertex_offsets[b];
+            cluster.primitive_offset += primitive_offsets[b];
+            clusters.clusters[cluster_offsets[b] + c] = cluster;
+        }
+    }
+
+    // Compute cluster bounds and normal cones.
+    const int cluster_count = int(clusters.clusters.size());
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (int c = 0; c < cluster_count; ++c) {
+        MeshCluster& cluster = clusters.clusters[c];
+
+        cluster.bounds = AABB::invalid();
+        for (unsigned int v = 0; v < cluster.vertex_count; ++v)
+            cluster.bounds.grow_to_contain(positions[clusters.vertex_indices[cluster.vertex_offset + v]]);
+
+        compute_bounding_sphere(clusters, cluster, positions, cluster.sphere_center, cluster.sphere_radius);
+        compute_normal_cone(clusters, cluster, positions);
+    }
+
+    return clusters;
+}
+
+} // NS MeshUtils
+} // NS Assets
+} // NS Cogwheel
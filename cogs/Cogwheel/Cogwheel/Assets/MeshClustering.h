@@ -0,0 +1,77 @@
+// Cogwheel mesh clustering utilities.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_MESH_CLUSTERING_H_
+#define _COGWHEEL_ASSETS_MESH_CLUSTERING_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+
+#include <vector>
+
+namespace Cogwheel {
+namespace Assets {
+namespace MeshUtils {
+
+//----------------------------------------------------------------------------
+// A small cluster of spatially coherent primitives, also known as a meshlet.
+// The cluster references its vertices through a list of mesh vertex indices
+// and its primitives through a list of 8 bit indices into its vertex list.
+//----------------------------------------------------------------------------
+struct MeshCluster {
+    unsigned int vertex_offset;    // Offset into MeshClusters::vertex_indices.
+    unsigned int vertex_count;
+    unsigned int primitive_offset; // Offset into MeshClusters::local_primitives.
+    unsigned int primitive_count;
+
+    Math::AABB bounds;
+    Math::Vector3f sphere_center;
+    float sphere_radius;
+
+    // Normal cone containing the normals of all the primitives in the cluster.
+    // The cone spans acos(cone_cos_angle) radians around the axis.
+    // If the cone is wider than a hemisphere then no backface culling is possible and cone_cos_angle is -1.
+    Math::Vector3f cone_apex;
+    Math::Vector3f cone_axis;
+    float cone_cos_angle;
+
+    // Returns true if all primitives in the cluster face away from the viewer.
+    inline bool is_backfacing(Math::Vector3f view_position) const {
+        if (cone_cos_angle <= 0.0f)
+            return false;
+        Math::Vector3f view_direction = cone_apex - view_position;
+        float cone_sin_angle = sqrt(1.0f - cone_cos_angle * cone_cos_angle);
+        return dot(view_direction, cone_axis) >= cone_sin_angle * magnitude(view_direction);
+    }
+};
+
+struct MeshClusters {
+    static const unsigned int max_vertex_count = 64u;
+    static const unsigned int max_primitive_count = 124u;
+
+    std::vector<MeshCluster> clusters;
+    std::vector<unsigned int> vertex_indices;  // Mesh vertex indices referenced by the clusters.
+    std::vector<unsigned char> local_primitives; // Three cluster local vertex indices pr primitive.
+
+    inline unsigned int get_mesh_vertex_index(const MeshCluster& cluster, unsigned int primitive_index, unsigned int corner) const {
+        unsigned char local_index = local_primitives[(cluster.primitive_offset + primitive_index) * 3 + corner];
+        return vertex_indices[cluster.vertex_offset + local_index];
+    }
+};
+
+// Partitions a mesh into clusters of at most MeshClusters::max_vertex_count vertices
+// and MeshClusters::max_primitive_count primitives.
+// The primitives are sorted along a Morton curve and consecutive primitives are then
+// greedily added to a cluster until it is full. Blocks of the sorted primitives are
+// clustered in parallel and the cluster bounds and cones are computed in parallel as well.
+MeshClusters build_clusters(Meshes::UID mesh_ID);
+
+} // NS MeshUtils
+} // NS Assets
+} // NS Cogwheel
+
+#endif // _COGWHEEL_ASSETS_MESH_CLUSTERING_H_
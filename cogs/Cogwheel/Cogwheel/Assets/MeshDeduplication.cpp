@@ -0,0 +1,252 @@
+// Cogwheel mesh deduplication utilities.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Assets/MeshDeduplication.h>
+#include <Cogwheel/Core/Hash.h>
+#include <Cogwheel/Math/Conversions.h>
+
+#include <cstring>
+#include <unordered_map>
+
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Assets {
+namespace MeshUtils {
+
+// All mesh buffers consist of 32 bit elements, so they are hashed as 32 bit words.
+static inline unsigned long long hash_header(Mesh mesh) {
+    unsigned int header[3] = { mesh.get_primitive_count(), mesh.get_vertex_count(), mesh.get_flags().raw() };
+    return Core::fnv1a(header, sizeof(header));
+}
+
+unsigned long long compute_hash(Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+    unsigned int vertex_count = mesh.get_vertex_count();
+    unsigned long long hash = hash_header(mesh);
+    hash = Core::fnv1a(mesh.get_primitives(), sizeof(Vector3ui) * mesh.get_primitive_count(), hash);
+    if (mesh.get_positions() != nullptr)
+        hash = Core::fnv1a(mesh.get_positions(), sizeof(Vector3f) * vertex_count, hash);
+    if (mesh.get_normals() != nullptr)
+        hash = Core::fnv1a(mesh.get_normals(), sizeof(Vector3f) * vertex_count, hash);
+    if (mesh.get_texcoords() != nullptr)
+        hash = Core::fnv1a(mesh.get_texcoords(), sizeof(Vector2f) * vertex_count, hash);
+    if (mesh.get_tangents() != nullptr)
+        hash = Core::fnv1a(mesh.get_tangents(), sizeof(Vector4f) * vertex_count, hash);
+    return hash;
+}
+
+unsigned long long compute_rigid_invariant_hash(Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+    unsigned int vertex_count = mesh.get_vertex_count();
+    unsigned long long hash = hash_header(mesh);
+    hash = Core::fnv1a(mesh.get_primitives(), sizeof(Vector3ui) * mesh.get_primitive_count(), hash);
+    if (mesh.get_texcoords() != nullptr)
+        hash = Core::fnv1a(mesh.get_texcoords(), sizeof(Vector2f) * vertex_count, hash);
+    if (mesh.get_tangents() != nullptr)
+        for (Vector4f tangent : mesh.get_tangent_iterable())
+            hash = Core::fnv1a(&tangent.w, sizeof(float), hash);
+    return hash;
+}
+
+static inline bool equal_buffers(const void* lhs, const void* rhs, size_t byte_count) {
+    return lhs == rhs || memcmp(lhs, rhs, byte_count) == 0;
+}
+
+bool equal(Meshes::UID lhs_ID, Meshes::UID rhs_ID) {
+    if (lhs_ID == rhs_ID)
+        return true;
+
+    Mesh lhs = lhs_ID, rhs = rhs_ID;
+    if (lhs.get_primitive_count() != rhs.get_primitive_count() || lhs.get_vertex_count() != rhs.get_vertex_count() ||
+        lhs.get_flags() != rhs.get_flags())
+        return false;
+
+    unsigned int vertex_count = lhs.get_vertex_count();
+    return equal_buffers(lhs.get_primitives(), rhs.get_primitives(), sizeof(Vector3ui) * lhs.get_primitive_count()) &&
+        equal_buffers(lhs.get_positions(), rhs.get_positions(), sizeof(Vector3f) * vertex_count) &&
+        equal_buffers(lhs.get_normals(), rhs.get_normals(), sizeof(Vector3f) * vertex_count) &&
+        equal_buffers(lhs.get_texcoords(), rhs.get_texcoords(), sizeof(Vector2f) * vertex_count) &&
+        equal_buffers(lhs.get_tangents(), rhs.get_tangents(), sizeof(Vector4f) * vertex_count);
+}
+
+static inline Vector3f compute_centroid(const Vector3f* positions, unsigned int vertex_count) {
+    double x = 0.0, y = 0.0, z = 0.0;
+    for (unsigned int v = 0; v < vertex_count; ++v) {
+        x += positions[v].x;
+        y += positions[v].y;
+        z += positions[v].z;
+    }
+    return Vector3f(float(x / vertex_count), float(y / vertex_count), float(z / vertex_count));
+}
+
+// Orthonormal frame spanned by the two non-parallel vectors a and b, stored in the matrix columns.
+static inline Matrix3x3f create_frame(Vector3f a, Vector3f b) {
+    Vector3f tangent = normalize(a);
+    Vector3f normal = normalize(cross(a, b));
+    Matrix3x3f frame;
+    frame.set_column(0, tangent);
+    frame.set_column(1, cross(normal, tangent));
+    frame.set_column(2, normal);
+    return frame;
+}
+
+bool find_rigid_transform(Meshes::UID source_ID, Meshes::UID target_ID, Transform& transform, float relative_tolerance) {
+    Mesh source = source_ID, target = target_ID;
+    if (source.get_primitive_count() != target.get_primitive_count() || source.get_vertex_count() != target.get_vertex_count() ||
+        source.get_flags() != target.get_flags() || source.get_positions() == nullptr)
+        return false;
+
+    unsigned int vertex_count = source.get_vertex_count();
+    if (vertex_count == 0)
+        return false;
+
+    // The rigid invariant buffers must be identical.
+    if (!equal_buffers(source.get_primitives(), target.get_primitives(), sizeof(Vector3ui) * source.get_primitive_count()) ||
+        !equal_buffers(source.get_texcoords(), target.get_texcoords(), sizeof(Vector2f) * vertex_count))
+        return false;
+
+    const Vector3f* source_positions = source.get_positions();
+    const Vector3f* target_positions = target.get_positions();
+    Vector3f source_centroid = compute_centroid(source_positions, vertex_count);
+    Vector3f target_centroid = compute_centroid(target_positions, vertex_count);
+
+    // Find two vertices that span a large triangle with the centroid and use it to define a frame in both meshes.
+    unsigned int vertex_a = 0;
+    float max_distance_squared = 0.0f;
+    for (unsigned int v = 0; v < vertex_count; ++v) {
+        float distance_squared = magnitude_squared(source_positions[v] - source_centroid);
+        if (distance_squared > max_distance_squared) {
+            max_distance_squared = distance_squared;
+            vertex_a = v;
+        }
+    }
+    Vector3f source_a = source_positions[vertex_a] - source_centroid;
+    Vector3f target_a = target_positions[vertex_a] - target_centroid;
+
+    unsigned int vertex_b = 0;
+    float max_area_squared = 0.0f;
+    for (unsigned int v = 0; v < vertex_count; ++v) {
+        float area_squared = magnitude_squared(cross(source_a, source_positions[v] - source_centroid));
+        if (area_squared > max_area_squared) {
+            max_area_squared = area_squared;
+            vertex_b = v;
+        }
+    }
+
+    // Meshes with all vertices on a line don't define a unique rotation.
+    // The threshold is relative to the squared extent, as the area is proportional to the extent squared.
+    if (max_area_squared <= 1e-12f * max_distance_squared * max_distance_squared)
+        return false;
+
+    Vector3f source_b = source_positions[vertex_b] - source_centroid;
+    Vector3f target_b = target_positions[vertex_b] - target_centroid;
+
+    float source_extent = sqrt(max_distance_squared);
+    float target_extent = magnitude(target_a);
+    if (target_extent == 0.0f)
+        return false;
+    float scale = target_extent / source_extent;
+
+    Matrix3x3f rotation_matrix = create_frame(target_a, target_b) * transpose(create_frame(source_a, source_b));
+    Quaternionf rotation = normalize(to_quaternion(rotation_matrix));
+    Transform candidate = Transform(target_centroid - rotation * source_centroid * scale, rotation, scale);
+
+    // Verify the transform for all vertices.
+    float tolerance_squared = relative_tolerance * target_extent;
+    tolerance_squared *= tolerance_squared;
+    for (unsigned int v = 0; v < vertex_count; ++v)
+        if (magnitude_squared(candidate * source_positions[v] - target_positions[v]) > tolerance_squared)
+            return false;
+
+    // Normals and tangents are unit vectors, so they are verified with the relative tolerance directly.
+    float direction_tolerance_squared = relative_tolerance * relative_tolerance;
+    if (source.get_normals() != nullptr) {
+        const Vector3f* source_normals = source.get_normals();
+        const Vector3f* target_normals = target.get_normals();
+        for (unsigned int v = 0; v < vertex_count; ++v)
+            if (magnitude_squared(rotation * source_normals[v] - target_normals[v]) > direction_tolerance_squared)
+                return false;
+    }
+
+    if (source.get_tangents() != nullptr) {
+        const Vector4f* source_tangents = source.get_tangents();
+        const Vector4f* target_tangents = target.get_tangents();
+        for (unsigned int v = 0; v < vertex_count; ++v) {
+            Vector4f source_tangent = source_tangents[v], target_tangent = target_tangents[v];
+            Vector3f rotated_tangent = rotation * Vector3f(source_tangent.x, source_tangent.y, source_tangent.z);
+            Vector3f tangent_delta = rotated_tangent - Vector3f(target_tangent.x, target_tangent.y, target_tangent.z);
+            if (source_tangent.w != target_tangent.w || magnitude_squared(tangent_delta) > direction_tolerance_squared)
+                return false;
+        }
+    }
+
+    transform = candidate;
+    return true;
+}
+
+std::vector<TransformedMesh> deduplicate(const Meshes::UID* meshes_begin, const Meshes::UID* meshes_end, bool detect_rigid_transforms) {
+    int mesh_count = int(meshes_end - meshes_begin);
+
+    std::vector<unsigned long long> hashes(mesh_count);
+    std::vector<unsigned long long> rigid_hashes(detect_rigid_transforms ? mesh_count : 0);
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (int m = 0; m < mesh_count; ++m) {
+        hashes[m] = compute_hash(meshes_begin[m]);
+        if (detect_rigid_transforms)
+            rigid_hashes[m] = compute_rigid_invariant_hash(meshes_begin[m]);
+    }
+
+    // Greedily match each mesh against the unique meshes found so far.
+    // The matching is done in order, so the first occurrence of a mesh is always the one that is kept.
+    std::vector<TransformedMesh> transformed_meshes(mesh_count);
+    std::unordered_multimap<unsigned long long, Meshes::UID> unique_meshes;
+    std::unordered_multimap<unsigned long long, Meshes::UID> rigid_unique_meshes;
+    std::vector<Meshes::UID> duplicate_meshes;
+    for (int m = 0; m < mesh_count; ++m) {
+        Meshes::UID mesh_ID = meshes_begin[m];
+        TransformedMesh& transformed_mesh = transformed_meshes[m];
+        transformed_mesh = { mesh_ID, Transform::identity() };
+
+        bool is_duplicate = false;
+        auto identical_candidates = unique_meshes.equal_range(hashes[m]);
+        for (auto itr = identical_candidates.first; itr != identical_candidates.second && !is_duplicate; ++itr)
+            if (equal(itr->second, mesh_ID)) {
+                transformed_mesh.mesh_ID = itr->second;
+                is_duplicate = true;
+            }
+
+        if (detect_rigid_transforms && !is_duplicate) {
+            auto rigid_candidates = rigid_unique_meshes.equal_range(rigid_hashes[m]);
+            for (auto itr = rigid_candidates.first; itr != rigid_candidates.second && !is_duplicate; ++itr)
+                if (find_rigid_transform(itr->second, mesh_ID, transformed_mesh.transform)) {
+                    transformed_mesh.mesh_ID = itr->second;
+                    is_duplicate = true;
+                }
+        }
+
+        if (is_duplicate) {
+            // The same mesh can be passed in more than once, in which case it must not be destroyed.
+            if (transformed_mesh.mesh_ID != mesh_ID)
+                duplicate_meshes.push_back(mesh_ID);
+        } else {
+            unique_meshes.emplace(hashes[m], mesh_ID);
+            if (detect_rigid_transforms)
+                rigid_unique_meshes.emplace(rigid_hashes[m], mesh_ID);
+        }
+    }
+
+    for (Meshes::UID mesh_ID : duplicate_meshes)
+        Meshes::destroy(mesh_ID);
+
+    return transformed_meshes;
+}
+
+} // NS MeshUtils
+} // NS Assets
+} // NS Cogwheel
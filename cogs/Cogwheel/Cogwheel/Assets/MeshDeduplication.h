@@ -0,0 +1,63 @@
+// Cogwheel mesh deduplication utilities.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_MESH_DEDUPLICATION_H_
+#define _COGWHEEL_ASSETS_MESH_DEDUPLICATION_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+
+#include <vector>
+
+namespace Cogwheel {
+namespace Assets {
+
+//----------------------------------------------------------------------------
+// Mesh deduplication utilities.
+// Identical meshes are found by hashing their buffers and then comparing
+// the meshes with equal hashes exactly, so hash collisions never merge meshes.
+// Rigid transformed duplicates are found by hashing the buffers that are invariant
+// under rotation, translation and uniform scaling, i.e. the indices and texcoords,
+// and then solving for the transform that maps the positions of one mesh onto the other.
+// Future work:
+// * Detect duplicates with a different vertex order.
+//----------------------------------------------------------------------------
+namespace MeshUtils {
+
+// Hashes the buffers of a mesh. Meshes with identical buffers have identical hashes.
+unsigned long long compute_hash(Meshes::UID mesh_ID);
+
+// Hashes the buffers of a mesh that are invariant under a rigid transformation,
+// i.e. the primitives, texcoords and the handedness of the tangents.
+unsigned long long compute_rigid_invariant_hash(Meshes::UID mesh_ID);
+
+// Returns true if the two meshes have the same buffers with bitwise identical content.
+bool equal(Meshes::UID lhs_ID, Meshes::UID rhs_ID);
+
+// Finds the transform that maps the source mesh onto the target mesh,
+// such that transform * source_position = target_position for all vertices.
+// The meshes must have identical primitives and texcoords and the normals and tangents
+// must be rotated along with the positions.
+// The tolerance is relative to the extent of the target mesh.
+// Returns false if no such transform exists.
+bool find_rigid_transform(Meshes::UID source_ID, Meshes::UID target_ID,
+                          Math::Transform& transform, float relative_tolerance = 0.0001f);
+
+// Collapses identical meshes into one mesh.
+// Returns a mesh and transform pr input mesh, such that the returned mesh transformed by the transform
+// reproduces the input mesh. The first occurrence of a mesh is kept and its duplicates are destroyed.
+// If detect_rigid_transforms is false, then only identical meshes are collapsed and
+// all returned transforms are the identity.
+// The hashes are computed in parallel.
+std::vector<TransformedMesh> deduplicate(const Meshes::UID* meshes_begin, const Meshes::UID* meshes_end,
+                                         bool detect_rigid_transforms = false);
+
+} // NS MeshUtils
+} // NS Assets
+} // NS Cogwheel
+
+#endif // _COGWHEEL_ASSETS_MESH_DEDUPLICATION_H_
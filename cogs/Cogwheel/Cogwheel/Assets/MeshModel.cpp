@@ -65,7 +65,9 @@ void MeshModels::reserve(unsigned int new_capacity) {
 MeshModels::UID MeshModels::create(Scene::SceneNodes::UID scene_node_ID, Assets::Meshes::UID mesh_ID, Assets::Materials::UID material_ID) {
     assert(m_models != nullptr);
 
-    if (!Scene::SceneNodes::has(scene_node_ID) || !Assets::Meshes::has(mesh_ID) || !Assets::Materials::has(material_ID))
+    // Models without a material, e.g. obj shapes without one, use the dummy material stored at the invalid material ID.
+    bool valid_material = Assets::Materials::has(material_ID) || material_ID == Assets::Materials::UID::invalid_UID();
+    if (!Scene::SceneNodes::has(scene_node_ID) || !Assets::Meshes::has(mesh_ID) || !valid_material)
         return MeshModels::UID::invalid_UID();
 
     unsigned int old_capacity = m_UID_generator.capacity();
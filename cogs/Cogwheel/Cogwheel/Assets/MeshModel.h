@@ -23,6 +23,8 @@ namespace Assets {
 //----------------------------------------------------------------------------
 // A mesh model contains the mesh and material IDs and combines them with 
 // the scene node ID.
+// Models can be created without a material, in which case the material ID
+// is invalid and the dummy material is used.
 //----------------------------------------------------------------------------
 class MeshModels final {
 public:
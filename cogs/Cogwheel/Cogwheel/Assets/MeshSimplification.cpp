@@ -0,0 +1,432 @@
+// Cogwheel mesh simplification utilities.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Assets/MeshSimplification.h>
+#include <Cogwheel/Math/Utils.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <string>
+#include <vector>
+
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Assets {
+namespace MeshUtils {
+
+//-----------------------------------------------------------------------------
+// Symmetric 4x4 error quadric stored as its upper triangle.
+// Evaluating the quadric at a point gives the weighted sum of squared distances
+// from the point to the planes that the quadric was constructed from.
+// The accumulated weight is stored as well, such that the quadric error can be
+// converted to a mean squared distance.
+//-----------------------------------------------------------------------------
+struct Quadric {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+    double weight;
+
+    static inline Quadric zero() { Quadric q = {}; return q; }
+
+    static inline Quadric from_plane(double a, double b, double c, double d, double weight) {
+        Quadric q = { a * a * weight, a * b * weight, a * c * weight, a * d * weight, 
+                      b * b * weight, b * c * weight, b * d * weight, 
+                      c * c * weight, c * d * weight, 
+                      d * d * weight, 
+                      weight };
+        return q;
+    }
+
+    inline Quadric& operator+=(const Quadric& rhs) {
+        a2 += rhs.a2; ab += rhs.ab; ac += rhs.ac; ad += rhs.ad;
+        b2 += rhs.b2; bc += rhs.bc; bd += rhs.bd;
+        c2 += rhs.c2; cd += rhs.cd;
+        d2 += rhs.d2;
+        weight += rhs.weight;
+        return *this;
+    }
+
+    inline Quadric operator+(const Quadric& rhs) const {
+        Quadric q = *this;
+        return q += rhs;
+    }
+
+    inline double evaluate(Vector3f p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+                          + b2 * y * y       + 2.0 * bc * y * z + 2.0 * bd * y
+                                             + c2 * z * z       + 2.0 * cd * z
+                                                                + d2;
+    }
+
+    inline double mean_squared_distance(Vector3f p) const {
+        return weight > 0.0 ? evaluate(p) / weight : 0.0;
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Incremental half-edge collapse simplifier.
+// Collapses are kept in a priority queue ordered by their area weighted quadric error.
+// Collapses are invalidated lazily by versioning the vertices, such that a
+// collapse is discarded if either of its vertices changed after it was queued.
+// The simplifier can be run to successively lower primitive counts,
+// which is used to generate a full LOD chain in a single pass.
+//-----------------------------------------------------------------------------
+class QuadricSimplifier final {
+public:
+
+    QuadricSimplifier(const Vector3ui* primitives_begin, const Vector3ui* primitives_end,
+                      const Vector3f* positions, unsigned int vertex_count)
+        : m_positions(positions)
+        , m_primitives(primitives_begin, primitives_end)
+        , m_primitive_alive(m_primitives.size(), 1)
+        , m_live_primitive_count(0u)
+        , m_vertex_primitives(vertex_count)
+        , m_vertex_alive(vertex_count, 1)
+        , m_vertex_locked(vertex_count, 0)
+        , m_vertex_versions(vertex_count, 0u)
+        , m_quadrics(vertex_count, Quadric::zero())
+        , m_max_squared_error(0.0) {
+
+        // Setup the vertex to primitive adjacency and the area weighted quadrics. Degenerate primitives are discarded.
+        std::vector<unsigned long long> edges;
+        edges.reserve(m_primitives.size() * 3);
+        for (unsigned int p = 0; p < m_primitives.size(); ++p) {
+            Vector3ui primitive = m_primitives[p];
+            if (primitive.x == primitive.y || primitive.y == primitive.z || primitive.z == primitive.x) {
+                m_primitive_alive[p] = 0;
+                continue;
+            }
+            ++m_live_primitive_count;
+
+            Vector3f p0 = m_positions[primitive.x], p1 = m_positions[primitive.y], p2 = m_positions[primitive.z];
+            Vector3f normal = cross(p1 - p0, p2 - p0);
+            float normal_length = magnitude(normal);
+            Quadric plane_quadric = Quadric::zero();
+            if (normal_length > 0.0f) {
+                normal /= normal_length;
+                float area = 0.5f * normal_length;
+                plane_quadric = Quadric::from_plane(normal.x, normal.y, normal.z, -dot(normal, p0), area);
+            }
+
+            for (int i = 0; i < 3; ++i) {
+                unsigned int v0 = primitive[i], v1 = primitive[(i + 1) % 3];
+                m_vertex_primitives[v0].push_back(p);
+                m_quadrics[v0] += plane_quadric;
+                edges.push_back(edge_key(v0, v1));
+            }
+        }
+
+        // Lock the vertices of boundary and non-manifold edges, i.e. edges that aren't shared by exactly two primitives.
+        std::sort(edges.begin(), edges.end());
+        size_t edge_begin = 0;
+        while (edge_begin < edges.size()) {
+            size_t edge_end = edge_begin + 1;
+            while (edge_end < edges.size() && edges[edge_end] == edges[edge_begin])
+                ++edge_end;
+
+            unsigned int v0 = (unsigned int)(edges[edge_begin] >> 32), v1 = (unsigned int)edges[edge_begin];
+            if (edge_end - edge_begin != 2)
+                m_vertex_locked[v0] = m_vertex_locked[v1] = 1;
+
+            edge_begin = edge_end;
+        }
+
+        // Queue the initial collapses.
+        for (size_t e = 0; e < edges.size(); ++e) {
+            if (e > 0 && edges[e] == edges[e - 1])
+                continue;
+            unsigned int v0 = (unsigned int)(edges[e] >> 32), v1 = (unsigned int)edges[e];
+            queue_collapse(v0, v1);
+            queue_collapse(v1, v0);
+        }
+    }
+
+    inline unsigned int get_primitive_count() const { return m_live_primitive_count; }
+
+    // The approximate geometric error is the largest root mean squared distance
+    // between a collapsed vertex and the planes of the primitives it represents.
+    inline float get_error() const { return float(sqrt(m_max_squared_error)); }
+
+    void collapse_until(unsigned int target_primitive_count) {
+        while (m_live_primitive_count > target_primitive_count && !m_collapses.empty()) {
+            Collapse collapse = m_collapses.top();
+            m_collapses.pop();
+
+            bool is_outdated = !m_vertex_alive[collapse.from] || !m_vertex_alive[collapse.to] ||
+                m_vertex_versions[collapse.from] != collapse.from_version ||
+                m_vertex_versions[collapse.to] != collapse.to_version;
+            if (is_outdated || !is_valid_collapse(collapse.from, collapse.to))
+                continue;
+
+            perform_collapse(collapse.from, collapse.to);
+            m_max_squared_error = max(m_max_squared_error, collapse.squared_error);
+        }
+    }
+
+    // Extracts the live primitives with compacted vertex indices
+    // and the map from the compacted vertex indices to the original vertex indices.
+    void extract(std::vector<Vector3ui>& primitives, std::vector<unsigned int>& vertex_map) const {
+        std::vector<int> compacted_indices(m_vertex_primitives.size(), -1);
+        primitives.clear();
+        primitives.reserve(m_live_primitive_count);
+        vertex_map.clear();
+        for (unsigned int p = 0; p < m_primitives.size(); ++p) {
+            if (!m_primitive_alive[p])
+                continue;
+
+            Vector3ui primitive = m_primitives[p];
+            for (int i = 0; i < 3; ++i) {
+                unsigned int vertex_index = primitive[i];
+                if (compacted_indices[vertex_index] < 0) {
+                    compacted_indices[vertex_index] = int(vertex_map.size());
+                    vertex_map.push_back(vertex_index);
+                }
+                primitive[i] = compacted_indices[vertex_index];
+            }
+            primitives.push_back(primitive);
+        }
+    }
+
+private:
+
+    struct Collapse {
+        double cost;
+        double squared_error;
+        unsigned int from, to;
+        unsigned int from_version, to_version;
+
+        inline bool operator>(const Collapse& rhs) const { return cost > rhs.cost; }
+    };
+
+    static inline unsigned long long edge_key(unsigned int v0, unsigned int v1) {
+        unsigned long long min_index = min(v0, v1), max_index = max(v0, v1);
+        return (min_index << 32) | max_index;
+    }
+
+    inline void queue_collapse(unsigned int from, unsigned int to) {
+        if (m_vertex_locked[from])
+            return;
+        Quadric quadric = m_quadrics[from] + m_quadrics[to];
+        Vector3f position = m_positions[to];
+        Collapse collapse = { max(0.0, quadric.evaluate(position)), max(0.0, quadric.mean_squared_distance(position)), 
+                              from, to, m_vertex_versions[from], m_vertex_versions[to] };
+        m_collapses.push(collapse);
+    }
+
+    template <typename F>
+    inline void for_each_neighbour(unsigned int vertex_index, F& function) const {
+        for (unsigned int p : m_vertex_primitives[vertex_index]) {
+            Vector3ui primitive = m_primitives[p];
+            for (int i = 0; i < 3; ++i)
+                if (primitive[i] != vertex_index)
+                    function(primitive[i]);
+        }
+    }
+
+    inline std::vector<unsigned int> get_neighbours(unsigned int vertex_index) const {
+        std::vector<unsigned int> neighbours;
+        neighbours.reserve(m_vertex_primitives[vertex_index].size() * 2);
+        auto add_neighbour = [&](unsigned int neighbour_index) { neighbours.push_back(neighbour_index); };
+        for_each_neighbour(vertex_index, add_neighbour);
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        return neighbours;
+    }
+
+    inline static bool contains(Vector3ui primitive, unsigned int vertex_index) {
+        return primitive.x == vertex_index || primitive.y == vertex_index || primitive.z == vertex_index;
+    }
+
+    bool is_valid_collapse(unsigned int from, unsigned int to) const {
+        // The link condition. The vertices of the edge may only share the neighbours opposite the edge,
+        // otherwise the collapse will create non-manifold geometry.
+        unsigned int shared_primitive_count = 0;
+        for (unsigned int p : m_vertex_primitives[from])
+            shared_primitive_count += contains(m_primitives[p], to) ? 1 : 0;
+        if (shared_primitive_count == 0)
+            return false;
+
+        std::vector<unsigned int> from_neighbours = get_neighbours(from);
+        std::vector<unsigned int> to_neighbours = get_neighbours(to);
+        std::vector<unsigned int> shared_neighbours;
+        std::set_intersection(from_neighbours.begin(), from_neighbours.end(), to_neighbours.begin(), to_neighbours.end(),
+                              std::back_inserter(shared_neighbours));
+        if (shared_neighbours.size() != shared_primitive_count)
+            return false;
+
+        // Reject the collapse if it flips or degenerates any of the remaining primitives.
+        Vector3f new_position = m_positions[to];
+        for (unsigned int p : m_vertex_primitives[from]) {
+            Vector3ui primitive = m_primitives[p];
+            if (contains(primitive, to))
+                continue;
+
+            Vector3f p0 = m_positions[primitive.x], p1 = m_positions[primitive.y], p2 = m_positions[primitive.z];
+            Vector3f old_normal = cross(p1 - p0, p2 - p0);
+            if (primitive.x == from) p0 = new_position;
+            if (primitive.y == from) p1 = new_position;
+            if (primitive.z == from) p2 = new_position;
+            Vector3f new_normal = cross(p1 - p0, p2 - p0);
+
+            float new_normal_length_squared = magnitude_squared(new_normal);
+            if (new_normal_length_squared == 0.0f)
+                return false;
+            float cos_theta = dot(old_normal, new_normal) / sqrt(magnitude_squared(old_normal) * new_normal_length_squared);
+            if (!(cos_theta > 0.2f))
+                return false;
+        }
+
+        return true;
+    }
+
+    void perform_collapse(unsigned int from, unsigned int to) {
+        for (unsigned int p : m_vertex_primitives[from]) {
+            Vector3ui& primitive = m_primitives[p];
+            if (contains(primitive, to)) {
+                // The primitive collapses. Remove it from its remaining vertices.
+                m_primitive_alive[p] = 0;
+                --m_live_primitive_count;
+                for (int i = 0; i < 3; ++i) {
+                    if (primitive[i] == from)
+                        continue;
+                    std::vector<unsigned int>& vertex_primitives = m_vertex_primitives[primitive[i]];
+                    auto primitive_itr = std::find(vertex_primitives.begin(), vertex_primitives.end(), p);
+                    *primitive_itr = vertex_primitives.back();
+                    vertex_primitives.pop_back();
+                }
+            } else {
+                for (int i = 0; i < 3; ++i)
+                    if (primitive[i] == from)
+                        primitive[i] = to;
+                m_vertex_primitives[to].push_back(p);
+            }
+        }
+
+        m_vertex_primitives[from].clear();
+        m_vertex_alive[from] = 0;
+        m_quadrics[to] += m_quadrics[from];
+        ++m_vertex_versions[to];
+
+        // Requeue the collapses around the new vertex, as its quadric changed.
+        for (unsigned int neighbour : get_neighbours(to)) {
+            queue_collapse(to, neighbour);
+            queue_collapse(neighbour, to);
+        }
+    }
+
+    const Vector3f* m_positions;
+
+    std::vector<Vector3ui> m_primitives;
+    std::vector<unsigned char> m_primitive_alive;
+    unsigned int m_live_primitive_count;
+
+    std::vector<std::vector<unsigned int>> m_vertex_primitives;
+    std::vector<unsigned char> m_vertex_alive;
+    std::vector<unsigned char> m_vertex_locked;
+    std::vector<unsigned int> m_vertex_versions;
+    std::vector<Quadric> m_quadrics;
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> m_collapses;
+    double m_max_squared_error;
+};
+
+// Creates a mesh from the current state of the simplifier.
+// The vertex attributes are copied from the source mesh, as the collapses never move a vertex.
+static Meshes::UID create_simplified_mesh(const std::string& name, Mesh source_mesh, const QuadricSimplifier& simplifier) {
+    std::vector<Vector3ui> primitives;
+    std::vector<unsigned int> vertex_map;
+    simplifier.extract(primitives, vertex_map);
+    const int vertex_count = int(vertex_map.size());
+
+    Meshes::UID mesh_ID;
+    #pragma omp critical
+    {
+        mesh_ID = Meshes::create(name, (unsigned int)primitives.size(), vertex_count, source_mesh.get_flags());
+    }
+    Mesh mesh = mesh_ID;
+
+    std::copy(primitives.begin(), primitives.end(), mesh.get_primitives());
+
+    const Vector3f* source_positions = source_mesh.get_positions();
+    const Vector3f* source_normals = source_mesh.get_normals();
+    const Vector2f* source_texcoords = source_mesh.get_texcoords();
+    const Vector4f* source_tangents = source_mesh.get_tangents();
+    Vector3f* positions = mesh.get_positions();
+    Vector3f* normals = mesh.get_normals();
+    Vector2f* texcoords = mesh.get_texcoords();
+    Vector4f* tangents = mesh.get_tangents();
+    for (int v = 0; v < vertex_count; ++v) {
+        unsigned int source_index = vertex_map[v];
+        positions[v] = source_positions[source_index];
+        if (normals)
+            normals[v] = source_normals[source_index];
+        if (texcoords)
+            texcoords[v] = source_texcoords[source_index];
+        if (tangents)
+            tangents[v] = source_tangents[source_index];
+    }
+
+    if (vertex_count > 0)
+        mesh.compute_bounds();
+
+    return mesh_ID;
+}
+
+Meshes::LOD simplify(Meshes::UID mesh_ID, unsigned int target_primitive_count) {
+    Mesh mesh = mesh_ID;
+    QuadricSimplifier simplifier(mesh.get_primitives(), mesh.get_primitives() + mesh.get_primitive_count(),
+                                 mesh.get_positions(), mesh.get_vertex_count());
+    simplifier.collapse_until(target_primitive_count);
+
+    Meshes::LOD lod = { create_simplified_mesh(mesh.get_name() + " simplified", mesh, simplifier), simplifier.get_error() };
+    return lod;
+}
+
+void generate_LODs(const Meshes::UID* meshes_begin, const Meshes::UID* meshes_end,
+                   unsigned int LOD_count, float primitive_reduction) {
+    const int mesh_count = int(meshes_end - meshes_begin);
+
+    // Reserve room for all LODs up front, so the mesh buffers aren't reallocated
+    // while other threads are reading from them.
+    Meshes::reserve(Meshes::capacity() + mesh_count * LOD_count + 1);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int m = 0; m < mesh_count; ++m) {
+        Mesh mesh = meshes_begin[m];
+        QuadricSimplifier simplifier(mesh.get_primitives(), mesh.get_primitives() + mesh.get_primitive_count(),
+                                     mesh.get_positions(), mesh.get_vertex_count());
+
+        // Simplify the mesh successively, creating a new LOD every time the target is reached.
+        std::vector<Meshes::LOD> LODs;
+        LODs.reserve(LOD_count);
+        unsigned int previous_primitive_count = mesh.get_primitive_count();
+        for (unsigned int level = 0; level < LOD_count; ++level) {
+            simplifier.collapse_until((unsigned int)(previous_primitive_count * primitive_reduction));
+            if (simplifier.get_primitive_count() == previous_primitive_count)
+                break;
+            previous_primitive_count = simplifier.get_primitive_count();
+
+            std::string name = mesh.get_name() + " LOD " + std::to_string(level);
+            Meshes::LOD lod = { create_simplified_mesh(name, mesh, simplifier), simplifier.get_error() };
+            LODs.push_back(lod);
+        }
+
+        #pragma omp critical
+        {
+            Meshes::set_LODs(mesh.get_ID(), LODs);
+        }
+    }
+}
+
+} // NS MeshUtils
+} // NS Assets
+} // NS Cogwheel
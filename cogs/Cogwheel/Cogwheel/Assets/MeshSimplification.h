@@ -0,0 +1,50 @@
+// Cogwheel mesh simplification utilities.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_MESH_SIMPLIFICATION_H_
+#define _COGWHEEL_ASSETS_MESH_SIMPLIFICATION_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+
+namespace Cogwheel {
+namespace Assets {
+
+//----------------------------------------------------------------------------
+// Mesh simplification utilities.
+// Meshes are simplified by quadric error metric edge collapses, see
+// Garland and Heckbert, Surface Simplification Using Quadric Error Metrics, 1997.
+// Edges are collapsed onto one of their existing vertices, so normals, texcoords
+// and tangents are preserved as is. Vertices on boundary and non-manifold edges
+// are locked, which also keeps attribute seams, as those are boundaries in
+// the index buffer.
+// Future work:
+// * Optimal vertex placement and attribute interpolation along the collapsed edge.
+//----------------------------------------------------------------------------
+namespace MeshUtils {
+
+// Simplifies a mesh until it has at most target_primitive_count primitives
+// or no more edges can be collapsed.
+// Returns the simplified mesh and its error relative to the input mesh.
+Meshes::LOD simplify(Meshes::UID mesh_ID, unsigned int target_primitive_count);
+
+// Generates a LOD chain for each mesh and stores it in Meshes.
+// Each LOD has primitive_reduction times the primitives of the previous level.
+// The chain stops early when a level can't be reduced any further.
+// The meshes are simplified in parallel.
+void generate_LODs(const Meshes::UID* meshes_begin, const Meshes::UID* meshes_end,
+                   unsigned int LOD_count, float primitive_reduction = 0.5f);
+
+inline void generate_LODs(Meshes::UID mesh_ID, unsigned int LOD_count, float primitive_reduction = 0.5f) {
+    generate_LODs(&mesh_ID, &mesh_ID + 1, LOD_count, primitive_reduction);
+}
+
+} // NS MeshUtils
+} // NS Assets
+} // NS Cogwheel
+
+#endif // _COGWHEEL_ASSETS_MESH_SIMPLIFICATION_H_
@@ -0,0 +1,214 @@
+// Cogwheel mesh validation.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Assets/MeshValidation.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Assets {
+namespace MeshTests {
+
+typedef ValidationReport::Issues Issues;
+
+static inline void add_issue(Issues& issues, unsigned int index, unsigned int max_reported_issues) {
+    if (issues.count++ < max_reported_issues)
+        issues.indices.push_back(index);
+}
+
+// Appends the issues of a later chunk to the issues found so far.
+static inline void merge_issues(Issues& issues, const Issues& chunk_issues, unsigned int max_reported_index_count) {
+    issues.count += chunk_issues.count;
+    size_t free_index_count = max_reported_index_count - std::min<size_t>(max_reported_index_count, issues.indices.size());
+    size_t index_count = std::min(chunk_issues.indices.size(), free_index_count);
+    issues.indices.insert(issues.indices.end(), chunk_issues.indices.begin(), chunk_issues.indices.begin() + index_count);
+}
+
+template<template<typename> class Vector>
+static inline bool is_finite(Vector<float> v) {
+    for (int i = 0; i < Vector<float>::N; ++i)
+        if (!std::isfinite(v[i]))
+            return false;
+    return true;
+}
+
+static inline Issues empty_issues() {
+    Issues issues = { 0u, std::vector<unsigned int>() };
+    return issues;
+}
+
+static inline ValidationReport empty_report(Meshes::UID mesh_ID) {
+    ValidationReport report = { mesh_ID, empty_issues(), empty_issues(), empty_issues(), empty_issues(), empty_issues(), empty_issues() };
+    return report;
+}
+
+std::vector<ValidationReport> validate(const Meshes::UID* meshes_begin, const Meshes::UID* meshes_end,
+                                       float epsilon_squared, unsigned int max_reported_issues) {
+    const int mesh_count = int(meshes_end - meshes_begin);
+
+    std::vector<ValidationReport> reports;
+    reports.reserve(mesh_count);
+    for (int m = 0; m < mesh_count; ++m)
+        reports.push_back(empty_report(meshes_begin[m]));
+
+    // Split the primitives and vertices of all meshes into chunks, so large meshes are distributed across all threads.
+    // The chunks of a mesh are ordered by their first element, which keeps the reported indices sorted when merging.
+    struct Chunk {
+        int mesh_index;
+        bool is_primitive_chunk;
+        unsigned int begin, end;
+        ValidationReport report;
+    };
+    const unsigned int chunk_size = 16384u;
+    std::vector<Chunk> chunks;
+    for (int m = 0; m < mesh_count; ++m) {
+        Mesh mesh = meshes_begin[m];
+        for (unsigned int begin = 0; begin < mesh.get_primitive_count(); begin += chunk_size) {
+            Chunk chunk = { m, true, begin, min(begin + chunk_size, mesh.get_primitive_count()), empty_report(mesh.get_ID()) };
+            chunks.push_back(chunk);
+        }
+        for (unsigned int begin = 0; begin < mesh.get_vertex_count(); begin += chunk_size) {
+            Chunk chunk = { m, false, begin, min(begin + chunk_size, mesh.get_vertex_count()), empty_report(mesh.get_ID()) };
+            chunks.push_back(chunk);
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < int(chunks.size()); ++c) {
+        Chunk& chunk = chunks[c];
+        ValidationReport& report = chunk.report;
+        Mesh mesh = meshes_begin[chunk.mesh_index];
+        const unsigned int vertex_count = mesh.get_vertex_count();
+        const Vector3f* positions = mesh.get_positions();
+        const Vector3f* normals = mesh.get_normals();
+
+        if (chunk.is_primitive_chunk) {
+            const Vector3ui* primitives = mesh.get_primitives();
+            for (unsigned int p = chunk.begin; p < chunk.end; ++p) {
+                Vector3ui primitive = primitives[p];
+                if (primitive.x >= vertex_count || primitive.y >= vertex_count || primitive.z >= vertex_count) {
+                    add_issue(report.invalid_indices, p, max_reported_issues);
+                    continue;
+                }
+
+                Vector3f p0 = positions[primitive.x], p1 = positions[primitive.y], p2 = positions[primitive.z];
+
+                bool degenerate_indices = primitive.x == primitive.y || primitive.x == primitive.z || primitive.y == primitive.z;
+                bool degenerate_positions = magnitude_squared(p0 - p1) < epsilon_squared ||
+                                            magnitude_squared(p0 - p2) < epsilon_squared ||
+                                            magnitude_squared(p1 - p2) < epsilon_squared;
+                if (degenerate_indices || degenerate_positions)
+                    add_issue(report.degenerate_primitives, p, max_reported_issues);
+
+                if (normals != nullptr) {
+                    Vector3f primitive_normal = cross(p1 - p0, p2 - p0); // Not normalized, as we only care about the sign of the dot product below.
+                    if (dot(primitive_normal, normals[primitive.x]) <= 0.0f ||
+                        dot(primitive_normal, normals[primitive.y]) <= 0.0f ||
+                        dot(primitive_normal, normals[primitive.z]) <= 0.0f)
+                        add_issue(report.inverted_primitives, p, max_reported_issues);
+                }
+            }
+        } else {
+            const Vector2f* texcoords = mesh.get_texcoords();
+            const Vector4f* tangents = mesh.get_tangents();
+            for (unsigned int v = chunk.begin; v < chunk.end; ++v) {
+                bool is_vertex_finite = is_finite(positions[v]) &&
+                                        (normals == nullptr || is_finite(normals[v])) &&
+                                        (texcoords == nullptr || is_finite(texcoords[v])) &&
+                                        (tangents == nullptr || is_finite(tangents[v]));
+                if (!is_vertex_finite)
+                    add_issue(report.non_finite_vertices, v, max_reported_issues);
+            }
+        }
+    }
+
+    for (Chunk& chunk : chunks) {
+        ValidationReport& report = reports[chunk.mesh_index];
+        merge_issues(report.invalid_indices, chunk.report.invalid_indices, max_reported_issues);
+        merge_issues(report.degenerate_primitives, chunk.report.degenerate_primitives, max_reported_issues);
+        merge_issues(report.inverted_primitives, chunk.report.inverted_primitives, max_reported_issues);
+        merge_issues(report.non_finite_vertices, chunk.report.non_finite_vertices, max_reported_issues);
+    }
+
+    // Edge and vertex reference checks using the vertex adjacency.
+    for (int m = 0; m < mesh_count; ++m) {
+        ValidationReport& report = reports[m];
+        Mesh mesh = meshes_begin[m];
+        if (mesh.get_primitive_count() == 0 || !report.invalid_indices.is_empty())
+            continue;
+
+        const unsigned int vertex_count = mesh.get_vertex_count();
+        const Vector3ui* primitives = mesh.get_primitives();
+        MeshUtils::VertexAdjacency adjacency = MeshUtils::compute_vertex_adjacency(mesh.get_ID());
+
+        // Each edge is checked by its lowest indexed vertex, which gathers the higher indexed vertices
+        // of its primitives. An edge shared by more than two primitives shows up more than twice.
+        std::vector<ValidationReport> vertex_chunk_reports(ceil_divide(vertex_count, chunk_size), empty_report(mesh.get_ID()));
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int c = 0; c < int(vertex_chunk_reports.size()); ++c) {
+            ValidationReport& chunk_report = vertex_chunk_reports[c];
+            unsigned int chunk_begin = c * chunk_size;
+            unsigned int chunk_end = min(chunk_begin + chunk_size, vertex_count);
+            std::vector<unsigned int> neighbours;
+            for (unsigned int v = chunk_begin; v < chunk_end; ++v) {
+                if (adjacency.get_corner_count(v) == 0) {
+                    add_issue(chunk_report.unreferenced_vertices, v, max_reported_issues);
+                    continue;
+                }
+
+                neighbours.clear();
+                for (unsigned int corner : adjacency.get_corners(v)) {
+                    const unsigned int* primitive = primitives[corner / 3].begin();
+                    unsigned int next_vertex = primitive[(corner + 1) % 3];
+                    unsigned int previous_vertex = primitive[(corner + 2) % 3];
+                    if (next_vertex > v)
+                        neighbours.push_back(next_vertex);
+                    if (previous_vertex > v)
+                        neighbours.push_back(previous_vertex);
+                }
+                std::sort(neighbours.begin(), neighbours.end());
+
+                for (size_t i = 0; i < neighbours.size();) {
+                    size_t run_end = i + 1;
+                    while (run_end < neighbours.size() && neighbours[run_end] == neighbours[i])
+                        ++run_end;
+                    if (run_end - i > 2) {
+                        Issues& edges = chunk_report.non_manifold_edges;
+                        if (edges.count++ < max_reported_issues) {
+                            edges.indices.push_back(v);
+                            edges.indices.push_back(neighbours[i]);
+                        }
+                    }
+                    i = run_end;
+                }
+            }
+        }
+
+        for (ValidationReport& chunk_report : vertex_chunk_reports) {
+            merge_issues(report.unreferenced_vertices, chunk_report.unreferenced_vertices, max_reported_issues);
+            merge_issues(report.non_manifold_edges, chunk_report.non_manifold_edges, 2 * max_reported_issues);
+        }
+    }
+
+    return reports;
+}
+
+std::vector<ValidationReport> validate_all(float epsilon_squared, unsigned int max_reported_issues) {
+    std::vector<Meshes::UID> mesh_IDs;
+    mesh_IDs.reserve(Meshes::capacity());
+    for (Meshes::UID mesh_ID : Meshes::get_iterable())
+        mesh_IDs.push_back(mesh_ID);
+    return validate(mesh_IDs.data(), mesh_IDs.data() + mesh_IDs.size(), epsilon_squared, max_reported_issues);
+}
+
+} // NS MeshTests
+} // NS Assets
+} // NS Cogwheel
@@ -0,0 +1,78 @@
+// Cogwheel mesh validation.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_MESH_VALIDATION_H_
+#define _COGWHEEL_ASSETS_MESH_VALIDATION_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+
+#include <vector>
+
+namespace Cogwheel {
+namespace Assets {
+
+//----------------------------------------------------------------------------
+// Mesh validation.
+// All checks are performed in a single pass over the primitives and vertices
+// of the meshes, which are split into chunks and processed in parallel,
+// followed by a parallel pass over the vertex adjacency for the edge checks.
+// The reports contain the number of issues found and a capped list of the
+// offending primitives, vertices or edges. The lists hold the lowest indices,
+// so the reports are deterministic.
+// Future work:
+// * Check that the tangents are orthogonal to the normals.
+//----------------------------------------------------------------------------
+namespace MeshTests {
+
+struct ValidationReport {
+    struct Issues {
+        unsigned int count;
+        std::vector<unsigned int> indices;
+
+        inline bool is_empty() const { return count == 0; }
+    };
+
+    Meshes::UID mesh_ID;
+
+    // Primitive issues. The indices are primitive indices.
+    Issues invalid_indices;       // Primitives indexing out of bounds. These are skipped by the other checks.
+    Issues degenerate_primitives; // Primitives with repeated indices or edges shorter than the epsilon.
+    Issues inverted_primitives;   // Primitives whose winding order doesn't correspond to their vertex normals.
+
+    // Vertex issues. The indices are vertex indices.
+    Issues non_finite_vertices;   // Vertices with NaN or infinite attributes.
+    Issues unreferenced_vertices; // Vertices not referenced by any primitive.
+
+    // Edge issues. The indices are pairs of vertex indices.
+    Issues non_manifold_edges;    // Edges shared by more than two primitives.
+
+    inline bool is_valid() const {
+        return invalid_indices.is_empty() && degenerate_primitives.is_empty() && inverted_primitives.is_empty() &&
+            non_finite_vertices.is_empty() && unreferenced_vertices.is_empty() && non_manifold_edges.is_empty();
+    }
+};
+
+// Validates the meshes and returns a report pr mesh.
+// At most max_reported_issues indices are stored pr issue. By default only the issues are counted.
+// The unreferenced vertex and non-manifold edge checks require valid indices and are
+// skipped for meshes with invalid indices and for meshes without primitives.
+std::vector<ValidationReport> validate(const Meshes::UID* meshes_begin, const Meshes::UID* meshes_end,
+                                       float epsilon_squared = 0.000001f, unsigned int max_reported_issues = 0u);
+
+inline ValidationReport validate(Meshes::UID mesh_ID, float epsilon_squared = 0.000001f, unsigned int max_reported_issues = 0u) {
+    return validate(&mesh_ID, &mesh_ID + 1, epsilon_squared, max_reported_issues)[0];
+}
+
+// Validates all meshes in Meshes.
+std::vector<ValidationReport> validate_all(float epsilon_squared = 0.000001f, unsigned int max_reported_issues = 0u);
+
+} // NS MeshTests
+} // NS Assets
+} // NS Cogwheel
+
+#endif // _COGWHEEL_ASSETS_MESH_VALIDATION_H_
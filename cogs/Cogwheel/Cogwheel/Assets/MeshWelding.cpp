@@ -0,0 +1,202 @@
+// Cogwheel mesh welding utilities.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Assets/MeshWelding.h>
+#include <Cogwheel/Math/RNG.h>
+#include <Cogwheel/Math/Utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Assets {
+namespace MeshUtils {
+
+// Returns the grid cell containing the position.
+// The cell coordinates are clamped to keep the conversion to int well defined for huge positions or tiny cells.
+static inline Vector3i compute_cell(Vector3f position, float inverse_cell_size) {
+    const float max_cell = 1073741824.0f; // 2^30
+    Vector3f cell = Vector3f(floor(position.x * inverse_cell_size), floor(position.y * inverse_cell_size), floor(position.z * inverse_cell_size));
+    return Vector3i(int(clamp(cell.x, -max_cell, max_cell)), int(clamp(cell.y, -max_cell, max_cell)), int(clamp(cell.z, -max_cell, max_cell)));
+}
+
+static inline unsigned int hash_cell(Vector3i cell, unsigned int bucket_mask) {
+    return RNG::teschner_hash((unsigned int)cell.x, (unsigned int)cell.y, (unsigned int)cell.z) & bucket_mask;
+}
+
+WeldedMesh weld(Meshes::UID mesh_ID, float position_epsilon, float normal_epsilon, float texcoord_epsilon) {
+    Mesh mesh = mesh_ID;
+    const unsigned int vertex_count = mesh.get_vertex_count();
+    const Vector3f* positions = mesh.get_positions();
+    const Vector3f* normals = mesh.get_normals();
+    const Vector2f* texcoords = mesh.get_texcoords();
+    const Vector4f* tangents = mesh.get_tangents();
+    const Vector3ui* primitives = mesh.get_primitives();
+
+    // Triangle soups are welded as if they had an index buffer with one primitive per three vertices.
+    const bool is_triangle_soup = mesh.get_primitive_count() == 0;
+    const unsigned int primitive_count = is_triangle_soup ? vertex_count / 3 : mesh.get_primitive_count();
+    auto get_primitive = [=](unsigned int p) -> Vector3ui {
+        return is_triangle_soup ? Vector3ui(p * 3, p * 3 + 1, p * 3 + 2) : primitives[p];
+    };
+
+    // Compute the grid cell of each vertex.
+    const float inverse_cell_size = position_epsilon > 0.0f ? 1.0f / position_epsilon : 1.0f;
+    std::vector<Vector3i> cells(vertex_count);
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < int(vertex_count); ++v)
+        cells[v] = compute_cell(positions[v], inverse_cell_size);
+
+    // Sort the vertices into the hash buckets using a counting sort.
+    // The vertices in a bucket are sorted by index, so the lowest indexed match is found first.
+    const unsigned int bucket_count = next_power_of_two(max(vertex_count, 1u));
+    const unsigned int bucket_mask = bucket_count - 1;
+    std::unique_ptr<std::atomic<unsigned int>[]> counters(new std::atomic<unsigned int>[bucket_count]);
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < int(bucket_count); ++b)
+        counters[b].store(0u, std::memory_order_relaxed);
+
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < int(vertex_count); ++v)
+        counters[hash_cell(cells[v], bucket_mask)].fetch_add(1u, std::memory_order_relaxed);
+
+    std::vector<unsigned int> bucket_offsets(bucket_count + 1);
+    unsigned int bucket_offset = 0u;
+    for (unsigned int b = 0; b < bucket_count; ++b) {
+        bucket_offsets[b] = bucket_offset;
+        bucket_offset += counters[b].load(std::memory_order_relaxed);
+        counters[b].store(bucket_offsets[b], std::memory_order_relaxed);
+    }
+    bucket_offsets[bucket_count] = bucket_offset;
+
+    std::vector<unsigned int> bucket_vertices(vertex_count);
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < int(vertex_count); ++v) {
+        unsigned int index = counters[hash_cell(cells[v], bucket_mask)].fetch_add(1u, std::memory_order_relaxed);
+        bucket_vertices[index] = v;
+    }
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int b = 0; b < int(bucket_count); ++b)
+        std::sort(bucket_vertices.begin() + bucket_offsets[b], bucket_vertices.begin() + bucket_offsets[b + 1]);
+
+    // Find the lowest indexed matching vertex of each vertex.
+    const float position_epsilon_squared = position_epsilon * position_epsilon;
+    const float normal_epsilon_squared = normal_epsilon * normal_epsilon;
+    const float texcoord_epsilon_squared = texcoord_epsilon * texcoord_epsilon;
+    auto vertices_match = [=](unsigned int u, unsigned int v) -> bool {
+        if (magnitude_squared(positions[u] - positions[v]) > position_epsilon_squared)
+            return false;
+        if (normals != nullptr && magnitude_squared(normals[u] - normals[v]) > normal_epsilon_squared)
+            return false;
+        if (texcoords != nullptr && magnitude_squared(texcoords[u] - texcoords[v]) > texcoord_epsilon_squared)
+            return false;
+        if (tangents != nullptr) {
+            Vector4f tangent_u = tangents[u], tangent_v = tangents[v];
+            if (tangent_u.w != tangent_v.w || magnitude_squared(Vector3f(tangent_u.x - tangent_v.x, tangent_u.y - tangent_v.y, tangent_u.z - tangent_v.z)) > normal_epsilon_squared)
+                return false;
+        }
+        return true;
+    };
+
+    // With a zero epsilon all matching vertices are in the same cell.
+    const int search_radius = position_epsilon > 0.0f ? 1 : 0;
+    std::vector<unsigned int> representatives(vertex_count);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < int(vertex_count); ++v) {
+        unsigned int representative = v;
+        Vector3i cell = cells[v];
+        for (int z = -search_radius; z <= search_radius; ++z)
+            for (int y = -search_radius; y <= search_radius; ++y)
+                for (int x = -search_radius; x <= search_radius; ++x) {
+                    Vector3i neighbour_cell = Vector3i(cell.x + x, cell.y + y, cell.z + z);
+                    unsigned int bucket = hash_cell(neighbour_cell, bucket_mask);
+                    for (unsigned int i = bucket_offsets[bucket]; i < bucket_offsets[bucket + 1]; ++i) {
+                        unsigned int u = bucket_vertices[i];
+                        if (u >= representative)
+                            break;
+                        if (cells[u] == neighbour_cell && vertices_match(u, v))
+                            representative = u;
+                    }
+                }
+        representatives[v] = representative;
+    }
+
+    // Assign the new vertex indices in the order of the input vertices.
+    // The representative of a vertex always has a lower index, so following the representatives
+    // resolves chains of welded vertices onto the first vertex in the chain.
+    std::vector<unsigned int> vertex_remap(vertex_count);
+    std::vector<unsigned int> welded_vertices;
+    welded_vertices.reserve(vertex_count);
+    for (unsigned int v = 0; v < vertex_count; ++v) {
+        if (representatives[v] == v) {
+            vertex_remap[v] = (unsigned int)welded_vertices.size();
+            welded_vertices.push_back(v);
+        } else
+            vertex_remap[v] = vertex_remap[representatives[v]];
+    }
+    const unsigned int welded_vertex_count = (unsigned int)welded_vertices.size();
+
+    // Remap the primitives and flag the ones that degenerated.
+    std::vector<Vector3ui> remapped_primitives(primitive_count);
+    std::vector<unsigned int> primitive_offsets(primitive_count + 1);
+    #pragma omp parallel for schedule(static)
+    for (int p = 0; p < int(primitive_count); ++p) {
+        Vector3ui primitive = get_primitive(p);
+        Vector3ui remapped_primitive = Vector3ui(vertex_remap[primitive.x], vertex_remap[primitive.y], vertex_remap[primitive.z]);
+        remapped_primitives[p] = remapped_primitive;
+        bool is_degenerate = remapped_primitive.x == remapped_primitive.y || remapped_primitive.y == remapped_primitive.z || remapped_primitive.z == remapped_primitive.x;
+        primitive_offsets[p] = is_degenerate ? 0u : 1u;
+    }
+
+    // Exclusive prefix sum over the kept primitives.
+    unsigned int welded_primitive_count = 0u;
+    for (unsigned int p = 0; p < primitive_count; ++p) {
+        unsigned int is_kept = primitive_offsets[p];
+        primitive_offsets[p] = welded_primitive_count;
+        welded_primitive_count += is_kept;
+    }
+    primitive_offsets[primitive_count] = welded_primitive_count;
+
+    Mesh welded_mesh = Meshes::create(mesh.get_name(), welded_primitive_count, welded_vertex_count, mesh.get_flags());
+
+    Vector3ui* welded_primitives = welded_mesh.get_primitives();
+    #pragma omp parallel for schedule(static)
+    for (int p = 0; p < int(primitive_count); ++p)
+        if (primitive_offsets[p] != primitive_offsets[p + 1])
+            welded_primitives[primitive_offsets[p]] = remapped_primitives[p];
+
+    Vector3f* welded_positions = welded_mesh.get_positions();
+    Vector3f* welded_normals = welded_mesh.get_normals();
+    Vector2f* welded_texcoords = welded_mesh.get_texcoords();
+    Vector4f* welded_tangents = welded_mesh.get_tangents();
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < int(welded_vertex_count); ++v) {
+        unsigned int source_vertex = welded_vertices[v];
+        welded_positions[v] = positions[source_vertex];
+        if (normals != nullptr)
+            welded_normals[v] = normals[source_vertex];
+        if (texcoords != nullptr)
+            welded_texcoords[v] = texcoords[source_vertex];
+        if (tangents != nullptr)
+            welded_tangents[v] = tangents[source_vertex];
+    }
+
+    welded_mesh.compute_bounds();
+
+    WeldedMesh result = { welded_mesh.get_ID(), vertex_count - welded_vertex_count, primitive_count - welded_primitive_count };
+    return result;
+}
+
+} // NS MeshUtils
+} // NS Assets
+} // NS Cogwheel
@@ -0,0 +1,50 @@
+// Cogwheel mesh welding utilities.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_MESH_WELDING_H_
+#define _COGWHEEL_ASSETS_MESH_WELDING_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+
+namespace Cogwheel {
+namespace Assets {
+
+//----------------------------------------------------------------------------
+// Mesh welding utilities.
+// Vertices are welded by hashing their positions into a uniform grid with
+// a cell size of the position epsilon, such that all vertices within epsilon
+// of a vertex are found in the 27 cells surrounding it.
+// A vertex is welded onto the lowest indexed vertex that matches it, which
+// makes the result deterministic and preserves the relative order of the
+// remaining vertices.
+// Future work:
+// * Average the attributes of the welded vertices instead of keeping the first.
+//----------------------------------------------------------------------------
+namespace MeshUtils {
+
+struct WeldedMesh {
+    Meshes::UID mesh_ID;
+    unsigned int removed_vertex_count;
+    unsigned int removed_primitive_count;
+};
+
+// Welds the vertices whose positions, normals and texcoords are within the given epsilons of each other
+// and whose tangents are within the normal epsilon and have the same handedness.
+// Attributes that the mesh doesn't have are ignored. An epsilon of zero welds exact duplicates only.
+// Meshes without primitives are treated as triangle soups, i.e. every three vertices form a primitive.
+// Primitives that degenerate to a line or point are removed.
+// A new mesh with the welded vertices is created. The input mesh is left untouched.
+// The spatial hash is built and queried in parallel.
+WeldedMesh weld(Meshes::UID mesh_ID, float position_epsilon = 0.0f,
+                float normal_epsilon = 0.0f, float texcoord_epsilon = 0.0f);
+
+} // NS MeshUtils
+} // NS Assets
+} // NS Cogwheel
+
+#endif // _COGWHEEL_ASSETS_MESH_WELDING_H_
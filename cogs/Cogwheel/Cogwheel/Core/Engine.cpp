@@ -33,6 +33,10 @@ void Engine::do_tick(double delta_time) {
     for (auto callback : m_mutating_callbacks)
         callback();
 
+    // Resolve the deferred scene node transforms, so they are visible to the non-mutating callbacks.
+    if (Scene::SceneNodes::is_allocated())
+        Scene::SceneNodes::propagate_deferred_transforms();
+
     for (auto callback : m_non_mutating_callbacks)
         callback();
 
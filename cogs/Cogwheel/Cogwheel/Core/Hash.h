@@ -0,0 +1,39 @@
+// Cogwheel hash functions.
+// ------------------------------------------------------------------------------------------------
+// Copyright (C) 2017, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License.
+// See LICENSE.txt for more detail.
+// ------------------------------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_CORE_HASH_H_
+#define _COGWHEEL_CORE_HASH_H_
+
+#include <cstddef>
+
+namespace Cogwheel {
+namespace Core {
+
+// ------------------------------------------------------------------------------------------------
+// 64 bit FNV-1a applied to whole words instead of bytes, which is considerably faster for large
+// buffers. Bytes beyond the last whole word are ignored.
+// Several buffers can be hashed in sequence by passing the previous hash as the initial hash.
+// ------------------------------------------------------------------------------------------------
+const unsigned long long fnv_offset_basis = 14695981039346656037ull;
+const unsigned long long fnv_prime = 1099511628211ull;
+
+template <typename Word = unsigned int>
+inline unsigned long long fnv1a(const void* data, size_t byte_count, unsigned long long hash = fnv_offset_basis) {
+    const Word* words = (const Word*)data;
+    size_t word_count = byte_count / sizeof(Word);
+    for (size_t w = 0; w < word_count; ++w) {
+        hash ^= words[w];
+        hash *= fnv_prime;
+    }
+    return hash;
+}
+
+} // NS Core
+} // NS Cogwheel
+
+#endif // _COGWHEEL_CORE_HASH_H_
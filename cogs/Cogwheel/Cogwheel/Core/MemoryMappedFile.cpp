@@ -0,0 +1,126 @@
+// Cogwheel read-only memory mapped file.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Core/MemoryMappedFile.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Cogwheel {
+namespace Core {
+
+MemoryMappedFile::MemoryMappedFile(const std::string& path)
+    : m_data(nullptr), m_size(0), m_file_handle(nullptr), m_mapping_handle(nullptr) {
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+
+    m_data = (const unsigned char*)data;
+    m_size = size_t(file_size.QuadPart);
+    m_file_handle = file;
+    m_mapping_handle = mapping;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return;
+
+    struct stat file_stats;
+    if (fstat(file, &file_stats) != 0 || file_stats.st_size == 0) {
+        ::close(file);
+        return;
+    }
+
+    void* data = mmap(nullptr, size_t(file_stats.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file); // The mapping keeps the file alive.
+    if (data == MAP_FAILED)
+        return;
+
+    m_data = (const unsigned char*)data;
+    m_size = size_t(file_stats.st_size);
+#endif
+}
+
+MemoryMappedFile::MemoryMappedFile(MemoryMappedFile&& other)
+    : m_data(other.m_data), m_size(other.m_size), m_file_handle(other.m_file_handle), m_mapping_handle(other.m_mapping_handle) {
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_file_handle = other.m_mapping_handle = nullptr;
+}
+
+MemoryMappedFile& MemoryMappedFile::operator=(MemoryMappedFile&& rhs) {
+    if (this != &rhs) {
+        close();
+        m_data = rhs.m_data;
+        m_size = rhs.m_size;
+        m_file_handle = rhs.m_file_handle;
+        m_mapping_handle = rhs.m_mapping_handle;
+        rhs.m_data = nullptr;
+        rhs.m_size = 0;
+        rhs.m_file_handle = rhs.m_mapping_handle = nullptr;
+    }
+    return *this;
+}
+
+void MemoryMappedFile::close() {
+    if (m_data == nullptr)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping_handle);
+    CloseHandle(m_file_handle);
+#else
+    munmap((void*)m_data, m_size);
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_file_handle = m_mapping_handle = nullptr;
+}
+
+unsigned long long MemoryMappedFile::get_modification_time(const std::string& path) {
+    struct stat file_stats;
+    if (stat(path.c_str(), &file_stats) != 0)
+        return 0;
+    return (unsigned long long)file_stats.st_mtime;
+}
+
+} // NS Core
+} // NS Cogwheel
@@ -0,0 +1,57 @@
+// Cogwheel read-only memory mapped file.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_CORE_MEMORY_MAPPED_FILE_H_
+#define _COGWHEEL_CORE_MEMORY_MAPPED_FILE_H_
+
+#include <string>
+
+namespace Cogwheel {
+namespace Core {
+
+// ---------------------------------------------------------------------------
+// Maps the contents of a file into memory for reading.
+// The pages are loaded by the OS on first access, so opening a file is cheap
+// and reading it is bound by the storage device.
+// The file is unmapped when the MemoryMappedFile is destroyed or closed.
+// Empty or non-existing files can't be mapped and will leave the file closed.
+// ---------------------------------------------------------------------------
+class MemoryMappedFile final {
+public:
+    MemoryMappedFile()
+        : m_data(nullptr), m_size(0), m_file_handle(nullptr), m_mapping_handle(nullptr) {}
+    explicit MemoryMappedFile(const std::string& path);
+    MemoryMappedFile(MemoryMappedFile&& other);
+    MemoryMappedFile& operator=(MemoryMappedFile&& rhs);
+    ~MemoryMappedFile() { close(); }
+
+    MemoryMappedFile(const MemoryMappedFile& other) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile& rhs) = delete;
+
+    void close();
+
+    inline bool is_open() const { return m_data != nullptr; }
+    inline const unsigned char* get_data() const { return m_data; }
+    inline size_t get_size() const { return m_size; }
+
+    // Returns the last modification time of a file in seconds since the epoch or 0 if the file doesn't exist.
+    static unsigned long long get_modification_time(const std::string& path);
+
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+
+    // Platform specific handles.
+    void* m_file_handle;
+    void* m_mapping_handle;
+};
+
+} // NS Core
+} // NS Cogwheel
+
+#endif // _COGWHEEL_CORE_MEMORY_MAPPED_FILE_H_
@@ -0,0 +1,806 @@
+// Cogwheel bounding volume hierarchy.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Geometry/BVH.h>
+#include <Cogwheel/Math/MortonEncode.h>
+#include <Cogwheel/Math/Utils.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include <omp.h>
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Geometry {
+
+//-----------------------------------------------------------------------------
+// Build utilities.
+//-----------------------------------------------------------------------------
+
+static const unsigned int max_bin_count = 32u;
+static const unsigned int max_depth = 64u;
+
+// Min ratio between the overlap of the best object split's children and the root's surface area before spatial splits are considered.
+static const float spatial_split_overlap_threshold = 0.00001f;
+
+static inline bool is_valid(AABB bounds) {
+    return bounds.minimum.x <= bounds.maximum.x && bounds.minimum.y <= bounds.maximum.y && bounds.minimum.z <= bounds.maximum.z;
+}
+
+static inline float surface_area(AABB bounds) {
+    if (!is_valid(bounds))
+        return 0.0f;
+    Vector3f size = bounds.size();
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static inline AABB intersection(AABB lhs, AABB rhs) {
+    return AABB(max(lhs.minimum, rhs.minimum), min(lhs.maximum, rhs.maximum));
+}
+
+// The triangles of the mesh the BVH is built over. Positions are null when building over a list of bounds.
+struct Triangles {
+    const Vector3f* positions;
+    const Vector3ui* primitives; // Null for triangle soups.
+
+    inline bool has_geometry() const { return positions != nullptr; }
+
+    inline Vector3ui get_primitive(unsigned int p) const {
+        return primitives != nullptr ? primitives[p] : Vector3ui(p * 3, p * 3 + 1, p * 3 + 2);
+    }
+
+    inline AABB get_bounds(unsigned int p) const {
+        Vector3ui primitive = get_primitive(p);
+        AABB bounds = AABB(positions[primitive.x], positions[primitive.x]);
+        bounds.grow_to_contain(positions[primitive.y]);
+        bounds.grow_to_contain(positions[primitive.z]);
+        return bounds;
+    }
+
+    // Computes the bounds of the part of the triangle that lies between the planes lower and upper along the axis.
+    inline AABB clip(unsigned int p, int axis, float lower, float upper) const {
+        Vector3ui primitive = get_primitive(p);
+        Vector3f vertices[3] = { positions[primitive.x], positions[primitive.y], positions[primitive.z] };
+        AABB bounds = AABB::invalid();
+        for (int v = 0; v < 3; ++v) {
+            Vector3f v0 = vertices[v], v1 = vertices[(v + 1) % 3];
+            float p0 = v0[axis], p1 = v1[axis];
+            if (lower <= p0 && p0 <= upper)
+                bounds.grow_to_contain(v0);
+
+            float planes[2] = { lower, upper };
+            for (float plane : planes)
+                if ((p0 < plane && plane < p1) || (p1 < plane && plane < p0)) {
+                    Vector3f intersection = lerp(v0, v1, (plane - p0) / (p1 - p0));
+                    intersection[axis] = plane;
+                    bounds.grow_to_contain(intersection);
+                }
+        }
+        return bounds;
+    }
+};
+
+// Temporary node used during construction. Subtrees are built in parallel and then flattened into the final layout.
+struct BuildNode {
+    AABB bounds;
+    std::unique_ptr<BuildNode> children[2];
+    std::vector<unsigned int> primitive_indices;
+
+    inline bool is_leaf() const { return children[0] == nullptr; }
+};
+
+// Flattens the build nodes in depth first order with siblings stored next to each other.
+static void flatten(const BuildNode& build_node, unsigned int node_index, unsigned int depth,
+                    std::vector<BVHNode>& nodes, std::vector<unsigned int>& primitive_indices, BVH::Statistics& statistics) {
+    statistics.max_depth = max(statistics.max_depth, depth);
+    nodes[node_index].set_bounds(build_node.bounds);
+    if (build_node.is_leaf()) {
+        unsigned int primitive_count = (unsigned int)build_node.primitive_indices.size();
+        nodes[node_index].first_index = (unsigned int)primitive_indices.size();
+        nodes[node_index].primitive_count = primitive_count;
+        primitive_indices.insert(primitive_indices.end(), build_node.primitive_indices.begin(), build_node.primitive_indices.end());
+        ++statistics.leaf_count;
+        statistics.max_leaf_size = max(statistics.max_leaf_size, primitive_count);
+    } else {
+        unsigned int first_child_index = (unsigned int)nodes.size();
+        nodes[node_index].first_index = first_child_index;
+        nodes[node_index].primitive_count = 0u;
+        nodes.resize(nodes.size() + 2);
+        flatten(*build_node.children[0], first_child_index, depth + 1, nodes, primitive_indices, statistics);
+        flatten(*build_node.children[1], first_child_index + 1, depth + 1, nodes, primitive_indices, statistics);
+    }
+}
+
+// The number of primitives below which a subtree is built serially as a single task.
+static inline size_t subtree_task_size(size_t primitive_count) {
+    return max(size_t(4096), primitive_count / (omp_get_max_threads() * 8));
+}
+
+//-----------------------------------------------------------------------------
+// Binned SAH builder with optional spatial splits.
+//-----------------------------------------------------------------------------
+class SAHBuilder {
+public:
+    struct Reference {
+        AABB bounds;
+        unsigned int primitive_index;
+    };
+
+    struct Task {
+        BuildNode* node;
+        std::vector<Reference> references;
+        unsigned int depth;
+        unsigned int split_budget; // The number of references the subtree may duplicate through spatial splits.
+    };
+
+    SAHBuilder(Triangles triangles, BVH::BuildSettings settings, float root_area)
+        : m_triangles(triangles), m_settings(settings), m_root_area(root_area), m_spatial_split_count(0) {
+        m_settings.bin_count = clamp(m_settings.bin_count, 2u, max_bin_count);
+        m_settings.max_leaf_size = max(m_settings.max_leaf_size, 1u);
+        m_settings.spatial_splits = m_settings.spatial_splits && triangles.has_geometry();
+    }
+
+    unsigned int get_spatial_split_count() const { return m_spatial_split_count; }
+
+    unsigned int get_split_budget(unsigned int primitive_count) const {
+        return m_settings.spatial_splits ? (unsigned int)(primitive_count * max(m_settings.spatial_split_budget, 0.0f)) : 0u;
+    }
+
+    // Splits the task's node and appends the tasks for its children, or turns it into a leaf.
+    void split_node(Task& task, bool parallel_binning, std::vector<Task>& child_tasks) {
+        std::vector<Reference>& references = task.references;
+        const unsigned int reference_count = (unsigned int)references.size();
+        BuildNode& node = *task.node;
+
+        if (reference_count <= 1 || task.depth >= max_depth)
+            return make_leaf(node, references);
+
+        Split object_split = find_object_split(references, node.bounds, parallel_binning);
+        Split split = object_split;
+
+        if (m_settings.spatial_splits && task.split_budget > 0) {
+            float overlap_area = surface_area(intersection(object_split.left_bounds, object_split.right_bounds));
+            if (overlap_area > spatial_split_overlap_threshold * m_root_area) {
+                Split spatial_split = find_spatial_split(references, node.bounds, parallel_binning);
+                if (spatial_split.cost < split.cost)
+                    split = spatial_split;
+            }
+        }
+
+        float leaf_cost = m_settings.intersection_cost * reference_count;
+        if (reference_count <= m_settings.max_leaf_size && leaf_cost <= split.cost)
+            return make_leaf(node, references);
+
+        // Fall back to the object split if the duplicated references exceed the subtree's budget.
+        unsigned int duplicate_count = split.is_spatial ? split.left_count + split.right_count - reference_count : 0u;
+        if (duplicate_count > task.split_budget) {
+            split = object_split;
+            duplicate_count = 0u;
+        }
+
+        std::vector<Reference> left_references, right_references;
+        if (split.axis >= 0)
+            partition(references, node.bounds, split, left_references, right_references);
+        if (left_references.empty() || right_references.empty()) {
+            // No valid split, e.g. if all centroids are identical, so split the references in the middle.
+            if (reference_count <= m_settings.max_leaf_size)
+                return make_leaf(node, references);
+            left_references.assign(references.begin(), references.begin() + reference_count / 2);
+            right_references.assign(references.begin() + reference_count / 2, references.end());
+        }
+        references.clear();
+        references.shrink_to_fit();
+
+        // Divide the remaining budget between the children in proportion to their reference counts.
+        // Each subtree owns its budget, so the layout doesn't depend on the order the subtrees are built in.
+        unsigned int remaining_budget = task.split_budget - duplicate_count;
+        size_t child_reference_count = left_references.size() + right_references.size();
+        unsigned int left_budget = (unsigned int)((unsigned long long)remaining_budget * left_references.size() / child_reference_count);
+
+        Task left_task = { create_child(node, 0, left_references), std::move(left_references), task.depth + 1, left_budget };
+        Task right_task = { create_child(node, 1, right_references), std::move(right_references), task.depth + 1, remaining_budget - left_budget };
+        child_tasks.push_back(std::move(left_task));
+        child_tasks.push_back(std::move(right_task));
+    }
+
+    void build_subtree(Task& task) {
+        std::vector<Task> child_tasks;
+        split_node(task, false, child_tasks);
+        for (Task& child_task : child_tasks)
+            build_subtree(child_task);
+    }
+
+private:
+    struct Split {
+        float cost;
+        int axis; // -1 if no valid split was found.
+        bool is_spatial;
+        unsigned int bin; // The first bin on the right side of the split.
+        AABB left_bounds, right_bounds;
+        unsigned int left_count, right_count;
+    };
+
+    struct ObjectBins {
+        AABB bounds[3][max_bin_count];
+        unsigned int counts[3][max_bin_count];
+    };
+
+    struct SpatialBins {
+        AABB bounds[3][max_bin_count];
+        unsigned int entries[3][max_bin_count];
+        unsigned int exits[3][max_bin_count];
+    };
+
+    static inline AABB compute_bounds(const std::vector<Reference>& references) {
+        AABB bounds = AABB::invalid();
+        for (const Reference& reference : references)
+            bounds.grow_to_contain(reference.bounds);
+        return bounds;
+    }
+
+    static BuildNode* create_child(BuildNode& node, int child, const std::vector<Reference>& references) {
+        node.children[child].reset(new BuildNode());
+        node.children[child]->bounds = compute_bounds(references);
+        return node.children[child].get();
+    }
+
+    static void make_leaf(BuildNode& node, std::vector<Reference>& references) {
+        node.primitive_indices.resize(references.size());
+        for (size_t r = 0; r < references.size(); ++r)
+            node.primitive_indices[r] = references[r].primitive_index;
+        references.clear();
+        references.shrink_to_fit();
+    }
+
+    // Maps coordinates along an axis to bins spanning [offset, offset + bin_count / scale].
+    struct BinMapping {
+        Vector3f offset;
+        Vector3f scale;
+        int bin_count;
+
+        BinMapping(AABB bounds, unsigned int bin_count)
+            : offset(bounds.minimum), bin_count(int(bin_count)) {
+            Vector3f size = bounds.size();
+            for (int a = 0; a < 3; ++a)
+                scale[a] = size[a] > 0.0f ? bin_count / size[a] : 0.0f;
+        }
+
+        inline int get_bin(float coordinate, int axis) const {
+            return clamp(int((coordinate - offset[axis]) * scale[axis]), 0, bin_count - 1);
+        }
+
+        inline float get_plane(unsigned int bin, int axis) const {
+            return offset[axis] + bin / scale[axis];
+        }
+    };
+
+    // Bins the references in chunks, in parallel if requested, and merges the chunks.
+    template <typename Bins, typename BinFunction>
+    void bin_references(const std::vector<Reference>& references, bool parallel, Bins& bins, BinFunction bin_function) const {
+        if (!parallel) {
+            reset_bins(bins);
+            for (const Reference& reference : references)
+                bin_function(reference, bins);
+            return;
+        }
+
+        const int chunk_count = omp_get_max_threads();
+        std::vector<Bins> chunk_bins(chunk_count);
+        #pragma omp parallel for schedule(static)
+        for (int c = 0; c < chunk_count; ++c) {
+            Bins& local_bins = chunk_bins[c];
+            reset_bins(local_bins);
+            size_t begin = references.size() * c / chunk_count;
+            size_t end = references.size() * (c + 1) / chunk_count;
+            for (size_t r = begin; r < end; ++r)
+                bin_function(references[r], local_bins);
+        }
+
+        bins = chunk_bins[0];
+        for (int c = 1; c < chunk_count; ++c)
+            merge_bins(bins, chunk_bins[c]);
+    }
+
+    void reset_bins(ObjectBins& bins) const {
+        for (int a = 0; a < 3; ++a)
+            for (unsigned int b = 0; b < m_settings.bin_count; ++b) {
+                bins.bounds[a][b] = AABB::invalid();
+                bins.counts[a][b] = 0u;
+            }
+    }
+
+    void merge_bins(ObjectBins& bins, const ObjectBins& other_bins) const {
+        for (int a = 0; a < 3; ++a)
+            for (unsigned int b = 0; b < m_settings.bin_count; ++b) {
+                bins.bounds[a][b].grow_to_contain(other_bins.bounds[a][b]);
+                bins.counts[a][b] += other_bins.counts[a][b];
+            }
+    }
+
+    void reset_bins(SpatialBins& bins) const {
+        for (int a = 0; a < 3; ++a)
+            for (unsigned int b = 0; b < m_settings.bin_count; ++b) {
+                bins.bounds[a][b] = AABB::invalid();
+                bins.entries[a][b] = bins.exits[a][b] = 0u;
+            }
+    }
+
+    void merge_bins(SpatialBins& bins, const SpatialBins& other_bins) const {
+        for (int a = 0; a < 3; ++a)
+            for (unsigned int b = 0; b < m_settings.bin_count; ++b) {
+                bins.bounds[a][b].grow_to_contain(other_bins.bounds[a][b]);
+                bins.entries[a][b] += other_bins.entries[a][b];
+                bins.exits[a][b] += other_bins.exits[a][b];
+            }
+    }
+
+    // Sweeps over the bins of an axis and updates the split if a cheaper one is found.
+    // The left side of the split at bin b contains the bins [0, b[ and the right side the bins [b, bin_count[.
+    void sweep(int axis, const AABB* bin_bounds, const unsigned int* left_counts, const unsigned int* right_counts,
+               float node_area, bool is_spatial, Split& split) const {
+        const unsigned int bin_count = m_settings.bin_count;
+        AABB right_bounds[max_bin_count];
+        unsigned int right_count[max_bin_count];
+        AABB bounds = AABB::invalid();
+        unsigned int count = 0u;
+        for (unsigned int b = bin_count - 1; b > 0; --b) {
+            bounds.grow_to_contain(bin_bounds[b]);
+            count += right_counts[b];
+            right_bounds[b] = bounds;
+            right_count[b] = count;
+        }
+
+        AABB left_bounds = AABB::invalid();
+        unsigned int left_count = 0u;
+        for (unsigned int b = 1; b < bin_count; ++b) {
+            left_bounds.grow_to_contain(bin_bounds[b - 1]);
+            left_count += left_counts[b - 1];
+            if (left_count == 0 || right_count[b] == 0)
+                continue;
+
+            float cost = m_settings.traversal_cost + m_settings.intersection_cost *
+                (surface_area(left_bounds) * left_count + surface_area(right_bounds[b]) * right_count[b]) / node_area;
+            if (cost < split.cost) {
+                split.cost = cost;
+                split.axis = axis;
+                split.is_spatial = is_spatial;
+                split.bin = b;
+                split.left_bounds = left_bounds;
+                split.right_bounds = right_bounds[b];
+                split.left_count = left_count;
+                split.right_count = right_count[b];
+            }
+        }
+    }
+
+    Split find_object_split(const std::vector<Reference>& references, AABB node_bounds, bool parallel) const {
+        Split split = { 1e30f, -1, false, 0u, AABB::invalid(), AABB::invalid(), 0u, 0u };
+
+        AABB centroid_bounds = AABB::invalid();
+        for (const Reference& reference : references)
+            centroid_bounds.grow_to_contain(reference.bounds.center());
+        BinMapping mapping = BinMapping(centroid_bounds, m_settings.bin_count);
+
+        ObjectBins bins;
+        bin_references(references, parallel, bins, [&](const Reference& reference, ObjectBins& bins) {
+            Vector3f centroid = reference.bounds.center();
+            for (int a = 0; a < 3; ++a) {
+                int bin = mapping.get_bin(centroid[a], a);
+                bins.bounds[a][bin].grow_to_contain(reference.bounds);
+                ++bins.counts[a][bin];
+            }
+        });
+
+        float node_area = max(surface_area(node_bounds), 1e-30f);
+        for (int a = 0; a < 3; ++a)
+            if (mapping.scale[a] > 0.0f)
+                sweep(a, bins.bounds[a], bins.counts[a], bins.counts[a], node_area, false, split);
+
+        return split;
+    }
+
+    Split find_spatial_split(const std::vector<Reference>& references, AABB node_bounds, bool parallel) const {
+        Split split = { 1e30f, -1, true, 0u, AABB::invalid(), AABB::invalid(), 0u, 0u };
+        BinMapping mapping = BinMapping(node_bounds, m_settings.bin_count);
+
+        SpatialBins bins;
+        bin_references(references, parallel, bins, [&](const Reference& reference, SpatialBins& bins) {
+            for (int a = 0; a < 3; ++a) {
+                if (mapping.scale[a] == 0.0f)
+                    continue;
+                int first_bin = mapping.get_bin(reference.bounds.minimum[a], a);
+                int last_bin = mapping.get_bin(reference.bounds.maximum[a], a);
+                if (first_bin == last_bin)
+                    bins.bounds[a][first_bin].grow_to_contain(reference.bounds);
+                else
+                    for (int b = first_bin; b <= last_bin; ++b) {
+                        AABB clipped_bounds = m_triangles.clip(reference.primitive_index, a, mapping.get_plane(b, a), mapping.get_plane(b + 1, a));
+                        clipped_bounds = intersection(clipped_bounds, reference.bounds);
+                        if (is_valid(clipped_bounds))
+                            bins.bounds[a][b].grow_to_contain(clipped_bounds);
+                    }
+                ++bins.entries[a][first_bin];
+                ++bins.exits[a][last_bin];
+            }
+        });
+
+        float node_area = max(surface_area(node_bounds), 1e-30f);
+        for (int a = 0; a < 3; ++a)
+            if (mapping.scale[a] > 0.0f)
+                sweep(a, bins.bounds[a], bins.entries[a], bins.exits[a], node_area, true, split);
+
+        return split;
+    }
+
+    void partition(const std::vector<Reference>& references, AABB node_bounds, Split split,
+                   std::vector<Reference>& left_references, std::vector<Reference>& right_references) {
+        const int axis = split.axis;
+
+        if (!split.is_spatial) {
+            AABB centroid_bounds = AABB::invalid();
+            for (const Reference& reference : references)
+                centroid_bounds.grow_to_contain(reference.bounds.center());
+            BinMapping mapping = BinMapping(centroid_bounds, m_settings.bin_count);
+            for (const Reference& reference : references) {
+                bool is_left = mapping.get_bin(reference.bounds.center()[axis], axis) < int(split.bin);
+                (is_left ? left_references : right_references).push_back(reference);
+            }
+            return;
+        }
+
+        BinMapping mapping = BinMapping(node_bounds, m_settings.bin_count);
+        const float plane = mapping.get_plane(split.bin, axis);
+        for (const Reference& reference : references) {
+            if (reference.bounds.maximum[axis] <= plane)
+                left_references.push_back(reference);
+            else if (reference.bounds.minimum[axis] >= plane)
+                right_references.push_back(reference);
+            else {
+                // Split the straddling reference. The duplicates have already been deducted from the budget.
+                Reference left_reference = { intersection(m_triangles.clip(reference.primitive_index, axis, -1e30f, plane), reference.bounds), reference.primitive_index };
+                Reference right_reference = { intersection(m_triangles.clip(reference.primitive_index, axis, plane, 1e30f), reference.bounds), reference.primitive_index };
+                if (is_valid(left_reference.bounds))
+                    left_references.push_back(left_reference);
+                if (is_valid(right_reference.bounds))
+                    right_references.push_back(right_reference);
+            }
+        }
+
+        ++m_spatial_split_count;
+    }
+
+    const Triangles m_triangles;
+    BVH::BuildSettings m_settings;
+    const float m_root_area;
+    std::atomic<unsigned int> m_spatial_split_count;
+};
+
+static std::unique_ptr<BuildNode> build_SAH(const AABB* primitive_bounds, unsigned int primitive_count, Triangles triangles,
+                                            BVH::BuildSettings settings, unsigned int& spatial_split_count) {
+    typedef SAHBuilder::Task Task;
+
+    std::unique_ptr<BuildNode> root = std::unique_ptr<BuildNode>(new BuildNode());
+    std::vector<SAHBuilder::Reference> references(primitive_count);
+    root->bounds = AABB::invalid();
+    for (unsigned int p = 0; p < primitive_count; ++p) {
+        SAHBuilder::Reference reference = { primitive_bounds[p], p };
+        references[p] = reference;
+        root->bounds.grow_to_contain(primitive_bounds[p]);
+    }
+
+    SAHBuilder builder(triangles, settings, surface_area(root->bounds));
+
+    // Split the upper levels one node at a time with parallel binning, until the subtrees are small enough to be built as independent tasks.
+    const size_t subtree_size = subtree_task_size(primitive_count);
+    std::vector<Task> large_tasks, subtree_tasks;
+    Task root_task = { root.get(), std::move(references), 0u, builder.get_split_budget(primitive_count) };
+    large_tasks.push_back(std::move(root_task));
+    while (!large_tasks.empty()) {
+        std::vector<Task> child_tasks;
+        for (Task& task : large_tasks)
+            builder.split_node(task, true, child_tasks);
+        large_tasks.clear();
+        for (Task& child_task : child_tasks)
+            (child_task.references.size() > subtree_size ? large_tasks : subtree_tasks).push_back(std::move(child_task));
+    }
+
+    // Build the largest subtrees first for better load balancing.
+    std::sort(subtree_tasks.begin(), subtree_tasks.end(), [](const Task& lhs, const Task& rhs) { return lhs.references.size() > rhs.references.size(); });
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int t = 0; t < int(subtree_tasks.size()); ++t)
+        builder.build_subtree(subtree_tasks[t]);
+
+    spatial_split_count = builder.get_spatial_split_count();
+    return root;
+}
+
+//-----------------------------------------------------------------------------
+// Morton builder.
+//-----------------------------------------------------------------------------
+
+// Sorts the keys by the 30 bit Morton code in their upper 32 bits using a three pass radix sort.
+// The sort is stable, so primitives with identical codes stay sorted by their index.
+static void radix_sort_morton_keys(std::vector<unsigned long long>& keys) {
+    std::vector<unsigned long long> sorted_keys(keys.size());
+    for (int pass = 0; pass < 3; ++pass) {
+        const int shift = 32 + pass * 10;
+        unsigned int offsets[1024] = {};
+        for (unsigned long long key : keys)
+            ++offsets[(key >> shift) & 1023];
+        unsigned int offset = 0u;
+        for (unsigned int& bin_offset : offsets) {
+            unsigned int count = bin_offset;
+            bin_offset = offset;
+            offset += count;
+        }
+        for (unsigned long long key : keys)
+            sorted_keys[offsets[(key >> shift) & 1023]++] = key;
+        keys.swap(sorted_keys);
+    }
+}
+
+struct MortonTask {
+    BuildNode* node;
+    unsigned int begin, end;
+};
+
+// Splits the task's range at the highest bit that differs between the Morton codes or in the middle if the codes are identical.
+// Returns false if the range should be a leaf.
+static inline bool split_morton_range(const std::vector<unsigned long long>& keys, MortonTask task, unsigned int max_leaf_size, unsigned int& split_index) {
+    if (task.end - task.begin <= max_leaf_size)
+        return false;
+
+    unsigned int first_code = (unsigned int)(keys[task.begin] >> 32);
+    unsigned int last_code = (unsigned int)(keys[task.end - 1] >> 32);
+    if (first_code == last_code) {
+        split_index = (task.begin + task.end) / 2;
+        return true;
+    }
+
+    int highest_bit = 31;
+    unsigned int differing_bits = first_code ^ last_code;
+    while ((differing_bits & (1u << highest_bit)) == 0)
+        --highest_bit;
+    auto split_itr = std::partition_point(keys.begin() + task.begin, keys.begin() + task.end,
+        [=](unsigned long long key) { return ((key >> (32 + highest_bit)) & 1) == 0; });
+    split_index = (unsigned int)(split_itr - keys.begin());
+    return true;
+}
+
+static void build_morton_subtree(const std::vector<unsigned long long>& keys, const AABB* primitive_bounds,
+                                 MortonTask task, unsigned int max_leaf_size) {
+    BuildNode& node = *task.node;
+    unsigned int split_index;
+    if (split_morton_range(keys, task, max_leaf_size, split_index)) {
+        node.children[0].reset(new BuildNode());
+        node.children[1].reset(new BuildNode());
+        MortonTask left_task = { node.children[0].get(), task.begin, split_index };
+        MortonTask right_task = { node.children[1].get(), split_index, task.end };
+        build_morton_subtree(keys, primitive_bounds, left_task, max_leaf_size);
+        build_morton_subtree(keys, primitive_bounds, right_task, max_leaf_size);
+        node.bounds = node.children[0]->bounds;
+        node.bounds.grow_to_contain(node.children[1]->bounds);
+    } else {
+        node.bounds = AABB::invalid();
+        node.primitive_indices.resize(task.end - task.begin);
+        for (unsigned int i = task.begin; i < task.end; ++i) {
+            unsigned int primitive_index = (unsigned int)keys[i];
+            node.primitive_indices[i - task.begin] = primitive_index;
+            node.bounds.grow_to_contain(primitive_bounds[primitive_index]);
+        }
+    }
+}
+
+static std::unique_ptr<BuildNode> build_morton(const AABB* primitive_bounds, unsigned int primitive_count, BVH::BuildSettings settings) {
+    const unsigned int max_leaf_size = max(settings.max_leaf_size, 1u);
+
+    AABB centroid_bounds = AABB::invalid();
+    for (unsigned int p = 0; p < primitive_count; ++p)
+        centroid_bounds.grow_to_contain(primitive_bounds[p].center());
+
+    // Quantize the centroids to 10 bits pr axis and encode them as 30 bit Morton codes.
+    Vector3f size = centroid_bounds.size();
+    Vector3f scale = Vector3f(size.x > 0.0f ? 1023.0f / size.x : 0.0f,
+                              size.y > 0.0f ? 1023.0f / size.y : 0.0f,
+                              size.z > 0.0f ? 1023.0f / size.z : 0.0f);
+    std::vector<unsigned long long> keys(primitive_count);
+    #pragma omp parallel for schedule(static)
+    for (int p = 0; p < int(primitive_count); ++p) {
+        Vector3f quantized_centroid = (primitive_bounds[p].center() - centroid_bounds.minimum) * scale;
+        unsigned int code = morton_encode((unsigned int)quantized_centroid.x, (unsigned int)quantized_centroid.y, (unsigned int)quantized_centroid.z);
+        keys[p] = ((unsigned long long)code << 32) | p;
+    }
+    radix_sort_morton_keys(keys);
+
+    // Split the upper levels serially, as a split is just a binary search, and then build the subtrees in parallel.
+    std::unique_ptr<BuildNode> root = std::unique_ptr<BuildNode>(new BuildNode());
+    const size_t subtree_size = subtree_task_size(primitive_count);
+    std::vector<BuildNode*> upper_nodes;
+    std::vector<MortonTask> large_tasks, subtree_tasks;
+    MortonTask root_task = { root.get(), 0u, primitive_count };
+    (primitive_count > subtree_size ? large_tasks : subtree_tasks).push_back(root_task);
+    while (!large_tasks.empty()) {
+        MortonTask task = large_tasks.back();
+        large_tasks.pop_back();
+        upper_nodes.push_back(task.node);
+
+        unsigned int split_index;
+        split_morton_range(keys, task, max_leaf_size, split_index);
+        task.node->children[0].reset(new BuildNode());
+        task.node->children[1].reset(new BuildNode());
+        MortonTask child_tasks[2] = { { task.node->children[0].get(), task.begin, split_index },
+                                      { task.node->children[1].get(), split_index, task.end } };
+        for (MortonTask child_task : child_tasks)
+            (child_task.end - child_task.begin > subtree_size ? large_tasks : subtree_tasks).push_back(child_task);
+    }
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int t = 0; t < int(subtree_tasks.size()); ++t)
+        build_morton_subtree(keys, primitive_bounds, subtree_tasks[t], max_leaf_size);
+
+    // The upper nodes were created before their children, so fit their bounds in reverse order.
+    for (auto node_itr = upper_nodes.rbegin(); node_itr != upper_nodes.rend(); ++node_itr) {
+        BuildNode& node = **node_itr;
+        node.bounds = node.children[0]->bounds;
+        node.bounds.grow_to_contain(node.children[1]->bounds);
+    }
+
+    return root;
+}
+
+//-----------------------------------------------------------------------------
+// Bounding volume hierarchy.
+//-----------------------------------------------------------------------------
+
+BVH::BVH() : m_traversal_cost(1.0f), m_intersection_cost(1.0f) {
+    m_statistics = {};
+}
+
+BVH::BVH(Meshes::UID mesh_ID, BuildSettings settings)
+    : m_traversal_cost(settings.traversal_cost), m_intersection_cost(settings.intersection_cost) {
+    Mesh mesh = mesh_ID;
+    bool is_triangle_soup = mesh.get_primitive_count() == 0;
+    Triangles triangles = { mesh.get_positions(), is_triangle_soup ? nullptr : mesh.get_primitives() };
+    unsigned int primitive_count = is_triangle_soup ? mesh.get_vertex_count() / 3 : mesh.get_primitive_count();
+
+    std::vector<AABB> primitive_bounds(primitive_count);
+    #pragma omp parallel for schedule(static)
+    for (int p = 0; p < int(primitive_count); ++p)
+        primitive_bounds[p] = triangles.get_bounds(p);
+
+    build(primitive_bounds.data(), primitive_count, triangles.positions, triangles.primitives, settings);
+}
+
+BVH::BVH(const AABB* bounds_begin, const AABB* bounds_end, BuildSettings settings)
+    : m_traversal_cost(settings.traversal_cost), m_intersection_cost(settings.intersection_cost) {
+    settings.spatial_splits = false;
+    build(bounds_begin, (unsigned int)(bounds_end - bounds_begin), nullptr, nullptr, settings);
+}
+
+BVH::BVH(std::vector<BVHNode> nodes, std::vector<unsigned int> primitive_indices, Statistics statistics)
+    : m_nodes(std::move(nodes)), m_primitive_indices(std::move(primitive_indices)), m_statistics(statistics)
+    , m_traversal_cost(1.0f), m_intersection_cost(1.0f) { }
+
+void BVH::build(const AABB* primitive_bounds, unsigned int primitive_count,
+                const Vector3f* positions, const Vector3ui* primitives, BuildSettings settings) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    m_statistics = {};
+    m_statistics.primitive_count = primitive_count;
+    if (primitive_count == 0)
+        return;
+
+    std::unique_ptr<BuildNode> root;
+    if (settings.mode == BuildMode::Morton)
+        root = build_morton(primitive_bounds, primitive_count, settings);
+    else {
+        Triangles triangles = { positions, primitives };
+        root = build_SAH(primitive_bounds, primitive_count, triangles, settings, m_statistics.spatial_split_count);
+    }
+
+    m_nodes.reserve(2 * primitive_count);
+    m_nodes.resize(1);
+    m_primitive_indices.reserve(primitive_count);
+    flatten(*root, 0, 0, m_nodes, m_primitive_indices, m_statistics);
+    m_nodes.shrink_to_fit();
+    m_primitive_indices.shrink_to_fit();
+
+    // Free the build nodes before stopping the timer, as that is part of the build cost.
+    root.reset();
+
+    m_statistics.node_count = (unsigned int)m_nodes.size();
+    m_statistics.reference_count = (unsigned int)m_primitive_indices.size();
+    m_statistics.SAH_cost = compute_SAH_cost(settings.traversal_cost, settings.intersection_cost);
+    m_statistics.build_time_in_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+}
+
+float BVH::compute_SAH_cost(float traversal_cost, float intersection_cost) const {
+    if (m_nodes.empty())
+        return 0.0f;
+
+    float root_area = max(surface_area(m_nodes[0].get_bounds()), 1e-30f);
+    double cost = 0.0;
+    for (const BVHNode& node : m_nodes) {
+        float node_cost = node.is_leaf() ? intersection_cost * node.primitive_count : traversal_cost;
+        cost += surface_area(node.get_bounds()) * node_cost;
+    }
+    return float(cost / root_area);
+}
+
+bool BVH::refit(const AABB* primitive_bounds, const unsigned int* changed_primitives_begin, const unsigned int* changed_primitives_end) {
+    // Spatial splits reference primitives from several leaves, so the leaf of a primitive isn't unique.
+    if (m_statistics.reference_count != m_statistics.primitive_count)
+        return false;
+    if (m_nodes.empty() || changed_primitives_begin == changed_primitives_end)
+        return true;
+
+    static const unsigned int no_parent = 0xFFFFFFFF;
+    if (m_parent_indices.size() != m_nodes.size()) {
+        m_parent_indices.resize(m_nodes.size());
+        m_parent_indices[0] = no_parent;
+        m_primitive_leaf_indices.resize(m_statistics.primitive_count);
+        for (unsigned int n = 0; n < m_nodes.size(); ++n) {
+            const BVHNode& node = m_nodes[n];
+            if (node.is_leaf())
+                for (unsigned int i = node.first_index; i < node.first_index + node.primitive_count; ++i)
+                    m_primitive_leaf_indices[m_primitive_indices[i]] = n;
+            else
+                m_parent_indices[node.first_index] = m_parent_indices[node.first_index + 1] = n;
+        }
+        m_refit_marks.assign(m_nodes.size(), false);
+    }
+
+    // Gather the leaves of the changed primitives and their ancestors.
+    // The walk towards the root stops at the first node that has already been gathered.
+    std::vector<unsigned int> dirty_nodes;
+    for (const unsigned int* p = changed_primitives_begin; p != changed_primitives_end; ++p) {
+        unsigned int node_index = m_primitive_leaf_indices[*p];
+        while (node_index != no_parent && !m_refit_marks[node_index]) {
+            m_refit_marks[node_index] = true;
+            dirty_nodes.push_back(node_index);
+            node_index = m_parent_indices[node_index];
+        }
+    }
+
+    // Children are stored after their parent, so refitting in reverse index order updates the children first.
+    std::sort(dirty_nodes.begin(), dirty_nodes.end(), std::greater<unsigned int>());
+
+    float old_root_area = max(surface_area(m_nodes[0].get_bounds()), 1e-30f);
+    double cost = double(m_statistics.SAH_cost) * old_root_area;
+    for (unsigned int node_index : dirty_nodes) {
+        BVHNode& node = m_nodes[node_index];
+        AABB bounds = AABB::invalid();
+        float node_cost;
+        if (node.is_leaf()) {
+            for (unsigned int i = node.first_index; i < node.first_index + node.primitive_count; ++i)
+                bounds.grow_to_contain(primitive_bounds[m_primitive_indices[i]]);
+            node_cost = m_intersection_cost * node.primitive_count;
+        } else {
+            bounds = m_nodes[node.first_index].get_bounds();
+            bounds.grow_to_contain(m_nodes[node.first_index + 1].get_bounds());
+            node_cost = m_traversal_cost;
+        }
+        cost += (surface_area(bounds) - surface_area(node.get_bounds())) * node_cost;
+        node.set_bounds(bounds);
+        m_refit_marks[node_index] = false;
+    }
+
+    float root_area = max(surface_area(m_nodes[0].get_bounds()), 1e-30f);
+    m_statistics.SAH_cost = float(max(cost, 0.0) / root_area);
+    return true;
+}
+
+} // NS Geometry
+} // NS Cogwheel
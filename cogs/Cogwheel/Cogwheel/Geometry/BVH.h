@@ -0,0 +1,150 @@
+// Cogwheel bounding volume hierarchy.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_BVH_H_
+#define _COGWHEEL_GEOMETRY_BVH_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Math/AABB.h>
+
+#include <vector>
+
+namespace Cogwheel {
+namespace Geometry {
+
+//----------------------------------------------------------------------------
+// BVH node.
+// The two children of an inner node are stored next to each other starting
+// at first_index. Leaves reference count primitive indices starting at
+// first_index. The node is 32 bytes, so two nodes fill a cache line.
+//----------------------------------------------------------------------------
+struct BVHNode final {
+    float minimum[3];
+    unsigned int first_index;
+    float maximum[3];
+    unsigned int primitive_count; // Zero for inner nodes.
+
+    inline bool is_leaf() const { return primitive_count != 0; }
+    inline Math::AABB get_bounds() const {
+        return Math::AABB(Math::Vector3f(minimum[0], minimum[1], minimum[2]), Math::Vector3f(maximum[0], maximum[1], maximum[2]));
+    }
+    inline void set_bounds(Math::AABB bounds) {
+        for (int a = 0; a < 3; ++a) {
+            minimum[a] = bounds.minimum[a];
+            maximum[a] = bounds.maximum[a];
+        }
+    }
+};
+static_assert(sizeof(BVHNode) == 32, "BVHNode must be 32 bytes.");
+
+//----------------------------------------------------------------------------
+// Bounding volume hierarchy over the primitives of a mesh or a list of bounds.
+// Build modes:
+// * SAH: Binned surface area heuristic, see Wald, On fast Construction of
+//   SAH-based Bounding Volume Hierarchies, 2007. Optionally with spatial splits,
+//   see Stich et al, Spatial Splits in Bounding Volume Hierarchies, 2009.
+// * Morton: Linear BVH built by sorting the primitives along a Morton curve and
+//   splitting at the highest differing bit. Fast to build, but lower quality,
+//   so mainly useful for dynamic geometry.
+// The upper levels of the hierarchy are split one level at a time with the
+// primitives processed in parallel. Once there are enough subtrees, these are
+// built in parallel as independent tasks. The final layout is deterministic,
+// as each subtree gets its own share of the spatial split budget.
+// Refitting updates the bounds of moved primitives and their ancestors
+// without changing the topology, which is much cheaper than a rebuild, but
+// the quality of the hierarchy degrades as the primitives move further away
+// from where they were when it was built.
+// Future work:
+// * Refitting of hierarchies with spatial splits.
+//----------------------------------------------------------------------------
+class BVH final {
+public:
+    enum class BuildMode {
+        SAH,
+        Morton
+    };
+
+    struct BuildSettings {
+        BuildMode mode;
+        unsigned int bin_count;
+        unsigned int max_leaf_size;
+        float traversal_cost;
+        float intersection_cost;
+        bool spatial_splits;
+        float spatial_split_budget; // The max number of split references relative to the number of primitives.
+
+        static BuildSettings default_settings() {
+            BuildSettings settings = { BuildMode::SAH, 16u, 4u, 1.0f, 1.0f, false, 0.5f };
+            return settings;
+        }
+        static BuildSettings morton_settings() {
+            BuildSettings settings = default_settings();
+            settings.mode = BuildMode::Morton;
+            return settings;
+        }
+    };
+
+    struct Statistics {
+        double build_time_in_seconds;
+        float SAH_cost;
+        unsigned int node_count;
+        unsigned int leaf_count;
+        unsigned int max_depth;
+        unsigned int max_leaf_size;
+        unsigned int primitive_count;
+        unsigned int reference_count; // Larger than the primitive count if primitives were split.
+        unsigned int spatial_split_count;
+    };
+
+    BVH();
+
+    // Builds a BVH over the triangles of a mesh. Meshes without primitives are treated as triangle soups.
+    BVH(Assets::Meshes::UID mesh_ID, BuildSettings settings = BuildSettings::default_settings());
+
+    // Builds a BVH over a list of bounds, e.g. the bounds of the models in a scene.
+    // Spatial splits require the primitive geometry and are ignored.
+    BVH(const Math::AABB* bounds_begin, const Math::AABB* bounds_end, BuildSettings settings = BuildSettings::default_settings());
+
+    // Creates a BVH from already built nodes, e.g. loaded from a cache.
+    BVH(std::vector<BVHNode> nodes, std::vector<unsigned int> primitive_indices, Statistics statistics);
+
+    inline bool is_empty() const { return m_nodes.empty(); }
+    inline const std::vector<BVHNode>& get_nodes() const { return m_nodes; }
+    inline const std::vector<unsigned int>& get_primitive_indices() const { return m_primitive_indices; }
+    inline const Statistics& get_statistics() const { return m_statistics; }
+    inline Math::AABB get_bounds() const { return m_nodes.empty() ? Math::AABB::invalid() : m_nodes[0].get_bounds(); }
+
+    // Computes the SAH cost of the hierarchy, normalized by the surface area of the root.
+    float compute_SAH_cost(float traversal_cost = 1.0f, float intersection_cost = 1.0f) const;
+
+    // Refits the leaves referencing the changed primitives and their ancestors to the new primitive bounds.
+    // The cost is proportional to the number of changed primitives times the depth of the hierarchy
+    // and the SAH cost in the statistics is updated incrementally.
+    // Hierarchies with spatial splits reference primitives from several leaves and cannot be refit,
+    // in which case the hierarchy is left unchanged and false is returned. The caller must then rebuild it.
+    bool refit(const Math::AABB* primitive_bounds, const unsigned int* changed_primitives_begin, const unsigned int* changed_primitives_end);
+
+private:
+    void build(const Math::AABB* primitive_bounds, unsigned int primitive_count,
+               const Math::Vector3f* positions, const Math::Vector3ui* primitives, BuildSettings settings);
+
+    std::vector<BVHNode> m_nodes;
+    std::vector<unsigned int> m_primitive_indices;
+    Statistics m_statistics;
+    float m_traversal_cost, m_intersection_cost;
+
+    // Refit data, created by the first refit.
+    std::vector<unsigned int> m_parent_indices;
+    std::vector<unsigned int> m_primitive_leaf_indices;
+    std::vector<bool> m_refit_marks;
+};
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_BVH_H_
@@ -0,0 +1,190 @@
+// Cogwheel on disk cache of mesh bounding volume hierarchies.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#pragma warning(disable : 4996)
+
+#include <Cogwheel/Geometry/BVHCache.h>
+#include <Cogwheel/Core/Hash.h>
+#include <Cogwheel/Core/MemoryMappedFile.h>
+
+#include <cstdio>
+#include <cstring>
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Core;
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Geometry {
+namespace BVHCache {
+
+//-----------------------------------------------------------------------------
+// File layout.
+// The header is followed by the nodes and the triangle packs, both stored in
+// the same layout as in memory. All offsets are absolute offsets into the file.
+//-----------------------------------------------------------------------------
+
+static const char file_magic[8] = { 'C', 'W', 'B', 'V', 'H', 'C', 'H', 'E' };
+static const size_t alignment = 16;
+
+struct SettingsEntry {
+    unsigned int mode;
+    unsigned int bin_count;
+    unsigned int max_leaf_size;
+    float traversal_cost;
+    float intersection_cost;
+    unsigned int spatial_splits;
+    float spatial_split_budget;
+    unsigned int padding;
+};
+
+struct FileHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int header_size;
+    unsigned int node_size;
+    unsigned int pack_size;
+    unsigned long long file_size;
+    unsigned long long checksum; // Checksum of the nodes and triangle packs.
+    unsigned long long mesh_hash;
+    SettingsEntry settings;
+    AABB bounds;
+    BVH8::Statistics statistics;
+    unsigned long long nodes_offset;
+    unsigned long long packs_offset;
+};
+
+static inline size_t align(size_t offset) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+static SettingsEntry to_entry(BVH::BuildSettings settings) {
+    SettingsEntry entry = { (unsigned int)settings.mode, settings.bin_count, settings.max_leaf_size,
+                            settings.traversal_cost, settings.intersection_cost,
+                            settings.spatial_splits ? 1u : 0u, settings.spatial_split_budget, 0u };
+    return entry;
+}
+
+//-----------------------------------------------------------------------------
+// Hashing.
+// All hashed buffers are multiples of four bytes, so they are hashed as 32 bit words.
+//-----------------------------------------------------------------------------
+
+unsigned long long compute_mesh_hash(Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+    unsigned int counts[2] = { mesh.get_primitive_count(), mesh.get_vertex_count() };
+    unsigned long long hash = fnv1a(counts, sizeof(counts));
+    hash = fnv1a(mesh.get_primitives(), sizeof(Vector3ui) * counts[0], hash);
+    if (mesh.get_positions() != nullptr)
+        hash = fnv1a(mesh.get_positions(), sizeof(Vector3f) * counts[1], hash);
+    return hash;
+}
+
+std::string get_path(const std::string& directory, unsigned long long mesh_hash) {
+    char filename[32];
+    sprintf(filename, "%016llx.bvh8", mesh_hash);
+    bool has_separator = !directory.empty() && (directory.back() == '/' || directory.back() == '\\');
+    return has_separator ? directory + filename : directory + "/" + filename;
+}
+
+//-----------------------------------------------------------------------------
+// Store and load.
+//-----------------------------------------------------------------------------
+
+bool store(const std::string& path, const BVH8& bvh, AABB bounds, BVH::BuildSettings settings, unsigned long long mesh_hash) {
+    const std::vector<BVH8::Node>& nodes = bvh.get_nodes();
+    const std::vector<TrianglePack>& packs = bvh.get_triangle_packs();
+    size_t nodes_size = sizeof(BVH8::Node) * nodes.size();
+    size_t packs_size = sizeof(TrianglePack) * packs.size();
+
+    FileHeader header = {};
+    memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version = version;
+    header.header_size = sizeof(FileHeader);
+    header.node_size = sizeof(BVH8::Node);
+    header.pack_size = sizeof(TrianglePack);
+    header.mesh_hash = mesh_hash;
+    header.settings = to_entry(settings);
+    header.bounds = bounds;
+    header.statistics = bvh.get_statistics();
+    header.nodes_offset = align(sizeof(FileHeader));
+    header.packs_offset = align(header.nodes_offset + nodes_size);
+    header.file_size = header.packs_offset + packs_size;
+    header.checksum = fnv1a(packs.data(), packs_size, fnv1a(nodes.data(), nodes_size));
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        printf("BVHCache::store error: Could not open '%s' for writing.\n", path.c_str());
+        return false;
+    }
+
+    static const unsigned char padding[alignment] = {};
+    bool written = fwrite(&header, sizeof(FileHeader), 1, file) == 1 &&
+        fwrite(padding, 1, size_t(header.nodes_offset - sizeof(FileHeader)), file) == header.nodes_offset - sizeof(FileHeader) &&
+        fwrite(nodes.data(), 1, nodes_size, file) == nodes_size &&
+        fwrite(padding, 1, size_t(header.packs_offset - header.nodes_offset - nodes_size), file) == header.packs_offset - header.nodes_offset - nodes_size &&
+        fwrite(packs.data(), 1, packs_size, file) == packs_size;
+    fclose(file);
+    if (!written) {
+        printf("BVHCache::store error: Could not write '%s'.\n", path.c_str());
+        remove(path.c_str());
+    }
+    return written;
+}
+
+bool load(const std::string& path, BVH::BuildSettings settings, unsigned long long mesh_hash, BVH8& bvh, AABB& bounds) {
+    MemoryMappedFile file = MemoryMappedFile(path);
+    if (!file.is_open() || file.get_size() < sizeof(FileHeader))
+        return false;
+
+    // Reject caches of other versions, meshes, node layouts or build settings.
+    const FileHeader& header = *(const FileHeader*)file.get_data();
+    SettingsEntry expected_settings = to_entry(settings);
+    bool valid_header = memcmp(header.magic, file_magic, sizeof(file_magic)) == 0 && header.version == version &&
+        header.header_size == sizeof(FileHeader) && header.node_size == sizeof(BVH8::Node) && header.pack_size == sizeof(TrianglePack) &&
+        header.mesh_hash == mesh_hash && memcmp(&header.settings, &expected_settings, sizeof(SettingsEntry)) == 0;
+    if (!valid_header)
+        return false;
+
+    unsigned long long nodes_size = sizeof(BVH8::Node) * (unsigned long long)header.statistics.node_count;
+    unsigned long long packs_size = sizeof(TrianglePack) * (unsigned long long)header.statistics.pack_count;
+    bool valid_layout = header.file_size == file.get_size() && header.nodes_offset == align(sizeof(FileHeader)) &&
+        header.packs_offset == align(size_t(header.nodes_offset + nodes_size)) && header.packs_offset + packs_size == header.file_size;
+    const unsigned char* nodes_data = file.get_data() + header.nodes_offset;
+    const unsigned char* packs_data = file.get_data() + header.packs_offset;
+    if (!valid_layout || header.checksum != fnv1a(packs_data, size_t(packs_size), fnv1a(nodes_data, size_t(nodes_size)))) {
+        printf("BVHCache::load error: '%s' is corrupt.\n", path.c_str());
+        return false;
+    }
+
+    const BVH8::Node* nodes = (const BVH8::Node*)nodes_data;
+    const TrianglePack* packs = (const TrianglePack*)packs_data;
+    bvh = BVH8(std::vector<BVH8::Node>(nodes, nodes + header.statistics.node_count),
+               std::vector<TrianglePack>(packs, packs + header.statistics.pack_count), header.statistics);
+    bounds = header.bounds;
+    return true;
+}
+
+BVH8 load_cached(const std::string& directory, Meshes::UID mesh_ID, BVH::BuildSettings settings, AABB& bounds) {
+    unsigned long long mesh_hash = compute_mesh_hash(mesh_ID);
+    std::string path = get_path(directory, mesh_hash);
+
+    BVH8 bvh;
+    if (load(path, settings, mesh_hash, bvh, bounds))
+        return bvh;
+
+    BVH binary_bvh = BVH(mesh_ID, settings);
+    bvh = BVH8(binary_bvh, mesh_ID);
+    bounds = binary_bvh.get_bounds();
+    store(path, bvh, bounds, settings, mesh_hash);
+    return bvh;
+}
+
+} // NS BVHCache
+} // NS Geometry
+} // NS Cogwheel
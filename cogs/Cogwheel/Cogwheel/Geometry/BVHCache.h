@@ -0,0 +1,63 @@
+// Cogwheel on disk cache of mesh bounding volume hierarchies.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_BVH_CACHE_H_
+#define _COGWHEEL_GEOMETRY_BVH_CACHE_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Geometry/BVH.h>
+#include <Cogwheel/Geometry/WideBVH.h>
+#include <Cogwheel/Math/AABB.h>
+
+#include <string>
+
+namespace Cogwheel {
+namespace Geometry {
+
+//----------------------------------------------------------------------------
+// Stores the BVH8 of a mesh on disk, so large static meshes don't have to
+// be rebuilt every time they are loaded.
+// Cache files are keyed by a hash of the mesh's primitives and positions
+// and store the settings the hierarchy was built with. The cache file is
+// memory mapped on load and rejected if the mesh hash, build settings,
+// node layout or checksum doesn't match, in which case the hierarchy is
+// rebuilt and the cache file replaced.
+// Future work:
+// * Reference the nodes in the mapped file instead of copying them.
+// * Hash the mesh in parallel.
+//----------------------------------------------------------------------------
+namespace BVHCache {
+
+static const unsigned int version = 1u;
+
+// Hash of the primitives and positions of a mesh, which identifies its cache file.
+unsigned long long compute_mesh_hash(Assets::Meshes::UID mesh_ID);
+
+// Path of the cache file of a mesh with the given hash in the cache directory.
+std::string get_path(const std::string& directory, unsigned long long mesh_hash);
+
+// Stores a hierarchy and the bounds of the mesh it was built over in a cache file.
+bool store(const std::string& path, const BVH8& bvh, Math::AABB bounds,
+           BVH::BuildSettings settings, unsigned long long mesh_hash);
+
+// Loads a hierarchy and the bounds of its mesh from a cache file.
+// Returns false if the file isn't a valid cache of a mesh with the given hash built with the given settings.
+bool load(const std::string& path, BVH::BuildSettings settings, unsigned long long mesh_hash,
+          BVH8& bvh, Math::AABB& bounds);
+
+// Loads the hierarchy of the mesh from the cache directory if it has been cached with the given settings.
+// Otherwise the hierarchy is built and stored in the cache directory.
+BVH8 load_cached(const std::string& directory, Assets::Meshes::UID mesh_ID,
+                 BVH::BuildSettings settings, Math::AABB& bounds);
+
+} // NS BVHCache
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_BVH_CACHE_H_
@@ -0,0 +1,187 @@
+// Cogwheel world space bounds of the models in the scene.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Geometry/ModelBounds.h>
+
+#include <chrono>
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Scene;
+
+namespace Cogwheel {
+namespace Geometry {
+
+static const unsigned int no_model = 0xFFFFFFFF;
+
+// Computes the world space bounds of an object space bounding box.
+static inline AABB transform_bounds(Transform transform, AABB bounds) {
+    AABB transformed_bounds = AABB::invalid();
+    for (int c = 0; c < 8; ++c) {
+        Vector3f corner = Vector3f(c & 1 ? bounds.maximum.x : bounds.minimum.x,
+                                   c & 2 ? bounds.maximum.y : bounds.minimum.y,
+                                   c & 4 ? bounds.maximum.z : bounds.minimum.z);
+        transformed_bounds.grow_to_contain(transform * corner);
+    }
+    return transformed_bounds;
+}
+
+ModelBounds::ModelBounds(Settings settings, const MeshCallbacks& mesh_callbacks)
+    : m_settings(settings) {
+    m_statistics = {};
+
+    // Add the models that already exist. Their creation notifications may have been reset already.
+    if (MeshModels::is_allocated()) {
+        for (const MeshModels::UID model_ID : MeshModels::get_iterable())
+            add_model(model_ID, mesh_callbacks);
+        m_statistics.model_count = (unsigned int)m_models.size();
+    }
+    if (!m_models.empty()) {
+        link_models_to_nodes();
+        rebuild();
+        m_statistics.SAH_cost = m_bvh.get_statistics().SAH_cost;
+    }
+}
+
+void ModelBounds::add_model(MeshModels::UID model_ID, const MeshCallbacks& mesh_callbacks) {
+    Meshes::UID mesh_ID = MeshModels::get_mesh_ID(model_ID);
+    if (m_meshes.size() <= mesh_ID)
+        m_meshes.resize(Meshes::capacity(), { AABB::invalid(), 0u });
+    if (m_meshes[mesh_ID].model_count++ == 0) {
+        m_meshes[mesh_ID].bounds = mesh_callbacks.update_mesh(mesh_ID);
+        ++m_statistics.mesh_count;
+    }
+
+    if (m_model_indices.size() <= model_ID)
+        m_model_indices.resize(MeshModels::capacity(), no_model);
+    m_model_indices[model_ID] = (unsigned int)m_models.size();
+
+    Model model = { model_ID, mesh_ID, MeshModels::get_scene_node_ID(model_ID), Transform::identity(), no_model };
+    m_models.push_back(model);
+    m_model_bounds.push_back(AABB::invalid());
+    update_model_bounds((unsigned int)m_models.size() - 1);
+}
+
+void ModelBounds::remove_model(unsigned int model_index, const MeshCallbacks& mesh_callbacks) {
+    Meshes::UID mesh_ID = m_models[model_index].mesh_ID;
+    if (--m_meshes[mesh_ID].model_count == 0) {
+        mesh_callbacks.release_mesh(mesh_ID);
+        --m_statistics.mesh_count;
+    }
+    m_model_indices[m_models[model_index].model_ID] = no_model;
+
+    // Move the last model into the removed model's place.
+    unsigned int last_index = (unsigned int)m_models.size() - 1;
+    if (model_index != last_index) {
+        m_models[model_index] = m_models[last_index];
+        m_model_bounds[model_index] = m_model_bounds[last_index];
+        m_model_indices[m_models[model_index].model_ID] = model_index;
+    }
+    m_models.pop_back();
+    m_model_bounds.pop_back();
+}
+
+void ModelBounds::update_model_bounds(unsigned int model_index) {
+    Model& model = m_models[model_index];
+    Transform object_to_world = SceneNodes::get_global_transform(model.node_ID);
+    model.world_to_object = object_to_world.inverse();
+    m_model_bounds[model_index] = transform_bounds(object_to_world, m_meshes[model.mesh_ID].bounds);
+}
+
+void ModelBounds::link_models_to_nodes() {
+    m_node_first_models.assign(SceneNodes::capacity(), no_model);
+    for (unsigned int m = 0; m < m_models.size(); ++m) {
+        unsigned int& first_model = m_node_first_models[m_models[m].node_ID];
+        m_models[m].next_model_of_node = first_model;
+        first_model = m;
+    }
+}
+
+void ModelBounds::rebuild() {
+    m_bvh = BVH(m_model_bounds.data(), m_model_bounds.data() + m_model_bounds.size(), m_settings.build_settings);
+    m_statistics.rebuild_SAH_cost = m_bvh.get_statistics().SAH_cost;
+    ++m_statistics.rebuild_count;
+}
+
+void ModelBounds::handle_updates(Meshes::Changes geometry_changes, const MeshCallbacks& mesh_callbacks) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    bool models_changed = false;
+    std::vector<unsigned int> moved_models;
+
+    for (const MeshModels::UID model_ID : MeshModels::get_changed_models()) {
+        MeshModels::Changes changes = MeshModels::get_changes(model_ID);
+        bool has_model = model_ID < m_model_indices.size() && m_model_indices[model_ID] != no_model;
+
+        if (changes.is_set(MeshModels::Change::Destroyed) && has_model) {
+            remove_model(m_model_indices[model_ID], mesh_callbacks);
+            models_changed = true;
+        }
+
+        // Models that are already present were added on construction.
+        bool is_present = model_ID < m_model_indices.size() && m_model_indices[model_ID] != no_model;
+        if (changes.is_set(MeshModels::Change::Created) && MeshModels::has(model_ID) && !is_present) {
+            add_model(model_ID, mesh_callbacks);
+            models_changed = true;
+        }
+    }
+
+    // Update the meshes whose geometry changed and the bounds of the models using them.
+    bool meshes_changed = false;
+    for (const Meshes::UID mesh_ID : Meshes::get_changed_meshes()) {
+        Meshes::Changes changes = Meshes::get_changes(mesh_ID);
+        bool is_used = mesh_ID < m_meshes.size() && m_meshes[mesh_ID].model_count > 0;
+        // Meshes created this tick have just been updated by add_model.
+        if ((changes & geometry_changes) && is_used && changes.not_set(Meshes::Change::Created) && Meshes::has(mesh_ID)) {
+            m_meshes[mesh_ID].bounds = mesh_callbacks.update_mesh(mesh_ID);
+            meshes_changed = true;
+        }
+    }
+    if (meshes_changed)
+        for (unsigned int m = 0; m < m_models.size(); ++m)
+            if (Meshes::get_changes(m_models[m].mesh_ID) & geometry_changes) {
+                update_model_bounds(m);
+                moved_models.push_back(m);
+            }
+
+    if (models_changed)
+        link_models_to_nodes();
+
+    // Update the bounds of the models attached to moved scene nodes.
+    // Transform changes are propagated to the children by SceneNodes, so only the changed nodes need to be considered.
+    for (const SceneNodes::UID node_ID : SceneNodes::get_changed_nodes()) {
+        if (SceneNodes::get_changes(node_ID).not_set(SceneNodes::Change::Transform) || m_node_first_models.size() <= node_ID)
+            continue;
+        for (unsigned int m = m_node_first_models[node_ID]; m != no_model; m = m_models[m].next_model_of_node) {
+            update_model_bounds(m);
+            moved_models.push_back(m);
+        }
+    }
+
+    m_statistics.refit_model_count = 0;
+    if (models_changed)
+        rebuild();
+    else if (!moved_models.empty()) {
+        if (m_bvh.refit(m_model_bounds.data(), moved_models.data(), moved_models.data() + moved_models.size())) {
+            m_statistics.refit_model_count = (unsigned int)moved_models.size();
+            ++m_statistics.refit_count;
+
+            // Rebuild once refitting has degraded the quality of the hierarchy too much.
+            if (m_bvh.get_statistics().SAH_cost > m_statistics.rebuild_SAH_cost * m_settings.rebuild_threshold)
+                rebuild();
+        } else
+            rebuild();
+    }
+
+    m_statistics.model_count = (unsigned int)m_models.size();
+    m_statistics.SAH_cost = m_bvh.get_statistics().SAH_cost;
+    m_statistics.update_time_in_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+}
+
+} // NS Geometry
+} // NS Cogwheel
@@ -0,0 +1,128 @@
+// Cogwheel world space bounds of the models in the scene.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_MODEL_BOUNDS_H_
+#define _COGWHEEL_GEOMETRY_MODEL_BOUNDS_H_
+
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Geometry/BVH.h>
+#include <Cogwheel/Math/AABB.h>
+#include <Cogwheel/Math/Transform.h>
+
+#include <functional>
+#include <vector>
+
+namespace Cogwheel {
+namespace Geometry {
+
+//----------------------------------------------------------------------------
+// Tracks the world space bounds of the mesh models in the scene and maintains
+// a binary BVH over them. This is the part shared by the SceneBounds and the
+// top level of the SceneBVH.
+// The models that exist on construction are added immediately and
+// handle_updates() consumes the change notifications of the meshes, models
+// and scene nodes and should be called once pr tick before the notifications
+// are reset. The bounds of moved models are refit into the hierarchy without
+// changing its topology, so the cost of an update is proportional to the
+// number of moved models. The hierarchy is rebuilt when models are created or
+// destroyed or when refitting has increased its SAH cost beyond the rebuild
+// threshold relative to the cost after the last rebuild.
+// The object space bounds of the meshes are provided by the owner through
+// the mesh callbacks, which also lets the owner maintain per mesh data, such
+// as a hierarchy over the mesh, for as long as the mesh is referenced.
+// The callbacks are passed to every call that may invoke them instead of
+// being stored, so they can safely reference the owner.
+//----------------------------------------------------------------------------
+class ModelBounds final {
+public:
+    struct Settings {
+        BVH::BuildSettings build_settings;
+        float rebuild_threshold;
+
+        static Settings default_settings() {
+            Settings settings = { BVH::BuildSettings::default_settings(), 1.5f };
+            return settings;
+        }
+    };
+
+    struct Statistics {
+        double update_time_in_seconds;
+        float SAH_cost;
+        float rebuild_SAH_cost; // The SAH cost after the last rebuild.
+        unsigned int model_count;
+        unsigned int mesh_count; // The number of meshes referenced by the models.
+        unsigned int refit_model_count; // The number of models refit by the last update.
+        unsigned int rebuild_count;
+        unsigned int refit_count;
+    };
+
+    struct MeshCallbacks {
+        // Called when a mesh gets its first model and when the geometry of a referenced mesh changes.
+        // Returns the object space bounds of the mesh.
+        std::function<Math::AABB(Assets::Meshes::UID)> update_mesh;
+        // Called when the last model referencing a mesh is removed.
+        std::function<void(Assets::Meshes::UID)> release_mesh;
+
+        // Uses the bounds stored with the meshes.
+        static MeshCallbacks mesh_bounds() {
+            MeshCallbacks callbacks = { Assets::Meshes::get_bounds, [](Assets::Meshes::UID) {} };
+            return callbacks;
+        }
+    };
+
+    struct Model {
+        Assets::MeshModels::UID model_ID;
+        Assets::Meshes::UID mesh_ID;
+        Scene::SceneNodes::UID node_ID;
+        Math::Transform world_to_object;
+        unsigned int next_model_of_node; // Index of the next model attached to the same scene node.
+    };
+
+    ModelBounds(Settings settings, const MeshCallbacks& mesh_callbacks);
+
+    // Updates the models and the hierarchy from the change notifications of the meshes, models and scene nodes.
+    // Referenced meshes with any of the geometry changes are updated and the models using them get new bounds.
+    void handle_updates(Assets::Meshes::Changes geometry_changes, const MeshCallbacks& mesh_callbacks);
+
+    inline bool is_empty() const { return m_models.empty(); }
+    inline const BVH& get_BVH() const { return m_bvh; }
+    inline const Statistics& get_statistics() const { return m_statistics; }
+    inline Math::AABB get_bounds() const { return m_bvh.get_bounds(); }
+
+    // The models are indexed by the primitive indices of the hierarchy.
+    inline unsigned int get_model_count() const { return (unsigned int)m_models.size(); }
+    inline const Model& get_model(unsigned int model_index) const { return m_models[model_index]; }
+    inline Math::AABB get_model_bounds(unsigned int model_index) const { return m_model_bounds[model_index]; }
+    inline unsigned int get_model_index(Assets::MeshModels::UID model_ID) const { return m_model_indices[model_ID]; }
+
+private:
+    struct MeshEntry {
+        Math::AABB bounds;
+        unsigned int model_count;
+    };
+
+    void add_model(Assets::MeshModels::UID model_ID, const MeshCallbacks& mesh_callbacks);
+    void remove_model(unsigned int model_index, const MeshCallbacks& mesh_callbacks);
+    void update_model_bounds(unsigned int model_index);
+    void link_models_to_nodes();
+    void rebuild();
+
+    Settings m_settings;
+    std::vector<MeshEntry> m_meshes; // Indexed by mesh ID.
+    std::vector<Model> m_models;
+    std::vector<Math::AABB> m_model_bounds; // World space bounds of the models, which the hierarchy is built over.
+    std::vector<unsigned int> m_model_indices; // Model indices indexed by model ID.
+    std::vector<unsigned int> m_node_first_models; // Index of the first model attached to a scene node, indexed by node ID.
+    BVH m_bvh;
+    Statistics m_statistics;
+};
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_MODEL_BOUNDS_H_
@@ -0,0 +1,184 @@
+// Cogwheel two level bounding volume hierarchy over the models in the scene.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Geometry/SceneBVH.h>
+#include <Cogwheel/Geometry/BVHCache.h>
+#include <Cogwheel/Math/Utils.h>
+
+#include <algorithm>
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Geometry {
+
+//-----------------------------------------------------------------------------
+// Utilities.
+//-----------------------------------------------------------------------------
+
+// The binary builder limits the depth to 64. At most one node per level and its sibling are on the stack at once.
+static const int max_depth = 64;
+
+// Transforms the ray into object space. The direction is not normalized, so distances along the ray are the same in both spaces.
+static inline Ray transform_ray(Transform world_to_object, Ray ray) {
+    Vector3f direction = world_to_object.rotation * ray.direction * world_to_object.scale;
+    return Ray(world_to_object * ray.origin, direction);
+}
+
+// Ray with precomputed values for the bounds tests.
+struct TraversalRay {
+    Vector3f origin;
+    Vector3f inverse_direction;
+
+    TraversalRay(Ray ray) : origin(ray.origin) {
+        for (int a = 0; a < 3; ++a) {
+            // Avoid infinite inverse directions, as multiplying them with zero produces NaNs.
+            float direction = ray.direction[a];
+            if (std::abs(direction) < 1e-20f)
+                direction = direction < 0.0f ? -1e-20f : 1e-20f;
+            inverse_direction[a] = 1.0f / direction;
+        }
+    }
+};
+
+// Returns the entry distance of the ray or infinity if the node isn't hit before t_max.
+static inline float intersect(const BVHNode& node, const TraversalRay& ray, float t_max) {
+    float t_near = 0.0f;
+    float t_far = t_max;
+    for (int a = 0; a < 3; ++a) {
+        float t0 = (node.minimum[a] - ray.origin[a]) * ray.inverse_direction[a];
+        float t1 = (node.maximum[a] - ray.origin[a]) * ray.inverse_direction[a];
+        t_near = max(t_near, min(t0, t1));
+        t_far = min(t_far, max(t0, t1));
+    }
+    // Conservative far distance, see Ize, Robust BVH Ray Traversal, 2013.
+    return t_near <= t_far * 1.0000004f ? t_near : std::numeric_limits<float>::infinity();
+}
+
+//-----------------------------------------------------------------------------
+// Scene bounding volume hierarchy.
+//-----------------------------------------------------------------------------
+
+SceneBVH::SceneBVH(Settings settings)
+    : m_settings(settings)
+    , m_models({ settings.model_settings, settings.rebuild_threshold }, mesh_callbacks()) { }
+
+AABB SceneBVH::build_mesh_BVH(Meshes::UID mesh_ID) {
+    if (m_mesh_BVHs.size() <= mesh_ID)
+        m_mesh_BVHs.resize(Meshes::capacity());
+
+    AABB bounds;
+    if (m_settings.cache_directory.empty()) {
+        BVH bvh = BVH(mesh_ID, m_settings.mesh_settings);
+        m_mesh_BVHs[mesh_ID] = BVH8(bvh, mesh_ID);
+        bounds = bvh.get_bounds();
+    } else
+        m_mesh_BVHs[mesh_ID] = BVHCache::load_cached(m_settings.cache_directory, mesh_ID, m_settings.mesh_settings, bounds);
+    // Empty meshes are given degenerate bounds at their origin, so the models can still be placed in the top level.
+    if (m_mesh_BVHs[mesh_ID].is_empty())
+        bounds = AABB(Vector3f::zero(), Vector3f::zero());
+    return bounds;
+}
+
+ModelBounds::MeshCallbacks SceneBVH::mesh_callbacks() {
+    ModelBounds::MeshCallbacks callbacks = {
+        [this](Meshes::UID mesh_ID) -> AABB { return build_mesh_BVH(mesh_ID); },
+        [this](Meshes::UID mesh_ID) { m_mesh_BVHs[mesh_ID] = BVH8(); }
+    };
+    return callbacks;
+}
+
+void SceneBVH::handle_updates() {
+    m_models.handle_updates({ Meshes::Change::IndicesUpdated, Meshes::Change::PositionsUpdated }, mesh_callbacks());
+}
+
+SceneRayHit SceneBVH::closest_hit(Ray ray, float t_max) const {
+    SceneRayHit scene_hit = { MeshModels::UID::invalid_UID(), RayHit::miss(t_max) };
+    const BVH& model_BVH = m_models.get_BVH();
+    if (model_BVH.is_empty())
+        return scene_hit;
+
+    const std::vector<BVHNode>& nodes = model_BVH.get_nodes();
+    const std::vector<unsigned int>& model_indices = model_BVH.get_primitive_indices();
+    const TraversalRay traversal_ray = TraversalRay(ray);
+
+    struct StackEntry {
+        unsigned int node_index;
+        float t;
+    };
+    StackEntry stack[max_depth + 1];
+    int stack_size = 0;
+    stack[stack_size++] = { 0u, 0.0f };
+
+    while (stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+        if (entry.t > scene_hit.hit.t)
+            continue;
+
+        const BVHNode& node = nodes[entry.node_index];
+        if (node.is_leaf()) {
+            for (unsigned int i = node.first_index; i < node.first_index + node.primitive_count; ++i) {
+                const ModelBounds::Model& model = m_models.get_model(model_indices[i]);
+                Ray object_ray = transform_ray(model.world_to_object, ray);
+                RayHit hit = m_mesh_BVHs[model.mesh_ID].closest_hit(object_ray, scene_hit.hit.t);
+                if (hit.is_hit()) {
+                    scene_hit.model_ID = model.model_ID;
+                    scene_hit.hit = hit;
+                }
+            }
+        } else {
+            // Push the children with the closest on top of the stack.
+            StackEntry near_entry = { node.first_index, intersect(nodes[node.first_index], traversal_ray, scene_hit.hit.t) };
+            StackEntry far_entry = { node.first_index + 1, intersect(nodes[node.first_index + 1], traversal_ray, scene_hit.hit.t) };
+            if (far_entry.t < near_entry.t)
+                std::swap(near_entry, far_entry);
+            // The entry distances are already clamped to the closest hit, so only missed children are infinite.
+            if (far_entry.t != std::numeric_limits<float>::infinity())
+                stack[stack_size++] = far_entry;
+            if (near_entry.t != std::numeric_limits<float>::infinity())
+                stack[stack_size++] = near_entry;
+        }
+    }
+
+    return scene_hit;
+}
+
+bool SceneBVH::any_hit(Ray ray, float t_max) const {
+    const BVH& model_BVH = m_models.get_BVH();
+    if (model_BVH.is_empty())
+        return false;
+
+    const std::vector<BVHNode>& nodes = model_BVH.get_nodes();
+    const std::vector<unsigned int>& model_indices = model_BVH.get_primitive_indices();
+    const TraversalRay traversal_ray = TraversalRay(ray);
+
+    unsigned int stack[max_depth + 1];
+    int stack_size = 0;
+    stack[stack_size++] = 0u;
+
+    while (stack_size > 0) {
+        const BVHNode& node = nodes[stack[--stack_size]];
+        if (node.is_leaf()) {
+            for (unsigned int i = node.first_index; i < node.first_index + node.primitive_count; ++i) {
+                const ModelBounds::Model& model = m_models.get_model(model_indices[i]);
+                if (m_mesh_BVHs[model.mesh_ID].any_hit(transform_ray(model.world_to_object, ray), t_max))
+                    return true;
+            }
+        } else {
+            for (unsigned int c = node.first_index; c < node.first_index + 2; ++c)
+                if (intersect(nodes[c], traversal_ray, t_max) != std::numeric_limits<float>::infinity())
+                    stack[stack_size++] = c;
+        }
+    }
+
+    return false;
+}
+
+} // NS Geometry
+} // NS Cogwheel
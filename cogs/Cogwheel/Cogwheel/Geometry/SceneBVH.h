@@ -0,0 +1,93 @@
+// Cogwheel two level bounding volume hierarchy over the models in the scene.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_SCENE_BVH_H_
+#define _COGWHEEL_GEOMETRY_SCENE_BVH_H_
+
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Geometry/BVH.h>
+#include <Cogwheel/Geometry/ModelBounds.h>
+#include <Cogwheel/Geometry/WideBVH.h>
+#include <Cogwheel/Math/Transform.h>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace Cogwheel {
+namespace Geometry {
+
+//----------------------------------------------------------------------------
+// The closest intersection along a ray and the model that was hit.
+// The primitive index of the hit is relative to the model's mesh.
+//----------------------------------------------------------------------------
+struct SceneRayHit final {
+    Assets::MeshModels::UID model_ID;
+    RayHit hit;
+
+    inline bool is_hit() const { return hit.is_hit(); }
+};
+
+//----------------------------------------------------------------------------
+// Two level bounding volume hierarchy over the mesh models in the scene.
+// Every mesh gets a BVH8 in object space, which is shared by all models
+// referencing the mesh. The top level is a binary BVH over the world space
+// bounds of the models. Rays are traced through a model by transforming them
+// into the object space of the model.
+// The top level is maintained by ModelBounds, see its description for how
+// updates are handled. The BVHs of meshes are rebuilt when their indices or
+// positions change and released once no models reference them.
+// Static meshes can be loaded from an on disk cache instead of being rebuilt
+// by setting a cache directory.
+// Future work:
+// * Refit the BVHs of deforming meshes instead of rebuilding them.
+// * Build the mesh BVHs in parallel.
+// * Packet queries.
+//----------------------------------------------------------------------------
+class SceneBVH final {
+public:
+    struct Settings {
+        BVH::BuildSettings mesh_settings;
+        BVH::BuildSettings model_settings;
+        float rebuild_threshold;
+        std::string cache_directory; // Mesh BVHs are cached in this directory unless it is empty. See BVHCache.
+
+        static Settings default_settings() {
+            Settings settings = { BVH::BuildSettings::default_settings(), BVH::BuildSettings::default_settings(), 1.5f, "" };
+            return settings;
+        }
+    };
+
+    typedef ModelBounds::Statistics Statistics; // The SAH cost and the rebuild statistics are of the top level.
+
+    SceneBVH(Settings settings = Settings::default_settings());
+
+    // Updates the hierarchy from the change notifications of the meshes, models and scene nodes.
+    void handle_updates();
+
+    inline bool is_empty() const { return m_models.is_empty(); }
+    inline const BVH& get_model_BVH() const { return m_models.get_BVH(); }
+    inline const Statistics& get_statistics() const { return m_models.get_statistics(); }
+
+    // Single ray queries. Intersections are reported in the interval [0, t_max].
+    SceneRayHit closest_hit(Math::Ray ray, float t_max = std::numeric_limits<float>::infinity()) const;
+    bool any_hit(Math::Ray ray, float t_max = std::numeric_limits<float>::infinity()) const;
+
+private:
+    Math::AABB build_mesh_BVH(Assets::Meshes::UID mesh_ID);
+    ModelBounds::MeshCallbacks mesh_callbacks();
+
+    Settings m_settings;
+    std::vector<BVH8> m_mesh_BVHs; // Indexed by mesh ID.
+    ModelBounds m_models; // Declared after the mesh BVHs, as the BVHs of the existing models' meshes are built on construction.
+};
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_SCENE_BVH_H_
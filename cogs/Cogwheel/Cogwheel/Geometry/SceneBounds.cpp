@@ -0,0 +1,149 @@
+// Cogwheel hierarchy over the world space bounds of the models in the scene.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Geometry/SceneBounds.h>
+#include <Cogwheel/Math/SIMD.h>
+
+#include <omp.h>
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Math::SIMD;
+
+namespace Cogwheel {
+namespace Geometry {
+
+//-----------------------------------------------------------------------------
+// Utilities.
+//-----------------------------------------------------------------------------
+
+// The binary builder limits the depth to 64. At most one node per level and its sibling are on the stack at once.
+static const int max_depth = 64;
+
+//-----------------------------------------------------------------------------
+// Frustum culling.
+//-----------------------------------------------------------------------------
+
+enum class Overlap { Outside, Intersecting, Inside };
+
+// The frustum planes stored as structure of arrays, so the bounds can be tested against all planes at once.
+// The two unused lanes hold planes that everything is inside.
+struct SIMDFrustum {
+    Float8 a, b, c, d;
+
+    SIMDFrustum(const Frustum& frustum) {
+        float as[8], bs[8], cs[8], ds[8];
+        for (int p = 0; p < 8; ++p) {
+            Plane plane = p < Frustum::plane_count ? frustum.planes[p] : Plane(0.0f, 0.0f, 0.0f, 1.0f);
+            as[p] = plane.a; bs[p] = plane.b; cs[p] = plane.c; ds[p] = plane.d;
+        }
+        a = Float8::load(as); b = Float8::load(bs); c = Float8::load(cs); d = Float8::load(ds);
+    }
+
+    inline Overlap test(const float* minimum, const float* maximum) const {
+        Float8 ax0 = a * Float8(minimum[0]), ax1 = a * Float8(maximum[0]);
+        Float8 by0 = b * Float8(minimum[1]), by1 = b * Float8(maximum[1]);
+        Float8 cz0 = c * Float8(minimum[2]), cz1 = c * Float8(maximum[2]);
+        const Float8 zero = Float8(0.0f);
+
+        // The bounds are outside if the corner furthest along the normal of any plane is behind it.
+        Float8 far_distances = max(ax0, ax1) + max(by0, by1) + max(cz0, cz1) + d;
+        if ((far_distances < zero).mask() != 0)
+            return Overlap::Outside;
+
+        // The bounds are inside if the corner furthest against the normal of every plane is in front of it.
+        Float8 near_distances = min(ax0, ax1) + min(by0, by1) + min(cz0, cz1) + d;
+        return (near_distances < zero).mask() == 0 ? Overlap::Inside : Overlap::Intersecting;
+    }
+    inline Overlap test(const BVHNode& node) const { return test(node.minimum, node.maximum); }
+    inline Overlap test(const AABB& bounds) const { return test(&bounds.minimum.x, &bounds.maximum.x); }
+};
+
+struct CullTask {
+    unsigned int node_index;
+    bool inside; // The subtree is known to be inside the frustum and needs no further tests.
+};
+
+//-----------------------------------------------------------------------------
+// Scene bounds.
+//-----------------------------------------------------------------------------
+
+void SceneBounds::cull(const Frustum& frustum, std::vector<MeshModels::UID>& visible_model_IDs) const {
+    const BVH& bvh = m_models.get_BVH();
+    if (bvh.is_empty())
+        return;
+
+    const SIMDFrustum simd_frustum = SIMDFrustum(frustum);
+    const std::vector<BVHNode>& nodes = bvh.get_nodes();
+    const std::vector<unsigned int>& model_indices = bvh.get_primitive_indices();
+
+    // Cull the upper levels breadth first until there are enough subtrees to keep the threads busy.
+    const size_t min_task_count = 8 * omp_get_max_threads();
+    std::vector<CullTask> tasks(1, { 0u, false });
+    std::vector<CullTask> next_tasks;
+    bool expanded = true;
+    while (expanded && tasks.size() < min_task_count) {
+        expanded = false;
+        next_tasks.clear();
+        for (CullTask task : tasks) {
+            const BVHNode& node = nodes[task.node_index];
+            if (task.inside || node.is_leaf()) {
+                next_tasks.push_back(task);
+                continue;
+            }
+
+            Overlap overlap = simd_frustum.test(node);
+            if (overlap == Overlap::Inside)
+                next_tasks.push_back({ task.node_index, true });
+            else if (overlap == Overlap::Intersecting) {
+                next_tasks.push_back({ node.first_index, false });
+                next_tasks.push_back({ node.first_index + 1, false });
+                expanded = true;
+            }
+        }
+        tasks.swap(next_tasks);
+    }
+
+    // Cull the subtrees in parallel and append the visible models in the order of the subtrees.
+    std::vector<std::vector<MeshModels::UID>> task_visible_model_IDs(tasks.size());
+    #pragma omp parallel for schedule(dynamic, 1) if (tasks.size() > 1)
+    for (int t = 0; t < int(tasks.size()); ++t) {
+        std::vector<MeshModels::UID>& task_model_IDs = task_visible_model_IDs[t];
+        CullTask stack[max_depth + 1];
+        int stack_size = 0;
+        stack[stack_size++] = tasks[t];
+
+        while (stack_size > 0) {
+            CullTask entry = stack[--stack_size];
+            const BVHNode& node = nodes[entry.node_index];
+            if (!entry.inside) {
+                Overlap overlap = simd_frustum.test(node);
+                if (overlap == Overlap::Outside)
+                    continue;
+                entry.inside = overlap == Overlap::Inside;
+            }
+
+            if (node.is_leaf()) {
+                for (unsigned int i = node.first_index; i < node.first_index + node.primitive_count; ++i) {
+                    unsigned int model_index = model_indices[i];
+                    if (entry.inside || simd_frustum.test(m_models.get_model_bounds(model_index)) != Overlap::Outside)
+                        task_model_IDs.push_back(m_models.get_model(model_index).model_ID);
+                }
+            } else {
+                stack[stack_size++] = { node.first_index + 1, entry.inside };
+                stack[stack_size++] = { node.first_index, entry.inside };
+            }
+        }
+    }
+
+    for (const std::vector<MeshModels::UID>& task_model_IDs : task_visible_model_IDs)
+        visible_model_IDs.insert(visible_model_IDs.end(), task_model_IDs.begin(), task_model_IDs.end());
+}
+
+} // NS Geometry
+} // NS Cogwheel
@@ -0,0 +1,71 @@
+// Cogwheel hierarchy over the world space bounds of the models in the scene.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_SCENE_BOUNDS_H_
+#define _COGWHEEL_GEOMETRY_SCENE_BOUNDS_H_
+
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Geometry/BVH.h>
+#include <Cogwheel/Geometry/ModelBounds.h>
+#include <Cogwheel/Math/AABB.h>
+#include <Cogwheel/Math/Frustum.h>
+#include <Cogwheel/Math/Matrix.h>
+
+#include <vector>
+
+namespace Cogwheel {
+namespace Geometry {
+
+//----------------------------------------------------------------------------
+// Binary BVH over the world space bounds of the mesh models in the scene,
+// computed from the bounds of their meshes and the global transforms of
+// their scene nodes. Unlike the SceneBVH no hierarchies are built over the
+// meshes, so it is cheap to maintain for rasterizers.
+// The bounds and the hierarchy are maintained by ModelBounds, see its
+// description for how updates are handled. Mesh bounds are reread when their
+// positions change.
+// Frustum culling tests the six planes against a node's bounds at once using
+// SIMD and accepts the subtrees fully inside the frustum without further
+// tests, so the cost is proportional to the number of visible models.
+// The upper levels are culled serially and the remaining subtrees are culled
+// in parallel.
+//----------------------------------------------------------------------------
+class SceneBounds final {
+public:
+    typedef ModelBounds::Settings Settings;
+    typedef ModelBounds::Statistics Statistics;
+
+    SceneBounds(Settings settings = Settings::default_settings())
+        : m_models(settings, ModelBounds::MeshCallbacks::mesh_bounds()) { }
+
+    // Updates the hierarchy from the change notifications of the meshes, models and scene nodes.
+    void handle_updates() { m_models.handle_updates(Assets::Meshes::Change::PositionsUpdated, ModelBounds::MeshCallbacks::mesh_bounds()); }
+
+    inline bool is_empty() const { return m_models.is_empty(); }
+    inline const BVH& get_BVH() const { return m_models.get_BVH(); }
+    inline const Statistics& get_statistics() const { return m_models.get_statistics(); }
+    inline Math::AABB get_bounds() const { return m_models.get_bounds(); }
+
+    // World space bounds of a model. The model must be part of the hierarchy.
+    Math::AABB get_model_bounds(Assets::MeshModels::UID model_ID) const { return m_models.get_model_bounds(m_models.get_model_index(model_ID)); }
+
+    // Appends the IDs of the models whose bounds intersect the frustum to visible_model_IDs.
+    // Models that are outside the frustum, but not fully outside any of its planes, are conservatively included.
+    void cull(const Math::Frustum& frustum, std::vector<Assets::MeshModels::UID>& visible_model_IDs) const;
+    void cull(Math::Matrix4x4f view_projection_matrix, std::vector<Assets::MeshModels::UID>& visible_model_IDs) const {
+        cull(Math::Frustum::from_view_projection_matrix(view_projection_matrix), visible_model_IDs);
+    }
+
+private:
+    ModelBounds m_models;
+};
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_SCENE_BOUNDS_H_
@@ -0,0 +1,523 @@
+// Cogwheel wide bounding volume hierarchy and ray traversal.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Geometry/WideBVH.h>
+#include <Cogwheel/Math/SIMD.h>
+#include <Cogwheel/Math/Utils.h>
+
+#include <cmath>
+#include <utility>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Math::SIMD;
+
+namespace Cogwheel {
+namespace Geometry {
+
+//-----------------------------------------------------------------------------
+// Collapsing.
+//-----------------------------------------------------------------------------
+
+static inline float surface_area(const BVHNode& node) {
+    Vector3f size = node.get_bounds().size();
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+template <int Width>
+struct Collapser {
+    typedef WideBVHNode<Width> Node;
+
+    const std::vector<BVHNode>& binary_nodes;
+    const std::vector<unsigned int>& primitive_indices;
+    const Vector3f* positions;
+    const Vector3ui* primitives; // Null for triangle soups.
+    std::vector<Node>& nodes;
+    std::vector<TrianglePack>& packs;
+    typename WideBVH<Width>::Statistics& statistics;
+
+    // Copies the triangles of a binary leaf into packs and returns the index of the first pack.
+    unsigned int create_packs(const BVHNode& leaf) {
+        unsigned int first_pack_index = (unsigned int)packs.size();
+        for (unsigned int i = 0; i < leaf.primitive_count; i += TrianglePack::width) {
+            TrianglePack pack = {};
+            for (int lane = 0; lane < TrianglePack::width; ++lane) {
+                if (i + lane < leaf.primitive_count) {
+                    unsigned int primitive_index = primitive_indices[leaf.first_index + i + lane];
+                    Vector3ui primitive = primitives != nullptr ? primitives[primitive_index] :
+                        Vector3ui(primitive_index * 3, primitive_index * 3 + 1, primitive_index * 3 + 2);
+                    for (int v = 0; v < 3; ++v)
+                        for (int a = 0; a < 3; ++a)
+                            pack.vertices[v][a][lane] = positions[primitive[v]][a];
+                    pack.primitive_indices[lane] = primitive_index;
+                } else
+                    pack.primitive_indices[lane] = RayHit::no_primitive;
+            }
+            packs.push_back(pack);
+        }
+        return first_pack_index;
+    }
+
+    // Pulls the grandchildren of the binary node up into a wide node, by repeatedly opening
+    // the inner child with the largest surface area until the node is full.
+    void collapse(unsigned int binary_node_index, unsigned int node_index, unsigned int depth) {
+        statistics.max_depth = max(statistics.max_depth, depth);
+
+        unsigned int children[Width];
+        int child_count = 0;
+        const BVHNode& binary_node = binary_nodes[binary_node_index];
+        if (binary_node.is_leaf())
+            children[child_count++] = binary_node_index;
+        else {
+            children[child_count++] = binary_node.first_index;
+            children[child_count++] = binary_node.first_index + 1;
+        }
+
+        while (child_count < Width) {
+            int largest_child = -1;
+            float largest_area = -1.0f;
+            for (int c = 0; c < child_count; ++c) {
+                const BVHNode& child = binary_nodes[children[c]];
+                if (!child.is_leaf() && surface_area(child) > largest_area) {
+                    largest_child = c;
+                    largest_area = surface_area(child);
+                }
+            }
+            if (largest_child < 0)
+                break;
+
+            unsigned int first_grandchild = binary_nodes[children[largest_child]].first_index;
+            children[largest_child] = first_grandchild;
+            children[child_count++] = first_grandchild + 1;
+        }
+
+        for (int c = 0; c < Width; ++c) {
+            for (int a = 0; a < 3; ++a) {
+                nodes[node_index].bounds[2 * a][c] = std::numeric_limits<float>::infinity();
+                nodes[node_index].bounds[2 * a + 1][c] = -std::numeric_limits<float>::infinity();
+            }
+            nodes[node_index].child_indices[c] = 0u;
+            nodes[node_index].pack_counts[c] = 0u;
+        }
+
+        for (int c = 0; c < child_count; ++c) {
+            const BVHNode& child = binary_nodes[children[c]];
+            for (int a = 0; a < 3; ++a) {
+                nodes[node_index].bounds[2 * a][c] = child.minimum[a];
+                nodes[node_index].bounds[2 * a + 1][c] = child.maximum[a];
+            }
+
+            if (child.is_leaf()) {
+                nodes[node_index].child_indices[c] = create_packs(child);
+                nodes[node_index].pack_counts[c] = ceil_divide(child.primitive_count, (unsigned int)TrianglePack::width);
+                ++statistics.leaf_count;
+            } else {
+                // Resizing invalidates references, so the nodes are only accessed by index.
+                unsigned int child_node_index = (unsigned int)nodes.size();
+                nodes.resize(nodes.size() + 1);
+                nodes[node_index].child_indices[c] = child_node_index;
+                collapse(children[c], child_node_index, depth + 1);
+            }
+        }
+    }
+};
+
+template <int Width>
+WideBVH<Width>::WideBVH(Meshes::UID mesh_ID, BVH::BuildSettings settings) {
+    Mesh mesh = mesh_ID;
+    bool is_triangle_soup = mesh.get_primitive_count() == 0;
+    collapse(BVH(mesh_ID, settings), mesh.get_positions(), is_triangle_soup ? nullptr : mesh.get_primitives());
+}
+
+template <int Width>
+WideBVH<Width>::WideBVH(const BVH& bvh, Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+    bool is_triangle_soup = mesh.get_primitive_count() == 0;
+    collapse(bvh, mesh.get_positions(), is_triangle_soup ? nullptr : mesh.get_primitives());
+}
+
+template <int Width>
+void WideBVH<Width>::collapse(const BVH& bvh, const Vector3f* positions, const Vector3ui* primitives) {
+    Statistics statistics = {};
+    m_statistics = statistics;
+    if (bvh.is_empty())
+        return;
+
+    m_nodes.reserve(bvh.get_nodes().size() / (Width - 1) + 1);
+    m_packs.reserve(ceil_divide(bvh.get_statistics().reference_count, (unsigned int)TrianglePack::width) + bvh.get_statistics().leaf_count);
+    m_nodes.resize(1);
+    Collapser<Width> collapser = { bvh.get_nodes(), bvh.get_primitive_indices(), positions, primitives, m_nodes, m_packs, m_statistics };
+    collapser.collapse(0u, 0u, 0u);
+
+    m_statistics.node_count = (unsigned int)m_nodes.size();
+    m_statistics.pack_count = (unsigned int)m_packs.size();
+    m_statistics.average_child_count = float(m_statistics.node_count - 1 + m_statistics.leaf_count) / m_statistics.node_count;
+}
+
+//-----------------------------------------------------------------------------
+// Traversal.
+//-----------------------------------------------------------------------------
+
+// The binary builder limits the depth to 64, which bounds the number of children left on the stack per level.
+static const int max_depth = 64;
+
+// Ray with precomputed values for the child bounds and triangle tests.
+template <typename Float>
+struct TraversalRay {
+    // Bounds.
+    Float inverse_direction[3];
+    Float origin_over_direction[3];
+    int near_rows[3]; // The row of the node's bounds holding the near planes along each axis.
+
+    // Watertight triangle intersection. The axes are permuted so the largest direction component is the last.
+    Float4 origin[3];
+    Float4 shear[3];
+    int axes[3];
+
+    TraversalRay() = default;
+    TraversalRay(Ray ray) {
+        for (int a = 0; a < 3; ++a) {
+            // Avoid infinite inverse directions, as multiplying them with zero produces NaNs.
+            float direction = ray.direction[a];
+            if (std::abs(direction) < 1e-20f)
+                direction = direction < 0.0f ? -1e-20f : 1e-20f;
+            inverse_direction[a] = Float(1.0f / direction);
+            origin_over_direction[a] = Float(ray.origin[a] / direction);
+            near_rows[a] = 2 * a + (direction < 0.0f ? 1 : 0);
+        }
+
+        Vector3f abs_direction = Vector3f(std::abs(ray.direction.x), std::abs(ray.direction.y), std::abs(ray.direction.z));
+        int kz = abs_direction.x > abs_direction.y ? (abs_direction.x > abs_direction.z ? 0 : 2) : (abs_direction.y > abs_direction.z ? 1 : 2);
+        int kx = (kz + 1) % 3;
+        int ky = (kx + 1) % 3;
+        if (ray.direction[kz] < 0.0f)
+            std::swap(kx, ky); // Preserve the winding.
+        axes[0] = kx; axes[1] = ky; axes[2] = kz;
+
+        for (int a = 0; a < 3; ++a)
+            origin[a] = Float4(ray.origin[axes[a]]);
+        shear[0] = Float4(ray.direction[kx] / ray.direction[kz]);
+        shear[1] = Float4(ray.direction[ky] / ray.direction[kz]);
+        shear[2] = Float4(1.0f / ray.direction[kz]);
+    }
+};
+
+// Tests the ray against the bounds of all children. Returns the mask of hit children and their entry distances.
+template <int Width, typename Float>
+static inline int intersect_children(const WideBVHNode<Width>& node, const TraversalRay<Float>& ray, float t_max, float* t_nears) {
+    Float t_near = Float(0.0f);
+    Float t_far = Float(t_max);
+    // NaNs are discarded by placing the distances as the first argument of min and max.
+    for (int a = 0; a < 3; ++a) {
+        int near_row = ray.near_rows[a];
+        Float near_plane_t = multiply_subtract(Float::load(node.bounds[near_row]), ray.inverse_direction[a], ray.origin_over_direction[a]);
+        Float far_plane_t = multiply_subtract(Float::load(node.bounds[near_row ^ 1]), ray.inverse_direction[a], ray.origin_over_direction[a]);
+        t_near = max(near_plane_t, t_near);
+        t_far = min(far_plane_t, t_far);
+    }
+    // Conservative far distance, see Ize, Robust BVH Ray Traversal, 2013.
+    t_far = t_far * Float(1.0000004f);
+    t_near.store(t_nears);
+    return (t_near <= t_far).mask();
+}
+
+// Intersects the ray with the four triangles in the pack, see Woop et al, Watertight Ray/Triangle Intersection, 2013.
+// Returns true and updates the hit if a triangle is hit closer than hit.t.
+template <typename Float>
+static inline bool intersect(const TrianglePack& pack, const TraversalRay<Float>& ray, RayHit& hit) {
+    // Vertices relative to the ray origin with the axes permuted.
+    Float4 vertices[3][3];
+    for (int v = 0; v < 3; ++v)
+        for (int a = 0; a < 3; ++a)
+            vertices[v][a] = Float4::load(pack.vertices[v][ray.axes[a]]) - ray.origin[a];
+
+    // Shear and scale the vertices.
+    Float4 Ax = vertices[0][0] - ray.shear[0] * vertices[0][2];
+    Float4 Ay = vertices[0][1] - ray.shear[1] * vertices[0][2];
+    Float4 Bx = vertices[1][0] - ray.shear[0] * vertices[1][2];
+    Float4 By = vertices[1][1] - ray.shear[1] * vertices[1][2];
+    Float4 Cx = vertices[2][0] - ray.shear[0] * vertices[2][2];
+    Float4 Cy = vertices[2][1] - ray.shear[1] * vertices[2][2];
+
+    // Scaled barycentric coordinates.
+    Float4 U = Cx * By - Cy * Bx;
+    Float4 V = Ax * Cy - Ay * Cx;
+    Float4 W = Bx * Ay - By * Ax;
+
+    const Float4 zero = Float4(0.0f);
+    Float4 has_negative = (U < zero) | (V < zero) | (W < zero);
+    Float4 has_positive = (U > zero) | (V > zero) | (W > zero);
+    Float4 determinant = U + V + W;
+
+    Float4 Az = ray.shear[2] * vertices[0][2];
+    Float4 Bz = ray.shear[2] * vertices[1][2];
+    Float4 Cz = ray.shear[2] * vertices[2][2];
+    Float4 T = U * Az + V * Bz + W * Cz;
+
+    // Compare the scaled distance against the interval without dividing by the determinant.
+    Float4 determinant_sign = determinant & Float4(-0.0f);
+    Float4 signed_T = T ^ determinant_sign;
+    Float4 abs_determinant = determinant ^ determinant_sign;
+    Float4 miss = (has_negative & has_positive) | (determinant == zero) |
+                  (signed_T < zero) | (signed_T > abs_determinant * Float4(hit.t));
+    int hit_mask = ~miss.mask() & 0xF;
+    if (hit_mask == 0)
+        return false;
+
+    alignas(16) float Ts[4], Vs[4], Ws[4], determinants[4];
+    T.store(Ts); V.store(Vs); W.store(Ws); determinant.store(determinants);
+    bool found_hit = false;
+    for (int lane = 0; lane < 4; ++lane)
+        if ((hit_mask & (1 << lane)) && pack.primitive_indices[lane] != RayHit::no_primitive) {
+            float inverse_determinant = 1.0f / determinants[lane];
+            float t = Ts[lane] * inverse_determinant;
+            if (t < hit.t) {
+                hit.t = t;
+                hit.u = Vs[lane] * inverse_determinant;
+                hit.v = Ws[lane] * inverse_determinant;
+                hit.primitive_index = pack.primitive_indices[lane];
+                found_hit = true;
+            }
+        }
+    return found_hit;
+}
+
+static inline int lowest_bit_index(int mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, (unsigned long)mask);
+    return int(index);
+#else
+    return __builtin_ctz((unsigned int)mask);
+#endif
+}
+
+static inline int lowest_bit_index(unsigned long long mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return int(index);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+struct StackEntry {
+    unsigned int index;
+    unsigned int pack_count; // Zero for nodes.
+    float t;
+};
+
+template <int Width>
+RayHit WideBVH<Width>::closest_hit(Ray ray, float t_max) const {
+    typedef typename FloatN<Width>::Type Float;
+
+    RayHit hit = RayHit::miss(t_max);
+    if (m_nodes.empty())
+        return hit;
+
+    const TraversalRay<Float> traversal_ray = TraversalRay<Float>(ray);
+    StackEntry stack[max_depth * Width];
+    int stack_size = 0;
+    StackEntry entry = { 0u, 0u, 0.0f };
+
+    while (true) {
+        if (entry.pack_count > 0) {
+            for (unsigned int p = entry.index; p < entry.index + entry.pack_count; ++p)
+                intersect(m_packs[p], traversal_ray, hit);
+        } else {
+            const Node& node = m_nodes[entry.index];
+            alignas(32) float t_nears[Width];
+            int hit_mask = intersect_children(node, traversal_ray, hit.t, t_nears);
+
+            if (hit_mask != 0) {
+                // Continue with the closest child and push the rest sorted by distance with the closest on top of the stack.
+                int child = lowest_bit_index(hit_mask);
+                hit_mask &= hit_mask - 1;
+                StackEntry closest_entry = { node.child_indices[child], node.pack_counts[child], t_nears[child] };
+                int first_pushed = stack_size;
+                while (hit_mask != 0) {
+                    child = lowest_bit_index(hit_mask);
+                    hit_mask &= hit_mask - 1;
+                    StackEntry child_entry = { node.child_indices[child], node.pack_counts[child], t_nears[child] };
+                    if (child_entry.t < closest_entry.t)
+                        std::swap(child_entry, closest_entry);
+                    int i = stack_size++;
+                    for (; i > first_pushed && stack[i - 1].t < child_entry.t; --i)
+                        stack[i] = stack[i - 1];
+                    stack[i] = child_entry;
+                }
+                entry = closest_entry;
+                continue;
+            }
+        }
+
+        // Pop the next entry that could contain a closer hit.
+        do {
+            if (stack_size == 0)
+                return hit;
+            entry = stack[--stack_size];
+        } while (entry.t > hit.t);
+    }
+}
+
+template <int Width>
+bool WideBVH<Width>::any_hit(Ray ray, float t_max) const {
+    typedef typename FloatN<Width>::Type Float;
+
+    if (m_nodes.empty())
+        return false;
+
+    RayHit hit = RayHit::miss(t_max);
+    const TraversalRay<Float> traversal_ray = TraversalRay<Float>(ray);
+    StackEntry stack[max_depth * Width];
+    StackEntry root = { 0u, 0u, 0.0f };
+    stack[0] = root;
+    int stack_size = 1;
+
+    while (stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+
+        if (entry.pack_count > 0) {
+            for (unsigned int p = entry.index; p < entry.index + entry.pack_count; ++p)
+                if (intersect(m_packs[p], traversal_ray, hit))
+                    return true;
+            continue;
+        }
+
+        const Node& node = m_nodes[entry.index];
+        alignas(32) float t_nears[Width];
+        int hit_mask = intersect_children(node, traversal_ray, t_max, t_nears);
+        while (hit_mask != 0) {
+            int child = lowest_bit_index(hit_mask);
+            hit_mask &= hit_mask - 1;
+            StackEntry child_entry = { node.child_indices[child], node.pack_counts[child], t_nears[child] };
+            stack[stack_size++] = child_entry;
+        }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Packet traversal.
+//-----------------------------------------------------------------------------
+
+struct PacketStackEntry {
+    unsigned int index;
+    unsigned int pack_count; // Zero for nodes.
+    unsigned long long ray_mask; // The rays in the packet that hit the node.
+};
+
+template <int Width>
+template <bool occlusion_only>
+void WideBVH<Width>::trace_packet(const Ray* rays, const float* t_maxs, int ray_count, RayHit* hits) const {
+    typedef typename FloatN<Width>::Type Float;
+
+    for (int r = 0; r < ray_count; ++r)
+        hits[r] = RayHit::miss(t_maxs[r]);
+    if (m_nodes.empty())
+        return;
+
+    TraversalRay<Float> traversal_rays[max_packet_size];
+    for (int r = 0; r < ray_count; ++r)
+        traversal_rays[r] = TraversalRay<Float>(rays[r]);
+
+    // Rays that still need to be traced. Occlusion rays are done once they hit anything.
+    unsigned long long active_rays = ray_count == 64 ? ~0ull : (1ull << ray_count) - 1ull;
+
+    PacketStackEntry stack[max_depth * Width];
+    PacketStackEntry root = { 0u, 0u, active_rays };
+    stack[0] = root;
+    int stack_size = 1;
+
+    while (stack_size > 0) {
+        PacketStackEntry entry = stack[--stack_size];
+        unsigned long long ray_mask = entry.ray_mask & active_rays;
+        if (ray_mask == 0)
+            continue;
+
+        if (entry.pack_count > 0) {
+            while (ray_mask != 0) {
+                int r = lowest_bit_index(ray_mask);
+                ray_mask &= ray_mask - 1;
+                for (unsigned int p = entry.index; p < entry.index + entry.pack_count; ++p)
+                    if (intersect(m_packs[p], traversal_rays[r], hits[r]) && occlusion_only) {
+                        active_rays &= ~(1ull << r);
+                        break;
+                    }
+            }
+            continue;
+        }
+
+        // Gather the rays hitting each child and the closest entry distance.
+        const Node& node = m_nodes[entry.index];
+        unsigned long long child_ray_masks[Width] = {};
+        float child_ts[Width];
+        for (int c = 0; c < Width; ++c)
+            child_ts[c] = std::numeric_limits<float>::infinity();
+        while (ray_mask != 0) {
+            int r = lowest_bit_index(ray_mask);
+            ray_mask &= ray_mask - 1;
+            alignas(32) float t_nears[Width];
+            int hit_mask = intersect_children(node, traversal_rays[r], hits[r].t, t_nears);
+            while (hit_mask != 0) {
+                int c = lowest_bit_index(hit_mask);
+                hit_mask &= hit_mask - 1;
+                child_ray_masks[c] |= 1ull << r;
+                child_ts[c] = min(child_ts[c], t_nears[c]);
+            }
+        }
+
+        // Push the children sorted by their closest entry distance with the closest child on top of the stack.
+        int first_pushed = stack_size;
+        float pushed_ts[Width];
+        for (int c = 0; c < Width; ++c)
+            if (child_ray_masks[c] != 0) {
+                PacketStackEntry child = { node.child_indices[c], node.pack_counts[c], child_ray_masks[c] };
+                int i = stack_size++;
+                for (; i > first_pushed && pushed_ts[i - 1 - first_pushed] < child_ts[c]; --i) {
+                    stack[i] = stack[i - 1];
+                    pushed_ts[i - first_pushed] = pushed_ts[i - 1 - first_pushed];
+                }
+                stack[i] = child;
+                pushed_ts[i - first_pushed] = child_ts[c];
+            }
+    }
+}
+
+template <int Width>
+void WideBVH<Width>::closest_hit(const Ray* rays, const float* t_maxs, int ray_count, RayHit* hits) const {
+    const int packet_size = max_packet_size;
+    for (int packet_begin = 0; packet_begin < ray_count; packet_begin += packet_size) {
+        int packet_ray_count = min(packet_size, ray_count - packet_begin);
+        trace_packet<false>(rays + packet_begin, t_maxs + packet_begin, packet_ray_count, hits + packet_begin);
+    }
+}
+
+template <int Width>
+void WideBVH<Width>::any_hit(const Ray* rays, const float* t_maxs, int ray_count, bool* hits) const {
+    const int packet_size = max_packet_size;
+    RayHit packet_hits[max_packet_size];
+    for (int packet_begin = 0; packet_begin < ray_count; packet_begin += packet_size) {
+        int packet_ray_count = min(packet_size, ray_count - packet_begin);
+        trace_packet<true>(rays + packet_begin, t_maxs + packet_begin, packet_ray_count, packet_hits);
+        for (int r = 0; r < packet_ray_count; ++r)
+            hits[packet_begin + r] = packet_hits[r].is_hit();
+    }
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
+
+} // NS Geometry
+} // NS Cogwheel
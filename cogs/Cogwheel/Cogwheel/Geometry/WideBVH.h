@@ -0,0 +1,149 @@
+// Cogwheel wide bounding volume hierarchy and ray traversal.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_WIDE_BVH_H_
+#define _COGWHEEL_GEOMETRY_WIDE_BVH_H_
+
+#include <Cogwheel/Geometry/BVH.h>
+#include <Cogwheel/Math/Ray.h>
+
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Cogwheel {
+namespace Geometry {
+
+//----------------------------------------------------------------------------
+// The closest intersection along a ray.
+// u and v are the barycentric coordinates of the second and third vertex.
+//----------------------------------------------------------------------------
+struct RayHit final {
+    static const unsigned int no_primitive = 0xFFFFFFFF;
+
+    float t;
+    float u, v;
+    unsigned int primitive_index;
+
+    inline bool is_hit() const { return primitive_index != no_primitive; }
+
+    static inline RayHit miss(float t_max = std::numeric_limits<float>::infinity()) {
+        RayHit hit = { t_max, 0.0f, 0.0f, no_primitive };
+        return hit;
+    }
+};
+
+//----------------------------------------------------------------------------
+// Node with up to Width children, whose bounds are stored as structure of
+// arrays, so a ray can be tested against all children at once.
+// Bounds are stored as [min x, max x, min y, max y, min z, max z].
+// Inner children have a triangle pack count of zero and a child index to a
+// node. Leaf children reference pack_count triangle packs starting at
+// child_index. Unused children have empty bounds and are never hit.
+// A node is 128 bytes for a width of 4 and 256 bytes for a width of 8.
+//----------------------------------------------------------------------------
+template <int Width>
+struct WideBVHNode final {
+    float bounds[6][Width];
+    unsigned int child_indices[Width];
+    unsigned int pack_counts[Width];
+
+    inline bool is_leaf(int child) const { return pack_counts[child] != 0; }
+    inline bool is_empty(int child) const { return bounds[0][child] > bounds[1][child]; }
+};
+static_assert(sizeof(WideBVHNode<4>) == 128, "WideBVHNode<4> must be 128 bytes.");
+static_assert(sizeof(WideBVHNode<8>) == 256, "WideBVHNode<8> must be 256 bytes.");
+
+//----------------------------------------------------------------------------
+// Four triangles stored as structure of arrays for SIMD intersection.
+// Unused lanes have no primitive index and are never hit.
+//----------------------------------------------------------------------------
+struct TrianglePack final {
+    static const int width = 4;
+
+    float vertices[3][3][width]; // [vertex][axis][lane]
+    unsigned int primitive_indices[width];
+};
+
+//----------------------------------------------------------------------------
+// Bounding volume hierarchy with a branching factor of 4 or 8, created by
+// collapsing a binary BVH. The children of a node are tested against a ray
+// using SSE or AVX and the triangles in the leaves are intersected four at a
+// time using the watertight ray/triangle intersection of Woop et al, 2013.
+// The triangles are copied into the leaves, so the mesh can be modified or
+// destroyed after the hierarchy has been created.
+// Single rays are traversed front to back.
+// Packets of coherent rays traverse the hierarchy together, sharing the node
+// visits between the rays that hit a node.
+// Future work:
+// * Build directly from the binned SAH builder instead of collapsing.
+// * Compressed node bounds.
+// * SIMD packet traversal across rays instead of children.
+//----------------------------------------------------------------------------
+template <int Width>
+class WideBVH final {
+public:
+    static_assert(Width == 4 || Width == 8, "WideBVH only supports a width of 4 or 8.");
+
+    typedef WideBVHNode<Width> Node;
+
+    static const int max_packet_size = 64;
+
+    struct Statistics {
+        unsigned int node_count;
+        unsigned int leaf_count;
+        unsigned int pack_count;
+        unsigned int max_depth;
+        float average_child_count;
+    };
+
+    WideBVH() = default;
+
+    // Builds a binary BVH over the mesh and collapses it.
+    WideBVH(Assets::Meshes::UID mesh_ID, BVH::BuildSettings settings = BVH::BuildSettings::default_settings());
+
+    // Collapses a binary BVH built over the mesh.
+    WideBVH(const BVH& bvh, Assets::Meshes::UID mesh_ID);
+
+    // Takes over the nodes and triangle packs of a previously built hierarchy, e.g. one loaded from disk.
+    WideBVH(std::vector<Node> nodes, std::vector<TrianglePack> packs, Statistics statistics)
+        : m_nodes(std::move(nodes)), m_packs(std::move(packs)), m_statistics(statistics) { }
+
+    inline bool is_empty() const { return m_nodes.empty(); }
+    inline const std::vector<Node>& get_nodes() const { return m_nodes; }
+    inline const std::vector<TrianglePack>& get_triangle_packs() const { return m_packs; }
+    inline const Statistics& get_statistics() const { return m_statistics; }
+
+    // Single ray queries. Intersections are reported in the interval [0, t_max].
+    RayHit closest_hit(Math::Ray ray, float t_max = std::numeric_limits<float>::infinity()) const;
+    bool any_hit(Math::Ray ray, float t_max = std::numeric_limits<float>::infinity()) const;
+
+    // Coherent ray packet queries. The max distance of ray i is given by t_maxs[i].
+    // Rays are processed in packets of max_packet_size and should be spatially coherent,
+    // e.g. primary rays from a tile of pixels, for the shared traversal to pay off.
+    void closest_hit(const Math::Ray* rays, const float* t_maxs, int ray_count, RayHit* hits) const;
+    void any_hit(const Math::Ray* rays, const float* t_maxs, int ray_count, bool* hits) const;
+
+private:
+    void collapse(const BVH& bvh, const Math::Vector3f* positions, const Math::Vector3ui* primitives);
+
+    template <bool occlusion_only>
+    void trace_packet(const Math::Ray* rays, const float* t_maxs, int ray_count, RayHit* hits) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<TrianglePack> m_packs;
+    Statistics m_statistics;
+};
+
+typedef WideBVH<4> BVH4;
+typedef WideBVH<8> BVH8;
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_WIDE_BVH_H_
@@ -16,6 +16,11 @@ namespace Cogwheel {
 namespace Math {
 namespace Distributions {
 
+struct DirectionalSample {
+    Vector3f direction;
+    float PDF;
+};
+
 //=================================================================================================
 // GGX distribution.
 //=================================================================================================
@@ -56,6 +61,29 @@ inline Sample sample(float alpha, Vector2f random_sample) {
 } // NS GGX
 
 
+//=================================================================================================
+// Cosine distribution.
+//=================================================================================================
+namespace Cosine {
+
+inline float PDF(float abs_cos_theta) { return abs_cos_theta / PI<float>(); }
+
+// Samples the hemisphere around the z-axis proportional to cos(theta).
+inline DirectionalSample sample(Vector2f random_sample) {
+    float phi = 2.0f * PI<float>() * random_sample.x;
+    float r2 = random_sample.y;
+    float r = sqrt(1.0f - r2);
+    float z = sqrt(r2);
+
+    DirectionalSample res;
+    res.direction = Vector3f(cos(phi) * r, sin(phi) * r, z);
+    res.PDF = z / PI<float>();
+    return res;
+}
+
+} // NS Cosine
+
+
 //=================================================================================================
 // Uniform sphere distribution.
 //=================================================================================================
@@ -0,0 +1,68 @@
+// Cogwheel view frustum.
+// ------------------------------------------------------------------------------------------------
+// Copyright (C) 2017, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License.
+// See LICENSE.txt for more detail.
+// ------------------------------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_MATH_FRUSTUM_H_
+#define _COGWHEEL_MATH_FRUSTUM_H_
+
+#include <Cogwheel/Math/AABB.h>
+#include <Cogwheel/Math/Matrix.h>
+#include <Cogwheel/Math/Plane.h>
+
+namespace Cogwheel {
+namespace Math {
+
+// ------------------------------------------------------------------------------------------------
+// View frustum represented by six planes with normals pointing into the frustum.
+// The planes are ordered left, right, bottom, top, near and far.
+// ------------------------------------------------------------------------------------------------
+struct Frustum final {
+public:
+    static const int plane_count = 6;
+
+    Plane planes[plane_count];
+
+    // Extracts the planes from a view projection matrix that maps the frustum to the [-1, 1] clip cube.
+    // See Gribb and Hartmann, Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix, 2001.
+    static inline Frustum from_view_projection_matrix(Matrix4x4f view_projection_matrix) {
+        Vector4f w_row = view_projection_matrix.get_row(3);
+        Frustum frustum;
+        for (int a = 0; a < 3; ++a) {
+            Vector4f row = view_projection_matrix.get_row(a);
+            frustum.planes[2 * a] = normalized_plane(w_row + row);
+            frustum.planes[2 * a + 1] = normalized_plane(w_row - row);
+        }
+        return frustum;
+    }
+
+    // Conservative test of whether the bounds intersect the frustum.
+    // Bounds outside the frustum, but not fully outside any of the planes, are reported as intersecting.
+    inline bool intersects(AABB bounds) const {
+        for (int p = 0; p < plane_count; ++p) {
+            Plane plane = planes[p];
+            // The corner furthest along the plane's normal.
+            Vector3f corner = Vector3f(plane.a < 0.0f ? bounds.minimum.x : bounds.maximum.x,
+                                       plane.b < 0.0f ? bounds.minimum.y : bounds.maximum.y,
+                                       plane.c < 0.0f ? bounds.minimum.z : bounds.maximum.z);
+            if (dot(plane.get_normal(), corner) + plane.d < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    static inline Plane normalized_plane(Vector4f coefficients) {
+        float inverse_length = 1.0f / magnitude(Vector3f(coefficients.x, coefficients.y, coefficients.z));
+        coefficients *= inverse_length;
+        return Plane(coefficients.x, coefficients.y, coefficients.z, coefficients.w);
+    }
+};
+
+} // NS Math
+} // NS Cogwheel
+
+#endif // _COGWHEEL_MATH_FRUSTUM_H_
@@ -0,0 +1,157 @@
+// Cogwheel SIMD float vectors.
+// ------------------------------------------------------------------------------------------------
+// Copyright (C) 2017, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License.
+// See LICENSE.txt for more detail.
+// ------------------------------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_MATH_SIMD_H_
+#define _COGWHEEL_MATH_SIMD_H_
+
+#include <immintrin.h>
+
+namespace Cogwheel {
+namespace Math {
+namespace SIMD {
+
+//----------------------------------------------------------------------------
+// Thin wrappers around SSE and AVX registers holding 4 or 8 floats.
+// Comparisons return masks of the same type with all bits set in the lanes
+// where the comparison holds. The 8 wide float is emulated using two SSE
+// registers when AVX isn't enabled. Loads and stores need not be aligned.
+//----------------------------------------------------------------------------
+struct Float4 final {
+    static const int width = 4;
+
+    __m128 v;
+
+    Float4() = default;
+    Float4(__m128 v) : v(v) { }
+    explicit Float4(float s) : v(_mm_set1_ps(s)) { }
+
+    static inline Float4 load(const float* const values) { return _mm_loadu_ps(values); }
+    inline void store(float* const values) const { _mm_storeu_ps(values, v); }
+
+    inline Float4 operator+(Float4 rhs) const { return _mm_add_ps(v, rhs.v); }
+    inline Float4 operator-(Float4 rhs) const { return _mm_sub_ps(v, rhs.v); }
+    inline Float4 operator*(Float4 rhs) const { return _mm_mul_ps(v, rhs.v); }
+    inline Float4 operator/(Float4 rhs) const { return _mm_div_ps(v, rhs.v); }
+
+    inline Float4 operator<(Float4 rhs) const { return _mm_cmplt_ps(v, rhs.v); }
+    inline Float4 operator<=(Float4 rhs) const { return _mm_cmple_ps(v, rhs.v); }
+    inline Float4 operator>(Float4 rhs) const { return _mm_cmpgt_ps(v, rhs.v); }
+    inline Float4 operator==(Float4 rhs) const { return _mm_cmpeq_ps(v, rhs.v); }
+
+    inline Float4 operator&(Float4 rhs) const { return _mm_and_ps(v, rhs.v); }
+    inline Float4 operator|(Float4 rhs) const { return _mm_or_ps(v, rhs.v); }
+    inline Float4 operator^(Float4 rhs) const { return _mm_xor_ps(v, rhs.v); }
+
+    // Returns the sign bits of the lanes as the lowest bits of an int.
+    inline int mask() const { return _mm_movemask_ps(v); }
+};
+
+inline Float4 min(Float4 lhs, Float4 rhs) { return _mm_min_ps(lhs.v, rhs.v); }
+inline Float4 max(Float4 lhs, Float4 rhs) { return _mm_max_ps(lhs.v, rhs.v); }
+
+// Computes a * b - c.
+inline Float4 multiply_subtract(Float4 a, Float4 b, Float4 c) {
+#ifdef __AVX2__
+    return _mm_fmsub_ps(a.v, b.v, c.v);
+#else
+    return a * b - c;
+#endif
+}
+
+#ifdef __AVX__
+
+struct Float8 final {
+    static const int width = 8;
+
+    __m256 v;
+
+    Float8() = default;
+    Float8(__m256 v) : v(v) { }
+    explicit Float8(float s) : v(_mm256_set1_ps(s)) { }
+
+    static inline Float8 load(const float* const values) { return _mm256_loadu_ps(values); }
+    inline void store(float* const values) const { _mm256_storeu_ps(values, v); }
+
+    inline Float8 operator+(Float8 rhs) const { return _mm256_add_ps(v, rhs.v); }
+    inline Float8 operator-(Float8 rhs) const { return _mm256_sub_ps(v, rhs.v); }
+    inline Float8 operator*(Float8 rhs) const { return _mm256_mul_ps(v, rhs.v); }
+    inline Float8 operator/(Float8 rhs) const { return _mm256_div_ps(v, rhs.v); }
+
+    inline Float8 operator<(Float8 rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_LT_OQ); }
+    inline Float8 operator<=(Float8 rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_LE_OQ); }
+    inline Float8 operator>(Float8 rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_GT_OQ); }
+    inline Float8 operator==(Float8 rhs) const { return _mm256_cmp_ps(v, rhs.v, _CMP_EQ_OQ); }
+
+    inline Float8 operator&(Float8 rhs) const { return _mm256_and_ps(v, rhs.v); }
+    inline Float8 operator|(Float8 rhs) const { return _mm256_or_ps(v, rhs.v); }
+    inline Float8 operator^(Float8 rhs) const { return _mm256_xor_ps(v, rhs.v); }
+
+    inline int mask() const { return _mm256_movemask_ps(v); }
+};
+
+inline Float8 min(Float8 lhs, Float8 rhs) { return _mm256_min_ps(lhs.v, rhs.v); }
+inline Float8 max(Float8 lhs, Float8 rhs) { return _mm256_max_ps(lhs.v, rhs.v); }
+
+inline Float8 multiply_subtract(Float8 a, Float8 b, Float8 c) {
+#ifdef __AVX2__
+    return _mm256_fmsub_ps(a.v, b.v, c.v);
+#else
+    return a * b - c;
+#endif
+}
+
+#else
+
+struct Float8 final {
+    static const int width = 8;
+
+    Float4 lower, upper;
+
+    Float8() = default;
+    Float8(Float4 lower, Float4 upper) : lower(lower), upper(upper) { }
+    explicit Float8(float s) : lower(s), upper(s) { }
+
+    static inline Float8 load(const float* const values) { return Float8(Float4::load(values), Float4::load(values + 4)); }
+    inline void store(float* const values) const { lower.store(values); upper.store(values + 4); }
+
+    inline Float8 operator+(Float8 rhs) const { return Float8(lower + rhs.lower, upper + rhs.upper); }
+    inline Float8 operator-(Float8 rhs) const { return Float8(lower - rhs.lower, upper - rhs.upper); }
+    inline Float8 operator*(Float8 rhs) const { return Float8(lower * rhs.lower, upper * rhs.upper); }
+    inline Float8 operator/(Float8 rhs) const { return Float8(lower / rhs.lower, upper / rhs.upper); }
+
+    inline Float8 operator<(Float8 rhs) const { return Float8(lower < rhs.lower, upper < rhs.upper); }
+    inline Float8 operator<=(Float8 rhs) const { return Float8(lower <= rhs.lower, upper <= rhs.upper); }
+    inline Float8 operator>(Float8 rhs) const { return Float8(lower > rhs.lower, upper > rhs.upper); }
+    inline Float8 operator==(Float8 rhs) const { return Float8(lower == rhs.lower, upper == rhs.upper); }
+
+    inline Float8 operator&(Float8 rhs) const { return Float8(lower & rhs.lower, upper & rhs.upper); }
+    inline Float8 operator|(Float8 rhs) const { return Float8(lower | rhs.lower, upper | rhs.upper); }
+    inline Float8 operator^(Float8 rhs) const { return Float8(lower ^ rhs.lower, upper ^ rhs.upper); }
+
+    inline int mask() const { return lower.mask() | (upper.mask() << 4); }
+};
+
+inline Float8 min(Float8 lhs, Float8 rhs) { return Float8(min(lhs.lower, rhs.lower), min(lhs.upper, rhs.upper)); }
+inline Float8 max(Float8 lhs, Float8 rhs) { return Float8(max(lhs.lower, rhs.lower), max(lhs.upper, rhs.upper)); }
+
+inline Float8 multiply_subtract(Float8 a, Float8 b, Float8 c) {
+    return Float8(multiply_subtract(a.lower, b.lower, c.lower), multiply_subtract(a.upper, b.upper, c.upper));
+}
+
+#endif // __AVX__
+
+// Maps a width to the float vector of that width.
+template <int W> struct FloatN;
+template <> struct FloatN<4> { typedef Float4 Type; };
+template <> struct FloatN<8> { typedef Float8 Type; };
+
+} // NS SIMD
+} // NS Math
+} // NS Cogwheel
+
+#endif // _COGWHEEL_MATH_SIMD_H_
@@ -0,0 +1,59 @@
+// Cogwheel tangent, bitangent and normal basis.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_MATH_TBN_H_
+#define _COGWHEEL_MATH_TBN_H_
+
+#include <Cogwheel/Math/Vector.h>
+
+#include <math.h>
+
+namespace Cogwheel {
+namespace Math {
+
+//==============================================================================
+// Tangent, bitangent and normal container.
+// tbn * v transforms v from world space to the local shading space and
+// v * tbn transforms it back.
+//==============================================================================
+class TBN {
+private:
+    Vector3f m_tangent;
+    Vector3f m_bitangent;
+    Vector3f m_normal;
+
+public:
+
+    // Building an Orthonormal Basis, Revisited, Duff et al.
+    // http://jcgt.org/published/0006/01/01/paper.pdf
+    explicit TBN(Vector3f normal)
+        : m_normal(normal) {
+        float sign = copysignf(1.0f, normal.z);
+        const float a = -1.0f / (sign + normal.z);
+        const float b = normal.x * normal.y * a;
+        m_tangent = Vector3f(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+        m_bitangent = Vector3f(b, sign + normal.y * normal.y * a, -normal.y);
+    }
+
+    inline Vector3f get_tangent() const { return m_tangent; }
+    inline Vector3f get_bitangent() const { return m_bitangent; }
+    inline Vector3f get_normal() const { return m_normal; }
+
+    inline Vector3f operator*(Vector3f rhs) const {
+        return Vector3f(dot(m_tangent, rhs), dot(m_bitangent, rhs), dot(m_normal, rhs));
+    }
+};
+
+inline Vector3f operator*(Vector3f lhs, const TBN& rhs) {
+    return rhs.get_tangent() * lhs.x + rhs.get_bitangent() * lhs.y + rhs.get_normal() * lhs.z;
+}
+
+} // NS Math
+} // NS Cogwheel
+
+#endif // _COGWHEEL_MATH_TBN_H_
@@ -0,0 +1,252 @@
+// Cogwheel ambient occlusion and bent normal baking.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Scene/OcclusionBaking.h>
+#include <Cogwheel/Math/Distributions.h>
+#include <Cogwheel/Math/RNG.h>
+#include <Cogwheel/Math/TBN.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Scene {
+namespace OcclusionBaking {
+
+static const unsigned int no_primitive = 0xFFFFFFFF;
+static const int tile_size = 8;
+
+// The primitive and barycentric coordinates of the surface point that a texel's center maps to.
+struct TexelSample {
+    unsigned int primitive_index;
+    Vector2f barycentric; // Barycentric coordinates of the second and third vertex.
+};
+
+// Returns the vertex indices of a triangle. Triangle soups have no index buffer and store their triangles as consecutive vertices.
+static inline Vector3ui get_primitive(const Vector3ui* primitives, unsigned int primitive_index) {
+    if (primitives == nullptr)
+        return Vector3ui(3 * primitive_index, 3 * primitive_index + 1, 3 * primitive_index + 2);
+    return primitives[primitive_index];
+}
+
+static inline float edge_function(Vector2f a, Vector2f b, Vector2f p) {
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+// Rasterizes the primitives in texture space and stores the surface point under each texel center.
+// Texels covered by several primitives, e.g. by overlapping charts, are assigned to the first primitive.
+static void rasterize_texels(Meshes::UID mesh_ID, Vector2ui size, std::vector<TexelSample>& texel_samples) {
+    bool is_triangle_soup = Meshes::get_primitive_count(mesh_ID) == 0;
+    Vector3ui* primitives = is_triangle_soup ? nullptr : Meshes::get_primitives(mesh_ID);
+    Vector2f* texcoords = Meshes::get_texcoords(mesh_ID);
+    unsigned int primitive_count = is_triangle_soup ? Meshes::get_vertex_count(mesh_ID) / 3 : Meshes::get_primitive_count(mesh_ID);
+
+    TexelSample empty_sample = { no_primitive, Vector2f::zero() };
+    texel_samples.assign(size.x * size.y, empty_sample);
+
+    for (unsigned int p = 0; p < primitive_count; ++p) {
+        Vector3ui primitive = get_primitive(primitives, p);
+        // Texel space coordinates of the vertices.
+        Vector2f uv0 = Vector2f(texcoords[primitive.x].x * size.x, texcoords[primitive.x].y * size.y);
+        Vector2f uv1 = Vector2f(texcoords[primitive.y].x * size.x, texcoords[primitive.y].y * size.y);
+        Vector2f uv2 = Vector2f(texcoords[primitive.z].x * size.x, texcoords[primitive.z].y * size.y);
+
+        float area = edge_function(uv0, uv1, uv2);
+        if (area == 0.0f || !std::isfinite(area))
+            continue;
+        float inverse_area = 1.0f / area;
+
+        // Texel bounds of the primitive, clamped to the image.
+        int min_x = std::max(0, int(floor(std::min(uv0.x, std::min(uv1.x, uv2.x)) - 0.5f)));
+        int min_y = std::max(0, int(floor(std::min(uv0.y, std::min(uv1.y, uv2.y)) - 0.5f)));
+        int max_x = std::min(int(size.x) - 1, int(ceil(std::max(uv0.x, std::max(uv1.x, uv2.x)) - 0.5f)));
+        int max_y = std::min(int(size.y) - 1, int(ceil(std::max(uv0.y, std::max(uv1.y, uv2.y)) - 0.5f)));
+
+        for (int y = min_y; y <= max_y; ++y)
+            for (int x = min_x; x <= max_x; ++x) {
+                Vector2f texel_center = Vector2f(x + 0.5f, y + 0.5f);
+                float w0 = edge_function(uv1, uv2, texel_center) * inverse_area;
+                float w1 = edge_function(uv2, uv0, texel_center) * inverse_area;
+                float w2 = edge_function(uv0, uv1, texel_center) * inverse_area;
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                    continue;
+
+                TexelSample& texel_sample = texel_samples[x + y * size.x];
+                if (texel_sample.primitive_index == no_primitive) {
+                    texel_sample.primitive_index = p;
+                    texel_sample.barycentric = Vector2f(w1, w2);
+                }
+            }
+    }
+}
+
+// Fills the uncovered texels neighbouring covered texels with the average of their covered neighbours.
+// Each iteration grows the covered area by a texel.
+static void dilate(Vector2ui size, unsigned int iterations, std::vector<bool>& covered, std::vector<float>& ambient_occlusion, std::vector<Vector3f>& bent_normals) {
+    int width = size.x, height = size.y;
+    for (unsigned int i = 0; i < iterations; ++i) {
+        // Only texels covered before the iteration are read and only uncovered texels are written,
+        // so the values can be dilated in place. std::vector<bool> packs the flags in words,
+        // so they are only read in parallel and written serially.
+        std::vector<int> dilated_texels;
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (int y = 0; y < height; ++y) {
+            std::vector<int> dilated_row_texels;
+            for (int x = 0; x < width; ++x) {
+                int index = x + y * width;
+                if (covered[index])
+                    continue;
+
+                float ambient_occlusion_sum = 0.0f;
+                Vector3f bent_normal_sum = Vector3f::zero();
+                int neighbour_count = 0;
+                for (int ny = std::max(0, y - 1); ny <= std::min(height - 1, y + 1); ++ny)
+                    for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1); ++nx) {
+                        int neighbour_index = nx + ny * width;
+                        if (covered[neighbour_index]) {
+                            ambient_occlusion_sum += ambient_occlusion[neighbour_index];
+                            bent_normal_sum += bent_normals[neighbour_index];
+                            ++neighbour_count;
+                        }
+                    }
+
+                if (neighbour_count > 0) {
+                    ambient_occlusion[index] = ambient_occlusion_sum / neighbour_count;
+                    float bent_normal_length = magnitude(bent_normal_sum);
+                    bent_normals[index] = bent_normal_length > 0.0f ? bent_normal_sum / bent_normal_length : Vector3f::zero();
+                    dilated_row_texels.push_back(index);
+                }
+            }
+
+            #pragma omp critical
+            dilated_texels.insert(dilated_texels.end(), dilated_row_texels.begin(), dilated_row_texels.end());
+        }
+
+        if (dilated_texels.empty())
+            break;
+        for (int index : dilated_texels)
+            covered[index] = true;
+    }
+}
+
+Result bake(const RayQuery& ray_query, MeshModels::UID model_ID, Settings settings) {
+    Meshes::UID mesh_ID = MeshModels::get_mesh_ID(model_ID);
+    if (Meshes::get_texcoords(mesh_ID) == nullptr) {
+        printf("OcclusionBaking::bake error: The mesh '%s' has no texcoords.\n", Meshes::get_name(mesh_ID).c_str());
+        Result result = { Images::UID::invalid_UID(), Images::UID::invalid_UID() };
+        return result;
+    }
+
+    Vector2ui size = settings.size;
+    int texel_count = size.x * size.y;
+
+    std::vector<TexelSample> texel_samples;
+    rasterize_texels(mesh_ID, size, texel_samples);
+
+    Transform transform = SceneNodes::get_global_transform(MeshModels::get_scene_node_ID(model_ID));
+    Quaternionf inverse_rotation = inverse_unit(transform.rotation);
+    Vector3ui* primitives = Meshes::get_primitive_count(mesh_ID) == 0 ? nullptr : Meshes::get_primitives(mesh_ID);
+    Vector3f* positions = Meshes::get_positions(mesh_ID);
+    Vector3f* normals = Meshes::get_normals(mesh_ID);
+
+    std::vector<bool> covered(texel_count);
+    for (int i = 0; i < texel_count; ++i)
+        covered[i] = texel_samples[i].primitive_index != no_primitive;
+    std::vector<float> ambient_occlusion(texel_count, 1.0f);
+    std::vector<Vector3f> bent_normals(texel_count, Vector3f::zero());
+
+    { // Trace occlusion rays in tiles of texels.
+        int tile_count_x = (size.x + tile_size - 1) / tile_size;
+        int tile_count_y = (size.y + tile_size - 1) / tile_size;
+        int tile_count = tile_count_x * tile_count_y;
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int t = 0; t < tile_count; ++t) {
+            int tile_x = (t % tile_count_x) * tile_size;
+            int tile_y = (t / tile_count_x) * tile_size;
+            for (int y = tile_y; y < std::min(tile_y + tile_size, int(size.y)); ++y)
+                for (int x = tile_x; x < std::min(tile_x + tile_size, int(size.x)); ++x) {
+                    int index = x + y * size.x;
+                    TexelSample texel_sample = texel_samples[index];
+                    if (texel_sample.primitive_index == no_primitive)
+                        continue;
+
+                    Vector3ui primitive = get_primitive(primitives, texel_sample.primitive_index);
+                    float w0 = 1.0f - texel_sample.barycentric.x - texel_sample.barycentric.y;
+                    float w1 = texel_sample.barycentric.x, w2 = texel_sample.barycentric.y;
+
+                    Vector3f p0 = positions[primitive.x], p1 = positions[primitive.y], p2 = positions[primitive.z];
+                    Vector3f local_position = p0 * w0 + p1 * w1 + p2 * w2;
+                    Vector3f local_geometric_normal = normalize(cross(p1 - p0, p2 - p0));
+                    Vector3f local_normal = local_geometric_normal;
+                    if (normals != nullptr) {
+                        Vector3f interpolated_normal = normals[primitive.x] * w0 + normals[primitive.y] * w1 + normals[primitive.z] * w2;
+                        float interpolated_normal_length = magnitude(interpolated_normal);
+                        if (interpolated_normal_length > 0.0f)
+                            local_normal = interpolated_normal / interpolated_normal_length;
+                    }
+                    // Orient the geometric normal to the same side as the shading normal.
+                    if (dot(local_geometric_normal, local_normal) < 0.0f)
+                        local_geometric_normal = -local_geometric_normal;
+
+                    Vector3f position = transform * local_position;
+                    Vector3f normal = normalize(transform.rotation * local_normal);
+                    Vector3f geometric_normal = normalize(transform.rotation * local_geometric_normal);
+                    float position_magnitude = std::max(fabsf(position.x), std::max(fabsf(position.y), fabsf(position.z)));
+                    Vector3f ray_origin = position + geometric_normal * (settings.ray_offset * std::max(1.0f, position_magnitude));
+
+                    // Scramble the sample sequence pr texel to decorrelate neighbouring texels.
+                    Vector2ui scramble = Vector2ui(RNG::jenkins_hash(index), RNG::jenkins_hash(index ^ 0x5bd1e995));
+                    unsigned int unoccluded_count = 0;
+                    Vector3f bent_normal_sum = Vector3f::zero();
+                    for (unsigned int s = 0; s < settings.sample_count; ++s) {
+                        Vector3f direction = Distributions::Cosine::sample(RNG::sample02(s, scramble)).direction * TBN(normal);
+                        // Directions below the surface are occluded by the surface itself.
+                        if (dot(direction, geometric_normal) <= 0.0f)
+                            continue;
+
+                        if (!ray_query.any_hit(Ray(ray_origin, direction), settings.max_distance)) {
+                            ++unoccluded_count;
+                            bent_normal_sum += direction;
+                        }
+                    }
+
+                    ambient_occlusion[index] = settings.sample_count > 0 ? unoccluded_count / float(settings.sample_count) : 1.0f;
+                    Vector3f bent_normal = unoccluded_count > 0 ? normalize(bent_normal_sum) : normal;
+                    bent_normals[index] = inverse_rotation * bent_normal;
+                }
+        }
+    }
+
+    dilate(size, settings.dilation_texel_count, covered, ambient_occlusion, bent_normals);
+
+    std::string name = Meshes::get_name(mesh_ID);
+    Result result;
+    result.ambient_occlusion_ID = Images::create2D(name + " ambient occlusion", PixelFormat::I8, 1.0f, size);
+    result.bent_normals_ID = Images::create2D(name + " bent normals", PixelFormat::RGB24, 1.0f, size);
+
+    unsigned char* ambient_occlusion_pixels = (unsigned char*)Images::get_pixels(result.ambient_occlusion_ID);
+    unsigned char* bent_normal_pixels = (unsigned char*)Images::get_pixels(result.bent_normals_ID);
+    auto to_unorm8 = [](float v) -> unsigned char { return (unsigned char)(clamp(v * 255.0f + 0.5f, 0.0f, 255.0f)); };
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < texel_count; ++i) {
+        ambient_occlusion_pixels[i] = to_unorm8(ambient_occlusion[i]);
+        for (int c = 0; c < 3; ++c)
+            bent_normal_pixels[3 * i + c] = to_unorm8(bent_normals[i][c] * 0.5f + 0.5f);
+    }
+
+    return result;
+}
+
+} // NS OcclusionBaking
+} // NS Scene
+} // NS Cogwheel
@@ -0,0 +1,60 @@
+// Cogwheel ambient occlusion and bent normal baking.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_SCENE_OCCLUSION_BAKING_H_
+#define _COGWHEEL_SCENE_OCCLUSION_BAKING_H_
+
+#include <Cogwheel/Assets/Image.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Scene/RayQuery.h>
+
+#include <limits>
+
+namespace Cogwheel {
+namespace Scene {
+namespace OcclusionBaking {
+
+struct Settings {
+    Math::Vector2ui size; // Dimensions of the baked images.
+    unsigned int sample_count; // Occlusion rays pr texel.
+    float max_distance; // Occluders further away than max_distance are ignored.
+    float ray_offset; // Offset of the ray origins along the geometric normal relative to the magnitude of the position.
+    unsigned int dilation_texel_count; // Number of texels that the baked texels are dilated into the uncovered texels.
+
+    static Settings default_settings() {
+        Settings settings = { Math::Vector2ui(512u, 512u), 256u, std::numeric_limits<float>::infinity(), 0.0001f, 4u };
+        return settings;
+    }
+};
+
+struct Result {
+    Assets::Images::UID ambient_occlusion_ID; // I8 image with the fraction of unoccluded cosine distributed rays.
+    Assets::Images::UID bent_normals_ID; // RGB24 image with the average unoccluded direction in the mesh's space, mapped from [-1, 1] to [0, 1].
+};
+
+//----------------------------------------------------------------------------
+// Bakes ambient occlusion and bent normals for a mesh model into images laid
+// out by the texcoords of its mesh.
+// The primitives are rasterized in texture space and the texels covered by a
+// primitive are traced from the corresponding surface point. Cosine
+// distributed occlusion rays are traced against the ray query's scene, so
+// the model occludes itself if it is part of the scene. The rays are
+// generated from the RNG::sample02 sequence, scrambled pr texel to avoid
+// structured aliasing between neighbouring texels.
+// The texels are traced in parallel in tiles and afterwards the baked values
+// are dilated into the uncovered texels to avoid seams when the images are
+// filtered across chart borders.
+// Returns invalid image IDs if the model's mesh has no texcoords.
+//----------------------------------------------------------------------------
+Result bake(const RayQuery& ray_query, Assets::MeshModels::UID model_ID, Settings settings = Settings::default_settings());
+
+} // NS OcclusionBaking
+} // NS Scene
+} // NS Cogwheel
+
+#endif // _COGWHEEL_SCENE_OCCLUSION_BAKING_H_
@@ -0,0 +1,46 @@
+// Cogwheel scene ray queries.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Scene/RayQuery.h>
+
+using namespace Cogwheel::Geometry;
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Scene {
+
+RayQuery::RayQuery(SceneRoots::UID scene_ID)
+    : m_scene_ID(scene_ID), m_bvh() { }
+
+RayQuery::Hit RayQuery::closest_hit(Ray ray, float t_max) const {
+    SceneRayHit scene_hit = m_bvh.closest_hit(ray, t_max);
+    if (!scene_hit.is_hit())
+        return Hit::miss();
+
+    Hit hit = { scene_hit.model_ID, scene_hit.hit.primitive_index, Vector2f(scene_hit.hit.u, scene_hit.hit.v), scene_hit.hit.t };
+    return hit;
+}
+
+bool RayQuery::any_hit(Ray ray, float t_max) const {
+    return m_bvh.any_hit(ray, t_max);
+}
+
+void RayQuery::closest_hit(const Ray* rays, const float* t_maxs, int count, Hit* hits) const {
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < count; ++i)
+        hits[i] = closest_hit(rays[i], t_maxs[i]);
+}
+
+void RayQuery::any_hit(const Ray* rays, const float* t_maxs, int count, bool* hits) const {
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < count; ++i)
+        hits[i] = any_hit(rays[i], t_maxs[i]);
+}
+
+} // NS Scene
+} // NS Cogwheel
@@ -0,0 +1,78 @@
+// Cogwheel scene ray queries.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_SCENE_RAY_QUERY_H_
+#define _COGWHEEL_SCENE_RAY_QUERY_H_
+
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Geometry/SceneBVH.h>
+#include <Cogwheel/Math/Ray.h>
+#include <Cogwheel/Math/Vector.h>
+#include <Cogwheel/Scene/SceneRoot.h>
+
+#include <limits>
+
+namespace Cogwheel {
+namespace Scene {
+
+//----------------------------------------------------------------------------
+// Ray queries against the mesh models of a scene, for tools such as picking,
+// occlusion tests and distance measurements.
+// The queries are answered by a scene BVH that is built over the existing
+// models on construction and afterwards kept in sync through the
+// change notifications of the meshes, models and scene nodes, so
+// handle_updates() must be called once pr tick before the notifications are
+// reset. Queries between updates reuse the hierarchy without rebuilding it.
+// Distances are measured in units of the ray direction's length, i.e. in
+// world units for normalized directions.
+// Future work
+// * Only consider the models below the scene's root node. Scene nodes
+//   don't report when they are reparented, so until they do all models are
+//   considered part of the scene, as is the case for the renderers.
+//----------------------------------------------------------------------------
+class RayQuery final {
+public:
+    struct Hit final {
+        Assets::MeshModels::UID model_ID;
+        unsigned int primitive_index; // Index of the triangle in the model's mesh.
+        Math::Vector2f barycentric; // Barycentric coordinates of the second and third vertex.
+        float distance;
+
+        inline bool is_hit() const { return model_ID != Assets::MeshModels::UID::invalid_UID(); }
+
+        static inline Hit miss() {
+            Hit hit = { Assets::MeshModels::UID::invalid_UID(), Geometry::RayHit::no_primitive, Math::Vector2f::zero(), std::numeric_limits<float>::infinity() };
+            return hit;
+        }
+    };
+
+    RayQuery(SceneRoots::UID scene_ID);
+
+    inline SceneRoots::UID get_scene_ID() const { return m_scene_ID; }
+    inline const Geometry::SceneBVH& get_BVH() const { return m_bvh; }
+
+    // Updates the hierarchy from the change notifications of the meshes, models and scene nodes.
+    void handle_updates() { m_bvh.handle_updates(); }
+
+    // Single ray queries. Intersections are reported in the interval [0, t_max].
+    Hit closest_hit(Math::Ray ray, float t_max = std::numeric_limits<float>::infinity()) const;
+    bool any_hit(Math::Ray ray, float t_max = std::numeric_limits<float>::infinity()) const;
+
+    // Batched queries of count rays, which are distributed across the available threads.
+    void closest_hit(const Math::Ray* rays, const float* t_maxs, int count, Hit* hits) const;
+    void any_hit(const Math::Ray* rays, const float* t_maxs, int count, bool* hits) const;
+
+private:
+    SceneRoots::UID m_scene_ID;
+    Geometry::SceneBVH m_bvh;
+};
+
+} // NS Scene
+} // NS Cogwheel
+
+#endif // _COGWHEEL_SCENE_RAY_QUERY_H_
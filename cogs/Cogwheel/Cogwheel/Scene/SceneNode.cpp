@@ -8,6 +8,7 @@
 
 #include <Cogwheel/Scene/SceneNode.h>
 
+#include <algorithm>
 #include <assert.h>
 
 using namespace Cogwheel::Math;
@@ -24,6 +25,17 @@ SceneNodes::UID* SceneNodes::m_first_child_IDs = nullptr;
 
 Transform* SceneNodes::m_global_transforms = nullptr;
 
+std::vector<SceneNodes::UID> SceneNodes::m_deferred_transform_IDs = std::vector<SceneNodes::UID>(0);
+std::vector<Transform> SceneNodes::m_deferred_local_transforms = std::vector<Transform>(0);
+
+bool SceneNodes::m_depths_are_dirty = true;
+std::vector<unsigned int> SceneNodes::m_depths = std::vector<unsigned int>(0);
+
+std::vector<unsigned int> SceneNodes::m_propagation_states = std::vector<unsigned int>(0);
+std::vector<Transform> SceneNodes::m_previous_global_transforms = std::vector<Transform>(0);
+std::vector<SceneNodes::UID> SceneNodes::m_edited_IDs = std::vector<SceneNodes::UID>(0);
+std::vector<SceneNodes::UID> SceneNodes::m_propagated_IDs = std::vector<SceneNodes::UID>(0);
+
 Core::ChangeSet<SceneNodes::Changes, SceneNodes::UID> SceneNodes::m_changes;
 
 void SceneNodes::allocate(unsigned int capacity) {
@@ -47,6 +59,8 @@ void SceneNodes::allocate(unsigned int capacity) {
     m_names[0] = "Dummy Node";
     m_parent_IDs[0] = m_first_child_IDs[0] = m_sibling_IDs[0] = UID::invalid_UID();
     m_global_transforms[0] = Transform::identity();
+
+    m_depths_are_dirty = true;
 }
 
 void SceneNodes::deallocate() {
@@ -62,6 +76,15 @@ void SceneNodes::deallocate() {
 
     delete[] m_global_transforms; m_global_transforms = nullptr;
 
+    m_deferred_transform_IDs.clear();
+    m_deferred_local_transforms.clear();
+    m_depths.clear();
+
+    m_propagation_states.clear(); m_propagation_states.shrink_to_fit();
+    m_previous_global_transforms.clear(); m_previous_global_transforms.shrink_to_fit();
+    m_edited_IDs.clear(); m_edited_IDs.shrink_to_fit();
+    m_propagated_IDs.clear(); m_propagated_IDs.shrink_to_fit();
+
     m_changes.resize(0);
 }
 
@@ -116,14 +139,17 @@ SceneNodes::UID SceneNodes::create(const std::string& name, Transform transform)
     m_parent_IDs[id] = m_first_child_IDs[id] = m_sibling_IDs[id] = UID::invalid_UID();
     m_global_transforms[id] = transform;
     m_changes.set_change(id, Change::Created);
+    m_depths_are_dirty = true;
 
     return id;
 }
 
 void SceneNodes::destroy(SceneNodes::UID node_ID) {
     // We don't actually destroy anything when destroying a node. The properties will get overwritten later when a node is created in same the spot.
-    if (m_UID_generator.erase(node_ID))
+    if (m_UID_generator.erase(node_ID)) {
         m_changes.set_change(node_ID, Change::Destroyed);
+        m_depths_are_dirty = true;
+    }
 }
 
 void SceneNodes::set_parent(SceneNodes::UID node_ID, const SceneNodes::UID parent_ID) {
@@ -150,6 +176,8 @@ void SceneNodes::set_parent(SceneNodes::UID node_ID, const SceneNodes::UID paren
         m_parent_IDs[node_ID] = parent_ID;
         m_sibling_IDs[node_ID] = m_first_child_IDs[parent_ID];
         m_first_child_IDs[parent_ID] = node_ID;
+
+        m_depths_are_dirty = true;
     }
 }
 
@@ -248,5 +276,144 @@ void SceneNodes::unsafe_set_global_transform(SceneNodes::UID node_ID, Transform
     });
 }
 
+void SceneNodes::set_local_transform_deferred(SceneNodes::UID node_ID, Transform transform) {
+    if (node_ID == UID::invalid_UID()) return;
+
+    m_deferred_transform_IDs.push_back(node_ID);
+    m_deferred_local_transforms.push_back(transform);
+}
+
+void SceneNodes::update_depths() {
+    if (!m_depths_are_dirty)
+        return;
+
+    m_depths.resize(capacity());
+
+    // Depth first traversal from the nodes without a parent.
+    std::vector<UID> pending_IDs;
+    for (UID node_ID : get_iterable())
+        if (m_parent_IDs[node_ID] == UID::invalid_UID()) {
+            m_depths[node_ID] = 0;
+            pending_IDs.push_back(node_ID);
+        }
+
+    while (!pending_IDs.empty()) {
+        UID node_ID = pending_IDs.back();
+        pending_IDs.pop_back();
+        for (UID child_ID = m_first_child_IDs[node_ID]; child_ID != UID::invalid_UID(); child_ID = m_sibling_IDs[child_ID]) {
+            m_depths[child_ID] = m_depths[node_ID] + 1;
+            pending_IDs.push_back(child_ID);
+        }
+    }
+
+    m_depths_are_dirty = false;
+}
+
+unsigned int SceneNodes::get_depth(SceneNodes::UID node_ID) {
+    update_depths();
+    return m_depths[node_ID];
+}
+
+void SceneNodes::set_global_transforms(const SceneNodes::UID* node_IDs, const Transform* transforms, unsigned int count) {
+    assert(m_global_transforms != nullptr);
+    propagate_transforms(node_IDs, transforms, count, false);
+}
+
+void SceneNodes::set_local_transforms(const SceneNodes::UID* node_IDs, const Transform* transforms, unsigned int count) {
+    assert(m_global_transforms != nullptr);
+    propagate_transforms(node_IDs, transforms, count, true);
+}
+
+void SceneNodes::propagate_deferred_transforms() {
+    if (m_deferred_transform_IDs.empty())
+        return;
+
+    propagate_transforms(m_deferred_transform_IDs.data(), m_deferred_local_transforms.data(), (unsigned int)m_deferred_transform_IDs.size(), true);
+
+    m_deferred_transform_IDs.clear();
+    m_deferred_local_transforms.clear();
+}
+
+void SceneNodes::propagate_transforms(const SceneNodes::UID* node_IDs, const Transform* transforms, unsigned int count, bool local_transforms) {
+    if (count == 0)
+        return;
+
+    update_depths();
+
+    // The state of a node is either untouched, moved by one of its ancestors
+    // or the index of its new transform offset by edited_state_offset.
+    const unsigned int untouched = 0u;
+    const unsigned int moved = 1u;
+    const unsigned int edited_state_offset = 2u;
+    std::vector<unsigned int>& states = m_propagation_states;
+    if (states.size() < capacity()) {
+        states.resize(capacity(), untouched);
+        m_previous_global_transforms.resize(capacity());
+    }
+
+    m_edited_IDs.clear();
+    for (unsigned int i = 0; i < count; ++i) {
+        UID node_ID = node_IDs[i];
+        if (!has(node_ID))
+            continue;
+        if (states[node_ID] == untouched)
+            m_edited_IDs.push_back(node_ID);
+        states[node_ID] = edited_state_offset + i; // Later edits of a node override the earlier ones.
+    }
+    if (m_edited_IDs.empty())
+        return;
+    std::sort(m_edited_IDs.begin(), m_edited_IDs.end(), [](UID lhs, UID rhs) { return m_depths[lhs] < m_depths[rhs]; });
+
+    // Sweep the levels from the topmost edited node and down, only visiting the edited nodes and their descendants.
+    // A level consists of the children of the nodes updated in the previous level and the edited nodes at that depth
+    // whose parents weren't updated. The parents of the nodes in a level have all been updated by the previous level,
+    // so the nodes within a level can be updated in parallel.
+    // The previous global transforms of the updated nodes are needed to compute the local transforms of their children.
+    std::vector<UID>& propagated_IDs = m_propagated_IDs;
+    propagated_IDs.clear();
+    unsigned int edited_index = 0;
+    unsigned int previous_level_begin = 0;
+    for (unsigned int depth = m_depths[m_edited_IDs[0]]; ; ++depth) {
+        unsigned int level_begin = (unsigned int)propagated_IDs.size();
+        for (unsigned int i = previous_level_begin; i < level_begin; ++i)
+            for (UID child_ID = m_first_child_IDs[propagated_IDs[i]]; child_ID != UID::invalid_UID(); child_ID = m_sibling_IDs[child_ID])
+                propagated_IDs.push_back(child_ID);
+        for (; edited_index < m_edited_IDs.size() && m_depths[m_edited_IDs[edited_index]] == depth; ++edited_index) {
+            UID node_ID = m_edited_IDs[edited_index];
+            if (states[m_parent_IDs[node_ID]] == untouched)
+                propagated_IDs.push_back(node_ID);
+        }
+        int level_end = int(propagated_IDs.size());
+        if (level_end == int(level_begin) && edited_index == m_edited_IDs.size())
+            break;
+        previous_level_begin = level_begin;
+
+        #pragma omp parallel for schedule(static) if (level_end - int(level_begin) > 1024)
+        for (int i = int(level_begin); i < level_end; ++i) {
+            UID node_ID = propagated_IDs[i];
+            UID parent_ID = m_parent_IDs[node_ID];
+
+            Transform new_global_transform;
+            if (states[node_ID] >= edited_state_offset) {
+                Transform transform = transforms[states[node_ID] - edited_state_offset];
+                new_global_transform = local_transforms ? m_global_transforms[parent_ID] * transform : transform;
+            } else {
+                Transform local_transform = Transform::delta(m_previous_global_transforms[parent_ID], m_global_transforms[node_ID]);
+                new_global_transform = m_global_transforms[parent_ID] * local_transform;
+                states[node_ID] = moved;
+            }
+
+            m_previous_global_transforms[node_ID] = m_global_transforms[node_ID];
+            m_global_transforms[node_ID] = new_global_transform;
+        }
+    }
+
+    // Notify about the moved nodes in depth order and reset their states for the next propagation.
+    for (UID node_ID : propagated_IDs) {
+        m_changes.add_change(node_ID, Change::Transform);
+        states[node_ID] = untouched;
+    }
+}
+
 } // NS Scene
 } // NS Cogwheel
\ No newline at end of file
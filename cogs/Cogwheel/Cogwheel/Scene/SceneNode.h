@@ -15,6 +15,8 @@
 #include <Cogwheel/Core/UniqueIDGenerator.h>
 #include <Cogwheel/Math/Transform.h>
 
+#include <vector>
+
 namespace Cogwheel {
 namespace Scene {
 
@@ -65,6 +67,25 @@ public:
     static void set_global_transform(SceneNodes::UID node_ID, Math::Transform transform);
     static void apply_delta_transform(SceneNodes::UID node_ID, Math::Transform delta_transform);
 
+    // Batched transform edits of count nodes. The edits are applied as if they were applied one at a time ordered by
+    // the depth of the nodes, i.e. descendants of the edited nodes preserve their local transforms unless they are edited
+    // themselves, and if a node is edited more than once, then the last edit is used.
+    // All affected nodes are updated in a single sweep over the levels of the hierarchy below the topmost edited node,
+    // where the nodes in each level are updated in parallel, and receive a single Transform change notification.
+    static void set_global_transforms(const SceneNodes::UID* node_IDs, const Math::Transform* transforms, unsigned int count);
+    static void set_local_transforms(const SceneNodes::UID* node_IDs, const Math::Transform* transforms, unsigned int count);
+
+    // Deferred local transform edits. The edits are stored until propagate_deferred_transforms() resolves them
+    // as a single batch, see set_local_transforms(), and take precedence over immediate edits of the same nodes
+    // made before they are resolved. The engine resolves the edits after the mutating callbacks.
+    static void set_local_transform_deferred(SceneNodes::UID node_ID, Math::Transform transform);
+    static inline bool has_deferred_transforms() { return !m_deferred_transform_IDs.empty(); }
+    static void propagate_deferred_transforms();
+
+    // The depth of the node in the hierarchy, where nodes without a parent have depth zero.
+    // The depths are recomputed lazily when the hierarchy has changed.
+    static unsigned int get_depth(SceneNodes::UID node_ID);
+
     template<typename F>
     static void apply_recursively(SceneNodes::UID node_ID, F& function);
     template<typename F>
@@ -92,6 +113,8 @@ public:
 private:
     static void reserve_node_data(unsigned int new_capacity, unsigned int old_capacity);
     static void SceneNodes::unsafe_set_global_transform(SceneNodes::UID node_ID, Math::Transform transform);
+    static void update_depths();
+    static void propagate_transforms(const SceneNodes::UID* node_IDs, const Math::Transform* transforms, unsigned int count, bool local_transforms);
 
 
     static UIDGenerator m_UID_generator;
@@ -103,6 +126,20 @@ private:
 
     static Math::Transform* m_global_transforms;
 
+    static std::vector<SceneNodes::UID> m_deferred_transform_IDs;
+    static std::vector<Math::Transform> m_deferred_local_transforms;
+
+    // The depth of each node, used to order the edited nodes when propagating transforms.
+    static bool m_depths_are_dirty;
+    static std::vector<unsigned int> m_depths;
+
+    // Scratch buffers for propagating transforms, kept between propagations to avoid reallocating them.
+    // The propagation states are reset to untouched after each propagation.
+    static std::vector<unsigned int> m_propagation_states;
+    static std::vector<Math::Transform> m_previous_global_transforms;
+    static std::vector<SceneNodes::UID> m_edited_IDs;
+    static std::vector<SceneNodes::UID> m_propagated_IDs;
+
     static Core::ChangeSet<Changes, UID> m_changes;
 };
 
@@ -142,6 +179,7 @@ public:
     inline Math::Transform get_global_transform() const { return SceneNodes::get_global_transform(m_ID); }
     inline void set_global_transform(Math::Transform transform) { SceneNodes::set_global_transform(m_ID, transform); }
     inline void apply_delta_transform(Math::Transform transform) { SceneNodes::apply_delta_transform(m_ID, transform); }
+    inline void set_local_transform_deferred(Math::Transform transform) { SceneNodes::set_local_transform_deferred(m_ID, transform); }
 
     inline SceneNodes::Changes get_changes() const { return SceneNodes::get_changes(m_ID); }
 
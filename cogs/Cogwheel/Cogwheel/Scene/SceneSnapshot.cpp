@@ -0,0 +1,265 @@
+// Cogwheel double buffered snapshots of the scene state.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <Cogwheel/Scene/SceneSnapshot.h>
+
+#include <algorithm>
+#include <assert.h>
+
+#include <omp.h>
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Math;
+
+namespace Cogwheel {
+namespace Scene {
+
+// Copying fewer entries than this isn't worth the overhead of spawning threads.
+static const int parallel_copy_threshold = 4096;
+
+//-----------------------------------------------------------------------------
+// Snapshot copying.
+//-----------------------------------------------------------------------------
+
+template <typename T>
+static inline void grow(std::vector<unsigned char>& alive, std::vector<T>& entries, unsigned int capacity) {
+    if (alive.size() < capacity) {
+        alive.resize(capacity, 0u);
+        entries.resize(capacity);
+    }
+}
+
+// Copies the IDs of an iterable, e.g. the live or changed IDs of a manager.
+template <typename UID, typename Iterable>
+static inline void assign_IDs(std::vector<UID>& IDs, Iterable iterable) {
+    IDs.clear();
+    for (UID ID : iterable)
+        IDs.push_back(ID);
+}
+
+static inline Materials::Data get_material_data(Materials::UID material_ID) {
+    Materials::Data data;
+    data.tint = Materials::get_tint(material_ID);
+    data.tint_texture_ID = Materials::get_tint_texture_ID(material_ID);
+    data.roughness = Materials::get_roughness(material_ID);
+    data.specularity = Materials::get_specularity(material_ID);
+    data.metallic = Materials::get_metallic(material_ID);
+    data.coverage = Materials::get_coverage(material_ID);
+    data.coverage_texture_ID = Materials::get_coverage_texture_ID(material_ID);
+    data.transmission = Materials::get_transmission(material_ID);
+    data.flags = Materials::get_flags(material_ID);
+    return data;
+}
+
+static inline SceneSnapshot::Light get_light_data(LightSources::UID light_ID) {
+    SceneSnapshot::Light light;
+    light.node_ID = LightSources::get_node_ID(light_ID);
+    light.type = LightSources::get_type(light_ID);
+    if (light.type == LightSources::Type::Sphere) {
+        light.color = LightSources::get_sphere_light_power(light_ID);
+        light.radius = LightSources::get_sphere_light_radius(light_ID);
+    } else {
+        light.color = LightSources::get_directional_light_radiance(light_ID);
+        light.radius = 0.0f;
+    }
+    return light;
+}
+
+void SceneSnapshot::copy_all() {
+    if (SceneNodes::is_allocated()) {
+        grow(m_node_alive, m_global_transforms, SceneNodes::capacity());
+        std::fill(m_node_alive.begin(), m_node_alive.end(), 0u);
+        for (SceneNodes::UID node_ID : SceneNodes::get_iterable()) {
+            m_node_alive[node_ID] = 1u;
+            m_global_transforms[node_ID] = SceneNodes::get_global_transform(node_ID);
+        }
+    }
+
+    m_model_IDs.clear();
+    if (MeshModels::is_allocated()) {
+        grow(m_model_alive, m_models, MeshModels::capacity());
+        std::fill(m_model_alive.begin(), m_model_alive.end(), 0u);
+        for (MeshModels::UID model_ID : MeshModels::get_iterable()) {
+            m_model_alive[model_ID] = 1u;
+            Model model = { MeshModels::get_scene_node_ID(model_ID), MeshModels::get_mesh_ID(model_ID), MeshModels::get_material_ID(model_ID) };
+            m_models[model_ID] = model;
+            m_model_IDs.push_back(model_ID);
+        }
+    }
+
+    if (Materials::is_allocated()) {
+        grow(m_material_alive, m_materials, Materials::capacity());
+        std::fill(m_material_alive.begin(), m_material_alive.end(), 0u);
+        for (Materials::UID material_ID : Materials::get_iterable()) {
+            m_material_alive[material_ID] = 1u;
+            m_materials[material_ID] = get_material_data(material_ID);
+        }
+    }
+
+    m_light_IDs.clear();
+    if (LightSources::is_allocated()) {
+        grow(m_light_alive, m_lights, LightSources::capacity());
+        std::fill(m_light_alive.begin(), m_light_alive.end(), 0u);
+        for (LightSources::UID light_ID : LightSources::get_iterable()) {
+            m_light_alive[light_ID] = 1u;
+            m_lights[light_ID] = get_light_data(light_ID);
+            m_light_IDs.push_back(light_ID);
+        }
+    }
+}
+
+void SceneSnapshot::copy_nodes(const std::vector<SceneNodes::UID>& node_IDs) {
+    if (node_IDs.empty())
+        return;
+
+    grow(m_node_alive, m_global_transforms, SceneNodes::capacity());
+    int node_count = int(node_IDs.size());
+    #pragma omp parallel for schedule(static) if (node_count > parallel_copy_threshold)
+    for (int i = 0; i < node_count; ++i) {
+        SceneNodes::UID node_ID = node_IDs[i];
+        bool alive = SceneNodes::has(node_ID);
+        m_node_alive[node_ID] = alive;
+        if (alive)
+            m_global_transforms[node_ID] = SceneNodes::get_global_transform(node_ID);
+    }
+}
+
+void SceneSnapshot::copy_models(const std::vector<MeshModels::UID>& model_IDs) {
+    if (model_IDs.empty())
+        return;
+
+    grow(m_model_alive, m_models, MeshModels::capacity());
+    int model_count = int(model_IDs.size());
+    int live_models_changed = 0;
+    #pragma omp parallel for schedule(static) reduction(|:live_models_changed) if (model_count > parallel_copy_threshold)
+    for (int i = 0; i < model_count; ++i) {
+        MeshModels::UID model_ID = model_IDs[i];
+        unsigned char alive = MeshModels::has(model_ID);
+        live_models_changed |= m_model_alive[model_ID] != alive;
+        m_model_alive[model_ID] = alive;
+        if (alive) {
+            Model model = { MeshModels::get_scene_node_ID(model_ID), MeshModels::get_mesh_ID(model_ID), MeshModels::get_material_ID(model_ID) };
+            m_models[model_ID] = model;
+        }
+    }
+
+    // The snapshot is written between ticks, so the live models in the snapshot are the models in the manager.
+    if (live_models_changed)
+        assign_IDs(m_model_IDs, MeshModels::get_iterable());
+}
+
+void SceneSnapshot::copy_materials(const std::vector<Materials::UID>& material_IDs) {
+    if (material_IDs.empty())
+        return;
+
+    grow(m_material_alive, m_materials, Materials::capacity());
+    for (Materials::UID material_ID : material_IDs) {
+        bool alive = Materials::has(material_ID);
+        m_material_alive[material_ID] = alive;
+        if (alive)
+            m_materials[material_ID] = get_material_data(material_ID);
+    }
+}
+
+void SceneSnapshot::copy_lights(const std::vector<LightSources::UID>& light_IDs) {
+    if (light_IDs.empty())
+        return;
+
+    grow(m_light_alive, m_lights, LightSources::capacity());
+    for (LightSources::UID light_ID : light_IDs) {
+        bool alive = LightSources::has(light_ID);
+        m_light_alive[light_ID] = alive;
+        if (alive)
+            m_lights[light_ID] = get_light_data(light_ID);
+    }
+
+    // Lights are only ever created or destroyed, so the live lights have changed.
+    assign_IDs(m_light_IDs, LightSources::get_iterable());
+}
+
+//-----------------------------------------------------------------------------
+// Double buffered snapshots.
+//-----------------------------------------------------------------------------
+
+SceneSnapshotBuffer::SceneSnapshotBuffer()
+    : m_published_index(-1), m_acquired_index(-1), m_frame_count(0u) { }
+
+void SceneSnapshotBuffer::capture() {
+    int write_index = m_published_index == 0 ? 1 : 0;
+
+    { // Wait until the render thread has released the snapshot that should be written.
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_released.wait(lock, [&] { return m_acquired_index != write_index; });
+    }
+
+    // The render thread only ever acquires the published snapshot, so the other one can be written without holding the lock.
+    SceneSnapshot& snapshot = m_snapshots[write_index];
+
+    std::vector<SceneNodes::UID> changed_node_IDs;
+    if (SceneNodes::is_allocated())
+        assign_IDs(changed_node_IDs, SceneNodes::get_changed_nodes());
+    std::vector<MeshModels::UID> changed_model_IDs;
+    if (MeshModels::is_allocated())
+        assign_IDs(changed_model_IDs, MeshModels::get_changed_models());
+    std::vector<Materials::UID> changed_material_IDs;
+    if (Materials::is_allocated())
+        assign_IDs(changed_material_IDs, Materials::get_changed_materials());
+    std::vector<LightSources::UID> changed_light_IDs;
+    if (LightSources::is_allocated())
+        assign_IDs(changed_light_IDs, LightSources::get_changed_lights());
+
+    if (m_frame_count < 2u)
+        // The snapshot has never been written.
+        snapshot.copy_all();
+    else {
+        // The snapshot holds the state from two ticks ago, so apply the changes of the previous and the current tick.
+        // Copying an entry reads its current state, so entries changed in both ticks can safely be copied twice.
+        snapshot.copy_nodes(m_previous_changed_node_IDs);
+        snapshot.copy_nodes(changed_node_IDs);
+        snapshot.copy_models(m_previous_changed_model_IDs);
+        snapshot.copy_models(changed_model_IDs);
+        snapshot.copy_materials(m_previous_changed_material_IDs);
+        snapshot.copy_materials(changed_material_IDs);
+        snapshot.copy_lights(m_previous_changed_light_IDs);
+        snapshot.copy_lights(changed_light_IDs);
+    }
+    snapshot.m_frame_number = m_frame_count;
+
+    std::swap(m_previous_changed_node_IDs, changed_node_IDs);
+    std::swap(m_previous_changed_model_IDs, changed_model_IDs);
+    std::swap(m_previous_changed_material_IDs, changed_material_IDs);
+    std::swap(m_previous_changed_light_IDs, changed_light_IDs);
+
+    { // Publish the snapshot.
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_published_index = write_index;
+        ++m_frame_count;
+    }
+}
+
+const SceneSnapshot* SceneSnapshotBuffer::acquire() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    assert(m_acquired_index == -1);
+    m_acquired_index = m_published_index;
+    return m_acquired_index == -1 ? nullptr : &m_snapshots[m_acquired_index];
+}
+
+void SceneSnapshotBuffer::release(const SceneSnapshot* snapshot) {
+    if (snapshot == nullptr)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        assert(snapshot == &m_snapshots[m_acquired_index]);
+        m_acquired_index = -1;
+    }
+    m_released.notify_one();
+}
+
+} // NS Scene
+} // NS Cogwheel
@@ -0,0 +1,146 @@
+// Cogwheel double buffered snapshots of the scene state.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_SCENE_SCENE_SNAPSHOT_H_
+#define _COGWHEEL_SCENE_SCENE_SNAPSHOT_H_
+
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Scene/LightSource.h>
+#include <Cogwheel/Scene/SceneNode.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace Cogwheel {
+namespace Scene {
+
+//----------------------------------------------------------------------------
+// Immutable copy of the scene node transforms, mesh models, materials and
+// light sources at the end of a tick.
+// The data is stored in dense arrays indexed by UID, like in the managers,
+// and the IDs of the live models and lights are stored in lists that can be
+// iterated.
+//----------------------------------------------------------------------------
+class SceneSnapshot final {
+public:
+    struct Model {
+        SceneNodes::UID scene_node_ID;
+        Assets::Meshes::UID mesh_ID;
+        Assets::Materials::UID material_ID;
+    };
+
+    struct Light {
+        SceneNodes::UID node_ID;
+        Math::RGB color; // The power in case of sphere lights and radiance in case of directional lights.
+        LightSources::Type type;
+        float radius; // Sphere light radius.
+    };
+
+    inline unsigned int get_frame_number() const { return m_frame_number; }
+
+    inline bool has_node(SceneNodes::UID node_ID) const { return node_ID < m_node_alive.size() && m_node_alive[node_ID]; }
+    inline Math::Transform get_global_transform(SceneNodes::UID node_ID) const { return m_global_transforms[node_ID]; }
+
+    inline bool has_model(Assets::MeshModels::UID model_ID) const { return model_ID < m_model_alive.size() && m_model_alive[model_ID]; }
+    inline const Model& get_model(Assets::MeshModels::UID model_ID) const { return m_models[model_ID]; }
+    inline const std::vector<Assets::MeshModels::UID>& get_model_IDs() const { return m_model_IDs; }
+
+    inline bool has_material(Assets::Materials::UID material_ID) const { return material_ID < m_material_alive.size() && m_material_alive[material_ID]; }
+    inline const Assets::Materials::Data& get_material(Assets::Materials::UID material_ID) const { return m_materials[material_ID]; }
+
+    inline bool has_light(LightSources::UID light_ID) const { return light_ID < m_light_alive.size() && m_light_alive[light_ID]; }
+    inline const Light& get_light(LightSources::UID light_ID) const { return m_lights[light_ID]; }
+    inline const std::vector<LightSources::UID>& get_light_IDs() const { return m_light_IDs; }
+
+private:
+    friend class SceneSnapshotBuffer;
+
+    // Copies the entire scene state from the managers.
+    void copy_all();
+
+    // Copies the state of the given nodes, models, materials and lights from the managers.
+    // Entries that have been destroyed in the managers are flagged as dead.
+    void copy_nodes(const std::vector<SceneNodes::UID>& node_IDs);
+    void copy_models(const std::vector<Assets::MeshModels::UID>& model_IDs);
+    void copy_materials(const std::vector<Assets::Materials::UID>& material_IDs);
+    void copy_lights(const std::vector<LightSources::UID>& light_IDs);
+
+    unsigned int m_frame_number;
+
+    // Alive flags are stored as bytes, so entries can be copied in parallel.
+    std::vector<unsigned char> m_node_alive;
+    std::vector<Math::Transform> m_global_transforms;
+
+    std::vector<unsigned char> m_model_alive;
+    std::vector<Model> m_models;
+    std::vector<Assets::MeshModels::UID> m_model_IDs;
+
+    std::vector<unsigned char> m_material_alive;
+    std::vector<Assets::Materials::Data> m_materials;
+
+    std::vector<unsigned char> m_light_alive;
+    std::vector<Light> m_lights;
+    std::vector<LightSources::UID> m_light_IDs;
+};
+
+//----------------------------------------------------------------------------
+// Double buffered scene snapshots, which allows a render thread to consume
+// the scene state of frame N while the mutating callbacks build frame N+1.
+// capture() is called by the engine thread once pr tick after the scene has
+// been updated and before the change notifications are reset, e.g. from a
+// non-mutating callback. It writes the tick's state into the snapshot not
+// published last and then publishes it. Only the entries changed since the
+// snapshot was last written are copied, i.e. the changes of the current and
+// the previous tick, so the cost is proportional to the number of changes.
+// Creating or destroying models or lights also rebuilds the lists of live
+// IDs. If the render thread is still reading the snapshot that should be
+// written, capture() blocks until it is released, so the render thread is
+// at most one frame behind.
+// A single render thread acquires the latest snapshot with acquire() and
+// releases it with release() when done.
+//----------------------------------------------------------------------------
+class SceneSnapshotBuffer final {
+public:
+    SceneSnapshotBuffer();
+
+    // Copies the current scene state into a snapshot and publishes it. Engine thread only.
+    void capture();
+
+    // Returns the latest published snapshot or nullptr if none has been published yet.
+    // The snapshot is immutable until it is released. Render thread only.
+    const SceneSnapshot* acquire();
+    void release(const SceneSnapshot* snapshot);
+
+    // The number of published snapshots. Engine thread only.
+    inline unsigned int get_frame_count() const { return m_frame_count; }
+
+private:
+    SceneSnapshotBuffer(SceneSnapshotBuffer& other) = delete;
+    SceneSnapshotBuffer& operator=(SceneSnapshotBuffer& rhs) = delete;
+
+    SceneSnapshot m_snapshots[2];
+    int m_published_index; // Index of the latest published snapshot. -1 if none has been published.
+    int m_acquired_index; // Index of the snapshot held by the render thread. -1 if none is held.
+    unsigned int m_frame_count;
+
+    // Changes of the previous tick, which have not been applied to the snapshot written next.
+    std::vector<SceneNodes::UID> m_previous_changed_node_IDs;
+    std::vector<Assets::MeshModels::UID> m_previous_changed_model_IDs;
+    std::vector<Assets::Materials::UID> m_previous_changed_material_IDs;
+    std::vector<LightSources::UID> m_previous_changed_light_IDs;
+
+    std::mutex m_mutex;
+    std::condition_variable m_released;
+};
+
+} // NS Scene
+} // NS Cogwheel
+
+#endif // _COGWHEEL_SCENE_SCENE_SNAPSHOT_H_
@@ -19,6 +19,7 @@
 #include <Cogwheel/Assets/MeshModel.h>
 #include <Cogwheel/Core/Engine.h>
 #include <Cogwheel/Core/Window.h>
+#include <Cogwheel/Geometry/SceneBounds.h>
 #include <Cogwheel/Math/OctahedralNormal.h>
 #include <Cogwheel/Scene/Camera.h>
 #include <Cogwheel/Scene/SceneRoot.h>
@@ -55,6 +56,11 @@ private:
     vector<int> m_model_indices = vector<int>(0); // The models index in the sorted models array.
     vector<Dx11Model> m_sorted_models = vector<Dx11Model>(0);
 
+    // Frustum culling.
+    Cogwheel::Geometry::SceneBounds m_scene_bounds;
+    vector<MeshModels::UID> m_visible_model_IDs = vector<MeshModels::UID>(0);
+    vector<bool> m_model_visibility = vector<bool>(0); // Visibility of the models in the current view, indexed by model ID.
+
     EnvironmentManager* m_environments;
     MaterialManager m_materials;
     TextureManager m_textures;
@@ -381,6 +387,8 @@ public:
 
             Dx11Model model = m_sorted_models[i];
             assert(model.model_ID != 0);
+            if (!m_model_visibility[model.model_ID])
+                continue;
             render_model<true>(m_render_context, model);
         }
     }
@@ -468,6 +476,14 @@ public:
             scene_vars.inverse_view_projection_matrix = to_matrix4x4(invert(view_transform)) * inverse_projection_matrix;
             scene_vars.projection_matrix = projection_matrix;
             scene_vars.inverse_projection_matrix = inverse_projection_matrix;
+
+            { // Frustum cull the models against the view frustum including the guard band.
+                m_visible_model_IDs.clear();
+                m_scene_bounds.cull(scene_vars.view_projection_matrix, m_visible_model_IDs);
+                m_model_visibility.assign(MeshModels::capacity(), false);
+                for (MeshModels::UID model_ID : m_visible_model_IDs)
+                    m_model_visibility[model_ID] = true;
+            }
             scene_vars.world_to_view_matrix = to_matrix4x3(view_transform);
             m_render_context->UpdateSubresource(m_scene_buffer, 0, nullptr, &scene_vars, 0, 0);
             m_render_context->VSSetConstantBuffers(13, 1, &m_scene_buffer);
@@ -631,6 +647,8 @@ public:
 
                 Dx11Model model = m_sorted_models[i];
                 assert(model.model_ID != 0);
+                if (!m_model_visibility[model.model_ID])
+                    continue;
                 render_model<false>(m_render_context, model);
             }
 
@@ -654,18 +672,23 @@ public:
                 auto transparent_models = m_transparent.sorted_models_pool; // Alias the pool.
                 transparent_models.resize(transparent_model_count);
 
-                { // Sort transparent models. TODO in a separate thread that is waited on when we get to the transparent render index.
+                { // Sort the visible transparent models. TODO in a separate thread that is waited on when we get to the transparent render index.
                     Vector3f cam_pos = Cameras::get_transform(camera_ID).translation;
+                    int visible_transparent_model_count = 0;
                     for (int i = 0; i < transparent_model_count; ++i) {
-                        // Calculate the distance to point halfway between the models center and side of the bounding box.
                         int model_index = i + m_transparent.first_model_index;
+                        if (!m_model_visibility[m_sorted_models[model_index].model_ID])
+                            continue;
+
+                        // Calculate the distance to point halfway between the models center and side of the bounding box.
                         Dx11Mesh& mesh = m_meshes[m_sorted_models[model_index].mesh_ID];
                         Transform transform = m_transforms.get_transform(m_sorted_models[model_index].transform_ID);
                         Cogwheel::Math::AABB bounds = { Vector3f(mesh.bounds.min.x, mesh.bounds.min.y, mesh.bounds.min.z),
                                                         Vector3f(mesh.bounds.max.x, mesh.bounds.max.y, mesh.bounds.max.z) };
                         float distance_to_cam = alpha_sort_value(cam_pos, transform, bounds);
-                        transparent_models[i] = { distance_to_cam, model_index};
+                        transparent_models[visible_transparent_model_count++] = { distance_to_cam, model_index};
                     }
+                    transparent_models.resize(visible_transparent_model_count);
 
                     std::sort(transparent_models.begin(), transparent_models.end(), 
                         [](Transparent::SortedModel lhs, Transparent::SortedModel rhs) -> bool {
@@ -705,6 +728,7 @@ public:
         m_materials.handle_updates(m_device, *m_render_context);
         m_textures.handle_updates(m_device, *m_render_context);
         m_transforms.handle_updates(m_device, *m_render_context);
+        m_scene_bounds.handle_updates();
 
         { // Camera updates.
             for (Cameras::UID cam_ID : Cameras::get_changed_cameras())
@@ -713,11 +737,29 @@ public:
         }
 
         { // Mesh updates.
+            auto create_vertex_geometry = [](Vector3f p, Vector3f n) -> Dx11VertexGeometry {
+                float3 dx_p = { p.x, p.y, p.z };
+                OctahedralNormal encoded_normal = OctahedralNormal::encode_precise(n);
+                int2 dx_normal = { encoded_normal.encoding.x, encoded_normal.encoding.y };
+                int packed_dx_normal = (dx_normal.x - SHRT_MIN) | (dx_normal.y << 16);
+                Dx11VertexGeometry geometry = { dx_p, packed_dx_normal };
+                return geometry;
+            };
+
             for (Meshes::UID mesh_ID : Meshes::get_changed_meshes()) {
                 if (m_meshes.size() <= mesh_ID)
                     m_meshes.resize(Meshes::capacity());
 
-                if (Meshes::get_changes(mesh_ID).any_set(Meshes::Change::Created, Meshes::Change::Destroyed)) {
+                Meshes::Changes changes = Meshes::get_changes(mesh_ID);
+
+                // Buffer updates are applied to the uploaded buffers in place, unless the mesh has no normals.
+                // In that case hard normals are computed per triangle and the buffers may have been expanded to hold them,
+                // so the dirty ranges don't map to the uploaded buffers and the mesh is recreated.
+                bool recreate = changes.is_set(Meshes::Change::Created);
+                if (!recreate && changes.any_set(Meshes::Change::BuffersUpdated) && !changes.is_set(Meshes::Change::Destroyed))
+                    recreate = Meshes::get_normals(mesh_ID) == nullptr;
+
+                if (recreate || changes.is_set(Meshes::Change::Destroyed)) {
                     if (m_meshes[mesh_ID].vertex_count != 0) {
                         m_meshes[mesh_ID].index_count = m_meshes[mesh_ID].vertex_count = 0;
                         safe_release(&m_meshes[mesh_ID].indices);
@@ -726,7 +768,7 @@ public:
                     }
                 }
 
-                if (Meshes::get_changes(mesh_ID).is_set(Meshes::Change::Created)) {
+                if (recreate) {
                     Cogwheel::Assets::Mesh mesh = mesh_ID;
                     Dx11Mesh dx_mesh = {};
 
@@ -757,15 +799,6 @@ public:
                     }
 
                     { // Upload geometry.
-                        auto create_vertex_geometry = [](Vector3f p, Vector3f n) -> Dx11VertexGeometry {
-                            float3 dx_p = { p.x, p.y, p.z };
-                            OctahedralNormal encoded_normal = OctahedralNormal::encode_precise(n);
-                            int2 dx_normal = { encoded_normal.encoding.x, encoded_normal.encoding.y };
-                            int packed_dx_normal = (dx_normal.x - SHRT_MIN) | (dx_normal.y << 16);
-                            Dx11VertexGeometry geometry = { dx_p, packed_dx_normal };
-                            return geometry;
-                        };
-
                         Vector3f* normals = mesh.get_normals();
 
                         Dx11VertexGeometry* geometry = new Dx11VertexGeometry[dx_mesh.vertex_count];
@@ -820,6 +853,45 @@ public:
                     dx_mesh.buffer_count = has_texcoords ? 2 : 1;
 
                     m_meshes[mesh_ID] = dx_mesh;
+                } else if (changes.any_set(Meshes::Change::BuffersUpdated) && !changes.is_set(Meshes::Change::Destroyed)) {
+                    // Reupload the dirty ranges of the updated buffers.
+                    Cogwheel::Assets::Mesh mesh = mesh_ID;
+                    Dx11Mesh& dx_mesh = m_meshes[mesh_ID];
+
+                    auto update_buffer_range = [&](ID3D11Buffer* buffer, const void* range_data, unsigned int element_size, Meshes::DirtyRange range) {
+                        D3D11_BOX box = { range.begin * element_size, 0, 0, range.end * element_size, 1, 1 };
+                        m_render_context->UpdateSubresource(buffer, 0, &box, range_data, 0, 0);
+                    };
+
+                    Meshes::DirtyRange index_range = mesh.get_dirty_range(Meshes::Change::IndicesUpdated);
+                    if (!index_range.is_empty())
+                        update_buffer_range(dx_mesh.indices, mesh.get_primitives() + index_range.begin, sizeof(Vector3ui), index_range);
+
+                    Meshes::DirtyRange position_range = mesh.get_dirty_range(Meshes::Change::PositionsUpdated);
+                    Meshes::DirtyRange normal_range = mesh.get_dirty_range(Meshes::Change::NormalsUpdated);
+                    Meshes::DirtyRange geometry_range = position_range;
+                    if (geometry_range.is_empty())
+                        geometry_range = normal_range;
+                    else if (!normal_range.is_empty())
+                        geometry_range = { std::min(position_range.begin, normal_range.begin), std::max(position_range.end, normal_range.end) };
+
+                    if (!geometry_range.is_empty()) {
+                        Vector3f* positions = mesh.get_positions() + geometry_range.begin;
+                        Vector3f* normals = mesh.get_normals() + geometry_range.begin;
+                        Dx11VertexGeometry* geometry = new Dx11VertexGeometry[geometry_range.size()];
+                        #pragma omp parallel for
+                        for (int i = 0; i < int(geometry_range.size()); ++i)
+                            geometry[i] = create_vertex_geometry(positions[i], normals[i]);
+                        update_buffer_range(dx_mesh.geometry(), geometry, sizeof(Dx11VertexGeometry), geometry_range);
+                        delete[] geometry;
+                    }
+
+                    Meshes::DirtyRange texcoord_range = mesh.get_dirty_range(Meshes::Change::TexcoordsUpdated);
+                    if (!texcoord_range.is_empty())
+                        update_buffer_range(dx_mesh.texcoords(), mesh.get_texcoords() + texcoord_range.begin, sizeof(Vector2f), texcoord_range);
+
+                    Cogwheel::Math::AABB bounds = mesh.get_bounds();
+                    dx_mesh.bounds = { make_float3(bounds.minimum), make_float3(bounds.maximum) };
                 }
             }
         }
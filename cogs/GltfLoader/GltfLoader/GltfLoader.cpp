@@ -0,0 +1,758 @@
+// Cogwheel glTF 2.0 model loader.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#pragma warning(disable : 4996)
+
+#include <GltfLoader/GltfLoader.h>
+#include <GltfLoader/Json.h>
+#include <GltfLoader/Uri.h>
+
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Assets/Texture.h>
+#include <Cogwheel/Core/MemoryMappedFile.h>
+#include <Cogwheel/Math/Conversions.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+#include <vector>
+
+using namespace Cogwheel;
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Core;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Scene;
+
+namespace GltfLoader {
+
+// ------------------------------------------------------------------------------------------------
+// glTF constants.
+// ------------------------------------------------------------------------------------------------
+
+enum ComponentType {
+    Byte = 5120,
+    UnsignedByte = 5121,
+    Short = 5122,
+    UnsignedShort = 5123,
+    UnsignedInt = 5125,
+    Float = 5126
+};
+
+static const int triangles_mode = 4;
+
+static const int nearest_filter = 9728;
+static const int linear_filter = 9729;
+static const int linear_mipmap_linear_filter = 9987;
+static const int clamp_to_edge_wrap = 33071;
+
+static const unsigned int glb_magic = 0x46546C67; // "glTF"
+static const unsigned int glb_json_chunk = 0x4E4F534A; // "JSON"
+static const unsigned int glb_bin_chunk = 0x004E4942; // "BIN\0"
+
+// ------------------------------------------------------------------------------------------------
+// Utilities.
+// ------------------------------------------------------------------------------------------------
+
+static void split_path(std::string& directory, std::string& filename, const std::string& path) {
+    size_t slash_index = path.find_last_of("/\\");
+    if (slash_index == std::string::npos) {
+        directory = "";
+        filename = path;
+    } else {
+        directory = path.substr(0, slash_index + 1);
+        filename = path.substr(slash_index + 1);
+    }
+}
+
+static inline unsigned int read_uint(const unsigned char* data) {
+    unsigned int value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Buffers and accessors.
+// ------------------------------------------------------------------------------------------------
+
+struct BufferView {
+    const unsigned char* data;
+    size_t size;
+    size_t stride;
+};
+
+struct Accessor {
+    const unsigned char* data;
+    unsigned int count;
+    int component_type;
+    int component_count;
+    bool normalized;
+    size_t stride;
+
+    inline bool is_valid() const { return data != nullptr; }
+};
+
+static inline int component_size(int component_type) {
+    switch (component_type) {
+    case Byte: case UnsignedByte: return 1;
+    case Short: case UnsignedShort: return 2;
+    case UnsignedInt: case Float: return 4;
+    default: return 0;
+    }
+}
+
+static inline int component_count(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0; // Matrices are not used by any of the supported attributes.
+}
+
+static inline float read_component(const unsigned char* data, int component_type, bool normalized) {
+    switch (component_type) {
+    case Byte: {
+        float value = float((signed char)data[0]);
+        return normalized ? fmaxf(value / 127.0f, -1.0f) : value;
+    }
+    case UnsignedByte:
+        return normalized ? data[0] / 255.0f : float(data[0]);
+    case Short: {
+        short value; memcpy(&value, data, sizeof(value));
+        return normalized ? fmaxf(value / 32767.0f, -1.0f) : float(value);
+    }
+    case UnsignedShort: {
+        unsigned short value; memcpy(&value, data, sizeof(value));
+        return normalized ? value / 65535.0f : float(value);
+    }
+    case UnsignedInt:
+        return float(read_uint(data));
+    case Float: {
+        float value; memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    default:
+        return 0.0f;
+    }
+}
+
+// Copies an accessor into an array of tightly packed float elements.
+// The accessor is copied directly if its layout matches and converted otherwise.
+static void copy_floats(const Accessor& accessor, float* destination, int destination_component_count) {
+    size_t element_size = sizeof(float) * destination_component_count;
+    if (accessor.component_type == Float && accessor.component_count == destination_component_count && accessor.stride == element_size) {
+        memcpy(destination, accessor.data, accessor.count * element_size);
+        return;
+    }
+
+    int size = component_size(accessor.component_type);
+    for (unsigned int i = 0; i < accessor.count; ++i) {
+        const unsigned char* element = accessor.data + i * accessor.stride;
+        for (int c = 0; c < destination_component_count; ++c)
+            destination[c] = c < accessor.component_count ? read_component(element + c * size, accessor.component_type, accessor.normalized) : 0.0f;
+        destination += destination_component_count;
+    }
+}
+
+// Copies indices into the mesh's index buffer. Returns the number of indices that referenced a vertex outside the mesh and were reset to 0.
+static unsigned int copy_indices(const Accessor& accessor, unsigned int* destination, unsigned int vertex_count) {
+    if (accessor.component_type == UnsignedInt && accessor.stride == sizeof(unsigned int))
+        memcpy(destination, accessor.data, accessor.count * sizeof(unsigned int));
+    else
+        for (unsigned int i = 0; i < accessor.count; ++i) {
+            const unsigned char* index = accessor.data + i * accessor.stride;
+            switch (accessor.component_type) {
+            case UnsignedByte: destination[i] = index[0]; break;
+            case UnsignedShort: { unsigned short value; memcpy(&value, index, sizeof(value)); destination[i] = value; break; }
+            default: destination[i] = read_uint(index); break;
+            }
+        }
+
+    unsigned int invalid_index_count = 0;
+    for (unsigned int i = 0; i < accessor.count; ++i)
+        if (destination[i] >= vertex_count) {
+            destination[i] = 0;
+            ++invalid_index_count;
+        }
+    return invalid_index_count;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Nodes.
+// ------------------------------------------------------------------------------------------------
+
+// Reads the local transform of a node from either its matrix or its translation, rotation and scale.
+// Cogwheel transforms only support uniform scaling, so non-uniform scales are approximated by their mean.
+static Transform read_local_transform(const Json::Value& node, bool& non_uniform_scale) {
+    Vector3f translation = Vector3f::zero();
+    Quaternionf rotation = Quaternionf::identity();
+    Vector3f scale = Vector3f::one();
+
+    const Json::Value& matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        // Column major matrix.
+        float m[16];
+        for (int i = 0; i < 16; ++i)
+            m[i] = matrix[i].as_float();
+        translation = Vector3f(m[12], m[13], m[14]);
+
+        Vector3f columns[3] = { Vector3f(m[0], m[1], m[2]), Vector3f(m[4], m[5], m[6]), Vector3f(m[8], m[9], m[10]) };
+        scale = Vector3f(magnitude(columns[0]), magnitude(columns[1]), magnitude(columns[2]));
+        if (scale.x > 0.0f && scale.y > 0.0f && scale.z > 0.0f) {
+            Matrix3x3f rotation_matrix;
+            for (int r = 0; r < 3; ++r)
+                for (int c = 0; c < 3; ++c)
+                    rotation_matrix[r][c] = columns[c][r] / scale[c];
+            // Mirroring cannot be represented by a rotation, so the mirrored axis is flipped back.
+            if (determinant(rotation_matrix) < 0.0f) {
+                for (int r = 0; r < 3; ++r)
+                    rotation_matrix[r][0] = -rotation_matrix[r][0];
+                non_uniform_scale = true;
+            }
+            rotation = normalize(to_quaternion(rotation_matrix));
+        }
+    } else {
+        const Json::Value& t = node["translation"];
+        if (t.size() == 3)
+            translation = Vector3f(t[0].as_float(), t[1].as_float(), t[2].as_float());
+        const Json::Value& r = node["rotation"];
+        if (r.size() == 4) // glTF stores quaternions as (x, y, z, w).
+            rotation = normalize(Quaternionf(Vector3f(r[0].as_float(), r[1].as_float(), r[2].as_float()), r[3].as_float()));
+        const Json::Value& s = node["scale"];
+        if (s.size() == 3)
+            scale = Vector3f(s[0].as_float(1.0f), s[1].as_float(1.0f), s[2].as_float(1.0f));
+    }
+
+    float uniform_scale = (scale.x + scale.y + scale.z) / 3.0f;
+    non_uniform_scale |= fabsf(scale.x - uniform_scale) > 0.001f * uniform_scale || fabsf(scale.y - uniform_scale) > 0.001f * uniform_scale;
+
+    return Transform(translation, rotation, uniform_scale);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Textures.
+// ------------------------------------------------------------------------------------------------
+
+static Textures::UID create_texture(Images::UID image_ID, const Json::Value& sampler) {
+    int mag_filter = sampler["magFilter"].as_int(linear_filter);
+    int min_filter = sampler["minFilter"].as_int(linear_mipmap_linear_filter);
+
+    MagnificationFilter magnification_filter = mag_filter == nearest_filter ? MagnificationFilter::None : MagnificationFilter::Linear;
+    MinificationFilter minification_filter = MinificationFilter::Trilinear;
+    if (min_filter == nearest_filter)
+        minification_filter = MinificationFilter::None;
+    else if (min_filter == linear_filter)
+        minification_filter = MinificationFilter::Linear;
+
+    WrapMode wrap_U = sampler["wrapS"].as_int() == clamp_to_edge_wrap ? WrapMode::Clamp : WrapMode::Repeat;
+    WrapMode wrap_V = sampler["wrapT"].as_int() == clamp_to_edge_wrap ? WrapMode::Clamp : WrapMode::Repeat;
+
+    return Textures::create2D(image_ID, magnification_filter, minification_filter, wrap_U, wrap_V);
+}
+
+// Extracts the alpha channel of an RGBA image into an intensity image. Returns an invalid UID if the image is fully opaque.
+static Images::UID extract_coverage(Images::UID image_ID) {
+    Image image = image_ID;
+    unsigned int mipmap_count = image.get_mipmap_count();
+    Vector2ui size = Vector2ui(image.get_width(), image.get_height());
+    Images::UID coverage_image_ID = Images::create2D(image.get_name() + "_coverage", PixelFormat::I8, 1.0f, size, mipmap_count);
+
+    float min_coverage = 1.0f;
+    for (unsigned int m = 0; m < mipmap_count; ++m)
+        for (unsigned int y = 0; y < image.get_height(m); ++y)
+            for (unsigned int x = 0; x < image.get_width(m); ++x) {
+                Vector2ui index = Vector2ui(x, y);
+                float coverage = image.get_pixel(index, m).a;
+                min_coverage = fminf(min_coverage, coverage);
+                Images::set_pixel(coverage_image_ID, RGBA(coverage, coverage, coverage, coverage), index, m);
+            }
+
+    if (min_coverage < 1.0f)
+        return coverage_image_ID;
+
+    Images::destroy(coverage_image_ID);
+    return Images::UID::invalid_UID();
+}
+
+// ------------------------------------------------------------------------------------------------
+// Loader.
+// ------------------------------------------------------------------------------------------------
+
+SceneNodes::UID load(const std::string& path, ImageLoader image_loader, EmbeddedImageLoader embedded_image_loader) {
+    std::string directory, filename;
+    split_path(directory, filename, path);
+
+    MemoryMappedFile file = MemoryMappedFile(path);
+    if (!file.is_open()) {
+        printf("GltfLoader::load error: Could not open '%s'.\n", path.c_str());
+        return SceneNodes::UID::invalid_UID();
+    }
+
+    // Locate the json document and, in case of glb files, the binary chunk.
+    const char* json_text = (const char*)file.get_data();
+    size_t json_length = file.get_size();
+    BufferView glb_buffer = { nullptr, 0, 0 };
+    if (file.get_size() >= 12 && read_uint(file.get_data()) == glb_magic) {
+        const unsigned char* data = file.get_data();
+        unsigned int version = read_uint(data + 4);
+        size_t length = std::min<size_t>(read_uint(data + 8), file.get_size());
+        if (version != 2) {
+            printf("GltfLoader::load error: Unsupported glb version %u in '%s'.\n", version, path.c_str());
+            return SceneNodes::UID::invalid_UID();
+        }
+
+        json_text = nullptr;
+        size_t offset = 12;
+        while (offset + 8 <= length) {
+            size_t chunk_length = read_uint(data + offset);
+            unsigned int chunk_type = read_uint(data + offset + 4);
+            const unsigned char* chunk_data = data + offset + 8;
+            if (chunk_length > length - offset - 8)
+                break;
+
+            if (chunk_type == glb_json_chunk && json_text == nullptr) {
+                json_text = (const char*)chunk_data;
+                json_length = chunk_length;
+            } else if (chunk_type == glb_bin_chunk && glb_buffer.data == nullptr)
+                glb_buffer = { chunk_data, chunk_length, 0 };
+
+            offset += 8 + ((chunk_length + 3) & ~size_t(3)); // Chunks are 4 byte aligned.
+        }
+
+        if (json_text == nullptr) {
+            printf("GltfLoader::load error: No json chunk found in '%s'.\n", path.c_str());
+            return SceneNodes::UID::invalid_UID();
+        }
+    }
+
+    Json::Value gltf;
+    std::string error;
+    if (!Json::parse(json_text, json_length, gltf, error)) {
+        printf("GltfLoader::load error: '%s' in '%s'.\n", error.c_str(), path.c_str());
+        return SceneNodes::UID::invalid_UID();
+    }
+
+    const std::string& version = gltf["asset"]["version"].as_string();
+    if (version.compare(0, 2, "2.") != 0) {
+        printf("GltfLoader::load error: Unsupported glTF version '%s' in '%s'.\n", version.c_str(), path.c_str());
+        return SceneNodes::UID::invalid_UID();
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Buffers. External buffers are memory mapped and data uris are decoded.
+    // --------------------------------------------------------------------------------------------
+    const Json::Value& buffers_json = gltf["buffers"];
+    int buffer_count = int(buffers_json.size());
+    std::vector<BufferView> buffers(buffer_count, { nullptr, 0, 0 });
+    std::vector<MemoryMappedFile> buffer_files(buffer_count);
+    std::vector<std::vector<unsigned char>> decoded_buffers(buffer_count);
+    int data_uri_count = 0;
+    for (int b = 0; b < buffer_count; ++b) {
+        const Json::Value& buffer = buffers_json[b];
+        if (!buffer.has("uri")) {
+            if (b == 0) // Only the first buffer may refer to the binary glb chunk.
+                buffers[b] = glb_buffer;
+        } else if (is_data_uri(buffer["uri"].as_string()))
+            ++data_uri_count;
+        else {
+            std::string buffer_path = directory + decode_uri(buffer["uri"].as_string());
+            buffer_files[b] = MemoryMappedFile(buffer_path);
+            buffers[b] = { buffer_files[b].get_data(), buffer_files[b].get_size(), 0 };
+        }
+    }
+
+    // Decode the data uris. The decoding of a single large buffer is parallelized internally instead.
+    #pragma omp parallel for schedule(dynamic, 1) if (data_uri_count > 1)
+    for (int b = 0; b < buffer_count; ++b) {
+        const std::string& uri = buffers_json[b]["uri"].as_string();
+        if (is_data_uri(uri) && decode_data_uri(uri, decoded_buffers[b]))
+            buffers[b] = { decoded_buffers[b].data(), decoded_buffers[b].size(), 0 };
+    }
+
+    for (int b = 0; b < buffer_count; ++b) {
+        size_t byte_length = size_t(buffers_json[b]["byteLength"].as_number());
+        if (buffers[b].data == nullptr || buffers[b].size < byte_length) {
+            printf("GltfLoader::load error: Could not load buffer %d in '%s'.\n", b, path.c_str());
+            buffers[b] = { nullptr, 0, 0 };
+        } else
+            buffers[b].size = byte_length;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Buffer views and accessors. Invalid views and accessors have no data.
+    // --------------------------------------------------------------------------------------------
+    const Json::Value& buffer_views_json = gltf["bufferViews"];
+    std::vector<BufferView> buffer_views(buffer_views_json.size(), { nullptr, 0, 0 });
+    for (size_t v = 0; v < buffer_views.size(); ++v) {
+        const Json::Value& view = buffer_views_json[v];
+        int buffer_index = view["buffer"].as_int(-1);
+        size_t offset = size_t(view["byteOffset"].as_number());
+        size_t length = size_t(view["byteLength"].as_number());
+        if (buffer_index < 0 || buffer_index >= buffer_count || buffers[buffer_index].data == nullptr || offset > buffers[buffer_index].size || length > buffers[buffer_index].size - offset)
+            continue;
+        buffer_views[v] = { buffers[buffer_index].data + offset, length, size_t(view["byteStride"].as_number()) };
+    }
+
+    const Json::Value& accessors_json = gltf["accessors"];
+    std::vector<Accessor> accessors(accessors_json.size(), { nullptr, 0, 0, 0, false, 0 });
+    for (size_t a = 0; a < accessors.size(); ++a) {
+        const Json::Value& accessor_json = accessors_json[a];
+        int view_index = accessor_json["bufferView"].as_int(-1);
+        if (view_index < 0 || view_index >= int(buffer_views.size()) || buffer_views[view_index].data == nullptr || accessor_json.has("sparse"))
+            continue;
+
+        const BufferView& view = buffer_views[view_index];
+        Accessor accessor;
+        accessor.count = accessor_json["count"].as_int();
+        accessor.component_type = accessor_json["componentType"].as_int();
+        accessor.component_count = component_count(accessor_json["type"].as_string());
+        accessor.normalized = accessor_json["normalized"].as_bool();
+        size_t element_size = component_size(accessor.component_type) * accessor.component_count;
+        accessor.stride = view.stride != 0 ? view.stride : element_size;
+        size_t offset = size_t(accessor_json["byteOffset"].as_number());
+        if (element_size == 0 || accessor.count == 0 || offset > view.size ||
+            accessor.stride * (accessor.count - 1) + element_size > view.size - offset)
+            continue;
+        accessor.data = view.data + offset;
+        accessors[a] = accessor;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Images. External images are loaded serially by the image loader and embedded images are
+    // loaded in parallel.
+    // --------------------------------------------------------------------------------------------
+    const Json::Value& images_json = gltf["images"];
+    int image_count = int(images_json.size());
+    std::vector<Images::UID> image_IDs(image_count, Images::UID::invalid_UID());
+    for (int i = 0; i < image_count; ++i) {
+        const std::string& uri = images_json[i]["uri"].as_string();
+        if (!uri.empty() && !is_data_uri(uri)) {
+            std::string image_path = directory + decode_uri(uri);
+            image_IDs[i] = image_loader != nullptr ? image_loader(image_path) : Images::UID::invalid_UID();
+            if (image_IDs[i] == Images::UID::invalid_UID())
+                printf("GltfLoader::load error: Could not load image at '%s'.\n", image_path.c_str());
+        }
+    }
+
+    if (embedded_image_loader != nullptr) {
+        // Reserve room for the embedded images up front, so the image manager isn't resized while the images are being decoded.
+        Images::reserve(Images::capacity() + image_count);
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < image_count; ++i) {
+            const Json::Value& image = images_json[i];
+            const std::string& uri = image["uri"].as_string();
+            std::string name = image.has("name") ? image["name"].as_string() : filename + "_image_" + std::to_string(i);
+
+            std::vector<unsigned char> decoded_image;
+            const unsigned char* data = nullptr;
+            size_t byte_count = 0;
+            if (is_data_uri(uri)) {
+                if (decode_data_uri(uri, decoded_image)) {
+                    data = decoded_image.data();
+                    byte_count = decoded_image.size();
+                }
+            } else if (uri.empty()) {
+                int view_index = image["bufferView"].as_int(-1);
+                if (view_index >= 0 && view_index < int(buffer_views.size())) {
+                    data = buffer_views[view_index].data;
+                    byte_count = buffer_views[view_index].size;
+                }
+            } else
+                continue; // External image.
+
+            if (data != nullptr)
+                image_IDs[i] = embedded_image_loader(name, data, byte_count);
+            if (image_IDs[i] == Images::UID::invalid_UID())
+                printf("GltfLoader::load error: Could not load embedded image '%s'.\n", name.c_str());
+        }
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Materials. Textures are created when first referenced, as the base color texture needs
+    // to be in RGBA format and its alpha is extracted into a coverage texture.
+    // --------------------------------------------------------------------------------------------
+    const Json::Value& textures_json = gltf["textures"];
+    const Json::Value& samplers_json = gltf["samplers"];
+    std::vector<Textures::UID> tint_texture_IDs(textures_json.size(), Textures::UID::invalid_UID());
+    std::vector<Textures::UID> coverage_texture_IDs(textures_json.size(), Textures::UID::invalid_UID());
+    std::vector<bool> coverage_extracted(textures_json.size(), false);
+
+    auto get_image_ID = [&](int texture_index) -> Images::UID {
+        if (texture_index < 0 || texture_index >= int(textures_json.size()))
+            return Images::UID::invalid_UID();
+        int image_index = textures_json[texture_index]["source"].as_int(-1);
+        return image_index >= 0 && image_index < image_count ? image_IDs[image_index] : Images::UID::invalid_UID();
+    };
+
+    const Json::Value& materials_json = gltf["materials"];
+    std::vector<Materials::UID> material_IDs(materials_json.size());
+    for (size_t m = 0; m < material_IDs.size(); ++m) {
+        const Json::Value& material = materials_json[m];
+        const Json::Value& pbr = material["pbrMetallicRoughness"];
+        const Json::Value& base_color = pbr["baseColorFactor"];
+        const std::string& alpha_mode = material["alphaMode"].as_string();
+        bool is_opaque = alpha_mode.empty() || alpha_mode == "OPAQUE";
+
+        Materials::Data material_data = {};
+        material_data.flags = alpha_mode == "MASK" ? MaterialFlag::Cutout : MaterialFlag::None;
+        material_data.tint = RGB(base_color[0].as_float(1.0f), base_color[1].as_float(1.0f), base_color[2].as_float(1.0f));
+        material_data.tint_texture_ID = Textures::UID::invalid_UID();
+        material_data.roughness = pbr["roughnessFactor"].as_float(1.0f);
+        material_data.metallic = pbr["metallicFactor"].as_float(1.0f);
+        material_data.specularity = 0.04f; // glTF dielectrics have an index of refraction of 1.5.
+        material_data.coverage = is_opaque ? 1.0f : base_color[3].as_float(1.0f);
+        material_data.coverage_texture_ID = Textures::UID::invalid_UID();
+        material_data.transmission = 0.0f;
+
+        const Json::Value& base_color_texture = pbr["baseColorTexture"];
+        int texture_index = base_color_texture["index"].as_int(-1);
+        Images::UID image_ID = get_image_ID(texture_index);
+        if (image_ID != Images::UID::invalid_UID()) {
+            if (base_color_texture["texCoord"].as_int() != 0)
+                printf("GltfLoader::load error: Only TEXCOORD_0 is supported. Material '%s' uses another set.\n", material["name"].as_string().c_str());
+
+            const Json::Value& sampler = samplers_json[textures_json[texture_index]["sampler"].as_int(-1)];
+
+            if (!is_opaque && !coverage_extracted[texture_index]) {
+                coverage_extracted[texture_index] = true;
+                if (channel_count(Images::get_pixel_format(image_ID)) == 4) {
+                    Images::UID coverage_image_ID = extract_coverage(image_ID);
+                    if (coverage_image_ID != Images::UID::invalid_UID())
+                        coverage_texture_IDs[texture_index] = create_texture(coverage_image_ID, sampler);
+                }
+            }
+            if (!is_opaque)
+                material_data.coverage_texture_ID = coverage_texture_IDs[texture_index];
+
+            if (tint_texture_IDs[texture_index] == Textures::UID::invalid_UID()) {
+                if (channel_count(Images::get_pixel_format(image_ID)) != 4) {
+                    Images::UID new_image_ID = ImageUtils::change_format(image_ID, PixelFormat::RGBA32);
+                    Images::destroy(image_ID);
+                    image_ID = new_image_ID;
+                    image_IDs[textures_json[texture_index]["source"].as_int()] = image_ID;
+                }
+                tint_texture_IDs[texture_index] = create_texture(image_ID, sampler);
+            }
+            material_data.tint_texture_ID = tint_texture_IDs[texture_index];
+        }
+
+        std::string name = material.has("name") ? material["name"].as_string() : filename + "_material_" + std::to_string(m);
+        material_IDs[m] = Materials::create(name, material_data);
+    }
+
+    // The glTF default material, used by primitives without a material.
+    Materials::UID default_material_ID = Materials::UID::invalid_UID();
+    auto get_material_ID = [&](int material_index) -> Materials::UID {
+        if (material_index >= 0 && material_index < int(material_IDs.size()))
+            return material_IDs[material_index];
+        if (default_material_ID == Materials::UID::invalid_UID())
+            default_material_ID = Materials::create(filename + "_default_material", Materials::Data::create_metal(RGB::white(), 1.0f, 0.04f));
+        return default_material_ID;
+    };
+
+    // --------------------------------------------------------------------------------------------
+    // Meshes. Primitives are mapped to unique meshes by their accessors. The meshes are created
+    // serially and filled in parallel afterwards.
+    // --------------------------------------------------------------------------------------------
+    struct MeshSource {
+        int indices, position, normal, texcoord, tangent;
+    };
+    struct Primitive {
+        int mesh_index; // Index into the unique meshes or -1 if the primitive could not be loaded.
+        int material_index;
+    };
+
+    const Json::Value& meshes_json = gltf["meshes"];
+    std::vector<std::vector<Primitive>> primitives(meshes_json.size());
+    std::vector<MeshSource> mesh_sources;
+    std::vector<Meshes::UID> mesh_IDs;
+    std::map<std::array<int, 5>, int> mesh_indices;
+    for (size_t m = 0; m < meshes_json.size(); ++m) {
+        const Json::Value& mesh = meshes_json[m];
+        const Json::Value& mesh_primitives = mesh["primitives"];
+        std::string mesh_name = mesh.has("name") ? mesh["name"].as_string() : filename + "_mesh_" + std::to_string(m);
+        primitives[m].resize(mesh_primitives.size());
+        for (size_t p = 0; p < mesh_primitives.size(); ++p) {
+            const Json::Value& primitive = mesh_primitives[p];
+            const Json::Value& attributes = primitive["attributes"];
+            primitives[m][p] = { -1, primitive["material"].as_int(-1) };
+
+            if (primitive["mode"].as_int(triangles_mode) != triangles_mode) {
+                printf("GltfLoader::load error: Only triangle primitives are supported. Skipping primitive %zu in mesh '%s'.\n", p, mesh_name.c_str());
+                continue;
+            }
+
+            MeshSource source = { primitive["indices"].as_int(-1), attributes["POSITION"].as_int(-1), attributes["NORMAL"].as_int(-1),
+                                  attributes["TEXCOORD_0"].as_int(-1), attributes["TANGENT"].as_int(-1) };
+            std::array<int, 5> key = { source.indices, source.position, source.normal, source.texcoord, source.tangent };
+            auto mesh_index_itr = mesh_indices.find(key);
+            if (mesh_index_itr != mesh_indices.end()) {
+                primitives[m][p].mesh_index = mesh_index_itr->second;
+                continue;
+            }
+
+            // Validate the accessors. Attributes with an unsupported layout are ignored.
+            auto get_accessor = [&](int index) -> const Accessor* {
+                return index >= 0 && index < int(accessors.size()) && accessors[index].is_valid() ? &accessors[index] : nullptr;
+            };
+            const Accessor* positions = get_accessor(source.position);
+            if (positions == nullptr || positions->component_count != 3 || positions->component_type != Float) {
+                printf("GltfLoader::load error: Invalid positions. Skipping primitive %zu in mesh '%s'.\n", p, mesh_name.c_str());
+                continue;
+            }
+            unsigned int vertex_count = positions->count;
+
+            const Accessor* indices = get_accessor(source.indices);
+            if (source.indices >= 0 && (indices == nullptr || indices->component_count != 1 || indices->count % 3 != 0 ||
+                (indices->component_type != UnsignedByte && indices->component_type != UnsignedShort && indices->component_type != UnsignedInt))) {
+                printf("GltfLoader::load error: Invalid indices. Skipping primitive %zu in mesh '%s'.\n", p, mesh_name.c_str());
+                continue;
+            }
+            unsigned int index_count = indices != nullptr ? indices->count : vertex_count;
+            if (index_count < 3 || index_count % 3 != 0) {
+                printf("GltfLoader::load error: Invalid triangle count. Skipping primitive %zu in mesh '%s'.\n", p, mesh_name.c_str());
+                continue;
+            }
+
+            const Accessor* normals = get_accessor(source.normal);
+            if (normals != nullptr && (normals->count != vertex_count || normals->component_count != 3 || normals->component_type != Float))
+                normals = nullptr;
+            const Accessor* texcoords = get_accessor(source.texcoord);
+            if (texcoords != nullptr && (texcoords->count != vertex_count || texcoords->component_count != 2))
+                texcoords = nullptr;
+            const Accessor* tangents = get_accessor(source.tangent);
+            if (tangents != nullptr && (tangents->count != vertex_count || tangents->component_count != 4 || tangents->component_type != Float))
+                tangents = nullptr;
+            source.normal = normals != nullptr ? source.normal : -1;
+            source.texcoord = texcoords != nullptr ? source.texcoord : -1;
+            source.tangent = tangents != nullptr ? source.tangent : -1;
+
+            MeshFlags mesh_flags = MeshFlag::Position;
+            if (normals != nullptr)
+                mesh_flags |= MeshFlag::Normal;
+            if (texcoords != nullptr)
+                mesh_flags |= MeshFlag::Texcoord;
+            if (tangents != nullptr)
+                mesh_flags |= MeshFlag::Tangent;
+
+            std::string name = mesh_primitives.size() > 1 ? mesh_name + "_" + std::to_string(p) : mesh_name;
+            primitives[m][p].mesh_index = int(mesh_IDs.size());
+            mesh_indices[key] = int(mesh_IDs.size());
+            mesh_sources.push_back(source);
+            mesh_IDs.push_back(Meshes::create(name, index_count / 3, vertex_count, mesh_flags));
+        }
+    }
+
+    unsigned int invalid_index_count = 0;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:invalid_index_count)
+    for (int m = 0; m < int(mesh_IDs.size()); ++m) {
+        const MeshSource& source = mesh_sources[m];
+        Mesh mesh = mesh_IDs[m];
+        unsigned int vertex_count = mesh.get_vertex_count();
+
+        if (source.indices >= 0)
+            invalid_index_count += copy_indices(accessors[source.indices], mesh.get_indices(), vertex_count);
+        else {
+            unsigned int* indices = mesh.get_indices();
+            for (unsigned int i = 0; i < mesh.get_index_count(); ++i)
+                indices[i] = i;
+        }
+
+        copy_floats(accessors[source.position], &mesh.get_positions()->x, 3);
+        if (source.normal >= 0)
+            copy_floats(accessors[source.normal], &mesh.get_normals()->x, 3);
+        if (source.tangent >= 0)
+            copy_floats(accessors[source.tangent], &mesh.get_tangents()->x, 4);
+        if (source.texcoord >= 0) {
+            // glTF's texcoord origin is the upper left corner, Cogwheel's is the lower left.
+            Vector2f* texcoords = mesh.get_texcoords();
+            copy_floats(accessors[source.texcoord], &texcoords->x, 2);
+            for (unsigned int v = 0; v < vertex_count; ++v)
+                texcoords[v].y = 1.0f - texcoords[v].y;
+        }
+
+        mesh.compute_bounds();
+    }
+    if (invalid_index_count > 0)
+        printf("GltfLoader::load error: %u indices referenced vertices outside their mesh in '%s'.\n", invalid_index_count, path.c_str());
+
+    // --------------------------------------------------------------------------------------------
+    // Scene nodes. The nodes of the default scene are created depth first below a root node.
+    // --------------------------------------------------------------------------------------------
+    const Json::Value& nodes_json = gltf["nodes"];
+    int node_count = int(nodes_json.size());
+
+    std::vector<int> root_nodes;
+    const Json::Value& scenes_json = gltf["scenes"];
+    if (scenes_json.size() > 0) {
+        const Json::Value& scene = scenes_json[gltf["scene"].as_int(0)];
+        for (const Json::Value& node_index : scene["nodes"].get_elements())
+            root_nodes.push_back(node_index.as_int(-1));
+    } else {
+        // Without scenes, all nodes without parents are loaded.
+        std::vector<bool> has_parent(node_count, false);
+        for (const Json::Value& node : nodes_json.get_elements())
+            for (const Json::Value& child_index : node["children"].get_elements())
+                if (child_index.as_int(-1) >= 0 && child_index.as_int(-1) < node_count)
+                    has_parent[child_index.as_int()] = true;
+        for (int n = 0; n < node_count; ++n)
+            if (!has_parent[n])
+                root_nodes.push_back(n);
+    }
+
+    SceneNodes::reserve(SceneNodes::capacity() + node_count + 1);
+    MeshModels::reserve(MeshModels::capacity() + (unsigned int)mesh_IDs.size());
+
+    std::string root_name = filename.substr(0, filename.find_last_of('.'));
+    SceneNodes::UID root_ID = SceneNodes::create(root_name, Transform::identity());
+
+    struct NodeEntry {
+        int node_index;
+        SceneNodes::UID parent_ID;
+        Transform parent_transform;
+    };
+    std::vector<NodeEntry> node_stack;
+    for (auto root_itr = root_nodes.rbegin(); root_itr != root_nodes.rend(); ++root_itr)
+        node_stack.push_back({ *root_itr, root_ID, Transform::identity() });
+
+    std::vector<bool> visited(node_count, false); // Guards against cycles and nodes with multiple parents.
+    bool non_uniform_scale = false;
+    while (!node_stack.empty()) {
+        NodeEntry entry = node_stack.back();
+        node_stack.pop_back();
+        if (entry.node_index < 0 || entry.node_index >= node_count || visited[entry.node_index])
+            continue;
+        visited[entry.node_index] = true;
+
+        const Json::Value& node = nodes_json[entry.node_index];
+        Transform global_transform = entry.parent_transform * read_local_transform(node, non_uniform_scale);
+        std::string name = node.has("name") ? node["name"].as_string() : filename + "_node_" + std::to_string(entry.node_index);
+        SceneNodes::UID node_ID = SceneNodes::create(name, global_transform);
+        SceneNodes::set_parent(node_ID, entry.parent_ID);
+
+        int mesh_index = node["mesh"].as_int(-1);
+        if (mesh_index >= 0 && mesh_index < int(primitives.size()))
+            for (const Primitive& primitive : primitives[mesh_index])
+                if (primitive.mesh_index >= 0)
+                    MeshModels::create(node_ID, mesh_IDs[primitive.mesh_index], get_material_ID(primitive.material_index));
+
+        const std::vector<Json::Value>& children = node["children"].get_elements();
+        for (auto child_itr = children.rbegin(); child_itr != children.rend(); ++child_itr)
+            node_stack.push_back({ child_itr->as_int(-1), node_ID, global_transform });
+    }
+
+    if (non_uniform_scale)
+        printf("GltfLoader::load error: Non-uniform scales are not supported and have been approximated by their mean in '%s'.\n", path.c_str());
+
+    return root_ID;
+}
+
+} // NS GltfLoader
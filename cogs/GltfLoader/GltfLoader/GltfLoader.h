@@ -0,0 +1,47 @@
+// Cogwheel glTF 2.0 model loader.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_GLTF_LOADER_H_
+#define _COGWHEEL_ASSETS_GLTF_LOADER_H_
+
+#include <Cogwheel/Assets/Image.h>
+#include <Cogwheel/Scene/SceneNode.h>
+#include <string>
+
+namespace GltfLoader {
+
+typedef Cogwheel::Assets::Images::UID (*ImageLoader)(const std::string& filename);
+
+// Creates an image from an encoded image in memory, e.g. a png stored in the binary chunk of a glb file.
+// Embedded images are loaded in parallel, so the loader must be thread safe.
+typedef Cogwheel::Assets::Images::UID (*EmbeddedImageLoader)(const std::string& name, const unsigned char* data, size_t byte_count);
+
+// -----------------------------------------------------------------------
+// Loads a glTF 2.0 file, either as json with external or base64 encoded
+// data URI buffers or as a binary glb file.
+// The nodes of the default scene are created as scene nodes below a root
+// node, which is returned. Each triangle primitive is loaded as a mesh
+// and a mesh model attached to the primitive's node. Primitives that use
+// the same vertex and index accessors share a single mesh, so meshes
+// instanced by multiple nodes are only loaded once. Accessors are copied
+// directly into the mesh buffers when their layout matches and are
+// converted otherwise.
+// Buffers are decoded and meshes are filled in parallel, as are embedded
+// images. External images are loaded by the image loader.
+// Materials are mapped from the metallic roughness model. The alpha of the
+// base color is used as coverage unless the alpha mode is opaque.
+// Future work:
+// * Cameras and KHR_lights_punctual.
+// * Sparse accessors and non-triangle primitives.
+// * Non-uniform scales, which currently are approximated by their mean.
+// -----------------------------------------------------------------------
+Cogwheel::Scene::SceneNodes::UID load(const std::string& filename, ImageLoader image_loader, EmbeddedImageLoader embedded_image_loader = nullptr);
+
+} // NS GltfLoader
+
+#endif // _COGWHEEL_ASSETS_GLTF_LOADER_H_
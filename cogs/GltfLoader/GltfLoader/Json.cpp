@@ -0,0 +1,295 @@
+// Cogwheel minimal JSON parser for glTF files.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <GltfLoader/Json.h>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace GltfLoader {
+namespace Json {
+
+static const Value null_value = Value();
+
+const Value& Value::operator[](size_t index) const {
+    return m_type == Type::Array && index < m_elements.size() ? m_elements[index] : null_value;
+}
+
+const Value& Value::operator[](const char* key) const {
+    if (m_type == Type::Object)
+        for (const auto& member : m_members)
+            if (member.first == key)
+                return member.second;
+    return null_value;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Recursive descent parser.
+// ------------------------------------------------------------------------------------------------
+
+class Parser final {
+public:
+    Parser(const char* text, size_t length)
+        : m_current(text), m_begin(text), m_end(text + length) { }
+
+    bool parse_document(Value& root, std::string& error) {
+        skip_whitespace();
+        bool parsed = parse_value(root, 0) && (skip_whitespace(), m_current == m_end);
+        if (!parsed)
+            error = (m_error.empty() ? "Unexpected trailing characters" : m_error) + " at offset " + std::to_string(m_current - m_begin) + ".";
+        return parsed;
+    }
+
+private:
+    // Guards against stack overflows on malicious input. glTF documents are shallow.
+    static const int max_depth = 512;
+
+    inline bool fail(const char* message) {
+        if (m_error.empty())
+            m_error = message;
+        return false;
+    }
+
+    inline void skip_whitespace() {
+        while (m_current < m_end && (*m_current == ' ' || *m_current == '\t' || *m_current == '\n' || *m_current == '\r'))
+            ++m_current;
+    }
+
+    inline bool consume(char c) {
+        skip_whitespace();
+        if (m_current < m_end && *m_current == c) {
+            ++m_current;
+            return true;
+        }
+        return false;
+    }
+
+    inline bool consume_literal(const char* literal) {
+        size_t length = strlen(literal);
+        if (size_t(m_end - m_current) < length || memcmp(m_current, literal, length) != 0)
+            return fail("Invalid literal");
+        m_current += length;
+        return true;
+    }
+
+    bool parse_value(Value& value, int depth) {
+        if (depth > max_depth)
+            return fail("Maximum nesting depth exceeded");
+        if (m_current == m_end)
+            return fail("Unexpected end of document");
+
+        switch (*m_current) {
+        case '{': return parse_object(value, depth);
+        case '[': return parse_array(value, depth);
+        case '"':
+            value.m_type = Value::Type::String;
+            return parse_string(value.m_string);
+        case 't':
+            value.m_type = Value::Type::Bool;
+            value.m_number = 1.0;
+            return consume_literal("true");
+        case 'f':
+            value.m_type = Value::Type::Bool;
+            value.m_number = 0.0;
+            return consume_literal("false");
+        case 'n':
+            value.m_type = Value::Type::Null;
+            return consume_literal("null");
+        default:
+            return parse_number(value);
+        }
+    }
+
+    bool parse_object(Value& value, int depth) {
+        value.m_type = Value::Type::Object;
+        ++m_current; // '{'
+        if (consume('}'))
+            return true;
+
+        do {
+            skip_whitespace();
+            value.m_members.emplace_back();
+            auto& member = value.m_members.back();
+            if (m_current == m_end || *m_current != '"')
+                return fail("Expected member name");
+            if (!parse_string(member.first))
+                return false;
+            if (!consume(':'))
+                return fail("Expected ':'");
+            skip_whitespace();
+            if (!parse_value(member.second, depth + 1))
+                return false;
+        } while (consume(','));
+
+        return consume('}') || fail("Expected ',' or '}'");
+    }
+
+    bool parse_array(Value& value, int depth) {
+        value.m_type = Value::Type::Array;
+        ++m_current; // '['
+        if (consume(']'))
+            return true;
+
+        do {
+            skip_whitespace();
+            value.m_elements.emplace_back();
+            if (!parse_value(value.m_elements.back(), depth + 1))
+                return false;
+        } while (consume(','));
+
+        return consume(']') || fail("Expected ',' or ']'");
+    }
+
+    bool parse_number(Value& value) {
+        // Validate the JSON number grammar, as strtod accepts more, e.g. hex and inf.
+        const char* number_begin = m_current;
+        const char* c = m_current;
+        if (c < m_end && *c == '-') ++c;
+        if (c == m_end || *c < '0' || *c > '9')
+            return fail("Invalid value");
+        if (*c == '0')
+            ++c; // Leading zeros aren't allowed.
+        else
+            while (c < m_end && *c >= '0' && *c <= '9') ++c;
+        if (c < m_end && *c == '.') {
+            ++c;
+            if (c == m_end || *c < '0' || *c > '9')
+                return fail("Invalid number");
+            while (c < m_end && *c >= '0' && *c <= '9') ++c;
+        }
+        if (c < m_end && (*c == 'e' || *c == 'E')) {
+            ++c;
+            if (c < m_end && (*c == '+' || *c == '-')) ++c;
+            if (c == m_end || *c < '0' || *c > '9')
+                return fail("Invalid number");
+            while (c < m_end && *c >= '0' && *c <= '9') ++c;
+        }
+
+        // The document isn't null terminated, so copy the number before converting it.
+        char buffer[64];
+        size_t length = c - number_begin;
+        if (length >= sizeof(buffer))
+            return fail("Number too long");
+        memcpy(buffer, number_begin, length);
+        buffer[length] = '\0';
+
+        value.m_type = Value::Type::Number;
+        value.m_number = strtod(buffer, nullptr);
+        m_current = c;
+        return true;
+    }
+
+    static inline int hex_value(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool parse_hex4(unsigned int& code_unit) {
+        if (m_end - m_current < 4)
+            return fail("Invalid unicode escape");
+        code_unit = 0;
+        for (int i = 0; i < 4; ++i) {
+            int digit = hex_value(*m_current++);
+            if (digit < 0)
+                return fail("Invalid unicode escape");
+            code_unit = (code_unit << 4) | digit;
+        }
+        return true;
+    }
+
+    static void append_utf8(std::string& str, unsigned int code_point) {
+        if (code_point < 0x80)
+            str += char(code_point);
+        else if (code_point < 0x800) {
+            str += char(0xC0 | (code_point >> 6));
+            str += char(0x80 | (code_point & 0x3F));
+        } else if (code_point < 0x10000) {
+            str += char(0xE0 | (code_point >> 12));
+            str += char(0x80 | ((code_point >> 6) & 0x3F));
+            str += char(0x80 | (code_point & 0x3F));
+        } else {
+            str += char(0xF0 | (code_point >> 18));
+            str += char(0x80 | ((code_point >> 12) & 0x3F));
+            str += char(0x80 | ((code_point >> 6) & 0x3F));
+            str += char(0x80 | (code_point & 0x3F));
+        }
+    }
+
+    bool parse_string(std::string& str) {
+        ++m_current; // '"'
+        while (m_current < m_end) {
+            // Copy the run of unescaped characters at once.
+            const char* run_begin = m_current;
+            while (m_current < m_end && *m_current != '"' && *m_current != '\\' && (unsigned char)*m_current >= 0x20)
+                ++m_current;
+            str.append(run_begin, m_current);
+            if (m_current == m_end)
+                break;
+
+            char c = *m_current++;
+            if (c == '"')
+                return true;
+            if (c != '\\')
+                return fail("Control character in string");
+            if (m_current == m_end)
+                break;
+
+            switch (*m_current++) {
+            case '"': str += '"'; break;
+            case '\\': str += '\\'; break;
+            case '/': str += '/'; break;
+            case 'b': str += '\b'; break;
+            case 'f': str += '\f'; break;
+            case 'n': str += '\n'; break;
+            case 'r': str += '\r'; break;
+            case 't': str += '\t'; break;
+            case 'u': {
+                unsigned int code_point;
+                if (!parse_hex4(code_point))
+                    return false;
+                // Combine surrogate pairs.
+                if (code_point >= 0xD800 && code_point < 0xDC00) {
+                    unsigned int low_surrogate;
+                    if (m_end - m_current < 2 || m_current[0] != '\\' || m_current[1] != 'u')
+                        return fail("Unpaired surrogate");
+                    m_current += 2;
+                    if (!parse_hex4(low_surrogate) || low_surrogate < 0xDC00 || low_surrogate > 0xDFFF)
+                        return fail("Unpaired surrogate");
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low_surrogate - 0xDC00);
+                }
+                append_utf8(str, code_point);
+                break;
+            }
+            default:
+                return fail("Invalid escape sequence");
+            }
+        }
+        return fail("Unterminated string");
+    }
+
+    const char* m_current;
+    const char* const m_begin;
+    const char* const m_end;
+    std::string m_error;
+};
+
+bool parse(const char* text, size_t length, Value& root, std::string& error) {
+    root = Value();
+    // Skip the byte order mark, if present.
+    if (length >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0) {
+        text += 3;
+        length -= 3;
+    }
+    Parser parser = Parser(text, length);
+    return parser.parse_document(root, error);
+}
+
+} // NS Json
+} // NS GltfLoader
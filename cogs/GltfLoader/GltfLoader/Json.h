@@ -0,0 +1,74 @@
+// Cogwheel minimal JSON parser for glTF files.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_GLTF_JSON_H_
+#define _COGWHEEL_ASSETS_GLTF_JSON_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace GltfLoader {
+namespace Json {
+
+// -----------------------------------------------------------------------
+// JSON value.
+// Accessing a missing array element or object member or reading a value
+// as the wrong type returns a null value or the given default value, so
+// optional glTF properties can be read without checking for them first.
+// Objects store their members in document order and are searched
+// linearly, which is fast enough for the small objects in glTF files.
+// -----------------------------------------------------------------------
+class Value final {
+public:
+    enum class Type : unsigned char { Null, Bool, Number, String, Array, Object };
+
+    Value() : m_type(Type::Null), m_number(0.0) { }
+
+    inline Type get_type() const { return m_type; }
+    inline bool is_null() const { return m_type == Type::Null; }
+    inline bool is_number() const { return m_type == Type::Number; }
+    inline bool is_string() const { return m_type == Type::String; }
+    inline bool is_array() const { return m_type == Type::Array; }
+    inline bool is_object() const { return m_type == Type::Object; }
+
+    inline bool as_bool(bool default_value = false) const { return m_type == Type::Bool ? m_number != 0.0 : default_value; }
+    inline double as_number(double default_value = 0.0) const { return m_type == Type::Number ? m_number : default_value; }
+    inline float as_float(float default_value = 0.0f) const { return m_type == Type::Number ? float(m_number) : default_value; }
+    inline int as_int(int default_value = 0) const { return m_type == Type::Number ? int(m_number) : default_value; }
+    inline const std::string& as_string() const { return m_string; }
+
+    // Number of elements in an array or members in an object.
+    inline size_t size() const { return m_type == Type::Array ? m_elements.size() : m_members.size(); }
+
+    const Value& operator[](size_t index) const;
+    inline const Value& operator[](int index) const { return (*this)[size_t(index)]; } // Negative indices return a null value.
+    const Value& operator[](const char* key) const;
+    inline const Value& operator[](const std::string& key) const { return (*this)[key.c_str()]; }
+    inline bool has(const char* key) const { return !(*this)[key].is_null(); }
+
+    inline const std::vector<Value>& get_elements() const { return m_elements; }
+    inline const std::vector<std::pair<std::string, Value>>& get_members() const { return m_members; }
+
+private:
+    friend class Parser;
+
+    Type m_type;
+    double m_number; // Also holds booleans.
+    std::string m_string;
+    std::vector<Value> m_elements;
+    std::vector<std::pair<std::string, Value>> m_members;
+};
+
+// Parses a UTF-8 JSON document. Returns false and describes the problem in error if the document is malformed.
+bool parse(const char* text, size_t length, Value& root, std::string& error);
+
+} // NS Json
+} // NS GltfLoader
+
+#endif // _COGWHEEL_ASSETS_GLTF_JSON_H_
@@ -0,0 +1,91 @@
+// Cogwheel uri decoding for glTF files.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <GltfLoader/Uri.h>
+
+namespace GltfLoader {
+
+std::string decode_uri(const std::string& uri) {
+    auto hex_value = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    std::string decoded;
+    decoded.reserve(uri.length());
+    for (size_t i = 0; i < uri.length(); ++i) {
+        if (uri[i] == '%' && i + 2 < uri.length() && hex_value(uri[i + 1]) >= 0 && hex_value(uri[i + 2]) >= 0) {
+            decoded += char(hex_value(uri[i + 1]) * 16 + hex_value(uri[i + 2]));
+            i += 2;
+        } else
+            decoded += uri[i];
+    }
+    return decoded;
+}
+
+static inline int base64_value(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+// Groups of four characters are decoded independently and in parallel.
+bool decode_data_uri(const std::string& uri, std::vector<unsigned char>& data) {
+    size_t comma_index = uri.find(',');
+    if (comma_index == std::string::npos || comma_index < 7 || uri.compare(comma_index - 7, 7, ";base64") != 0)
+        return false;
+
+    const unsigned char* text = (const unsigned char*)uri.data() + comma_index + 1;
+    size_t padded_length = uri.length() - comma_index - 1;
+    size_t length = padded_length;
+    while (length > 0 && text[length - 1] == '=')
+        --length;
+    size_t padding = padded_length - length;
+    if (length % 4 == 1 || padding > 2 || (padding > 0 && padded_length % 4 != 0))
+        return false;
+
+    data.resize(length / 4 * 3 + (length % 4 == 0 ? 0 : length % 4 - 1));
+    int group_count = int(length / 4);
+    int invalid_characters = 0;
+    #pragma omp parallel for schedule(static) reduction(+:invalid_characters) if (group_count > 65536)
+    for (int g = 0; g < group_count; ++g) {
+        const unsigned char* group = text + 4 * g;
+        int v0 = base64_value(group[0]), v1 = base64_value(group[1]), v2 = base64_value(group[2]), v3 = base64_value(group[3]);
+        invalid_characters += (v0 | v1 | v2 | v3) < 0 ? 1 : 0;
+        unsigned int bits = ((v0 & 63) << 18) | ((v1 & 63) << 12) | ((v2 & 63) << 6) | (v3 & 63); // Masked, as invalid characters are -1.
+        unsigned char* bytes = data.data() + 3 * g;
+        bytes[0] = (unsigned char)(bits >> 16);
+        bytes[1] = (unsigned char)(bits >> 8);
+        bytes[2] = (unsigned char)bits;
+    }
+
+    // Decode the trailing partial group.
+    size_t tail_length = length % 4;
+    if (tail_length > 0) {
+        const unsigned char* group = text + 4 * group_count;
+        unsigned int bits = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            int v = i < tail_length ? base64_value(group[i]) : 0;
+            invalid_characters += v < 0 ? 1 : 0;
+            bits = (bits << 6) | (v & 63);
+        }
+        unsigned char* bytes = data.data() + 3 * group_count;
+        bytes[0] = (unsigned char)(bits >> 16);
+        if (tail_length == 3)
+            bytes[1] = (unsigned char)(bits >> 8);
+    }
+
+    return invalid_characters == 0;
+}
+
+} // NS GltfLoader
@@ -0,0 +1,31 @@
+// Cogwheel uri decoding for glTF files.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_GLTF_URI_H_
+#define _COGWHEEL_ASSETS_GLTF_URI_H_
+
+#include <string>
+#include <vector>
+
+namespace GltfLoader {
+
+// Decodes percent encoded characters in relative uris, e.g. %20 for space.
+std::string decode_uri(const std::string& uri);
+
+inline bool is_data_uri(const std::string& uri) {
+    return uri.compare(0, 5, "data:") == 0;
+}
+
+// Decodes the base64 payload of a data uri. The payload may be unpadded, but if it is padded,
+// then the padded payload must be a multiple of four characters.
+// Returns false if the uri isn't base64 encoded or the payload contains invalid characters.
+bool decode_data_uri(const std::string& uri, std::vector<unsigned char>& data);
+
+} // NS GltfLoader
+
+#endif // _COGWHEEL_ASSETS_GLTF_URI_H_
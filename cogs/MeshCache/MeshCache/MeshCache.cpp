@@ -0,0 +1,834 @@
+// Cogwheel binary mesh cache.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#pragma warning(disable : 4996)
+
+#include <MeshCache/MeshCache.h>
+
+#include <Cogwheel/Assets/Image.h>
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Assets/Texture.h>
+#include <Cogwheel/Core/Hash.h>
+#include <Cogwheel/Core/MemoryMappedFile.h>
+#include <Cogwheel/Scene/Camera.h>
+#include <Cogwheel/Scene/LightSource.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace Cogwheel;
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Core;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Scene;
+
+namespace MeshCache {
+
+// ------------------------------------------------------------------------------------------------
+// File layout.
+// All offsets are absolute offsets into the file.
+// ------------------------------------------------------------------------------------------------
+
+static const char file_magic[8] = { 'C', 'W', 'M', 'C', 'A', 'C', 'H', 'E' };
+static const unsigned int invalid_index = 0xFFFFFFFF;
+static const size_t alignment = 16;
+
+enum class Section {
+    Images,
+    Textures,
+    Materials,
+    Meshes,
+    Nodes,
+    Models,
+    Scenes,
+    Cameras,
+    Lights,
+    Count
+};
+
+struct SectionHeader {
+    unsigned long long offset;
+    unsigned int element_count;
+    unsigned int element_size;
+};
+
+struct StringRef {
+    unsigned long long offset;
+    unsigned long long length;
+};
+
+struct FileHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int header_size;
+    unsigned long long file_size;
+    unsigned long long checksum; // Checksum of everything after the header.
+    unsigned long long source_modification_time;
+    StringRef source_path;
+    SectionHeader sections[int(Section::Count)];
+};
+
+struct ImageEntry {
+    StringRef name;
+    unsigned int pixel_format;
+    float gamma;
+    Vector3ui size;
+    unsigned int mipmap_count;
+    unsigned int is_mipmapable;
+    unsigned long long pixels_offset;
+    unsigned long long pixels_size;
+};
+
+struct TextureEntry {
+    unsigned int image_index;
+    unsigned int magnification_filter;
+    unsigned int minification_filter;
+    unsigned int wrapmode_U;
+    unsigned int wrapmode_V;
+};
+
+struct MaterialEntry {
+    StringRef name;
+    RGB tint;
+    unsigned int tint_texture_index;
+    float roughness;
+    float specularity;
+    float metallic;
+    float coverage;
+    unsigned int coverage_texture_index;
+    float transmission;
+    unsigned int flags;
+};
+
+struct MeshEntry {
+    StringRef name;
+    unsigned int primitive_count;
+    unsigned int vertex_count;
+    unsigned int flags;
+    AABB bounds;
+    // Buffer offsets. Zero if the buffer isn't present.
+    unsigned long long primitives_offset;
+    unsigned long long positions_offset;
+    unsigned long long normals_offset;
+    unsigned long long texcoords_offset;
+    unsigned long long tangents_offset;
+};
+
+struct NodeEntry {
+    StringRef name;
+    unsigned int parent_index; // Parents are always stored before their children.
+    Transform global_transform;
+};
+
+struct ModelEntry {
+    unsigned int node_index;
+    unsigned int mesh_index;
+    unsigned int material_index; // Invalid if the model has no material.
+};
+
+// The root node of a scene is the first node and the name of the scene is the name of its root node.
+struct SceneEntry {
+    RGB environment_tint;
+    unsigned int environment_map_index;
+};
+
+struct CameraEntry {
+    StringRef name;
+    Transform transform;
+    Matrix4x4f projection_matrix;
+    Matrix4x4f inverse_projection_matrix;
+    Rectf viewport;
+    int z_index;
+    CameraEffects::Settings effects_settings;
+};
+
+struct LightEntry {
+    unsigned int node_index;
+    unsigned int type;
+    RGB color;
+    float radius;
+};
+
+static inline size_t align(size_t offset) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Checksum.
+// 64 bit FNV-1a applied to 64 bit words. The data is hashed in chunks in parallel
+// and the chunk hashes are then hashed in order.
+// ------------------------------------------------------------------------------------------------
+
+static const size_t checksum_chunk_size = 1 << 20;
+
+static unsigned long long compute_checksum(const unsigned char* data, size_t size) {
+    // The file size is a multiple of the alignment, so the data can be read as 64 bit words.
+    int chunk_count = int((size + checksum_chunk_size - 1) / checksum_chunk_size);
+    std::vector<unsigned long long> chunk_hashes(chunk_count);
+    #pragma omp parallel for schedule(dynamic, 4)
+    for (int c = 0; c < chunk_count; ++c) {
+        size_t chunk_begin = c * checksum_chunk_size;
+        chunk_hashes[c] = fnv1a<unsigned long long>(data + chunk_begin, std::min(checksum_chunk_size, size - chunk_begin));
+    }
+
+    return fnv1a<unsigned long long>(chunk_hashes.data(), chunk_hashes.size() * sizeof(unsigned long long));
+}
+
+// ------------------------------------------------------------------------------------------------
+// Store.
+// ------------------------------------------------------------------------------------------------
+
+// The cache is assembled in memory and written with a single write.
+// Offsets are handed out first and the large buffers are then copied in parallel.
+struct CacheWriter {
+    std::vector<unsigned char> data;
+
+    unsigned long long allocate(size_t size) {
+        size_t offset = align(data.size());
+        data.resize(align(offset + size));
+        return offset;
+    }
+
+    StringRef write_string(const std::string& str) {
+        StringRef ref = { allocate(str.size()), str.size() };
+        memcpy(data.data() + ref.offset, str.c_str(), str.size());
+        return ref;
+    }
+
+    template <typename T>
+    void write_section(FileHeader& header, Section section, const std::vector<T>& entries) {
+        SectionHeader& section_header = header.sections[int(section)];
+        section_header.offset = allocate(sizeof(T) * entries.size());
+        section_header.element_count = (unsigned int)entries.size();
+        section_header.element_size = sizeof(T);
+        if (!entries.empty())
+            memcpy(data.data() + section_header.offset, entries.data(), sizeof(T) * entries.size());
+    }
+};
+
+// Maps UIDs to their index in the cache. The map is indexed by the UID like the data model arrays.
+struct IndexMap {
+    std::vector<unsigned int> indices;
+
+    IndexMap(unsigned int capacity) : indices(capacity, invalid_index) { }
+
+    // Adds the ID to the map if it isn't already present and returns true if it was added.
+    inline bool add(unsigned int ID, unsigned int index) {
+        if (indices[ID] != invalid_index)
+            return false;
+        indices[ID] = index;
+        return true;
+    }
+    inline unsigned int operator[](unsigned int ID) const { return indices[ID]; }
+};
+
+static size_t compute_image_byte_count(Images::UID image_ID) {
+    size_t pixel_count = 0;
+    for (unsigned int m = 0; m < Images::get_mipmap_count(image_ID); ++m)
+        pixel_count += Images::get_pixel_count(image_ID, m);
+    return pixel_count * size_of(Images::get_pixel_format(image_ID));
+}
+
+// Stores the nodes below root_ID and the resources they reference.
+// If a scene is given, then root_ID is its root node and the scene, its cameras and the lights in the hierarchy are stored as well.
+static bool store_file(const std::string& cache_path, SceneNodes::UID root_ID, SceneRoots::UID scene_ID,
+                       const std::string& source_path, unsigned long long source_modification_time) {
+    if (!SceneNodes::has(root_ID))
+        return false;
+
+    // Gather the nodes below the root with the parents ahead of their children.
+    std::vector<SceneNodes::UID> node_IDs;
+    IndexMap node_indices = IndexMap(SceneNodes::capacity());
+    node_IDs.push_back(root_ID);
+    node_indices.add(root_ID, 0);
+    for (unsigned int n = 0; n < node_IDs.size(); ++n)
+        for (SceneNodes::UID child_ID : SceneNodes::get_children_IDs(node_IDs[n])) {
+            node_indices.add(child_ID, (unsigned int)node_IDs.size());
+            node_IDs.push_back(child_ID);
+        }
+
+    // Gather the models in the scene and the meshes, materials, textures and images they reference.
+    std::vector<MeshModels::UID> model_IDs;
+    std::vector<Meshes::UID> mesh_IDs;
+    std::vector<Materials::UID> material_IDs;
+    std::vector<Textures::UID> texture_IDs;
+    std::vector<Images::UID> image_IDs;
+    IndexMap mesh_indices = IndexMap(Meshes::capacity());
+    IndexMap material_indices = IndexMap(Materials::capacity());
+    IndexMap texture_indices = IndexMap(Textures::capacity());
+    IndexMap image_indices = IndexMap(Images::capacity());
+
+    auto add_texture = [&](Textures::UID texture_ID) {
+        if (!Textures::has(texture_ID) || Textures::get_type(texture_ID) != Textures::Type::TwoD)
+            return;
+        if (texture_indices.add(texture_ID, (unsigned int)texture_IDs.size()))
+            texture_IDs.push_back(texture_ID);
+        Images::UID image_ID = Textures::get_image_ID(texture_ID);
+        if (image_indices.add(image_ID, (unsigned int)image_IDs.size()))
+            image_IDs.push_back(image_ID);
+    };
+
+    for (MeshModels::UID model_ID : MeshModels::get_iterable()) {
+        SceneNodes::UID node_ID = MeshModels::get_scene_node_ID(model_ID);
+        Meshes::UID mesh_ID = MeshModels::get_mesh_ID(model_ID);
+        Materials::UID material_ID = MeshModels::get_material_ID(model_ID);
+        if (!SceneNodes::has(node_ID) || node_indices[node_ID] == invalid_index || !Meshes::has(mesh_ID))
+            continue;
+        model_IDs.push_back(model_ID);
+
+        if (mesh_indices.add(mesh_ID, (unsigned int)mesh_IDs.size()))
+            mesh_IDs.push_back(mesh_ID);
+
+        // Models without a material, e.g. obj shapes without one, are stored with an invalid material index.
+        if (Materials::has(material_ID) && material_indices.add(material_ID, (unsigned int)material_IDs.size())) {
+            material_IDs.push_back(material_ID);
+            add_texture(Materials::get_tint_texture_ID(material_ID));
+            add_texture(Materials::get_coverage_texture_ID(material_ID));
+        }
+    }
+
+    // Gather the scene's environment map, cameras and the lights in the scene.
+    bool store_scene = SceneRoots::has(scene_ID);
+    std::vector<Cameras::UID> camera_IDs;
+    std::vector<LightSources::UID> light_IDs;
+    if (store_scene) {
+        add_texture(SceneRoots::get_environment_map(scene_ID));
+
+        if (Cameras::is_allocated())
+            for (Cameras::UID camera_ID : Cameras::get_iterable())
+                if (Cameras::get_scene_ID(camera_ID) == scene_ID)
+                    camera_IDs.push_back(camera_ID);
+
+        if (LightSources::is_allocated())
+            for (LightSources::UID light_ID : LightSources::get_iterable()) {
+                SceneNodes::UID node_ID = LightSources::get_node_ID(light_ID);
+                if (SceneNodes::has(node_ID) && node_indices[node_ID] != invalid_index)
+                    light_IDs.push_back(light_ID);
+            }
+    }
+
+    auto texture_index = [&](Textures::UID texture_ID) -> unsigned int {
+        return Textures::has(texture_ID) ? texture_indices[texture_ID] : invalid_index;
+    };
+
+    auto material_index = [&](Materials::UID material_ID) -> unsigned int {
+        return Materials::has(material_ID) ? material_indices[material_ID] : invalid_index;
+    };
+
+    // Lay out the file.
+    CacheWriter writer;
+    unsigned long long header_offset = writer.allocate(sizeof(FileHeader));
+    FileHeader header = {};
+    memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version = version;
+    header.header_size = sizeof(FileHeader);
+    header.source_modification_time = source_modification_time;
+    header.source_path = writer.write_string(source_path);
+
+    std::vector<ImageEntry> image_entries(image_IDs.size());
+    for (unsigned int i = 0; i < image_IDs.size(); ++i) {
+        Image image = image_IDs[i];
+        ImageEntry& entry = image_entries[i];
+        entry.name = writer.write_string(image.get_name());
+        entry.pixel_format = (unsigned int)image.get_pixel_format();
+        entry.gamma = image.get_gamma();
+        entry.size = Vector3ui(image.get_width(), image.get_height(), image.get_depth());
+        entry.mipmap_count = image.get_mipmap_count();
+        entry.is_mipmapable = image.is_mipmapable() ? 1u : 0u;
+        entry.pixels_size = compute_image_byte_count(image.get_ID());
+        entry.pixels_offset = writer.allocate(entry.pixels_size);
+    }
+
+    std::vector<TextureEntry> texture_entries(texture_IDs.size());
+    for (unsigned int t = 0; t < texture_IDs.size(); ++t) {
+        Textures::UID texture_ID = texture_IDs[t];
+        TextureEntry& entry = texture_entries[t];
+        entry.image_index = image_indices[Textures::get_image_ID(texture_ID)];
+        entry.magnification_filter = (unsigned int)Textures::get_magnification_filter(texture_ID);
+        entry.minification_filter = (unsigned int)Textures::get_minification_filter(texture_ID);
+        entry.wrapmode_U = (unsigned int)Textures::get_wrapmode_U(texture_ID);
+        entry.wrapmode_V = (unsigned int)Textures::get_wrapmode_V(texture_ID);
+    }
+
+    std::vector<MaterialEntry> material_entries(material_IDs.size());
+    for (unsigned int m = 0; m < material_IDs.size(); ++m) {
+        Materials::UID material_ID = material_IDs[m];
+        MaterialEntry& entry = material_entries[m];
+        entry.name = writer.write_string(Materials::get_name(material_ID));
+        entry.tint = Materials::get_tint(material_ID);
+        entry.tint_texture_index = texture_index(Materials::get_tint_texture_ID(material_ID));
+        entry.roughness = Materials::get_roughness(material_ID);
+        entry.specularity = Materials::get_specularity(material_ID);
+        entry.metallic = Materials::get_metallic(material_ID);
+        entry.coverage = Materials::get_coverage(material_ID);
+        entry.coverage_texture_index = texture_index(Materials::get_coverage_texture_ID(material_ID));
+        entry.transmission = Materials::get_transmission(material_ID);
+        entry.flags = Materials::get_flags(material_ID).raw();
+    }
+
+    std::vector<MeshEntry> mesh_entries(mesh_IDs.size());
+    for (unsigned int m = 0; m < mesh_IDs.size(); ++m) {
+        Mesh mesh = mesh_IDs[m];
+        MeshEntry& entry = mesh_entries[m];
+        unsigned int vertex_count = mesh.get_vertex_count();
+        entry.name = writer.write_string(mesh.get_name());
+        entry.primitive_count = mesh.get_primitive_count();
+        entry.vertex_count = vertex_count;
+        entry.flags = mesh.get_flags().raw();
+        entry.bounds = mesh.get_bounds();
+        entry.primitives_offset = writer.allocate(sizeof(Vector3ui) * entry.primitive_count);
+        entry.positions_offset = mesh.get_positions() ? writer.allocate(sizeof(Vector3f) * vertex_count) : 0;
+        entry.normals_offset = mesh.get_normals() ? writer.allocate(sizeof(Vector3f) * vertex_count) : 0;
+        entry.texcoords_offset = mesh.get_texcoords() ? writer.allocate(sizeof(Vector2f) * vertex_count) : 0;
+        entry.tangents_offset = mesh.get_tangents() ? writer.allocate(sizeof(Vector4f) * vertex_count) : 0;
+    }
+
+    std::vector<NodeEntry> node_entries(node_IDs.size());
+    for (unsigned int n = 0; n < node_IDs.size(); ++n) {
+        SceneNodes::UID node_ID = node_IDs[n];
+        NodeEntry& entry = node_entries[n];
+        entry.name = writer.write_string(SceneNodes::get_name(node_ID));
+        entry.parent_index = n == 0 ? invalid_index : node_indices[SceneNodes::get_parent_ID(node_ID)];
+        entry.global_transform = SceneNodes::get_global_transform(node_ID);
+    }
+
+    std::vector<ModelEntry> model_entries(model_IDs.size());
+    for (unsigned int m = 0; m < model_IDs.size(); ++m) {
+        MeshModels::UID model_ID = model_IDs[m];
+        model_entries[m] = { node_indices[MeshModels::get_scene_node_ID(model_ID)],
+                             mesh_indices[MeshModels::get_mesh_ID(model_ID)],
+                             material_index(MeshModels::get_material_ID(model_ID)) };
+    }
+
+    std::vector<SceneEntry> scene_entries;
+    if (store_scene) {
+        SceneEntry entry = { SceneRoots::get_environment_tint(scene_ID), texture_index(SceneRoots::get_environment_map(scene_ID)) };
+        scene_entries.push_back(entry);
+    }
+
+    std::vector<CameraEntry> camera_entries(camera_IDs.size());
+    for (unsigned int c = 0; c < camera_IDs.size(); ++c) {
+        Cameras::UID camera_ID = camera_IDs[c];
+        CameraEntry& entry = camera_entries[c];
+        entry.name = writer.write_string(Cameras::get_name(camera_ID));
+        entry.transform = Cameras::get_transform(camera_ID);
+        entry.projection_matrix = Cameras::get_projection_matrix(camera_ID);
+        entry.inverse_projection_matrix = Cameras::get_inverse_projection_matrix(camera_ID);
+        entry.viewport = Cameras::get_viewport(camera_ID);
+        entry.z_index = Cameras::get_z_index(camera_ID);
+        entry.effects_settings = Cameras::get_effects_settings(camera_ID);
+    }
+
+    std::vector<LightEntry> light_entries(light_IDs.size());
+    for (unsigned int l = 0; l < light_IDs.size(); ++l) {
+        LightSources::UID light_ID = light_IDs[l];
+        LightEntry& entry = light_entries[l];
+        entry.node_index = node_indices[LightSources::get_node_ID(light_ID)];
+        entry.type = (unsigned int)LightSources::get_type(light_ID);
+        if (LightSources::get_type(light_ID) == LightSources::Type::Sphere) {
+            entry.color = LightSources::get_sphere_light_power(light_ID);
+            entry.radius = LightSources::get_sphere_light_radius(light_ID);
+        } else {
+            entry.color = LightSources::get_directional_light_radiance(light_ID);
+            entry.radius = 0.0f;
+        }
+    }
+
+    writer.write_section(header, Section::Images, image_entries);
+    writer.write_section(header, Section::Textures, texture_entries);
+    writer.write_section(header, Section::Materials, material_entries);
+    writer.write_section(header, Section::Meshes, mesh_entries);
+    writer.write_section(header, Section::Nodes, node_entries);
+    writer.write_section(header, Section::Models, model_entries);
+    writer.write_section(header, Section::Scenes, scene_entries);
+    writer.write_section(header, Section::Cameras, camera_entries);
+    writer.write_section(header, Section::Lights, light_entries);
+
+    // Copy the buffers in parallel now that the layout is fixed.
+    unsigned char* data = writer.data.data();
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < int(image_IDs.size()); ++i)
+        memcpy(data + image_entries[i].pixels_offset, Images::get_pixels(image_IDs[i]), image_entries[i].pixels_size);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int m = 0; m < int(mesh_IDs.size()); ++m) {
+        Mesh mesh = mesh_IDs[m];
+        const MeshEntry& entry = mesh_entries[m];
+        if (entry.primitive_count > 0)
+            memcpy(data + entry.primitives_offset, mesh.get_primitives(), sizeof(Vector3ui) * entry.primitive_count);
+        if (entry.positions_offset)
+            memcpy(data + entry.positions_offset, mesh.get_positions(), sizeof(Vector3f) * entry.vertex_count);
+        if (entry.normals_offset)
+            memcpy(data + entry.normals_offset, mesh.get_normals(), sizeof(Vector3f) * entry.vertex_count);
+        if (entry.texcoords_offset)
+            memcpy(data + entry.texcoords_offset, mesh.get_texcoords(), sizeof(Vector2f) * entry.vertex_count);
+        if (entry.tangents_offset)
+            memcpy(data + entry.tangents_offset, mesh.get_tangents(), sizeof(Vector4f) * entry.vertex_count);
+    }
+
+    header.file_size = writer.data.size();
+    header.checksum = compute_checksum(data + sizeof(FileHeader), writer.data.size() - sizeof(FileHeader));
+    memcpy(data + header_offset, &header, sizeof(FileHeader));
+
+    FILE* file = fopen(cache_path.c_str(), "wb");
+    if (file == nullptr) {
+        printf("MeshCache::store error: Could not open '%s' for writing.\n", cache_path.c_str());
+        return false;
+    }
+    bool written = fwrite(data, 1, writer.data.size(), file) == writer.data.size();
+    fclose(file);
+    if (!written) {
+        printf("MeshCache::store error: Could not write '%s'.\n", cache_path.c_str());
+        remove(cache_path.c_str());
+    }
+    return written;
+}
+
+bool store(const std::string& cache_path, SceneNodes::UID root_ID,
+           const std::string& source_path, unsigned long long source_modification_time) {
+    return store_file(cache_path, root_ID, SceneRoots::UID::invalid_UID(), source_path, source_modification_time);
+}
+
+bool store_scene(const std::string& path, SceneRoots::UID scene_ID) {
+    if (!SceneRoots::has(scene_ID))
+        return false;
+    return store_file(path, SceneRoots::get_root_node(scene_ID), scene_ID, "", 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Load.
+// ------------------------------------------------------------------------------------------------
+
+struct CacheReader {
+    const MemoryMappedFile& file;
+    const FileHeader& header;
+
+    inline bool contains(unsigned long long offset, unsigned long long size) const {
+        return offset <= file.get_size() && size <= file.get_size() - offset;
+    }
+
+    inline std::string read_string(StringRef ref) const {
+        return std::string((const char*)file.get_data() + ref.offset, size_t(ref.length));
+    }
+
+    template <typename T>
+    inline const T* get_section(Section section) const {
+        return (const T*)(file.get_data() + header.sections[int(section)].offset);
+    }
+
+    inline unsigned int get_count(Section section) const { return header.sections[int(section)].element_count; }
+
+    template <typename T>
+    bool valid_section(Section section) const {
+        const SectionHeader& section_header = header.sections[int(section)];
+        return section_header.element_size == sizeof(T) &&
+            contains(section_header.offset, (unsigned long long)section_header.element_count * sizeof(T));
+    }
+};
+
+static bool validate(const CacheReader& reader) {
+    bool valid_sections = reader.valid_section<ImageEntry>(Section::Images) && reader.valid_section<TextureEntry>(Section::Textures) &&
+        reader.valid_section<MaterialEntry>(Section::Materials) && reader.valid_section<MeshEntry>(Section::Meshes) &&
+        reader.valid_section<NodeEntry>(Section::Nodes) && reader.valid_section<ModelEntry>(Section::Models) &&
+        reader.valid_section<SceneEntry>(Section::Scenes) && reader.valid_section<CameraEntry>(Section::Cameras) &&
+        reader.valid_section<LightEntry>(Section::Lights);
+    if (!valid_sections || reader.get_count(Section::Nodes) == 0)
+        return false;
+
+    unsigned int image_count = reader.get_count(Section::Images);
+    const ImageEntry* images = reader.get_section<ImageEntry>(Section::Images);
+    for (unsigned int i = 0; i < image_count; ++i)
+        if (!reader.contains(images[i].name.offset, images[i].name.length) || !reader.contains(images[i].pixels_offset, images[i].pixels_size))
+            return false;
+
+    unsigned int texture_count = reader.get_count(Section::Textures);
+    const TextureEntry* textures = reader.get_section<TextureEntry>(Section::Textures);
+    for (unsigned int t = 0; t < texture_count; ++t)
+        if (textures[t].image_index >= image_count)
+            return false;
+
+    unsigned int material_count = reader.get_count(Section::Materials);
+    const MaterialEntry* materials = reader.get_section<MaterialEntry>(Section::Materials);
+    for (unsigned int m = 0; m < material_count; ++m) {
+        const MaterialEntry& material = materials[m];
+        if (!reader.contains(material.name.offset, material.name.length) ||
+            (material.tint_texture_index != invalid_index && material.tint_texture_index >= texture_count) ||
+            (material.coverage_texture_index != invalid_index && material.coverage_texture_index >= texture_count))
+            return false;
+    }
+
+    // A vertex buffer is stored if and only if the mesh has the corresponding flag, as the flags decide which buffers the mesh allocates.
+    unsigned int mesh_count = reader.get_count(Section::Meshes);
+    const MeshEntry* meshes = reader.get_section<MeshEntry>(Section::Meshes);
+    for (unsigned int m = 0; m < mesh_count; ++m) {
+        const MeshEntry& mesh = meshes[m];
+        unsigned long long vertex_count = mesh.vertex_count;
+        MeshFlags flags = MeshFlags((unsigned char)mesh.flags);
+        auto valid_buffer = [&](unsigned long long offset, unsigned long long element_size, MeshFlag flag) -> bool {
+            return (offset != 0) == bool(flags & flag) && reader.contains(offset, element_size * vertex_count);
+        };
+        if (mesh.flags > ((unsigned int)MeshFlag::AllBuffers | (unsigned int)MeshFlag::Tangent) ||
+            !reader.contains(mesh.name.offset, mesh.name.length) ||
+            (mesh.primitive_count > 0 && mesh.primitives_offset == 0) ||
+            !reader.contains(mesh.primitives_offset, sizeof(Vector3ui) * (unsigned long long)mesh.primitive_count) ||
+            !valid_buffer(mesh.positions_offset, sizeof(Vector3f), MeshFlag::Position) ||
+            !valid_buffer(mesh.normals_offset, sizeof(Vector3f), MeshFlag::Normal) ||
+            !valid_buffer(mesh.texcoords_offset, sizeof(Vector2f), MeshFlag::Texcoord) ||
+            !valid_buffer(mesh.tangents_offset, sizeof(Vector4f), MeshFlag::Tangent))
+            return false;
+    }
+
+    // All primitives must reference vertices in their mesh. The indices are the bulk of the validation, so the meshes are checked in parallel.
+    int invalid_mesh_count = 0;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:invalid_mesh_count)
+    for (int m = 0; m < int(mesh_count); ++m) {
+        const MeshEntry& mesh = meshes[m];
+        if (mesh.primitive_count == 0)
+            continue;
+        const unsigned int* indices = (const unsigned int*)(reader.file.get_data() + mesh.primitives_offset);
+        unsigned int max_index = 0;
+        for (unsigned long long i = 0; i < 3ull * mesh.primitive_count; ++i)
+            max_index = std::max(max_index, indices[i]);
+        invalid_mesh_count += max_index < mesh.vertex_count ? 0 : 1;
+    }
+    if (invalid_mesh_count > 0)
+        return false;
+
+    unsigned int node_count = reader.get_count(Section::Nodes);
+    const NodeEntry* nodes = reader.get_section<NodeEntry>(Section::Nodes);
+    for (unsigned int n = 0; n < node_count; ++n)
+        if (!reader.contains(nodes[n].name.offset, nodes[n].name.length) ||
+            (n > 0 && nodes[n].parent_index >= n))
+            return false;
+
+    unsigned int model_count = reader.get_count(Section::Models);
+    const ModelEntry* models = reader.get_section<ModelEntry>(Section::Models);
+    for (unsigned int m = 0; m < model_count; ++m)
+        if (models[m].node_index >= node_count || models[m].mesh_index >= mesh_count ||
+            (models[m].material_index != invalid_index && models[m].material_index >= material_count))
+            return false;
+
+    unsigned int scene_count = reader.get_count(Section::Scenes);
+    const SceneEntry* scenes = reader.get_section<SceneEntry>(Section::Scenes);
+    if (scene_count > 1 || (scene_count == 1 && scenes[0].environment_map_index != invalid_index && scenes[0].environment_map_index >= texture_count))
+        return false;
+
+    unsigned int camera_count = reader.get_count(Section::Cameras);
+    const CameraEntry* cameras = reader.get_section<CameraEntry>(Section::Cameras);
+    for (unsigned int c = 0; c < camera_count; ++c)
+        if (!reader.contains(cameras[c].name.offset, cameras[c].name.length))
+            return false;
+
+    unsigned int light_count = reader.get_count(Section::Lights);
+    const LightEntry* lights = reader.get_section<LightEntry>(Section::Lights);
+    for (unsigned int l = 0; l < light_count; ++l)
+        if (lights[l].node_index >= node_count || lights[l].type > (unsigned int)LightSources::Type::Directional)
+            return false;
+
+    // Only scenes have cameras and lights.
+    return scene_count == 1 || (camera_count == 0 && light_count == 0);
+}
+
+// Loads the nodes and resources in a cache file and returns the root node.
+// If scene_ID is given, then the file must contain a scene, which is loaded into a new scene with the first node as its root node.
+static SceneNodes::UID load_file(const std::string& cache_path, const std::string& source_path, unsigned long long source_modification_time,
+                                 SceneRoots::UID* scene_ID) {
+    MemoryMappedFile file = MemoryMappedFile(cache_path);
+    if (!file.is_open() || file.get_size() < sizeof(FileHeader))
+        return SceneNodes::UID::invalid_UID();
+
+    const FileHeader& header = *(const FileHeader*)file.get_data();
+    CacheReader reader = { file, header };
+
+    // Reject caches of other versions or sources before validating the content.
+    bool valid_header = memcmp(header.magic, file_magic, sizeof(file_magic)) == 0 && header.version == version &&
+        header.header_size == sizeof(FileHeader) && header.file_size == file.get_size() && header.file_size % alignment == 0 &&
+        header.source_modification_time == source_modification_time &&
+        reader.contains(header.source_path.offset, header.source_path.length) && reader.read_string(header.source_path) == source_path;
+    if (!valid_header)
+        return SceneNodes::UID::invalid_UID();
+
+    if (header.checksum != compute_checksum(file.get_data() + sizeof(FileHeader), file.get_size() - sizeof(FileHeader)) || !validate(reader)) {
+        printf("MeshCache::load error: '%s' is corrupt.\n", cache_path.c_str());
+        return SceneNodes::UID::invalid_UID();
+    }
+
+    bool load_scene = scene_ID != nullptr;
+    if (load_scene && reader.get_count(Section::Scenes) != 1) {
+        printf("MeshCache::load error: '%s' doesn't contain a scene.\n", cache_path.c_str());
+        return SceneNodes::UID::invalid_UID();
+    }
+
+    const unsigned char* data = file.get_data();
+
+    // Images.
+    unsigned int image_count = reader.get_count(Section::Images);
+    const ImageEntry* image_entries = reader.get_section<ImageEntry>(Section::Images);
+    std::vector<Images::UID> image_IDs(image_count);
+    for (unsigned int i = 0; i < image_count; ++i) {
+        const ImageEntry& entry = image_entries[i];
+        image_IDs[i] = Images::create3D(reader.read_string(entry.name), PixelFormat(entry.pixel_format), entry.gamma, entry.size, entry.mipmap_count);
+        Images::set_mipmapable(image_IDs[i], entry.is_mipmapable != 0);
+    }
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < int(image_count); ++i) {
+        size_t byte_count = compute_image_byte_count(image_IDs[i]);
+        if (byte_count == image_entries[i].pixels_size)
+            memcpy(Images::get_pixels(image_IDs[i]), data + image_entries[i].pixels_offset, byte_count);
+    }
+
+    // Textures.
+    unsigned int texture_count = reader.get_count(Section::Textures);
+    const TextureEntry* texture_entries = reader.get_section<TextureEntry>(Section::Textures);
+    std::vector<Textures::UID> texture_IDs(texture_count);
+    for (unsigned int t = 0; t < texture_count; ++t) {
+        const TextureEntry& entry = texture_entries[t];
+        texture_IDs[t] = Textures::create2D(image_IDs[entry.image_index], MagnificationFilter(entry.magnification_filter),
+                                            MinificationFilter(entry.minification_filter), WrapMode(entry.wrapmode_U), WrapMode(entry.wrapmode_V));
+    }
+
+    auto texture_ID = [&](unsigned int texture_index) -> Textures::UID {
+        return texture_index == invalid_index ? Textures::UID::invalid_UID() : texture_IDs[texture_index];
+    };
+
+    // Materials.
+    unsigned int material_count = reader.get_count(Section::Materials);
+    const MaterialEntry* material_entries = reader.get_section<MaterialEntry>(Section::Materials);
+    std::vector<Materials::UID> material_IDs(material_count);
+    for (unsigned int m = 0; m < material_count; ++m) {
+        const MaterialEntry& entry = material_entries[m];
+        Materials::Data material_data = {};
+        material_data.tint = entry.tint;
+        material_data.tint_texture_ID = texture_ID(entry.tint_texture_index);
+        material_data.roughness = entry.roughness;
+        material_data.specularity = entry.specularity;
+        material_data.metallic = entry.metallic;
+        material_data.coverage = entry.coverage;
+        material_data.coverage_texture_ID = texture_ID(entry.coverage_texture_index);
+        material_data.transmission = entry.transmission;
+        material_data.flags = Materials::Flags((unsigned char)entry.flags);
+        material_IDs[m] = Materials::create(reader.read_string(entry.name), material_data);
+    }
+
+    // Meshes.
+    unsigned int mesh_count = reader.get_count(Section::Meshes);
+    const MeshEntry* mesh_entries = reader.get_section<MeshEntry>(Section::Meshes);
+    std::vector<Meshes::UID> mesh_IDs(mesh_count);
+    Meshes::reserve(Meshes::capacity() + mesh_count);
+    for (unsigned int m = 0; m < mesh_count; ++m) {
+        const MeshEntry& entry = mesh_entries[m];
+        mesh_IDs[m] = Meshes::create(reader.read_string(entry.name), entry.primitive_count, entry.vertex_count, MeshFlags((unsigned char)entry.flags));
+        Meshes::set_bounds(mesh_IDs[m], entry.bounds);
+    }
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int m = 0; m < int(mesh_count); ++m) {
+        Mesh mesh = mesh_IDs[m];
+        const MeshEntry& entry = mesh_entries[m];
+        if (entry.primitive_count > 0)
+            memcpy(mesh.get_primitives(), data + entry.primitives_offset, sizeof(Vector3ui) * entry.primitive_count);
+        if (entry.positions_offset)
+            memcpy(mesh.get_positions(), data + entry.positions_offset, sizeof(Vector3f) * entry.vertex_count);
+        if (entry.normals_offset)
+            memcpy(mesh.get_normals(), data + entry.normals_offset, sizeof(Vector3f) * entry.vertex_count);
+        if (entry.texcoords_offset)
+            memcpy(mesh.get_texcoords(), data + entry.texcoords_offset, sizeof(Vector2f) * entry.vertex_count);
+        if (entry.tangents_offset)
+            memcpy(mesh.get_tangents(), data + entry.tangents_offset, sizeof(Vector4f) * entry.vertex_count);
+    }
+
+    // Scene nodes.
+    unsigned int node_count = reader.get_count(Section::Nodes);
+    const NodeEntry* node_entries = reader.get_section<NodeEntry>(Section::Nodes);
+    std::vector<SceneNodes::UID> node_IDs(node_count);
+    SceneNodes::reserve(SceneNodes::capacity() + node_count);
+    for (unsigned int n = 0; n < node_count; ++n) {
+        const NodeEntry& entry = node_entries[n];
+        if (n == 0 && load_scene) {
+            // The scene root creates its root node.
+            const SceneEntry& scene_entry = *reader.get_section<SceneEntry>(Section::Scenes);
+            *scene_ID = SceneRoots::create(reader.read_string(entry.name), texture_ID(scene_entry.environment_map_index), scene_entry.environment_tint);
+            node_IDs[n] = SceneRoots::get_root_node(*scene_ID);
+            SceneNodes::set_global_transform(node_IDs[n], entry.global_transform);
+            continue;
+        }
+        node_IDs[n] = SceneNodes::create(reader.read_string(entry.name), entry.global_transform);
+        if (entry.parent_index != invalid_index)
+            SceneNodes::set_parent(node_IDs[n], node_IDs[entry.parent_index]);
+    }
+
+    // Mesh models.
+    unsigned int model_count = reader.get_count(Section::Models);
+    const ModelEntry* model_entries = reader.get_section<ModelEntry>(Section::Models);
+    MeshModels::reserve(MeshModels::capacity() + model_count);
+    for (unsigned int m = 0; m < model_count; ++m) {
+        const ModelEntry& entry = model_entries[m];
+        Materials::UID material_ID = entry.material_index == invalid_index ? Materials::UID::invalid_UID() : material_IDs[entry.material_index];
+        MeshModels::create(node_IDs[entry.node_index], mesh_IDs[entry.mesh_index], material_ID);
+    }
+
+    if (!load_scene)
+        return node_IDs[0];
+
+    // Cameras.
+    unsigned int camera_count = reader.get_count(Section::Cameras);
+    const CameraEntry* camera_entries = reader.get_section<CameraEntry>(Section::Cameras);
+    for (unsigned int c = 0; c < camera_count; ++c) {
+        const CameraEntry& entry = camera_entries[c];
+        Cameras::UID camera_ID = Cameras::create(reader.read_string(entry.name), *scene_ID, entry.projection_matrix, entry.inverse_projection_matrix);
+        Cameras::set_transform(camera_ID, entry.transform);
+        Cameras::set_viewport(camera_ID, entry.viewport);
+        Cameras::set_z_index(camera_ID, entry.z_index);
+        Cameras::set_effects_settings(camera_ID, entry.effects_settings);
+    }
+
+    // Light sources.
+    unsigned int light_count = reader.get_count(Section::Lights);
+    const LightEntry* light_entries = reader.get_section<LightEntry>(Section::Lights);
+    for (unsigned int l = 0; l < light_count; ++l) {
+        const LightEntry& entry = light_entries[l];
+        if (LightSources::Type(entry.type) == LightSources::Type::Sphere)
+            LightSources::create_sphere_light(node_IDs[entry.node_index], entry.color, entry.radius);
+        else
+            LightSources::create_directional_light(node_IDs[entry.node_index], entry.color);
+    }
+
+    return node_IDs[0];
+}
+
+SceneNodes::UID load(const std::string& cache_path, const std::string& source_path, unsigned long long source_modification_time) {
+    return load_file(cache_path, source_path, source_modification_time, nullptr);
+}
+
+SceneRoots::UID load_scene(const std::string& path) {
+    SceneRoots::UID scene_ID = SceneRoots::UID::invalid_UID();
+    load_file(path, "", 0, &scene_ID);
+    return scene_ID;
+}
+
+SceneNodes::UID load_cached(const std::string& source_path, SceneLoader scene_loader) {
+    std::string cache_path = source_path + ".meshcache";
+    unsigned long long source_modification_time = MemoryMappedFile::get_modification_time(source_path);
+    if (source_modification_time != 0) {
+        SceneNodes::UID root_ID = load(cache_path, source_path, source_modification_time);
+        if (root_ID != SceneNodes::UID::invalid_UID())
+            return root_ID;
+    }
+
+    SceneNodes::UID root_ID = scene_loader(source_path);
+    if (root_ID != SceneNodes::UID::invalid_UID() && source_modification_time != 0)
+        store(cache_path, root_ID, source_path, source_modification_time);
+    return root_ID;
+}
+
+} // NS MeshCache
@@ -0,0 +1,64 @@
+// Cogwheel binary mesh cache.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_MESH_CACHE_H_
+#define _COGWHEEL_MESH_CACHE_H_
+
+#include <Cogwheel/Scene/SceneNode.h>
+#include <Cogwheel/Scene/SceneRoot.h>
+
+#include <functional>
+#include <string>
+
+namespace MeshCache {
+
+// -----------------------------------------------------------------------
+// Binary cache of the meshes, mesh models, materials, textures, images and
+// scene nodes below a scene node.
+// The same format is used to store entire scenes, in which case the scene
+// root, its cameras and the light sources in the scene are stored as well.
+// The file consists of a header followed by a table of sections and the raw
+// buffer data. All sections and buffers are 16 byte aligned and stored in
+// the same layout as in memory, so loading maps the file and copies the
+// buffers straight into the data model without any parsing.
+// The cache stores the path and modification time of the file it was created
+// from and a checksum of its content. The cache is rejected on a mismatch.
+// Scene files have no source and are only validated by their checksum.
+// Future work:
+// * Store mesh LODs.
+// * Let Meshes reference buffers in the mapped file instead of copying them.
+// -----------------------------------------------------------------------
+
+typedef std::function<Cogwheel::Scene::SceneNodes::UID(const std::string& path)> SceneLoader;
+
+static const unsigned int version = 3u;
+
+// Stores the scene below root_ID in a cache file.
+// The source path and modification time identifies what the cache was created from.
+bool store(const std::string& cache_path, Cogwheel::Scene::SceneNodes::UID root_ID,
+           const std::string& source_path, unsigned long long source_modification_time);
+
+// Loads a cache file and returns the root node of the cached scene.
+// Returns an invalid UID if the file isn't a valid cache of the given source.
+Cogwheel::Scene::SceneNodes::UID load(const std::string& cache_path,
+                                      const std::string& source_path, unsigned long long source_modification_time);
+
+// Stores the scene root, the nodes, models and lights below its root node and the cameras of the scene.
+bool store_scene(const std::string& path, Cogwheel::Scene::SceneRoots::UID scene_ID);
+
+// Loads a scene file into a new scene.
+// Returns an invalid UID if the file isn't a valid scene file.
+Cogwheel::Scene::SceneRoots::UID load_scene(const std::string& path);
+
+// Loads the cache next to the source file if it is up to date with the source.
+// Otherwise the source is loaded by the scene loader and the cache is (re)created.
+Cogwheel::Scene::SceneNodes::UID load_cached(const std::string& source_path, SceneLoader scene_loader);
+
+} // NS MeshCache
+
+#endif // _COGWHEEL_MESH_CACHE_H_
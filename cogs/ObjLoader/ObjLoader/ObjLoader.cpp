@@ -12,6 +12,7 @@
 
 #include <Cogwheel/Assets/Material.h>
 #include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshDeduplication.h>
 #include <Cogwheel/Assets/MeshModel.h>
 #include <Cogwheel/Core/Array.h>
 
@@ -47,7 +48,7 @@ void split_path(std::string& directory, std::string& filename, const std::string
     }
 }
 
-SceneNodes::UID load(const std::string& path, ImageLoader image_loader) {
+SceneNodes::UID load(const std::string& path, ImageLoader image_loader, bool instance_rigid_duplicates) {
     std::string directory, filename;
     split_path(directory, filename, path);
 
@@ -134,11 +135,12 @@ SceneNodes::UID load(const std::string& path, ImageLoader image_loader) {
         materials[unsigned int(i)] = Materials::create(tiny_mat.name, material_data);
     }
 
+    std::vector<Meshes::UID> mesh_IDs(shapes.size());
     #pragma omp parallel for
     for (int s = 0; s < shapes.size(); ++s) {
-        tinyobj::shape_t shape = shapes[s];
+        tinyobj::shape_t& shape = shapes[s];
 
-        Meshes::UID mesh_ID = Meshes::UID::invalid_UID();
+        Meshes::UID& mesh_ID = mesh_IDs[s];
         { // Create mesh
             // Base normal and texcoords on the first vertex.
             tinyobj::index_t first_vertex_index = shape.mesh.indices[0];
@@ -220,18 +222,24 @@ SceneNodes::UID load(const std::string& path, ImageLoader image_loader) {
             cogwheel_mesh.compute_bounds();
         }
 
-        #pragma omp critical
-        {
-            SceneNodes::UID node_ID = SceneNodes::create(shape.name);
-            if (root_ID != SceneNodes::UID::invalid_UID())
-                SceneNodes::set_parent(node_ID, root_ID);
-            else
-                root_ID = node_ID;
-
-            int material_index = shape.mesh.material_ids[0]; // No per facet material support. TODO Add it in the future by splitting up the shape.
-            Materials::UID material_ID = material_index >= 0 ? materials[material_index] : Materials::UID::invalid_UID();
-            MeshModels::UID model_ID = MeshModels::create(node_ID, mesh_ID, material_ID);
-        }
+    }
+
+    // Collapse repeated geometry into a single mesh referenced by multiple models.
+    std::vector<MeshUtils::TransformedMesh> instances = MeshUtils::deduplicate(mesh_IDs.data(), mesh_IDs.data() + mesh_IDs.size(), instance_rigid_duplicates);
+
+    for (int s = 0; s < shapes.size(); ++s) {
+        tinyobj::shape_t& shape = shapes[s];
+        MeshUtils::TransformedMesh instance = instances[s];
+
+        SceneNodes::UID node_ID = SceneNodes::create(shape.name, instance.transform);
+        if (root_ID != SceneNodes::UID::invalid_UID())
+            SceneNodes::set_parent(node_ID, root_ID);
+        else
+            root_ID = node_ID;
+
+        int material_index = shape.mesh.material_ids[0]; // No per facet material support. TODO Add it in the future by splitting up the shape.
+        Materials::UID material_ID = material_index >= 0 ? materials[material_index] : Materials::UID::invalid_UID();
+        MeshModels::UID model_ID = MeshModels::create(node_ID, instance.mesh_ID, material_ID);
     }
 
     return root_ID;
@@ -19,13 +19,17 @@ typedef Cogwheel::Assets::Images::UID (*ImageLoader)(const std::string& filename
 
 // -----------------------------------------------------------------------
 // Loads an obj file.
+// Shapes with identical geometry share a single mesh, referenced by a mesh model pr shape.
+// If instance_rigid_duplicates is true, then shapes whose geometry is a rotated, translated
+// or uniformly scaled copy of another shape also share the mesh and the difference is
+// expressed by the transform of the shape's scene node.
 // Future work:
 // * Support for materials.
 // * Pass in texture 2D loader function as argument.
 // * Return an (optional) list of created mesh model IDs?
 // * Reserve capacity for Mesh, MeshModels and SceneNodes before creating them.
 // -----------------------------------------------------------------------
-Cogwheel::Scene::SceneNodes::UID load(const std::string& filename, ImageLoader image_loader);
+Cogwheel::Scene::SceneNodes::UID load(const std::string& filename, ImageLoader image_loader, bool instance_rigid_duplicates = false);
 
 } // NS ObjLoader
 
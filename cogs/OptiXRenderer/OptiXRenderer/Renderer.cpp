@@ -119,6 +119,46 @@ static inline optix::Geometry load_mesh(optix::Context& context, Meshes::UID mes
     return optix_mesh;
 }
 
+// Updates the dirty ranges of the mesh's buffers.
+static inline void update_mesh(optix::Geometry optix_mesh, Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+
+    Meshes::DirtyRange index_range = mesh.get_dirty_range(Meshes::Change::IndicesUpdated);
+    if (!index_range.is_empty()) {
+        optix::Buffer index_buffer = optix_mesh["index_buffer"]->getBuffer();
+        Vector3ui* mapped_indices = (Vector3ui*)index_buffer->map();
+        std::memcpy(mapped_indices + index_range.begin, mesh.get_primitives() + index_range.begin, index_range.size() * sizeof(Vector3ui));
+        index_buffer->unmap();
+    }
+
+    Meshes::DirtyRange position_range = mesh.get_dirty_range(Meshes::Change::PositionsUpdated);
+    Meshes::DirtyRange normal_range = mesh.get_dirty_range(Meshes::Change::NormalsUpdated);
+    if (!position_range.is_empty() || !normal_range.is_empty()) {
+        optix::Buffer geometry_buffer = optix_mesh["geometry_buffer"]->getBuffer();
+        VertexGeometry* mapped_geometry = (VertexGeometry*)geometry_buffer->map();
+        for (unsigned int i = position_range.begin; i < position_range.end; ++i) {
+            Vector3f position = mesh.get_positions()[i];
+            mapped_geometry[i].position = optix::make_float3(position.x, position.y, position.z);
+        }
+        for (unsigned int i = normal_range.begin; i < normal_range.end; ++i) {
+            Vector3f normal = mesh.get_normals()[i];
+            Math::OctahedralNormal encoded_normal = Math::OctahedralNormal::encode_precise(normal.x, normal.y, normal.z);
+            mapped_geometry[i].normal = { optix::make_short2(encoded_normal.encoding.x, encoded_normal.encoding.y) };
+        }
+        geometry_buffer->unmap();
+    }
+
+    Meshes::DirtyRange texcoord_range = mesh.get_dirty_range(Meshes::Change::TexcoordsUpdated);
+    if (!texcoord_range.is_empty()) {
+        optix::Buffer texcoord_buffer = optix_mesh["texcoord_buffer"]->getBuffer();
+        Vector2f* mapped_texcoords = (Vector2f*)texcoord_buffer->map();
+        std::memcpy(mapped_texcoords + texcoord_range.begin, mesh.get_texcoords() + texcoord_range.begin, texcoord_range.size() * sizeof(Vector2f));
+        texcoord_buffer->unmap();
+    }
+
+    optix_mesh->markDirty();
+}
+
 static inline optix::Transform load_model(optix::Context& context, MeshModel model, optix::Geometry* meshes, optix::Material optix_material) {
     Mesh mesh = model.get_mesh();
     optix::Geometry optix_mesh = meshes[mesh.get_ID()];
@@ -136,6 +176,7 @@ static inline optix::Transform load_model(optix::Context& context, MeshModel mod
     acceleration->setProperty("index_buffer_name", "index_buffer");
     acceleration->setProperty("vertex_buffer_name", "geometry_buffer");
     acceleration->setProperty("vertex_buffer_stride", "16");
+    acceleration->setProperty("refit", "1"); // Refit instead of rebuilding when the mesh's buffers are updated.
     OPTIX_VALIDATE(acceleration);
 
     optix::GeometryGroup geometry_group = context->createGeometryGroup(&optix_model, &optix_model + 1);
@@ -447,6 +488,7 @@ struct Renderer::Implementation {
         }
 
         { // Mesh updates.
+            bool meshes_updated = false;
             for (Meshes::UID mesh_ID : Meshes::get_changed_meshes()) {
                 if (Meshes::get_changes(mesh_ID) == Meshes::Change::Destroyed) {
                     if (mesh_ID < meshes.size() && meshes[mesh_ID]) {
@@ -459,7 +501,26 @@ struct Renderer::Implementation {
                     if (meshes.size() <= mesh_ID)
                         meshes.resize(Meshes::capacity());
                     meshes[mesh_ID] = load_mesh(context, mesh_ID, triangle_intersection_program, triangle_bounds_program);
+                } else if (Meshes::get_changes(mesh_ID).any_set(Meshes::Change::BuffersUpdated) && 
+                           Meshes::get_changes(mesh_ID).not_set(Meshes::Change::Destroyed)) {
+                    update_mesh(meshes[mesh_ID], mesh_ID);
+                    meshes_updated = true;
+                }
+            }
+
+            if (meshes_updated) {
+                // Refit the acceleration structures of the models referencing the updated meshes.
+                for (MeshModels::UID model_ID : MeshModels::get_iterable()) {
+                    MeshModel model = model_ID;
+                    Meshes::Changes mesh_changes = model.get_mesh().get_changes();
+                    if (mesh_changes.any_set(Meshes::Change::BuffersUpdated) && mesh_changes.not_set(Meshes::Change::Created)) {
+                        unsigned int scene_node_index = model.get_scene_node().get_ID();
+                        if (scene_node_index < transforms.size() && transforms[scene_node_index])
+                            transforms[scene_node_index]->getChild<optix::GeometryGroup>()->getAcceleration()->markDirty();
+                    }
                 }
+                root_node->getAcceleration()->markDirty();
+                should_reset_allocations = true;
             }
         }
 
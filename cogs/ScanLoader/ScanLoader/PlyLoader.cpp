@@ -0,0 +1,691 @@
+// Cogwheel PLY model loader.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <ScanLoader/PlyLoader.h>
+#include <ScanLoader/TextParsing.h>
+
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Core/MemoryMappedFile.h>
+
+using namespace Cogwheel;
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Core;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Scene;
+using namespace ScanLoader::TextParsing;
+
+namespace PlyLoader {
+
+// ------------------------------------------------------------------------------------------------
+// Header.
+// ------------------------------------------------------------------------------------------------
+
+enum class Format { ASCII, BinaryLittleEndian, BinaryBigEndian };
+
+enum class PropertyType : unsigned char { Invalid, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+struct Property {
+    std::string name;
+    PropertyType type;
+    PropertyType count_type; // The type of the element count, if the property is a list. Invalid otherwise.
+
+    inline bool is_list() const { return count_type != PropertyType::Invalid; }
+};
+
+struct Element {
+    std::string name;
+    unsigned int count;
+    std::vector<Property> properties;
+
+    // Returns the index of the property with the given name or -1 if there is none.
+    int find_property(const char* property_name) const {
+        for (int p = 0; p < int(properties.size()); ++p)
+            if (properties[p].name == property_name)
+                return p;
+        return -1;
+    }
+};
+
+static PropertyType parse_type(const std::string& type) {
+    if (type == "char" || type == "int8") return PropertyType::Int8;
+    if (type == "uchar" || type == "uint8") return PropertyType::UInt8;
+    if (type == "short" || type == "int16") return PropertyType::Int16;
+    if (type == "ushort" || type == "uint16") return PropertyType::UInt16;
+    if (type == "int" || type == "int32") return PropertyType::Int32;
+    if (type == "uint" || type == "uint32") return PropertyType::UInt32;
+    if (type == "float" || type == "float32") return PropertyType::Float32;
+    if (type == "double" || type == "float64") return PropertyType::Float64;
+    return PropertyType::Invalid;
+}
+
+static inline int size_of(PropertyType type) {
+    switch (type) {
+    case PropertyType::Int8: case PropertyType::UInt8: return 1;
+    case PropertyType::Int16: case PropertyType::UInt16: return 2;
+    case PropertyType::Int32: case PropertyType::UInt32: case PropertyType::Float32: return 4;
+    case PropertyType::Float64: return 8;
+    default: return 0;
+    }
+}
+
+static std::vector<std::string> split_words(const char* begin, const char* end) {
+    std::vector<std::string> words;
+    const char* c = skip_spaces(begin, end);
+    while (c < end && *c != '\n') {
+        const char* word_begin = c;
+        while (c < end && !is_space(*c) && *c != '\n')
+            ++c;
+        words.emplace_back(word_begin, c);
+        c = skip_spaces(c, end);
+    }
+    return words;
+}
+
+// Parses the header and returns the beginning of the body or nullptr if the header is malformed.
+static const char* parse_header(const char* begin, const char* end, Format& format, std::vector<Element>& elements, std::string& error) {
+    if (!starts_with_token(begin, end, "ply")) {
+        error = "Not a PLY file";
+        return nullptr;
+    }
+
+    bool has_format = false;
+    for (const char* line = next_line(begin, end); line < end; line = next_line(line, end)) {
+        std::vector<std::string> words = split_words(line, end);
+        if (words.empty() || words[0] == "comment" || words[0] == "obj_info")
+            continue;
+
+        if (words[0] == "end_header")
+            return has_format ? next_line(line, end) : (error = "Missing format", nullptr);
+        else if (words[0] == "format" && words.size() >= 2) {
+            has_format = true;
+            if (words[1] == "ascii")
+                format = Format::ASCII;
+            else if (words[1] == "binary_little_endian")
+                format = Format::BinaryLittleEndian;
+            else if (words[1] == "binary_big_endian")
+                format = Format::BinaryBigEndian;
+            else {
+                error = "Unknown format '" + words[1] + "'";
+                return nullptr;
+            }
+        } else if (words[0] == "element" && words.size() >= 3) {
+            Element element = { words[1], (unsigned int)strtoul(words[2].c_str(), nullptr, 10), {} };
+            elements.push_back(element);
+        } else if (words[0] == "property" && !elements.empty()) {
+            Property property;
+            if (words.size() >= 5 && words[1] == "list")
+                property = { words[4], parse_type(words[3]), parse_type(words[2]) };
+            else if (words.size() >= 3)
+                property = { words[2], parse_type(words[1]), PropertyType::Invalid };
+            else
+                property = { "", PropertyType::Invalid, PropertyType::Invalid };
+
+            if (property.type == PropertyType::Invalid || (words[1] == "list" && property.count_type == PropertyType::Invalid)) {
+                error = "Invalid property";
+                return nullptr;
+            }
+            elements.back().properties.push_back(property);
+        } else {
+            error = "Unexpected header line '" + words[0] + "'";
+            return nullptr;
+        }
+    }
+
+    error = "Missing end_header";
+    return nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Mesh layout.
+// ------------------------------------------------------------------------------------------------
+
+// The vertex properties that are loaded and the face index list.
+struct Layout {
+    const Element* vertex_element;
+    const Element* face_element;
+    int position[3];
+    int normal[3]; // -1 if the vertices have no normals.
+    int texcoord[2]; // -1 if the vertices have no texcoords.
+    int indices; // The index of the face list property.
+};
+
+static bool resolve_layout(const std::vector<Element>& elements, Layout& layout, std::string& error) {
+    layout.vertex_element = layout.face_element = nullptr;
+    for (const Element& element : elements) {
+        if (element.name == "vertex")
+            layout.vertex_element = &element;
+        else if (element.name == "face")
+            layout.face_element = &element;
+    }
+    if (layout.vertex_element == nullptr || layout.face_element == nullptr) {
+        error = layout.vertex_element == nullptr ? "No vertex element" : "No face element. Point clouds are not supported";
+        return false;
+    }
+
+    // Attributes must be scalars. Partially specified attributes are ignored.
+    const Element& vertex = *layout.vertex_element;
+    auto find_scalar = [&](const char* name) -> int {
+        int p = vertex.find_property(name);
+        return p >= 0 && !vertex.properties[p].is_list() ? p : -1;
+    };
+    auto find_attribute = [&](int* attribute, const char* const* names, int count) -> bool {
+        for (int i = 0; i < count; ++i)
+            attribute[i] = find_scalar(names[i]);
+        for (int i = 0; i < count; ++i)
+            if (attribute[i] < 0) {
+                for (int j = 0; j < count; ++j)
+                    attribute[j] = -1;
+                return false;
+            }
+        return true;
+    };
+
+    const char* position_names[] = { "x", "y", "z" };
+    if (!find_attribute(layout.position, position_names, 3)) {
+        error = "Vertices have no positions";
+        return false;
+    }
+    const char* normal_names[] = { "nx", "ny", "nz" };
+    find_attribute(layout.normal, normal_names, 3);
+    const char* texcoord_names[][2] = { { "u", "v" }, { "s", "t" }, { "texture_u", "texture_v" }, { "texture_s", "texture_t" } };
+    for (auto& names : texcoord_names)
+        if (find_attribute(layout.texcoord, names, 2))
+            break;
+
+    const Element& face = *layout.face_element;
+    layout.indices = face.find_property("vertex_indices");
+    if (layout.indices < 0)
+        layout.indices = face.find_property("vertex_index");
+    if (layout.indices < 0 || !face.properties[layout.indices].is_list()) {
+        error = "Faces have no vertex index list";
+        return false;
+    }
+
+    // The elements are converted in parallel loops over signed indices.
+    if (vertex.count > 0x7FFFFFFFu || face.count > 0x7FFFFFFFu) {
+        error = "Too many vertices or faces";
+        return false;
+    }
+
+    return true;
+}
+
+static inline MeshFlags mesh_flags(const Layout& layout) {
+    // Normals are computed if the file doesn't contain any.
+    MeshFlags flags = { MeshFlag::Position, MeshFlag::Normal };
+    if (layout.texcoord[0] >= 0)
+        flags |= MeshFlag::Texcoord;
+    return flags;
+}
+
+// Triangulates a polygon as a fan. Indices outside the mesh are set to zero and counted.
+static inline unsigned int write_triangle_fan(const unsigned int* polygon, unsigned int polygon_size, unsigned int vertex_count, Vector3ui* primitives) {
+    unsigned int invalid_index_count = 0;
+    auto validate = [&](unsigned int index) -> unsigned int {
+        bool is_valid = index < vertex_count;
+        invalid_index_count += is_valid ? 0 : 1;
+        return is_valid ? index : 0;
+    };
+    for (unsigned int i = 2; i < polygon_size; ++i)
+        primitives[i - 2] = Vector3ui(validate(polygon[0]), validate(polygon[i - 1]), validate(polygon[i]));
+    return invalid_index_count;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Binary PLY.
+// ------------------------------------------------------------------------------------------------
+
+static inline double read_value(const unsigned char* data, PropertyType type, bool swap_bytes) {
+    unsigned char bytes[8];
+    int size = size_of(type);
+    if (swap_bytes)
+        for (int i = 0; i < size; ++i)
+            bytes[i] = data[size - 1 - i];
+    else
+        memcpy(bytes, data, size);
+
+    switch (type) {
+    case PropertyType::Int8: return double((signed char)bytes[0]);
+    case PropertyType::UInt8: return double(bytes[0]);
+    case PropertyType::Int16: { short v; memcpy(&v, bytes, sizeof(v)); return double(v); }
+    case PropertyType::UInt16: { unsigned short v; memcpy(&v, bytes, sizeof(v)); return double(v); }
+    case PropertyType::Int32: { int v; memcpy(&v, bytes, sizeof(v)); return double(v); }
+    case PropertyType::UInt32: { unsigned int v; memcpy(&v, bytes, sizeof(v)); return double(v); }
+    case PropertyType::Float32: { float v; memcpy(&v, bytes, sizeof(v)); return double(v); }
+    case PropertyType::Float64: { double v; memcpy(&v, bytes, sizeof(v)); return v; }
+    default: return 0.0;
+    }
+}
+
+static inline unsigned int read_index(const unsigned char* data, PropertyType type, bool swap_bytes) {
+    double index = read_value(data, type, swap_bytes);
+    return index >= 0.0 && index < 4294967296.0 ? (unsigned int)index : 0xFFFFFFFFu; // Negative indices are invalid.
+}
+
+// Returns the size of the element instance starting at data or 0 if it extends beyond the end.
+static inline size_t instance_size(const unsigned char* data, const unsigned char* end, const Element& element, bool swap_bytes) {
+    size_t size = 0;
+    for (const Property& property : element.properties) {
+        if (property.is_list()) {
+            if (data + size + size_of(property.count_type) > end)
+                return 0;
+            double count = read_value(data + size, property.count_type, swap_bytes);
+            size += size_of(property.count_type) + size_t(std::max(0.0, count)) * size_of(property.type);
+        } else
+            size += size_of(property.type);
+    }
+    return data + size <= end ? size : 0;
+}
+
+// Offset of the given property in an instance, assuming the preceding lists have the given size.
+static inline size_t property_offset(const Element& element, int property_index, size_t list_size) {
+    size_t offset = 0;
+    for (int p = 0; p < property_index; ++p)
+        offset += element.properties[p].is_list() ? size_of(element.properties[p].count_type) + list_size * size_of(element.properties[p].type)
+                                                  : size_of(element.properties[p].type);
+    return offset;
+}
+
+static Meshes::UID load_binary(const std::string& name, const unsigned char* body, const unsigned char* end,
+                               const std::vector<Element>& elements, const Layout& layout, bool swap_bytes, std::string& error) {
+    const Element& vertex = *layout.vertex_element;
+    const Element& face = *layout.face_element;
+    const Property& index_property = face.properties[layout.indices];
+
+    // Faces are converted in blocks, so faces with varying sizes can be converted in parallel once the block offsets are known.
+    const unsigned int faces_pr_block = 65536;
+    struct FaceBlock {
+        const unsigned char* data;
+        unsigned int triangle_offset;
+    };
+    std::vector<FaceBlock> face_blocks;
+    unsigned int triangle_count = 0;
+    bool all_triangles = false;
+    size_t triangle_face_size = 0;
+
+    // Find the data of each element.
+    const unsigned char* vertex_data = nullptr;
+    const unsigned char* element_data = body;
+    for (const Element& element : elements) {
+        bool has_lists = false;
+        size_t fixed_size = 0;
+        for (const Property& property : element.properties) {
+            has_lists |= property.is_list();
+            fixed_size += property.is_list() ? 0 : size_of(property.type);
+        }
+
+        if (&element == &vertex)
+            vertex_data = element_data;
+
+        if (&element == &face) {
+            // Fast path for triangle meshes. If all faces have three indices, the faces have a fixed size and can be converted in parallel directly.
+            int list_count = 0;
+            for (const Property& property : element.properties)
+                list_count += property.is_list() ? 1 : 0;
+            triangle_face_size = fixed_size + size_of(index_property.count_type) + 3 * size_of(index_property.type);
+            size_t count_offset = property_offset(face, layout.indices, 0);
+            if (list_count == 1 && size_t(end - element_data) >= face.count * triangle_face_size) {
+                int non_triangle_count = 0;
+                #pragma omp parallel for schedule(static) reduction(+:non_triangle_count)
+                for (int f = 0; f < int(face.count); ++f)
+                    non_triangle_count += read_value(element_data + size_t(f) * triangle_face_size + count_offset, index_property.count_type, swap_bytes) != 3.0 ? 1 : 0;
+                all_triangles = non_triangle_count == 0;
+            }
+
+            if (all_triangles) {
+                triangle_count = face.count;
+                face_blocks.push_back({ element_data, 0 });
+                element_data += face.count * triangle_face_size;
+                continue;
+            }
+
+            // Scan the face sizes serially and store the offset of every block of faces.
+            size_t index_offset = property_offset(face, layout.indices, 0);
+            for (unsigned int f = 0; f < face.count; ++f) {
+                if (f % faces_pr_block == 0)
+                    face_blocks.push_back({ element_data, triangle_count });
+                size_t size = instance_size(element_data, end, face, swap_bytes);
+                if (size == 0) {
+                    error = "Truncated face data";
+                    return Meshes::UID::invalid_UID();
+                }
+                double polygon_size = read_value(element_data + index_offset, index_property.count_type, swap_bytes);
+                triangle_count += polygon_size > 2.0 ? (unsigned int)polygon_size - 2 : 0;
+                element_data += size;
+            }
+        } else if (!has_lists) {
+            if (size_t(end - element_data) < element.count * fixed_size) {
+                error = "Truncated " + element.name + " data";
+                return Meshes::UID::invalid_UID();
+            }
+            element_data += element.count * fixed_size;
+        } else {
+            // Skip other elements with lists.
+            for (unsigned int i = 0; i < element.count; ++i) {
+                size_t size = instance_size(element_data, end, element, swap_bytes);
+                if (size == 0) {
+                    error = "Truncated " + element.name + " data";
+                    return Meshes::UID::invalid_UID();
+                }
+                element_data += size;
+            }
+        }
+    }
+
+    // The vertex element may not contain lists, as the vertices are converted in parallel.
+    size_t vertex_size = 0;
+    for (const Property& property : vertex.properties) {
+        if (property.is_list()) {
+            error = "Lists in the vertex element are not supported";
+            return Meshes::UID::invalid_UID();
+        }
+        vertex_size += size_of(property.type);
+    }
+
+    Mesh mesh = Meshes::create(name, triangle_count, vertex.count, mesh_flags(layout));
+
+    // Convert the vertices.
+    size_t position_offsets[3], normal_offsets[3], texcoord_offsets[2];
+    for (int i = 0; i < 3; ++i) {
+        position_offsets[i] = property_offset(vertex, layout.position[i], 0);
+        normal_offsets[i] = layout.normal[0] >= 0 ? property_offset(vertex, layout.normal[i], 0) : 0;
+    }
+    for (int i = 0; i < 2; ++i)
+        texcoord_offsets[i] = layout.texcoord[0] >= 0 ? property_offset(vertex, layout.texcoord[i], 0) : 0;
+
+    Vector3f* positions = mesh.get_positions();
+    Vector3f* normals = layout.normal[0] >= 0 ? mesh.get_normals() : nullptr;
+    Vector2f* texcoords = mesh.get_texcoords();
+    auto vertex_property_type = [&](int property) { return vertex.properties[property].type; };
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < int(vertex.count); ++v) {
+        const unsigned char* data = vertex_data + size_t(v) * vertex_size;
+        for (int i = 0; i < 3; ++i)
+            positions[v][i] = float(read_value(data + position_offsets[i], vertex_property_type(layout.position[i]), swap_bytes));
+        if (normals != nullptr)
+            for (int i = 0; i < 3; ++i)
+                normals[v][i] = float(read_value(data + normal_offsets[i], vertex_property_type(layout.normal[i]), swap_bytes));
+        if (texcoords != nullptr)
+            for (int i = 0; i < 2; ++i)
+                texcoords[v][i] = float(read_value(data + texcoord_offsets[i], vertex_property_type(layout.texcoord[i]), swap_bytes));
+    }
+
+    // Convert the faces.
+    Vector3ui* primitives = mesh.get_primitives();
+    unsigned int invalid_index_count = 0;
+    if (all_triangles) {
+        const unsigned char* face_data = face_blocks[0].data;
+        size_t indices_offset = property_offset(face, layout.indices, 0) + size_of(index_property.count_type);
+        int index_size = size_of(index_property.type);
+        #pragma omp parallel for schedule(static) reduction(+:invalid_index_count)
+        for (int f = 0; f < int(face.count); ++f) {
+            const unsigned char* indices = face_data + size_t(f) * triangle_face_size + indices_offset;
+            unsigned int triangle[3] = { read_index(indices, index_property.type, swap_bytes),
+                                         read_index(indices + index_size, index_property.type, swap_bytes),
+                                         read_index(indices + 2 * index_size, index_property.type, swap_bytes) };
+            invalid_index_count += write_triangle_fan(triangle, 3, vertex.count, primitives + f);
+        }
+    } else {
+        size_t count_offset = property_offset(face, layout.indices, 0);
+        int block_count = int(face_blocks.size());
+        #pragma omp parallel for schedule(dynamic, 1) reduction(+:invalid_index_count)
+        for (int b = 0; b < block_count; ++b) {
+            std::vector<unsigned int> polygon;
+            const unsigned char* face_data = face_blocks[b].data;
+            unsigned int triangle_index = face_blocks[b].triangle_offset;
+            unsigned int block_end = std::min(face.count, (b + 1) * faces_pr_block);
+            for (unsigned int f = b * faces_pr_block; f < block_end; ++f) {
+                double polygon_size = read_value(face_data + count_offset, index_property.count_type, swap_bytes);
+                polygon.resize(size_t(std::max(0.0, polygon_size)));
+                const unsigned char* indices = face_data + count_offset + size_of(index_property.count_type);
+                for (size_t i = 0; i < polygon.size(); ++i)
+                    polygon[i] = read_index(indices + i * size_of(index_property.type), index_property.type, swap_bytes);
+                invalid_index_count += write_triangle_fan(polygon.data(), (unsigned int)polygon.size(), vertex.count, primitives + triangle_index);
+                triangle_index += polygon.size() > 2 ? (unsigned int)polygon.size() - 2 : 0;
+                face_data += instance_size(face_data, end, face, swap_bytes);
+            }
+        }
+    }
+
+    if (invalid_index_count > 0)
+        printf("PlyLoader::load error: %u face indices referenced vertices outside the mesh in '%s'.\n", invalid_index_count, name.c_str());
+
+    return mesh.get_ID();
+}
+
+// ------------------------------------------------------------------------------------------------
+// ASCII PLY.
+// ------------------------------------------------------------------------------------------------
+
+// Parses the polygon of a face line. Returns false if the line is malformed.
+static bool parse_ascii_polygon(const char* c, const char* end, const Element& face, int indices_property, std::vector<unsigned int>& polygon) {
+    for (int p = 0; p <= indices_property; ++p) {
+        const Property& property = face.properties[p];
+        long long count = 1;
+        if (property.is_list() && !parse_int(c, end, count))
+            return false;
+
+        if (p == indices_property) {
+            polygon.resize(size_t(std::max(0ll, count)));
+            for (unsigned int& index : polygon) {
+                long long value;
+                if (!parse_int(c, end, value))
+                    return false;
+                index = value >= 0 && value <= 0xFFFFFFFFll ? (unsigned int)value : 0xFFFFFFFFu;
+            }
+        } else
+            for (long long i = 0; i < count; ++i) {
+                double value;
+                if (!parse_double(c, end, value))
+                    return false;
+            }
+    }
+    return true;
+}
+
+static Meshes::UID load_ascii(const std::string& name, const char* body, const char* end, const std::vector<Element>& elements,
+                              const Layout& layout, std::string& error) {
+    const Element& vertex = *layout.vertex_element;
+    const Element& face = *layout.face_element;
+
+    // Every element instance is on its own line, so the lines are parsed in parallel once the line offset of each chunk is known.
+    std::vector<const char*> chunks = split_into_chunks(body, end, [](const char*, const char*) { return true; });
+    int chunk_count = int(chunks.size()) - 1;
+
+    std::vector<unsigned int> line_offsets(chunk_count + 1, 0u);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunk_count; ++c) {
+        unsigned int line_count = 0;
+        for (const char* line = chunks[c]; line < chunks[c + 1]; line = next_line(line, chunks[c + 1]))
+            line_count += is_blank_line(line, chunks[c + 1]) ? 0 : 1;
+        line_offsets[c + 1] = line_count;
+    }
+    for (int c = 0; c < chunk_count; ++c)
+        line_offsets[c + 1] += line_offsets[c];
+
+    // The first line of each element.
+    std::vector<unsigned long long> element_lines(elements.size() + 1, 0ull);
+    for (size_t e = 0; e < elements.size(); ++e)
+        element_lines[e + 1] = element_lines[e] + elements[e].count;
+    const unsigned long long vertex_begin = element_lines[&vertex - elements.data()];
+    const unsigned long long face_begin = element_lines[&face - elements.data()];
+    if (line_offsets[chunk_count] < element_lines[elements.size()]) {
+        error = "Truncated element data";
+        return Meshes::UID::invalid_UID();
+    }
+
+    // Count the triangles of the faces in each chunk.
+    std::vector<unsigned int> triangle_offsets(chunk_count + 1, 0u);
+    unsigned int malformed_line_count = 0;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:malformed_line_count)
+    for (int c = 0; c < chunk_count; ++c) {
+        std::vector<unsigned int> polygon;
+        unsigned long long line_index = line_offsets[c];
+        unsigned int triangle_count = 0;
+        for (const char* line = chunks[c]; line < chunks[c + 1] && line_index < face_begin + face.count; line = next_line(line, chunks[c + 1])) {
+            if (is_blank_line(line, chunks[c + 1]))
+                continue;
+            if (line_index >= face_begin) {
+                if (parse_ascii_polygon(line, chunks[c + 1], face, layout.indices, polygon))
+                    triangle_count += polygon.size() > 2 ? (unsigned int)polygon.size() - 2 : 0;
+                else
+                    ++malformed_line_count;
+            }
+            ++line_index;
+        }
+        triangle_offsets[c + 1] = triangle_count;
+    }
+    for (int c = 0; c < chunk_count; ++c)
+        triangle_offsets[c + 1] += triangle_offsets[c];
+
+    Mesh mesh = Meshes::create(name, triangle_offsets[chunk_count], vertex.count, mesh_flags(layout));
+    Vector3f* positions = mesh.get_positions();
+    Vector3f* normals = layout.normal[0] >= 0 ? mesh.get_normals() : nullptr;
+    Vector2f* texcoords = mesh.get_texcoords();
+    Vector3ui* primitives = mesh.get_primitives();
+
+    // Map each vertex property to the attribute and component it is stored in, encoded as attribute * 4 + component.
+    // Attribute 1 is the position, 2 the normal and 3 the texcoord. Properties that aren't loaded are mapped to 0.
+    std::vector<int> vertex_property_components(vertex.properties.size(), 0);
+    auto set_components = [&](const int* attribute_properties, int component_count, int attribute) {
+        for (int i = 0; i < component_count; ++i)
+            if (attribute_properties[i] >= 0)
+                vertex_property_components[attribute_properties[i]] = attribute * 4 + i;
+    };
+    set_components(layout.position, 3, 1);
+    set_components(layout.normal, 3, 2);
+    set_components(layout.texcoord, 2, 3);
+
+    unsigned int invalid_index_count = 0;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:malformed_line_count, invalid_index_count)
+    for (int c = 0; c < chunk_count; ++c) {
+        std::vector<unsigned int> polygon;
+        unsigned long long line_index = line_offsets[c];
+        unsigned int triangle_index = triangle_offsets[c];
+        for (const char* line = chunks[c]; line < chunks[c + 1]; line = next_line(line, chunks[c + 1])) {
+            if (is_blank_line(line, chunks[c + 1]))
+                continue;
+
+            if (line_index >= vertex_begin && line_index < vertex_begin + vertex.count) {
+                unsigned long long v = line_index - vertex_begin;
+                const char* value_itr = line;
+                for (size_t p = 0; p < vertex.properties.size(); ++p) {
+                    long long count = 1;
+                    if (vertex.properties[p].is_list() && !parse_int(value_itr, chunks[c + 1], count)) {
+                        ++malformed_line_count;
+                        break;
+                    }
+                    bool malformed = false;
+                    for (long long i = 0; i < count; ++i) {
+                        double value;
+                        if (!parse_double(value_itr, chunks[c + 1], value)) {
+                            malformed = true;
+                            break;
+                        }
+                        int component = vertex_property_components[p];
+                        if (vertex.properties[p].is_list() || component == 0)
+                            continue;
+                        int attribute = component / 4, index = component % 4;
+                        if (attribute == 1)
+                            positions[v][index] = float(value);
+                        else if (attribute == 2 && normals != nullptr)
+                            normals[v][index] = float(value);
+                        else if (attribute == 3 && texcoords != nullptr)
+                            texcoords[v][index] = float(value);
+                    }
+                    if (malformed) {
+                        ++malformed_line_count;
+                        break;
+                    }
+                }
+            } else if (line_index >= face_begin && line_index < face_begin + face.count) {
+                // Malformed faces have already been counted and produce no triangles.
+                if (parse_ascii_polygon(line, chunks[c + 1], face, layout.indices, polygon) && polygon.size() > 2) {
+                    invalid_index_count += write_triangle_fan(polygon.data(), (unsigned int)polygon.size(), vertex.count, primitives + triangle_index);
+                    triangle_index += (unsigned int)polygon.size() - 2;
+                }
+            }
+            ++line_index;
+        }
+    }
+
+    if (malformed_line_count > 0)
+        printf("PlyLoader::load error: %u malformed element lines in '%s'.\n", malformed_line_count, name.c_str());
+    if (invalid_index_count > 0)
+        printf("PlyLoader::load error: %u face indices referenced vertices outside the mesh in '%s'.\n", invalid_index_count, name.c_str());
+
+    return mesh.get_ID();
+}
+
+// ------------------------------------------------------------------------------------------------
+// Loader.
+// ------------------------------------------------------------------------------------------------
+
+static std::string name_from_path(const std::string& path) {
+    size_t name_begin = path.find_last_of("/\\");
+    name_begin = name_begin == std::string::npos ? 0 : name_begin + 1;
+    size_t name_end = path.find_last_of('.');
+    return path.substr(name_begin, name_end > name_begin && name_end != std::string::npos ? name_end - name_begin : std::string::npos);
+}
+
+Meshes::UID load_mesh(const std::string& path) {
+    MemoryMappedFile file = MemoryMappedFile(path);
+    if (!file.is_open()) {
+        printf("PlyLoader::load error: Could not open '%s'.\n", path.c_str());
+        return Meshes::UID::invalid_UID();
+    }
+
+    const char* begin = (const char*)file.get_data();
+    const char* end = begin + file.get_size();
+    Format format;
+    std::vector<Element> elements;
+    Layout layout;
+    std::string error;
+    const char* body = parse_header(begin, end, format, elements, error);
+    if (body == nullptr || !resolve_layout(elements, layout, error)) {
+        printf("PlyLoader::load error: %s in '%s'.\n", error.c_str(), path.c_str());
+        return Meshes::UID::invalid_UID();
+    }
+
+    std::string name = name_from_path(path);
+    Meshes::UID mesh_ID;
+    if (format == Format::ASCII)
+        mesh_ID = load_ascii(name, body, end, elements, layout, error);
+    else {
+        // PLY files written on little endian machines are by far the most common, so only big endian data is swapped.
+        bool swap_bytes = format == Format::BinaryBigEndian;
+        mesh_ID = load_binary(name, (const unsigned char*)body, (const unsigned char*)end, elements, layout, swap_bytes, error);
+    }
+
+    if (mesh_ID == Meshes::UID::invalid_UID()) {
+        printf("PlyLoader::load error: %s in '%s'.\n", error.c_str(), path.c_str());
+        return Meshes::UID::invalid_UID();
+    }
+
+    if (layout.normal[0] < 0)
+        MeshUtils::compute_normals(mesh_ID);
+    Meshes::compute_bounds(mesh_ID);
+
+    return mesh_ID;
+}
+
+SceneNodes::UID load(const std::string& path) {
+    Meshes::UID mesh_ID = load_mesh(path);
+    if (mesh_ID == Meshes::UID::invalid_UID())
+        return SceneNodes::UID::invalid_UID();
+
+    // Vertex colors aren't supported, so a neutral grey material is created.
+    std::string name = Meshes::get_name(mesh_ID);
+    Materials::UID material_ID = Materials::create(name, Materials::Data::create_dielectric(RGB(0.5f), 0.5f, 0.04f));
+    SceneNodes::UID node_ID = SceneNodes::create(name);
+    MeshModels::create(node_ID, mesh_ID, material_ID);
+    return node_ID;
+}
+
+} // NS PlyLoader
@@ -0,0 +1,43 @@
+// Cogwheel PLY model loader.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_PLY_LOADER_H_
+#define _COGWHEEL_ASSETS_PLY_LOADER_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Scene/SceneNode.h>
+#include <string>
+
+namespace PlyLoader {
+
+// -----------------------------------------------------------------------
+// Loads the vertex and face elements of an ASCII or binary PLY file into
+// a mesh. Positions, normals and texcoords are loaded and polygons are
+// triangulated as fans. Normals are computed if the file has none.
+// The file is memory mapped and the mesh buffers are allocated from the
+// element counts in the header and filled in parallel, so the only
+// memory used besides the mesh is a small amount of bookkeeping.
+// * Binary vertices are converted in parallel. Faces are converted in
+//   parallel if all faces are triangles. Otherwise the face offsets are
+//   found in a serial scan over the face sizes before the faces are
+//   converted in parallel.
+// * ASCII files are split into chunks of lines, which are counted and
+//   then parsed in parallel.
+// Future work:
+// * Vertex colors, which Cogwheel meshes don't support yet.
+// * Point clouds, i.e. files without faces, are rejected.
+// Returns an invalid UID if the file could not be loaded.
+// -----------------------------------------------------------------------
+Cogwheel::Assets::Meshes::UID load_mesh(const std::string& filename);
+
+// Loads a PLY file as a mesh model on a scene node, which is returned.
+Cogwheel::Scene::SceneNodes::UID load(const std::string& filename);
+
+} // NS PlyLoader
+
+#endif // _COGWHEEL_ASSETS_PLY_LOADER_H_
@@ -0,0 +1,423 @@
+// Cogwheel STL model loader.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <ScanLoader/StlLoader.h>
+#include <ScanLoader/TextParsing.h>
+
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Core/MemoryMappedFile.h>
+#include <Cogwheel/Math/RNG.h>
+#include <Cogwheel/Math/Utils.h>
+
+#include <atomic>
+#include <memory>
+
+using namespace Cogwheel;
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Core;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Scene;
+using namespace ScanLoader::TextParsing;
+
+namespace StlLoader {
+
+// Binary STL files consist of an 80 byte header, the triangle count and the triangles.
+static const size_t binary_header_size = 80 + sizeof(unsigned int);
+static const size_t binary_triangle_size = 50; // Facet normal, three positions and a 16 bit attribute.
+
+static std::string name_from_path(const std::string& path) {
+    size_t name_begin = path.find_last_of("/\\");
+    name_begin = name_begin == std::string::npos ? 0 : name_begin + 1;
+    size_t name_end = path.find_last_of('.');
+    return path.substr(name_begin, name_end > name_begin && name_end != std::string::npos ? name_end - name_begin : std::string::npos);
+}
+
+static inline Vector3f read_vector3f(const unsigned char* data) {
+    Vector3f v;
+    memcpy(&v, data, sizeof(v));
+    return v;
+}
+
+// Facet normals are frequently left as zero by exporters, in which case the normal is computed from the winding order.
+static inline Vector3f compute_facet_normal(Vector3f normal, Vector3f p0, Vector3f p1, Vector3f p2) {
+    float length_squared = magnitude_squared(normal);
+    if (length_squared > 0.0f && length_squared < 1e30f)
+        return normal / sqrt(length_squared);
+
+    Vector3f winding_normal = cross(p1 - p0, p2 - p0);
+    float winding_length = magnitude(winding_normal);
+    return winding_length > 0.0f ? winding_normal / winding_length : Vector3f(0, 0, 1);
+}
+
+// Splits the triangles into contiguous chunks that are processed in parallel.
+static inline int triangle_chunk_count(unsigned int triangle_count) {
+    return std::max(1, std::min(8 * omp_get_max_threads(), int(triangle_count / 4096)));
+}
+
+static inline unsigned int chunk_begin(unsigned int triangle_count, int chunk_count, int chunk) {
+    return (unsigned int)((unsigned long long)triangle_count * chunk / chunk_count);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Welding.
+// ------------------------------------------------------------------------------------------------
+
+// Negative zero is mapped to positive zero, so positions can be compared and hashed by their bits.
+static inline Vector3f canonical_position(Vector3f position) {
+    return Vector3f(position.x + 0.0f, position.y + 0.0f, position.z + 0.0f);
+}
+
+static inline bool bitwise_equal(Vector3f lhs, Vector3f rhs) {
+    return memcmp(&lhs, &rhs, sizeof(Vector3f)) == 0;
+}
+
+static inline unsigned int hash_position(Vector3f position) {
+    unsigned int bits[3];
+    memcpy(bits, &position, sizeof(bits));
+    return RNG::jenkins_hash(RNG::teschner_hash(bits[0], bits[1], bits[2]));
+}
+
+// Welds the corners of a triangle soup with identical positions into a mesh with smooth normals.
+// The unique positions are inserted into an open addressing hash table in parallel. Each slot holds
+// the lowest index of the corners with that position, which makes the result independent of the
+// thread scheduling. The representative corners are then assigned vertex indices in corner order
+// and the slots are tagged with the vertex index, such that the primitives can be written by
+// looking up their corners.
+// The table refers to the corners through the position lookup, so the only allocations besides
+// the mesh are the table and the per chunk counters.
+template <typename PositionLookup>
+static Meshes::UID weld_triangle_soup(const std::string& name, unsigned int triangle_count, PositionLookup corner_position) {
+    const unsigned int empty_slot = 0xFFFFFFFFu;
+    const unsigned int vertex_tag = 0x80000000u; // Set on slots that hold a vertex index instead of a corner index.
+
+    auto position = [&](unsigned int corner) -> Vector3f { return canonical_position(corner_position(corner)); };
+    auto is_degenerate = [&](unsigned int triangle) -> bool {
+        Vector3f p0 = position(3 * triangle), p1 = position(3 * triangle + 1), p2 = position(3 * triangle + 2);
+        return bitwise_equal(p0, p1) || bitwise_equal(p1, p2) || bitwise_equal(p2, p0);
+    };
+
+    const int chunk_count = triangle_chunk_count(triangle_count);
+
+    // Count the triangles that are kept pr chunk.
+    std::vector<unsigned int> primitive_offsets(chunk_count + 1, 0u);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunk_count; ++c) {
+        unsigned int kept_triangle_count = 0;
+        for (unsigned int t = chunk_begin(triangle_count, chunk_count, c); t < chunk_begin(triangle_count, chunk_count, c + 1); ++t)
+            kept_triangle_count += is_degenerate(t) ? 0 : 1;
+        primitive_offsets[c + 1] = kept_triangle_count;
+    }
+    for (int c = 0; c < chunk_count; ++c)
+        primitive_offsets[c + 1] += primitive_offsets[c];
+    const unsigned int primitive_count = primitive_offsets[chunk_count];
+
+    // Closed meshes have roughly half as many vertices as triangles, so the initial table has a load
+    // factor of about one quarter. The table is grown if the positions turn out to be less shared.
+    size_t capacity = next_power_of_two(std::max(1024u, primitive_count));
+    std::unique_ptr<std::atomic<unsigned int>[]> slots;
+    size_t slot_mask;
+
+    auto read_slot_position = [&](unsigned int stored, const Vector3f* vertex_positions) -> Vector3f {
+        return (stored & vertex_tag) ? vertex_positions[stored & ~vertex_tag] : position(stored);
+    };
+    auto find_slot = [&](Vector3f p, const Vector3f* vertex_positions) -> size_t {
+        size_t slot = hash_position(p) & slot_mask;
+        while (!bitwise_equal(read_slot_position(slots[slot].load(std::memory_order_acquire), vertex_positions), p))
+            slot = (slot + 1) & slot_mask;
+        return slot;
+    };
+
+    bool table_full;
+    do {
+        slots.reset(new std::atomic<unsigned int>[capacity]);
+        slot_mask = capacity - 1;
+        const int clear_block_size = 1 << 16;
+        int clear_block_count = int((capacity + clear_block_size - 1) / clear_block_size);
+        #pragma omp parallel for schedule(static)
+        for (int b = 0; b < clear_block_count; ++b)
+            for (size_t s = size_t(b) * clear_block_size; s < std::min(capacity, size_t(b + 1) * clear_block_size); ++s)
+                slots[s].store(empty_slot, std::memory_order_relaxed);
+
+        const unsigned int max_unique_positions = (unsigned int)std::min<size_t>(capacity / 4 * 3, vertex_tag);
+        std::atomic<unsigned int> unique_position_count(0u);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int c = 0; c < chunk_count; ++c) {
+            for (unsigned int t = chunk_begin(triangle_count, chunk_count, c); t < chunk_begin(triangle_count, chunk_count, c + 1); ++t) {
+                if (unique_position_count.load(std::memory_order_relaxed) > max_unique_positions)
+                    break;
+                if (is_degenerate(t))
+                    continue;
+
+                for (unsigned int corner = 3 * t; corner < 3 * t + 3; ++corner) {
+                    Vector3f p = position(corner);
+                    size_t slot = hash_position(p) & slot_mask;
+                    while (true) {
+                        unsigned int stored = slots[slot].load(std::memory_order_relaxed);
+                        if (stored == empty_slot) {
+                            if (slots[slot].compare_exchange_strong(stored, corner, std::memory_order_relaxed)) {
+                                unique_position_count.fetch_add(1u, std::memory_order_relaxed);
+                                break;
+                            }
+                            // Another corner claimed the slot. Compare against it below.
+                        }
+                        if (bitwise_equal(position(stored), p)) {
+                            // Keep the lowest corner index as the representative.
+                            while (corner < stored && !slots[slot].compare_exchange_weak(stored, corner, std::memory_order_relaxed)) { }
+                            break;
+                        }
+                        slot = (slot + 1) & slot_mask;
+                    }
+                }
+            }
+        }
+
+        table_full = unique_position_count.load() > max_unique_positions;
+        capacity *= 2;
+    } while (table_full);
+
+    // Count the representative corners pr chunk. Their order defines the vertex order.
+    std::vector<unsigned int> vertex_offsets(chunk_count + 1, 0u);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunk_count; ++c) {
+        unsigned int representative_count = 0;
+        for (unsigned int t = chunk_begin(triangle_count, chunk_count, c); t < chunk_begin(triangle_count, chunk_count, c + 1); ++t)
+            if (!is_degenerate(t))
+                for (unsigned int corner = 3 * t; corner < 3 * t + 3; ++corner)
+                    representative_count += slots[find_slot(position(corner), nullptr)].load(std::memory_order_relaxed) == corner ? 1 : 0;
+        vertex_offsets[c + 1] = representative_count;
+    }
+    for (int c = 0; c < chunk_count; ++c)
+        vertex_offsets[c + 1] += vertex_offsets[c];
+    const unsigned int vertex_count = vertex_offsets[chunk_count];
+
+    Mesh mesh = Meshes::create(name, primitive_count, vertex_count, { MeshFlag::Position, MeshFlag::Normal });
+    Vector3f* positions = mesh.get_positions();
+    Vector3ui* primitives = mesh.get_primitives();
+
+    // Write the positions of the representatives and tag their slots with the vertex index.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunk_count; ++c) {
+        unsigned int vertex_index = vertex_offsets[c];
+        for (unsigned int t = chunk_begin(triangle_count, chunk_count, c); t < chunk_begin(triangle_count, chunk_count, c + 1); ++t)
+            if (!is_degenerate(t))
+                for (unsigned int corner = 3 * t; corner < 3 * t + 3; ++corner) {
+                    Vector3f p = position(corner);
+                    size_t slot = find_slot(p, positions);
+                    if (slots[slot].load(std::memory_order_relaxed) == corner) {
+                        positions[vertex_index] = p;
+                        slots[slot].store(vertex_index | vertex_tag, std::memory_order_release);
+                        ++vertex_index;
+                    }
+                }
+    }
+
+    // Write the primitives.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunk_count; ++c) {
+        unsigned int primitive_index = primitive_offsets[c];
+        for (unsigned int t = chunk_begin(triangle_count, chunk_count, c); t < chunk_begin(triangle_count, chunk_count, c + 1); ++t) {
+            if (is_degenerate(t))
+                continue;
+            unsigned int indices[3];
+            for (int i = 0; i < 3; ++i)
+                indices[i] = slots[find_slot(position(3 * t + i), positions)].load(std::memory_order_relaxed) & ~vertex_tag;
+            primitives[primitive_index++] = Vector3ui(indices[0], indices[1], indices[2]);
+        }
+    }
+    slots.reset();
+
+    MeshUtils::compute_normals(mesh.get_ID());
+    mesh.compute_bounds();
+
+    return mesh.get_ID();
+}
+
+// ------------------------------------------------------------------------------------------------
+// Binary STL.
+// ------------------------------------------------------------------------------------------------
+
+static Meshes::UID load_binary(const std::string& name, const unsigned char* data, unsigned int triangle_count, bool weld_vertices) {
+    const unsigned char* triangles = data + binary_header_size;
+
+    if (weld_vertices) {
+        auto corner_position = [=](unsigned int corner) -> Vector3f {
+            const unsigned char* triangle = triangles + (corner / 3) * binary_triangle_size;
+            return read_vector3f(triangle + sizeof(Vector3f) * (1 + corner % 3));
+        };
+        return weld_triangle_soup(name, triangle_count, corner_position);
+    }
+
+    Mesh mesh = Meshes::create(name, triangle_count, 3 * triangle_count, { MeshFlag::Position, MeshFlag::Normal });
+    Vector3ui* primitives = mesh.get_primitives();
+    Vector3f* positions = mesh.get_positions();
+    Vector3f* normals = mesh.get_normals();
+    #pragma omp parallel for schedule(static)
+    for (int t = 0; t < int(triangle_count); ++t) {
+        const unsigned char* triangle = triangles + t * binary_triangle_size;
+        Vector3f p0 = read_vector3f(triangle + 12), p1 = read_vector3f(triangle + 24), p2 = read_vector3f(triangle + 36);
+        Vector3f normal = compute_facet_normal(read_vector3f(triangle), p0, p1, p2);
+        positions[3 * t] = p0; positions[3 * t + 1] = p1; positions[3 * t + 2] = p2;
+        normals[3 * t] = normals[3 * t + 1] = normals[3 * t + 2] = normal;
+        primitives[t] = Vector3ui(3 * t, 3 * t + 1, 3 * t + 2);
+    }
+    mesh.compute_bounds();
+
+    return mesh.get_ID();
+}
+
+// ------------------------------------------------------------------------------------------------
+// ASCII STL.
+// ------------------------------------------------------------------------------------------------
+
+// Parses the facets in [begin, end) into the positions and normals, starting at the given triangle.
+// Returns the number of malformed facets.
+static unsigned int parse_facets(const char* begin, const char* end, unsigned int triangle_offset, Vector3f* positions, Vector3f* normals) {
+    unsigned int malformed_facet_count = 0;
+    long long triangle = (long long)triangle_offset - 1;
+    int corner = 3;
+    for (const char* line = begin; line < end; line = next_line(line, end)) {
+        const char* c = skip_spaces(line, end);
+        if (starts_with_token(c, end, "facet")) {
+            malformed_facet_count += corner != 3 ? 1 : 0;
+            ++triangle;
+            corner = 0;
+            positions[3 * triangle] = positions[3 * triangle + 1] = positions[3 * triangle + 2] = Vector3f::zero();
+
+            Vector3f normal = Vector3f::zero();
+            c = skip_spaces(c + 5, end);
+            if (starts_with_token(c, end, "normal")) {
+                c += 6;
+                if (!(parse_float(c, end, normal.x) && parse_float(c, end, normal.y) && parse_float(c, end, normal.z)))
+                    normal = Vector3f::zero();
+            }
+            if (normals != nullptr)
+                normals[3 * triangle] = normal;
+        } else if (starts_with_token(c, end, "vertex") && corner < 3) {
+            c += 6;
+            Vector3f position;
+            if (parse_float(c, end, position.x) && parse_float(c, end, position.y) && parse_float(c, end, position.z))
+                positions[3 * triangle + corner] = position;
+            ++corner;
+        }
+    }
+    malformed_facet_count += corner != 3 ? 1 : 0;
+    return malformed_facet_count;
+}
+
+static Meshes::UID load_ascii(const std::string& name, const char* text_begin, const char* text_end, bool weld_vertices) {
+    auto is_facet = [](const char* line, const char* end) -> bool { return starts_with_token(line, end, "facet"); };
+    std::vector<const char*> chunks = split_into_chunks(text_begin, text_end, is_facet);
+    int chunk_count = int(chunks.size()) - 1;
+
+    // Count the facets in each chunk to find the triangle offsets of the chunks.
+    std::vector<unsigned int> triangle_offsets(chunk_count + 1, 0u);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunk_count; ++c) {
+        unsigned int facet_count = 0;
+        for (const char* line = chunks[c]; line < chunks[c + 1]; line = next_line(line, chunks[c + 1]))
+            facet_count += is_facet(line, chunks[c + 1]) ? 1 : 0;
+        triangle_offsets[c + 1] = facet_count;
+    }
+    for (int c = 0; c < chunk_count; ++c)
+        triangle_offsets[c + 1] += triangle_offsets[c];
+    unsigned int triangle_count = triangle_offsets[chunk_count];
+    if (triangle_count == 0)
+        return Meshes::UID::invalid_UID();
+
+    // When welding, the soup is parsed into a temporary position buffer. Otherwise it is parsed directly into the mesh.
+    std::vector<Vector3f> soup_positions;
+    Meshes::UID mesh_ID = Meshes::UID::invalid_UID();
+    Vector3f* positions;
+    Vector3f* normals = nullptr;
+    if (weld_vertices) {
+        soup_positions.resize(3 * size_t(triangle_count));
+        positions = soup_positions.data();
+    } else {
+        mesh_ID = Meshes::create(name, triangle_count, 3 * triangle_count, { MeshFlag::Position, MeshFlag::Normal });
+        positions = Meshes::get_positions(mesh_ID);
+        normals = Meshes::get_normals(mesh_ID);
+    }
+
+    unsigned int malformed_facet_count = 0;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:malformed_facet_count)
+    for (int c = 0; c < chunk_count; ++c)
+        malformed_facet_count += parse_facets(chunks[c], chunks[c + 1], triangle_offsets[c], positions, normals);
+    if (malformed_facet_count > 0)
+        printf("StlLoader::load error: %u facets did not have three vertices in '%s'.\n", malformed_facet_count, name.c_str());
+
+    if (weld_vertices)
+        return weld_triangle_soup(name, triangle_count, [&](unsigned int corner) { return soup_positions[corner]; });
+
+    Vector3ui* primitives = Meshes::get_primitives(mesh_ID);
+    #pragma omp parallel for schedule(static)
+    for (int t = 0; t < int(triangle_count); ++t) {
+        Vector3f normal = compute_facet_normal(normals[3 * t], positions[3 * t], positions[3 * t + 1], positions[3 * t + 2]);
+        normals[3 * t] = normals[3 * t + 1] = normals[3 * t + 2] = normal;
+        primitives[t] = Vector3ui(3 * t, 3 * t + 1, 3 * t + 2);
+    }
+    Meshes::compute_bounds(mesh_ID);
+
+    return mesh_ID;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Loader.
+// ------------------------------------------------------------------------------------------------
+
+Meshes::UID load_mesh(const std::string& path, bool weld_vertices) {
+    MemoryMappedFile file = MemoryMappedFile(path);
+    if (!file.is_open()) {
+        printf("StlLoader::load error: Could not open '%s'.\n", path.c_str());
+        return Meshes::UID::invalid_UID();
+    }
+
+    const unsigned char* data = file.get_data();
+    size_t size = file.get_size();
+    std::string name = name_from_path(path);
+
+    // Binary files may also start with 'solid', so the file is only treated as ASCII if its size doesn't match the binary triangle count.
+    if (size >= binary_header_size) {
+        unsigned int triangle_count;
+        memcpy(&triangle_count, data + 80, sizeof(triangle_count));
+        if (size == binary_header_size + size_t(triangle_count) * binary_triangle_size) {
+            if (triangle_count == 0 || triangle_count > 0x7FFFFFFFu / 3) {
+                printf("StlLoader::load error: Unsupported triangle count %u in '%s'.\n", triangle_count, path.c_str());
+                return Meshes::UID::invalid_UID();
+            }
+            return load_binary(name, data, triangle_count, weld_vertices);
+        }
+    }
+
+    const char* text_begin = (const char*)data;
+    const char* text_end = text_begin + size;
+    if (starts_with_token(text_begin, text_end, "solid")) {
+        Meshes::UID mesh_ID = load_ascii(name, next_line(text_begin, text_end), text_end, weld_vertices);
+        if (mesh_ID == Meshes::UID::invalid_UID())
+            printf("StlLoader::load error: No facets found in '%s'.\n", path.c_str());
+        return mesh_ID;
+    }
+
+    printf("StlLoader::load error: '%s' is neither a binary nor an ASCII STL file.\n", path.c_str());
+    return Meshes::UID::invalid_UID();
+}
+
+SceneNodes::UID load(const std::string& path, bool weld_vertices) {
+    Meshes::UID mesh_ID = load_mesh(path, weld_vertices);
+    if (mesh_ID == Meshes::UID::invalid_UID())
+        return SceneNodes::UID::invalid_UID();
+
+    // STL files have no materials, so a neutral grey material is created.
+    std::string name = Meshes::get_name(mesh_ID);
+    Materials::UID material_ID = Materials::create(name, Materials::Data::create_dielectric(RGB(0.5f), 0.5f, 0.04f));
+    SceneNodes::UID node_ID = SceneNodes::create(name);
+    MeshModels::create(node_ID, mesh_ID, material_ID);
+    return node_ID;
+}
+
+} // NS StlLoader
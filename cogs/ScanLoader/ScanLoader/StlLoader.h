@@ -0,0 +1,40 @@
+// Cogwheel STL model loader.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_STL_LOADER_H_
+#define _COGWHEEL_ASSETS_STL_LOADER_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Scene/SceneNode.h>
+#include <string>
+
+namespace StlLoader {
+
+// -----------------------------------------------------------------------
+// Loads a binary or ASCII STL file into a mesh.
+// The file is memory mapped and the triangles are parsed in parallel
+// directly into the mesh buffers. ASCII files are split into chunks of
+// facets, which are counted and then parsed in parallel.
+// STL files are triangle soups. By default every triangle gets its own
+// three vertices with the facet normal, which matches the file exactly.
+// If weld_vertices is true, vertices with identical positions are welded
+// while loading, degenerate triangles are removed and smooth normals are
+// computed. Welding uses a concurrent hash table of the unique positions,
+// which refers to the vertices in the mapped file, so only the final mesh
+// and the table are allocated. ASCII files are parsed into a temporary
+// position buffer before welding.
+// Returns an invalid UID if the file could not be loaded.
+// -----------------------------------------------------------------------
+Cogwheel::Assets::Meshes::UID load_mesh(const std::string& filename, bool weld_vertices = false);
+
+// Loads an STL file as a mesh model on a scene node, which is returned.
+Cogwheel::Scene::SceneNodes::UID load(const std::string& filename, bool weld_vertices = false);
+
+} // NS StlLoader
+
+#endif // _COGWHEEL_ASSETS_STL_LOADER_H_
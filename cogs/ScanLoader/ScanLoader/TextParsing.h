@@ -0,0 +1,174 @@
+// Cogwheel text parsing utilities for the scan loaders.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_SCAN_LOADER_TEXT_PARSING_H_
+#define _COGWHEEL_ASSETS_SCAN_LOADER_TEXT_PARSING_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <omp.h>
+
+namespace ScanLoader {
+namespace TextParsing {
+
+// The parsers operate directly on memory mapped files, which are not null terminated,
+// so all functions take the end of the text as an argument.
+
+inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char* skip_spaces(const char* c, const char* end) {
+    while (c < end && is_space(*c))
+        ++c;
+    return c;
+}
+
+// Returns the beginning of the next line or the end of the text.
+inline const char* next_line(const char* c, const char* end) {
+    const char* newline = (const char*)memchr(c, '\n', end - c);
+    return newline == nullptr ? end : newline + 1;
+}
+
+inline bool is_blank_line(const char* c, const char* end) {
+    c = skip_spaces(c, end);
+    return c == end || *c == '\n';
+}
+
+// Checks if the first word of the line starting at c is the given token.
+inline bool starts_with_token(const char* c, const char* end, const char* token) {
+    c = skip_spaces(c, end);
+    size_t length = strlen(token);
+    if (size_t(end - c) < length || memcmp(c, token, length) != 0)
+        return false;
+    return c + length == end || is_space(c[length]) || c[length] == '\n';
+}
+
+// Parses a decimal integer and advances c past it. Leading spaces are skipped.
+// Integers that don't fit in a long long are clamped.
+inline bool parse_int(const char*& c, const char* end, long long& value) {
+    const long long max_value = 0x7FFFFFFFFFFFFFFFll;
+    const char* itr = skip_spaces(c, end);
+    bool negative = itr < end && *itr == '-';
+    if (itr < end && (*itr == '-' || *itr == '+'))
+        ++itr;
+    if (itr == end || *itr < '0' || *itr > '9')
+        return false;
+    long long v = 0;
+    while (itr < end && *itr >= '0' && *itr <= '9') {
+        int digit = *itr++ - '0';
+        v = v <= (max_value - digit) / 10 ? v * 10 + digit : max_value;
+    }
+    value = negative ? -v : v;
+    c = itr;
+    return true;
+}
+
+// Parses a decimal floating point number and advances c past it. Leading spaces are skipped.
+// The significant digits are accumulated in an integer and scaled by a power of ten in a single
+// multiplication, which is exact for the numbers written by scanning software and much faster
+// than strtod.
+inline bool parse_double(const char*& c, const char* end, double& value) {
+    static const double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char* itr = skip_spaces(c, end);
+    bool negative = itr < end && *itr == '-';
+    if (itr < end && (*itr == '-' || *itr == '+'))
+        ++itr;
+
+    unsigned long long mantissa = 0;
+    int exponent = 0;
+    int significant_digits = 0;
+    bool has_digits = false;
+    while (itr < end && *itr >= '0' && *itr <= '9') {
+        if (significant_digits < 19) {
+            mantissa = mantissa * 10 + (*itr - '0');
+            significant_digits += mantissa != 0 ? 1 : 0;
+        } else
+            ++exponent; // Ignore digits beyond the precision of the mantissa.
+        has_digits = true;
+        ++itr;
+    }
+    if (itr < end && *itr == '.') {
+        ++itr;
+        while (itr < end && *itr >= '0' && *itr <= '9') {
+            if (significant_digits < 19) {
+                mantissa = mantissa * 10 + (*itr - '0');
+                significant_digits += mantissa != 0 ? 1 : 0;
+                --exponent;
+            }
+            has_digits = true;
+            ++itr;
+        }
+    }
+    if (!has_digits)
+        return false;
+
+    if (itr < end && (*itr == 'e' || *itr == 'E')) {
+        const char* exponent_itr = itr + 1;
+        long long explicit_exponent;
+        if (parse_int(exponent_itr, end, explicit_exponent) && exponent_itr > itr + 1 && !is_space(itr[1])) {
+            exponent += int(std::max(-1000ll, std::min(explicit_exponent, 1000ll)));
+            itr = exponent_itr;
+        }
+    }
+
+    double v = double(mantissa);
+    if (mantissa != 0 && exponent != 0) {
+        if (exponent > 0 && exponent <= 22)
+            v *= powers_of_ten[exponent];
+        else if (exponent < 0 && exponent >= -22)
+            v /= powers_of_ten[-exponent];
+        else
+            v *= pow(10.0, double(exponent));
+    }
+    value = negative ? -v : v;
+    c = itr;
+    return true;
+}
+
+inline bool parse_float(const char*& c, const char* end, float& value) {
+    double v;
+    bool parsed = parse_double(c, end, v);
+    value = float(v);
+    return parsed;
+}
+
+// Splits the text into chunks that can be parsed in parallel.
+// Each chunk, except the first, starts at the beginning of a line for which is_chunk_start(line, end) returns true.
+// Returns the chunk boundaries, i.e. chunk i spans [boundaries[i], boundaries[i+1]).
+template <typename Predicate>
+std::vector<const char*> split_into_chunks(const char* begin, const char* end, Predicate is_chunk_start) {
+    const size_t min_chunk_size = 1 << 16;
+    size_t size = end - begin;
+    size_t chunk_count = std::max<size_t>(1, std::min<size_t>(8 * omp_get_max_threads(), size / min_chunk_size));
+
+    std::vector<const char*> boundaries(chunk_count + 1);
+    boundaries[0] = begin;
+    boundaries[chunk_count] = end;
+    #pragma omp parallel for schedule(static)
+    for (int i = 1; i < int(chunk_count); ++i) {
+        const char* c = next_line(begin + size * i / chunk_count, end);
+        while (c < end && !is_chunk_start(c, end))
+            c = next_line(c, end);
+        boundaries[i] = c;
+    }
+
+    // Chunks may end up empty if the chunk starts are far apart, but must never overlap.
+    for (size_t i = 1; i < chunk_count; ++i)
+        boundaries[i] = std::max(boundaries[i], boundaries[i - 1]);
+
+    return boundaries;
+}
+
+} // NS TextParsing
+} // NS ScanLoader
+
+#endif // _COGWHEEL_ASSETS_SCAN_LOADER_TEXT_PARSING_H_
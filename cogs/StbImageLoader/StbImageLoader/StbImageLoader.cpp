@@ -63,32 +63,27 @@ unsigned int sizeof_format(PixelFormat format) {
     return 0u;
 }
 
-Images::UID load(const std::string& path) {
-    
-    stbi_set_flip_vertically_on_load(true);
-
-    void* loaded_data = nullptr;
-    int width, height, channel_count;
-    bool is_HDR = check_HDR_fileformat(path);
-    if (is_HDR)
-        loaded_data = stbi_loadf(path.c_str(), &width, &height, &channel_count, 0);
-    else
-        loaded_data = stbi_load(path.c_str(), &width, &height, &channel_count, 0);
-
-    if (loaded_data == nullptr) {
-        printf("StbImageLoader::load(%s) failed with error: '%s'\n", path.c_str(), stbi_failure_reason());
-        return Images::UID::invalid_UID();
-    }
+// Images are always flipped vertically on load, as Cogwheel's origin is the lower left corner.
+// The flag is global in stb, so it is set once at startup instead of pr load, which allows images to be loaded concurrently.
+static const int flip_vertically_on_load = (stbi_set_flip_vertically_on_load(true), 1);
 
+static Images::UID create_image(const std::string& name, void* loaded_data, int width, int height, int channel_count, bool is_HDR) {
     PixelFormat pixel_format = resolve_format(channel_count, is_HDR);
     if (pixel_format == PixelFormat::Unknown) {
-        printf("StbImageLoader::load(%s) failed with error: 'Could not resolve format'\n", path.c_str());
+        printf("StbImageLoader::load(%s) failed with error: 'Could not resolve format'\n", name.c_str());
+        stbi_image_free(loaded_data);
         return Images::UID::invalid_UID();
     }
 
     float image_gamma = is_HDR ? 1.0f : 2.2f;
-    Images::UID image_ID = Images::create2D(path, pixel_format, image_gamma, Vector2ui(width, height));
-    Images::PixelData pixel_data = Images::get_pixels(image_ID);
+    // Creating an image can grow the image manager, so the pixel pointer is fetched while no other thread can create images.
+    Images::UID image_ID;
+    Images::PixelData pixel_data;
+    #pragma omp critical
+    {
+        image_ID = Images::create2D(name, pixel_format, image_gamma, Vector2ui(width, height));
+        pixel_data = Images::get_pixels(image_ID);
+    }
     if (channel_count == 2) {
         unsigned char* pixel_data_uc4 = (unsigned char*)pixel_data;
         unsigned char* loaded_data_uc2 = (unsigned char*)loaded_data;
@@ -106,4 +101,40 @@ Images::UID load(const std::string& path) {
     return image_ID;
 }
 
+Images::UID load(const std::string& path) {
+
+    void* loaded_data = nullptr;
+    int width, height, channel_count;
+    bool is_HDR = check_HDR_fileformat(path);
+    if (is_HDR)
+        loaded_data = stbi_loadf(path.c_str(), &width, &height, &channel_count, 0);
+    else
+        loaded_data = stbi_load(path.c_str(), &width, &height, &channel_count, 0);
+
+    if (loaded_data == nullptr) {
+        printf("StbImageLoader::load(%s) failed with error: '%s'\n", path.c_str(), stbi_failure_reason());
+        return Images::UID::invalid_UID();
+    }
+
+    return create_image(path, loaded_data, width, height, channel_count, is_HDR);
+}
+
+Images::UID load_from_memory(const std::string& name, const unsigned char* data, size_t byte_count) {
+
+    void* loaded_data = nullptr;
+    int width, height, channel_count;
+    bool is_HDR = stbi_is_hdr_from_memory(data, int(byte_count)) != 0;
+    if (is_HDR)
+        loaded_data = stbi_loadf_from_memory(data, int(byte_count), &width, &height, &channel_count, 0);
+    else
+        loaded_data = stbi_load_from_memory(data, int(byte_count), &width, &height, &channel_count, 0);
+
+    if (loaded_data == nullptr) {
+        printf("StbImageLoader::load_from_memory(%s) failed with error: '%s'\n", name.c_str(), stbi_failure_reason());
+        return Images::UID::invalid_UID();
+    }
+
+    return create_image(name, loaded_data, width, height, channel_count, is_HDR);
+}
+
 } // NS StbImageLoader
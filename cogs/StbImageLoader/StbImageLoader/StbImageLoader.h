@@ -20,6 +20,12 @@ namespace StbImageLoader {
 // -----------------------------------------------------------------------
 Cogwheel::Assets::Images::UID load(const std::string& filename);
 
+// -----------------------------------------------------------------------
+// Loads an image from an encoded file in memory, e.g. a png embedded in
+// another file. Both load functions can be called concurrently.
+// -----------------------------------------------------------------------
+Cogwheel::Assets::Images::UID load_from_memory(const std::string& name, const unsigned char* data, size_t byte_count);
+
 } // NS StbImageLoader
 
 #endif // _COGWHEEL_ASSETS_STB_IMAGE_LOADER_H_
\ No newline at end of file
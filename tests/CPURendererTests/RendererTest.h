@@ -0,0 +1,288 @@
+// Test the CPU path tracer.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _CPURENDERER_RENDERER_TEST_H_
+#define _CPURENDERER_RENDERER_TEST_H_
+
+#include <Utils.h>
+
+#include <CPURenderer/Renderer.h>
+#include <CPURenderer/Shading/ShadingModels/DefaultShading.h>
+
+#include <Cogwheel/Assets/Image.h>
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Assets/Texture.h>
+#include <Cogwheel/Math/TBN.h>
+#include <Cogwheel/Scene/Camera.h>
+#include <Cogwheel/Scene/LightSource.h>
+#include <Cogwheel/Scene/SceneRoot.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace CPURenderer {
+
+class CPURenderer_Renderer : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        using namespace Cogwheel;
+        Core::Renderers::allocate(2u);
+        Assets::Images::allocate(1u);
+        Assets::Materials::allocate(2u);
+        Assets::Meshes::allocate(1u);
+        Assets::MeshModels::allocate(1u);
+        Assets::Textures::allocate(1u);
+        Scene::Cameras::allocate(1u);
+        Scene::LightSources::allocate(1u);
+        Scene::SceneNodes::allocate(4u);
+        Scene::SceneRoots::allocate(1u);
+    }
+    virtual void TearDown() {
+        using namespace Cogwheel;
+        Core::Renderers::deallocate();
+        Assets::Images::deallocate();
+        Assets::Materials::deallocate();
+        Assets::Meshes::deallocate();
+        Assets::MeshModels::deallocate();
+        Assets::Textures::deallocate();
+        Scene::Cameras::deallocate();
+        Scene::LightSources::deallocate();
+        Scene::SceneNodes::deallocate();
+        Scene::SceneRoots::deallocate();
+    }
+
+    // Creates a camera one unit above the origin looking straight down.
+    static Cogwheel::Scene::Cameras::UID create_camera(Cogwheel::Scene::SceneRoots::UID scene_ID, Cogwheel::Core::Renderers::UID renderer_ID) {
+        using namespace Cogwheel::Math;
+        using namespace Cogwheel::Scene;
+
+        Matrix4x4f projection_matrix, inverse_projection_matrix;
+        CameraUtils::compute_perspective_projection(0.1f, 100.0f, PI<float>() / 4.0f, 1.0f, projection_matrix, inverse_projection_matrix);
+        Cameras::UID camera_ID = Cameras::create("Camera", scene_ID, projection_matrix, inverse_projection_matrix, renderer_ID);
+        Cameras::set_transform(camera_ID, Transform(Vector3f(0.0f, 1.0f, 0.0f), Quaternionf::look_in(-Vector3f::up(), Vector3f::forward())));
+        return camera_ID;
+    }
+};
+
+TEST_F(CPURenderer_Renderer, environment_tint) {
+    using namespace Cogwheel::Math;
+    using namespace Cogwheel::Scene;
+
+    Renderer* renderer = Renderer::initialize();
+    RGB environment_tint = RGB(0.5f, 0.25f, 1.0f);
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", environment_tint);
+    Cameras::UID camera_ID = create_camera(scene_ID, renderer->get_ID());
+    renderer->handle_updates();
+
+    const int width = 5, height = 4;
+    std::vector<RGBA> image(width * height);
+    EXPECT_EQ(1u, renderer->render(camera_ID, image.data(), width, height));
+    EXPECT_EQ(2u, renderer->render(camera_ID, image.data(), width, height));
+    for (RGBA pixel : image)
+        EXPECT_RGB_EQ_EPS(environment_tint, pixel.rgb(), 0.00001f);
+
+    // Changing the resolution restarts the accumulation.
+    image.resize(height * width * 4);
+    EXPECT_EQ(1u, renderer->render(camera_ID, image.data(), width * 2, height * 2));
+
+    delete renderer;
+}
+
+TEST_F(CPURenderer_Renderer, ignore_cameras_of_other_renderers) {
+    using namespace Cogwheel;
+    using namespace Cogwheel::Math;
+    using namespace Cogwheel::Scene;
+
+    Core::Renderers::UID other_renderer_ID = Core::Renderers::create("OtherRenderer");
+    Renderer* renderer = Renderer::initialize();
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", RGB::white());
+    Cameras::UID camera_ID = create_camera(scene_ID, other_renderer_ID);
+    renderer->handle_updates();
+
+    RGBA pixel = RGBA(RGB::black(), 0.0f);
+    EXPECT_EQ(0u, renderer->render(camera_ID, &pixel, 1, 1));
+    EXPECT_EQ(0.0f, pixel.a);
+
+    delete renderer;
+}
+
+TEST_F(CPURenderer_Renderer, directional_light_on_plane) {
+    using namespace Cogwheel;
+    using namespace Cogwheel::Assets;
+    using namespace Cogwheel::Math;
+    using namespace Cogwheel::Scene;
+
+    Renderer* renderer = Renderer::initialize();
+    renderer->set_max_bounce_count(1u); // Only direct light.
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", RGB::black());
+    SceneNodes::UID root_node_ID = SceneRoots::get_root_node(scene_ID);
+
+    Materials::Data material_data = Materials::Data::create_dielectric(RGB(0.5f, 0.75f, 0.25f), 0.7f, 0.25f);
+    Materials::UID material_ID = Materials::create("Plastic", material_data);
+    SceneNodes::UID plane_node_ID = SceneNodes::create("Plane", Transform(Vector3f::zero(), Quaternionf::identity(), 10.0f));
+    SceneNodes::set_parent(plane_node_ID, root_node_ID);
+    MeshModels::create(plane_node_ID, MeshCreation::plane(1), material_ID);
+
+    RGB light_radiance = RGB(2.0f);
+    Vector3f light_direction = normalize(Vector3f(1.0f, -1.0f, 0.0f));
+    SceneNodes::UID light_node_ID = SceneNodes::create("Light", Transform(Vector3f::zero(), Quaternionf::look_in(light_direction)));
+    SceneNodes::set_parent(light_node_ID, root_node_ID);
+    LightSources::create_directional_light(light_node_ID, light_radiance);
+
+    Cameras::UID camera_ID = create_camera(scene_ID, renderer->get_ID());
+    renderer->handle_updates();
+
+    // The first sample is taken through the pixel centers, so the center pixel sees the plane head on.
+    const int size = 9;
+    std::vector<RGBA> image(size * size);
+    renderer->render(camera_ID, image.data(), size, size);
+    RGB center_pixel = image[size / 2 + (size / 2) * size].rgb();
+
+    Material material_params = {};
+    material_params.tint = material_data.tint;
+    material_params.roughness = material_data.roughness;
+    material_params.specularity = material_data.specularity;
+    material_params.metallic = material_data.metallic;
+    material_params.coverage = material_data.coverage;
+    TBN tbn = TBN(Vector3f::up());
+    Vector3f wo = tbn * Vector3f::up();
+    Vector3f wi = tbn * -light_direction;
+    auto material = Shading::ShadingModels::DefaultShading(material_params, wo.z, Vector2f::zero());
+    RGB expected_radiance = material.evaluate(wo, wi) * light_radiance * wi.z;
+    EXPECT_RGB_EQ_EPS(expected_radiance, center_pixel, 0.0001f);
+
+    delete renderer;
+}
+
+TEST_F(CPURenderer_Renderer, wavefront_matches_recursive) {
+    using namespace Cogwheel;
+    using namespace Cogwheel::Assets;
+    using namespace Cogwheel::Math;
+    using namespace Cogwheel::Scene;
+
+    Renderer* renderer = Renderer::initialize();
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", RGB(0.2f, 0.3f, 0.4f));
+    SceneNodes::UID root_node_ID = SceneRoots::get_root_node(scene_ID);
+
+    // A partially covered plane with a sphere on top, lit by a sphere light.
+    Materials::Data plane_material_data = Materials::Data::create_dielectric(RGB(0.5f), 0.6f, 0.25f);
+    plane_material_data.coverage = 0.75f;
+    Materials::UID plane_material_ID = Materials::create("Plane material", plane_material_data);
+    SceneNodes::UID plane_node_ID = SceneNodes::create("Plane", Transform(Vector3f::zero(), Quaternionf::identity(), 4.0f));
+    SceneNodes::set_parent(plane_node_ID, root_node_ID);
+    MeshModels::create(plane_node_ID, MeshCreation::plane(1), plane_material_ID);
+
+    Materials::UID sphere_material_ID = Materials::create("Sphere material", Materials::Data::create_metal(RGB(1.0f, 0.766f, 0.336f), 0.2f, 0.25f));
+    SceneNodes::UID sphere_node_ID = SceneNodes::create("Sphere", Transform(Vector3f(0.1f, 0.1f, 0.0f), Quaternionf::identity(), 0.2f));
+    SceneNodes::set_parent(sphere_node_ID, root_node_ID);
+    MeshModels::create(sphere_node_ID, MeshCreation::revolved_sphere(16, 8), sphere_material_ID);
+
+    SceneNodes::UID light_node_ID = SceneNodes::create("Light", Transform(Vector3f(-0.3f, 0.5f, 0.2f)));
+    SceneNodes::set_parent(light_node_ID, root_node_ID);
+    LightSources::create_sphere_light(light_node_ID, RGB(4.0f), 0.1f);
+
+    Cameras::UID camera_ID = create_camera(scene_ID, renderer->get_ID());
+    renderer->handle_updates();
+
+    // The paths are seeded pr pixel, so both modes trace the exact same paths.
+    const int size = 16;
+    std::vector<RGBA> recursive_image(size * size), wavefront_image(size * size);
+    for (int i = 0; i < 2; ++i)
+        renderer->render(camera_ID, recursive_image.data(), size, size);
+
+    renderer->set_tracing_mode(Renderer::TracingMode::Wavefront);
+    renderer->set_max_bounce_count(renderer->get_max_bounce_count()); // Restart accumulation.
+    for (int i = 0; i < 2; ++i)
+        renderer->render(camera_ID, wavefront_image.data(), size, size);
+
+    for (int p = 0; p < size * size; ++p)
+        EXPECT_RGB_EQ_EPS(recursive_image[p].rgb(), wavefront_image[p].rgb(), 0.00001f);
+
+    delete renderer;
+}
+
+TEST_F(CPURenderer_Renderer, scene_created_before_renderer) {
+    using namespace Cogwheel;
+    using namespace Cogwheel::Assets;
+    using namespace Cogwheel::Math;
+    using namespace Cogwheel::Scene;
+
+    // Scene with a tinted environment.
+    RGB environment_tint = RGB(0.5f, 0.25f, 1.0f);
+    SceneRoots::UID sky_scene_ID = SceneRoots::create("Sky", environment_tint);
+
+    // Scene with a directional light above a plane made of a triangle soup without normals.
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", RGB::black());
+    SceneNodes::UID root_node_ID = SceneRoots::get_root_node(scene_ID);
+
+    Materials::Data material_data = Materials::Data::create_dielectric(RGB(0.5f, 0.75f, 0.25f), 0.7f, 0.25f);
+    Materials::UID material_ID = Materials::create("Plastic", material_data);
+    Mesh plane = Meshes::create("Plane", 0u, 6u, MeshFlag::Position);
+    Vector3f corners[] = { Vector3f(-5.0f, 0.0f, -5.0f), Vector3f(-5.0f, 0.0f, 5.0f), Vector3f(5.0f, 0.0f, 5.0f), Vector3f(5.0f, 0.0f, -5.0f) };
+    unsigned int corner_indices[] = { 0, 1, 2, 0, 2, 3 };
+    for (int v = 0; v < 6; ++v)
+        plane.get_positions()[v] = corners[corner_indices[v]];
+    plane.compute_bounds();
+    SceneNodes::UID plane_node_ID = SceneNodes::create("Plane");
+    SceneNodes::set_parent(plane_node_ID, root_node_ID);
+    MeshModels::create(plane_node_ID, plane.get_ID(), material_ID);
+
+    RGB light_radiance = RGB(2.0f);
+    Vector3f light_direction = normalize(Vector3f(1.0f, -1.0f, 0.0f));
+    SceneNodes::UID light_node_ID = SceneNodes::create("Light", Transform(Vector3f::zero(), Quaternionf::look_in(light_direction)));
+    SceneNodes::set_parent(light_node_ID, root_node_ID);
+    LightSources::create_directional_light(light_node_ID, light_radiance);
+
+    // The renderer is created after the scene has been processed, so it only sees the scene on construction.
+    Materials::reset_change_notifications();
+    Meshes::reset_change_notifications();
+    MeshModels::reset_change_notifications();
+    SceneNodes::reset_change_notifications();
+    SceneRoots::reset_change_notifications();
+    LightSources::reset_change_notifications();
+
+    Renderer* renderer = Renderer::initialize();
+    renderer->set_max_bounce_count(1u); // Only direct light.
+    Cameras::UID sky_camera_ID = create_camera(sky_scene_ID, renderer->get_ID());
+    Cameras::set_transform(sky_camera_ID, Transform(Vector3f(0.0f, 1.0f, 0.0f), Quaternionf::look_in(Vector3f::up(), Vector3f::forward())));
+    Cameras::UID camera_ID = create_camera(scene_ID, renderer->get_ID());
+    renderer->handle_updates();
+
+    const int size = 9;
+    std::vector<RGBA> image(size * size);
+    renderer->render(sky_camera_ID, image.data(), size, size);
+    for (RGBA pixel : image)
+        EXPECT_RGB_EQ_EPS(environment_tint, pixel.rgb(), 0.00001f);
+
+    // The first sample is taken through the pixel centers, so the center pixel sees the plane head on.
+    renderer->render(camera_ID, image.data(), size, size);
+    RGB center_pixel = image[size / 2 + (size / 2) * size].rgb();
+
+    Material material_params = {};
+    material_params.tint = material_data.tint;
+    material_params.roughness = material_data.roughness;
+    material_params.specularity = material_data.specularity;
+    material_params.metallic = material_data.metallic;
+    material_params.coverage = material_data.coverage;
+    TBN tbn = TBN(Vector3f::up());
+    Vector3f wo = tbn * Vector3f::up();
+    Vector3f wi = tbn * -light_direction;
+    auto material = Shading::ShadingModels::DefaultShading(material_params, wo.z, Vector2f::zero());
+    RGB expected_radiance = material.evaluate(wo, wi) * light_radiance * wi.z;
+    EXPECT_RGB_EQ_EPS(expected_radiance, center_pixel, 0.0001f);
+
+    delete renderer;
+}
+
+} // NS CPURenderer
+
+#endif // _CPURENDERER_RENDERER_TEST_H_
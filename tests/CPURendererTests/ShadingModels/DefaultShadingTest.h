@@ -0,0 +1,106 @@
+// Test CPURenderer's default shading model.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _CPURENDERER_SHADING_MODEL_DEFAULT_TEST_H_
+#define _CPURENDERER_SHADING_MODEL_DEFAULT_TEST_H_
+
+#include <Utils.h>
+
+#include <CPURenderer/Shading/ShadingModels/DefaultShading.h>
+
+#include <Cogwheel/Math/RNG.h>
+#include <Cogwheel/Math/Utils.h>
+
+#include <gtest/gtest.h>
+
+namespace CPURenderer {
+
+inline Material plastic_parameters() {
+    Material plastic_params = {};
+    plastic_params.tint = Cogwheel::Math::RGB(0.02f, 0.27f, 0.33f);
+    plastic_params.roughness = 0.7f;
+    plastic_params.metallic = 0.0f;
+    plastic_params.specularity = 0.25f;
+    plastic_params.coverage = 1.0f;
+    return plastic_params;
+}
+
+GTEST_TEST(DefaultShadingModel, power_conservation) {
+    using namespace Cogwheel::Math;
+    using namespace Shading::ShadingModels;
+
+    const unsigned int MAX_SAMPLES = 4096u;
+
+    // A white material to stress test power_conservation.
+    Material material_params = plastic_parameters();
+    material_params.tint = RGB::white();
+
+    for (int i = 0; i < 10; ++i) {
+        const Vector3f wo = normalize(Vector3f(float(i), 0.0f, 1.001f - float(i) * 0.1f));
+        auto material = DefaultShading(material_params, wo.z, Vector2f::zero());
+        float ws[MAX_SAMPLES];
+        for (unsigned int s = 0u; s < MAX_SAMPLES; ++s) {
+            Vector2f sample_xy = RNG::sample02(s);
+            BSDFSample sample = material.sample_all(wo, Vector3f(sample_xy.x, sample_xy.y, float(s) / float(MAX_SAMPLES)));
+            if (is_PDF_valid(sample.PDF))
+                ws[s] = sample.weight.r * sample.direction.z / sample.PDF; // f * ||cos_theta|| / pdf
+            else
+                ws[s] = 0.0f;
+        }
+
+        float average_w = sort_and_pairwise_summation(ws, ws + MAX_SAMPLES) / float(MAX_SAMPLES);
+        EXPECT_LE(average_w, 1.0011f);
+    }
+}
+
+GTEST_TEST(DefaultShadingModel, consistent_PDF) {
+    using namespace Cogwheel::Math;
+    using namespace Shading::ShadingModels;
+
+    // This test can only be performed with rough materials, as the PDF of smooth materials 
+    // is highly sensitive to floating point precision.
+    const Vector3f wo = normalize(Vector3f(1.0f, 0.0f, 1.0f));
+    auto material = DefaultShading(plastic_parameters(), wo.z, Vector2f::zero());
+
+    const unsigned int MAX_SAMPLES = 64;
+    for (unsigned int i = 0u; i < MAX_SAMPLES; ++i) {
+        Vector2f sample_xy = RNG::sample02(i);
+        BSDFSample sample = material.sample_all(wo, Vector3f(sample_xy.x, sample_xy.y, float(i) / float(MAX_SAMPLES)));
+        if (is_PDF_valid(sample.PDF)) {
+            float PDF = material.PDF(wo, sample.direction);
+            EXPECT_TRUE(almost_equal_eps(sample.PDF, PDF, 0.0001f));
+        }
+    }
+}
+
+GTEST_TEST(DefaultShadingModel, evaluate_with_PDF) {
+    using namespace Cogwheel::Math;
+    using namespace Shading::ShadingModels;
+
+    const unsigned int MAX_SAMPLES = 128u;
+    const Vector3f wo = normalize(Vector3f(1.0f, 1.0f, 1.0f));
+    Material plastic_params = plastic_parameters();
+
+    for (int a = 0; a < 11; ++a) {
+        plastic_params.roughness = lerp(0.2f, 1.0f, a / 10.0f);
+        auto plastic_material = DefaultShading(plastic_params, wo.z, Vector2f::zero());
+        for (unsigned int i = 0u; i < MAX_SAMPLES; ++i) {
+            Vector2f sample_xy = RNG::sample02(i);
+            BSDFSample sample = plastic_material.sample_all(wo, Vector3f(sample_xy.x, sample_xy.y, float(i) / float(MAX_SAMPLES)));
+            if (is_PDF_valid(sample.PDF)) {
+                BSDFResponse response = plastic_material.evaluate_with_PDF(wo, sample.direction);
+                EXPECT_RGB_EQ_EPS(plastic_material.evaluate(wo, sample.direction), response.weight, 0.00001f);
+                EXPECT_FLOAT_EQ(plastic_material.PDF(wo, sample.direction), response.PDF);
+            }
+        }
+    }
+}
+
+} // NS CPURenderer
+
+#endif // _CPURENDERER_SHADING_MODEL_DEFAULT_TEST_H_
@@ -0,0 +1,30 @@
+// CPURenderer testing utils.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _CPURENDERERTEST_UTILS_H_
+#define _CPURENDERERTEST_UTILS_H_
+
+#include <Cogwheel/Math/Color.h>
+
+//-----------------------------------------------------------------------------
+// Comparison helpers.
+//-----------------------------------------------------------------------------
+
+inline bool almost_equal_eps(float lhs, float rhs, float eps) {
+    return lhs < rhs + eps && lhs + eps > rhs;
+}
+
+#define EXPECT_FLOAT_EQ_EPS(expected, actual, epsilon) EXPECT_PRED3(almost_equal_eps, expected, actual, epsilon)
+
+inline bool equal_rgb_eps(Cogwheel::Math::RGB lhs, Cogwheel::Math::RGB rhs, float epsilon) {
+    return almost_equal_eps(lhs.r, rhs.r, epsilon) && almost_equal_eps(lhs.g, rhs.g, epsilon) && almost_equal_eps(lhs.b, rhs.b, epsilon);
+}
+
+#define EXPECT_RGB_EQ_EPS(expected, actual, epsilon) EXPECT_PRED3(equal_rgb_eps, expected, actual, epsilon)
+
+#endif // _CPURENDERERTEST_UTILS_H_
@@ -0,0 +1,104 @@
+// Test Cogwheel mesh clustering.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_MESH_CLUSTERING_TEST_H_
+#define _COGWHEEL_ASSETS_MESH_CLUSTERING_TEST_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshClustering.h>
+#include <Cogwheel/Assets/MeshCreation.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace Cogwheel {
+namespace Assets {
+
+class Assets_MeshClustering : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Meshes::allocate(8u);
+    }
+    virtual void TearDown() {
+        Meshes::deallocate();
+    }
+};
+
+TEST_F(Assets_MeshClustering, clusters_cover_mesh) {
+    using namespace Math;
+
+    Mesh sphere = MeshCreation::revolved_sphere(64, 64);
+    MeshUtils::MeshClusters clusters = MeshUtils::build_clusters(sphere.get_ID());
+    const unsigned int max_vertex_count = MeshUtils::MeshClusters::max_vertex_count;
+    const unsigned int max_primitive_count = MeshUtils::MeshClusters::max_primitive_count;
+    EXPECT_GE(clusters.clusters.size() * max_primitive_count, sphere.get_primitive_count());
+
+    auto primitive_less = [](Vector3ui lhs, Vector3ui rhs) {
+        return lhs.x < rhs.x || (lhs.x == rhs.x && (lhs.y < rhs.y || (lhs.y == rhs.y && lhs.z < rhs.z))); 
+    };
+
+    std::vector<Vector3ui> cluster_primitives;
+    for (const MeshUtils::MeshCluster& cluster : clusters.clusters) {
+        EXPECT_LE(cluster.vertex_count, max_vertex_count);
+        EXPECT_LE(cluster.primitive_count, max_primitive_count);
+        EXPECT_LT(0u, cluster.primitive_count);
+
+        for (unsigned int v = 0; v < cluster.vertex_count; ++v) {
+            Vector3f position = sphere.get_positions()[clusters.vertex_indices[cluster.vertex_offset + v]];
+            EXPECT_LE(magnitude(position - cluster.sphere_center), cluster.sphere_radius * 1.0001f);
+            EXPECT_TRUE(cluster.bounds.minimum.x <= position.x && position.x <= cluster.bounds.maximum.x);
+            EXPECT_TRUE(cluster.bounds.minimum.y <= position.y && position.y <= cluster.bounds.maximum.y);
+            EXPECT_TRUE(cluster.bounds.minimum.z <= position.z && position.z <= cluster.bounds.maximum.z);
+        }
+
+        for (unsigned int p = 0; p < cluster.primitive_count; ++p) {
+            Vector3ui primitive = Vector3ui(clusters.get_mesh_vertex_index(cluster, p, 0),
+                                            clusters.get_mesh_vertex_index(cluster, p, 1),
+                                            clusters.get_mesh_vertex_index(cluster, p, 2));
+            cluster_primitives.push_back(primitive);
+
+            // The normal of each primitive must lie inside the cluster's normal cone.
+            Vector3f p0 = sphere.get_positions()[primitive.x];
+            Vector3f p1 = sphere.get_positions()[primitive.y];
+            Vector3f p2 = sphere.get_positions()[primitive.z];
+            Vector3f normal = cross(p1 - p0, p2 - p0);
+            if (magnitude_squared(normal) > 0.0f)
+                EXPECT_GE(dot(normalize(normal), cluster.cone_axis), cluster.cone_cos_angle - 0.0001f);
+        }
+    }
+
+    // Test that every primitive in the mesh is in exactly one cluster.
+    std::vector<Vector3ui> mesh_primitives(sphere.get_primitives(), sphere.get_primitives() + sphere.get_primitive_count());
+    std::sort(mesh_primitives.begin(), mesh_primitives.end(), primitive_less);
+    std::sort(cluster_primitives.begin(), cluster_primitives.end(), primitive_less);
+    EXPECT_TRUE(mesh_primitives == cluster_primitives);
+}
+
+TEST_F(Assets_MeshClustering, backface_culling) {
+    using namespace Math;
+
+    // A single cluster plane facing upwards.
+    Mesh plane = MeshCreation::plane(4);
+    MeshUtils::MeshClusters clusters = MeshUtils::build_clusters(plane.get_ID());
+    EXPECT_EQ(1u, clusters.clusters.size());
+    const MeshUtils::MeshCluster& cluster = clusters.clusters[0];
+    EXPECT_FLOAT_EQ(1.0f, cluster.cone_cos_angle);
+
+    Vector3f plane_normal = plane.get_normals()[0];
+    EXPECT_FALSE(cluster.is_backfacing(plane_normal * 10.0f));
+    EXPECT_FALSE(cluster.is_backfacing(plane_normal * 10.0f + Vector3f(100, 0, 100)));
+    EXPECT_TRUE(cluster.is_backfacing(-plane_normal * 10.0f));
+    EXPECT_TRUE(cluster.is_backfacing(-plane_normal * 10.0f + Vector3f(100, 0, 100)));
+}
+
+} // NS Assets
+} // NS Cogwheel
+
+#endif // _COGWHEEL_ASSETS_MESH_CLUSTERING_TEST_H_
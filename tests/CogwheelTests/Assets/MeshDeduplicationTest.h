@@ -0,0 +1,112 @@
+// Test Cogwheel mesh deduplication.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_MESH_DEDUPLICATION_TEST_H_
+#define _COGWHEEL_ASSETS_MESH_DEDUPLICATION_TEST_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Assets/MeshDeduplication.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace Cogwheel {
+namespace Assets {
+
+class Assets_MeshDeduplication : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Meshes::allocate(8u);
+    }
+    virtual void TearDown() {
+        Meshes::deallocate();
+    }
+};
+
+TEST_F(Assets_MeshDeduplication, identical_meshes_are_collapsed) {
+    using namespace Math;
+
+    Meshes::UID cube0_ID = MeshCreation::cube(2);
+    Meshes::UID cube1_ID = MeshCreation::cube(2);
+    Meshes::UID sphere_ID = MeshCreation::revolved_sphere(8, 8);
+    EXPECT_EQ(MeshUtils::compute_hash(cube0_ID), MeshUtils::compute_hash(cube1_ID));
+    EXPECT_NE(MeshUtils::compute_hash(cube0_ID), MeshUtils::compute_hash(sphere_ID));
+    EXPECT_TRUE(MeshUtils::equal(cube0_ID, cube1_ID));
+    EXPECT_FALSE(MeshUtils::equal(cube0_ID, sphere_ID));
+
+    Meshes::UID mesh_IDs[] = { cube0_ID, cube1_ID, sphere_ID, cube0_ID };
+    std::vector<MeshUtils::TransformedMesh> instances = MeshUtils::deduplicate(mesh_IDs, mesh_IDs + 4);
+    EXPECT_EQ(4u, instances.size());
+    EXPECT_EQ(cube0_ID, instances[0].mesh_ID);
+    EXPECT_EQ(cube0_ID, instances[1].mesh_ID);
+    EXPECT_EQ(sphere_ID, instances[2].mesh_ID);
+    EXPECT_EQ(cube0_ID, instances[3].mesh_ID);
+    for (MeshUtils::TransformedMesh instance : instances)
+        EXPECT_EQ(Transform::identity(), instance.transform);
+
+    EXPECT_TRUE(Meshes::has(cube0_ID));
+    EXPECT_FALSE(Meshes::has(cube1_ID));
+    EXPECT_TRUE(Meshes::has(sphere_ID));
+}
+
+TEST_F(Assets_MeshDeduplication, modified_meshes_are_kept) {
+    using namespace Math;
+
+    Meshes::UID cube0_ID = MeshCreation::cube(2);
+    Meshes::UID cube1_ID = MeshCreation::cube(2);
+    Mesh(cube1_ID).get_positions()[3].x += 0.01f;
+    EXPECT_FALSE(MeshUtils::equal(cube0_ID, cube1_ID));
+
+    Meshes::UID mesh_IDs[] = { cube0_ID, cube1_ID };
+    std::vector<MeshUtils::TransformedMesh> instances = MeshUtils::deduplicate(mesh_IDs, mesh_IDs + 2, true);
+    EXPECT_EQ(cube0_ID, instances[0].mesh_ID);
+    EXPECT_EQ(cube1_ID, instances[1].mesh_ID);
+    EXPECT_TRUE(Meshes::has(cube1_ID));
+}
+
+TEST_F(Assets_MeshDeduplication, rigid_duplicates_are_instanced) {
+    using namespace Math;
+
+    Meshes::UID sphere_ID = MeshCreation::revolved_sphere(8, 8);
+    Transform transform = Transform(Vector3f(3.0f, -1.0f, 2.0f), Quaternionf::from_angle_axis(1.2f, normalize(Vector3f(1, 2, 3))), 2.5f);
+    MeshUtils::TransformedMesh transformed_sphere = { sphere_ID, transform };
+    Meshes::UID transformed_sphere_ID = MeshUtils::combine("Transformed sphere", &transformed_sphere, &transformed_sphere + 1);
+
+    Mesh transformed_mesh = transformed_sphere_ID;
+    std::vector<Vector3f> transformed_positions(transformed_mesh.get_positions(), transformed_mesh.get_positions() + transformed_mesh.get_vertex_count());
+
+    EXPECT_EQ(MeshUtils::compute_rigid_invariant_hash(sphere_ID), MeshUtils::compute_rigid_invariant_hash(transformed_sphere_ID));
+
+    { // Without rigid transform detection the meshes are unique.
+        Meshes::UID mesh_IDs[] = { sphere_ID, transformed_sphere_ID };
+        std::vector<MeshUtils::TransformedMesh> instances = MeshUtils::deduplicate(mesh_IDs, mesh_IDs + 2);
+        EXPECT_EQ(sphere_ID, instances[0].mesh_ID);
+        EXPECT_EQ(transformed_sphere_ID, instances[1].mesh_ID);
+    }
+
+    Meshes::UID mesh_IDs[] = { sphere_ID, transformed_sphere_ID };
+    std::vector<MeshUtils::TransformedMesh> instances = MeshUtils::deduplicate(mesh_IDs, mesh_IDs + 2, true);
+    EXPECT_EQ(sphere_ID, instances[0].mesh_ID);
+    EXPECT_EQ(Transform::identity(), instances[0].transform);
+    EXPECT_EQ(sphere_ID, instances[1].mesh_ID);
+    EXPECT_FALSE(Meshes::has(transformed_sphere_ID));
+
+    Transform found_transform = instances[1].transform;
+    EXPECT_FLOAT_EQ(transform.scale, found_transform.scale);
+    Mesh sphere = sphere_ID;
+    for (unsigned int v = 0; v < sphere.get_vertex_count(); ++v)
+        EXPECT_LT(magnitude(found_transform * sphere.get_positions()[v] - transformed_positions[v]), 0.0001f);
+}
+
+} // NS Assets
+} // NS Cogwheel
+
+#endif // _COGWHEEL_ASSETS_MESH_DEDUPLICATION_TEST_H_
@@ -75,6 +75,20 @@ TEST_F(Assets_MeshModels, create) {
     EXPECT_EQ(MeshModels::get_changes(model_ID), MeshModels::Change::Created);
 }
 
+TEST_F(Assets_MeshModels, create_without_material) {
+    Scene::SceneNodes::UID node_ID = Scene::SceneNodes::create("TestNode");
+    Meshes::UID mesh_ID = Meshes::create("TestMesh", 32u, 16u);
+
+    MeshModels::UID model_ID = MeshModels::create(node_ID, mesh_ID, Materials::UID::invalid_UID());
+    EXPECT_TRUE(MeshModels::has(model_ID));
+    EXPECT_EQ(MeshModels::get_material_ID(model_ID), Materials::UID::invalid_UID());
+
+    // Models can't reference materials that don't exist.
+    Materials::UID destroyed_material_ID = Materials::create("TestMaterial", {});
+    Materials::destroy(destroyed_material_ID);
+    EXPECT_EQ(MeshModels::create(node_ID, mesh_ID, destroyed_material_ID), MeshModels::UID::invalid_UID());
+}
+
 TEST_F(Assets_MeshModels, destroy) {
     Scene::SceneNodes::UID node_ID = Scene::SceneNodes::create("TestNode");
     Meshes::UID mesh_ID = Meshes::create("TestMesh", 32u, 16u);
@@ -0,0 +1,93 @@
+// Test Cogwheel mesh simplification.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_MESH_SIMPLIFICATION_TEST_H_
+#define _COGWHEEL_ASSETS_MESH_SIMPLIFICATION_TEST_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Assets/MeshSimplification.h>
+
+#include <gtest/gtest.h>
+
+namespace Cogwheel {
+namespace Assets {
+
+class Assets_MeshSimplification : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Meshes::allocate(8u);
+    }
+    virtual void TearDown() {
+        Meshes::deallocate();
+    }
+};
+
+TEST_F(Assets_MeshSimplification, simplify_plane) {
+    using namespace Math;
+
+    Mesh plane = MeshCreation::plane(8);
+    plane.compute_bounds();
+    Meshes::LOD lod = MeshUtils::simplify(plane.get_ID(), 1);
+    Mesh simplified_plane = lod.mesh_ID;
+
+    // The interior of the plane can be removed without introducing any error, but the boundary is locked.
+    EXPECT_LT(simplified_plane.get_primitive_count(), plane.get_primitive_count());
+    EXPECT_LT(simplified_plane.get_vertex_count(), plane.get_vertex_count());
+    EXPECT_FLOAT_EQ(0.0f, lod.error);
+    EXPECT_FALSE(MeshTests::has_invalid_indices(simplified_plane.get_ID()));
+    EXPECT_EQ(plane.get_flags(), simplified_plane.get_flags());
+    EXPECT_EQ(plane.get_bounds().minimum, simplified_plane.get_bounds().minimum);
+    EXPECT_EQ(plane.get_bounds().maximum, simplified_plane.get_bounds().maximum);
+    EXPECT_EQ(0, MeshTests::normals_correspond_to_winding_order(simplified_plane.get_ID()));
+}
+
+TEST_F(Assets_MeshSimplification, LOD_chain) {
+    using namespace Math;
+
+    Mesh sphere = MeshCreation::revolved_sphere(32, 32);
+    MeshUtils::generate_LODs(sphere.get_ID(), 3);
+    EXPECT_EQ(3u, sphere.get_LOD_count());
+
+    unsigned int previous_primitive_count = sphere.get_primitive_count();
+    float previous_error = 0.0f;
+    for (unsigned int level = 0; level < sphere.get_LOD_count(); ++level) {
+        Meshes::LOD lod = sphere.get_LOD(level);
+        Mesh lod_mesh = lod.mesh_ID;
+        EXPECT_TRUE(lod_mesh.exists());
+        EXPECT_LE(lod_mesh.get_primitive_count(), previous_primitive_count / 2);
+        EXPECT_LE(previous_error, lod.error);
+        EXPECT_GT(0.5f, lod.error);
+        EXPECT_FALSE(MeshTests::has_invalid_indices(lod.mesh_ID));
+
+        // Vertices are never moved, so they should still lie on the sphere.
+        for (Vector3f position : lod_mesh.get_position_iterable())
+            EXPECT_FLOAT_EQ(1.0f, magnitude(position) * 2.0f);
+
+        previous_primitive_count = lod_mesh.get_primitive_count();
+        previous_error = lod.error;
+    }
+}
+
+TEST_F(Assets_MeshSimplification, LODs_destroyed_with_mesh) {
+    Mesh sphere = MeshCreation::revolved_sphere(8, 8);
+    MeshUtils::generate_LODs(sphere.get_ID(), 2);
+    EXPECT_EQ(2u, sphere.get_LOD_count());
+    Meshes::UID LOD0_ID = sphere.get_LOD(0).mesh_ID;
+    Meshes::UID LOD1_ID = sphere.get_LOD(1).mesh_ID;
+
+    Meshes::destroy(sphere.get_ID());
+    EXPECT_FALSE(Meshes::has(LOD0_ID));
+    EXPECT_FALSE(Meshes::has(LOD1_ID));
+}
+
+} // NS Assets
+} // NS Cogwheel
+
+#endif // _COGWHEEL_ASSETS_MESH_SIMPLIFICATION_TEST_H_
@@ -12,6 +12,8 @@
 #include <Cogwheel/Assets/Mesh.h>
 #include <Cogwheel/Assets/MeshCreation.h>
 
+#include <Expects.h>
+
 #include <gtest/gtest.h>
 
 namespace Cogwheel {
@@ -171,6 +173,48 @@ TEST_F(Assets_Mesh, create_and_destroy_notifications) {
     }
 }
 
+TEST_F(Assets_Mesh, buffer_update_notifications) {
+    Meshes::UID mesh_ID = Meshes::create("TestMesh", 32u, 16u);
+    Meshes::reset_change_notifications();
+
+    { // Map ranges of the positions and indices.
+        Math::Vector3f* positions = Meshes::map_positions(mesh_ID, 2u, 4u);
+        EXPECT_EQ(Meshes::get_positions(mesh_ID), positions);
+        Meshes::map_positions(mesh_ID, 10u, 2u);
+        Meshes::map_primitives(mesh_ID, 30u, 8u); // Clamped to the primitive count.
+
+        Core::Iterable<Meshes::ChangedIterator> changed_meshes = Meshes::get_changed_meshes();
+        EXPECT_EQ(1, changed_meshes.end() - changed_meshes.begin());
+        EXPECT_EQ(mesh_ID, *changed_meshes.begin());
+
+        Meshes::Changes changes = Meshes::get_changes(mesh_ID);
+        EXPECT_TRUE(changes.is_set(Meshes::Change::PositionsUpdated));
+        EXPECT_TRUE(changes.is_set(Meshes::Change::IndicesUpdated));
+        EXPECT_FALSE(changes.any_set(Meshes::Change::NormalsUpdated, Meshes::Change::TexcoordsUpdated));
+        EXPECT_FALSE(changes.any_set(Meshes::Change::Created, Meshes::Change::Destroyed));
+
+        Meshes::DirtyRange position_range = Meshes::get_dirty_range(mesh_ID, Meshes::Change::PositionsUpdated);
+        EXPECT_EQ(2u, position_range.begin);
+        EXPECT_EQ(12u, position_range.end);
+        Meshes::DirtyRange index_range = Meshes::get_dirty_range(mesh_ID, Meshes::Change::IndicesUpdated);
+        EXPECT_EQ(30u, index_range.begin);
+        EXPECT_EQ(32u, index_range.end);
+        EXPECT_TRUE(Meshes::get_dirty_range(mesh_ID, Meshes::Change::NormalsUpdated).is_empty());
+    }
+
+    Meshes::reset_change_notifications();
+
+    { // Test that the dirty ranges are reset along with the notifications.
+        EXPECT_TRUE(Meshes::get_changed_meshes().is_empty());
+        EXPECT_TRUE(Meshes::get_dirty_range(mesh_ID, Meshes::Change::PositionsUpdated).is_empty());
+        EXPECT_TRUE(Meshes::get_dirty_range(mesh_ID, Meshes::Change::IndicesUpdated).is_empty());
+
+        Mesh(mesh_ID).map_texcoords(0u, 16u);
+        EXPECT_EQ(Meshes::Change::TexcoordsUpdated, Meshes::get_changes(mesh_ID));
+        EXPECT_EQ(16u, Meshes::get_dirty_range(mesh_ID, Meshes::Change::TexcoordsUpdated).size());
+    }
+}
+
 TEST_F(Assets_Mesh, normals_correspond_to_winding_order) {
     Meshes::UID plane_ID = MeshCreation::plane(3);
     EXPECT_EQ(0, MeshTests::normals_correspond_to_winding_order(plane_ID));
@@ -224,6 +268,207 @@ TEST_F(Assets_Mesh, hard_normal_computation) {
     }
 }
 
+TEST_F(Assets_Mesh, combine) {
+    using namespace Math;
+
+    Mesh cube = MeshCreation::cube(2);
+    Mesh plane = MeshCreation::plane(3);
+    Transform plane_transform = Transform(Vector3f(1, 2, 3), Quaternionf::from_angle_axis(0.5f, Vector3f::up()), 2.0f);
+
+    Mesh combined_mesh = MeshUtils::combine("Combined", cube.get_ID(), Transform::identity(), plane.get_ID(), plane_transform);
+    EXPECT_EQ(cube.get_primitive_count() + plane.get_primitive_count(), combined_mesh.get_primitive_count());
+    EXPECT_EQ(cube.get_vertex_count() + plane.get_vertex_count(), combined_mesh.get_vertex_count());
+    EXPECT_FALSE(MeshTests::has_invalid_indices(combined_mesh.get_ID()));
+
+    // Test that the cube is copied verbatim.
+    for (unsigned int p = 0; p < cube.get_primitive_count(); ++p)
+        EXPECT_EQ(cube.get_primitives()[p], combined_mesh.get_primitives()[p]);
+    for (unsigned int v = 0; v < cube.get_vertex_count(); ++v) {
+        EXPECT_EQ(cube.get_positions()[v], combined_mesh.get_positions()[v]);
+        EXPECT_EQ(cube.get_normals()[v], combined_mesh.get_normals()[v]);
+        EXPECT_EQ(cube.get_texcoords()[v], combined_mesh.get_texcoords()[v]);
+    }
+
+    // Test that the plane is transformed and its indices offset.
+    unsigned int primitive_offset = cube.get_primitive_count();
+    unsigned int vertex_offset = cube.get_vertex_count();
+    for (unsigned int p = 0; p < plane.get_primitive_count(); ++p)
+        EXPECT_EQ(plane.get_primitives()[p] + vertex_offset, combined_mesh.get_primitives()[primitive_offset + p]);
+    for (unsigned int v = 0; v < plane.get_vertex_count(); ++v) {
+        EXPECT_NORMAL_EQ(plane_transform * plane.get_positions()[v], combined_mesh.get_positions()[vertex_offset + v], 0.00001);
+        EXPECT_NORMAL_EQ(plane_transform.rotation * plane.get_normals()[v], combined_mesh.get_normals()[vertex_offset + v], 0.00001);
+        EXPECT_EQ(plane.get_texcoords()[v], combined_mesh.get_texcoords()[vertex_offset + v]);
+    }
+}
+
+// Creates a cube where the corners are shared between the sides.
+inline Meshes::UID create_shared_vertex_cube() {
+    using namespace Math;
+
+    Mesh cube = Meshes::create("SharedVertexCube", 12, 8, { MeshFlag::Position, MeshFlag::Normal });
+    Vector3f* positions = cube.get_positions();
+    for (unsigned int v = 0; v < 8; ++v)
+        positions[v] = Vector3f((v & 1) ? 0.5f : -0.5f, (v & 2) ? 0.5f : -0.5f, (v & 4) ? 0.5f : -0.5f);
+
+    Vector3ui* primitives = cube.get_primitives();
+    primitives[0] = Vector3ui(0, 2, 3); primitives[1] = Vector3ui(0, 3, 1); // -z
+    primitives[2] = Vector3ui(4, 5, 7); primitives[3] = Vector3ui(4, 7, 6); // +z
+    primitives[4] = Vector3ui(0, 4, 6); primitives[5] = Vector3ui(0, 6, 2); // -x
+    primitives[6] = Vector3ui(1, 3, 7); primitives[7] = Vector3ui(1, 7, 5); // +x
+    primitives[8] = Vector3ui(0, 1, 5); primitives[9] = Vector3ui(0, 5, 4); // -y
+    primitives[10] = Vector3ui(2, 6, 7); primitives[11] = Vector3ui(2, 7, 3); // +y
+    cube.compute_bounds();
+    return cube.get_ID();
+}
+
+TEST_F(Assets_Mesh, vertex_adjacency) {
+    using namespace Math;
+
+    Mesh cube = create_shared_vertex_cube();
+    MeshUtils::VertexAdjacency adjacency = MeshUtils::compute_vertex_adjacency(cube.get_ID());
+    EXPECT_EQ(cube.get_vertex_count() + 1, adjacency.corner_offsets.size());
+    EXPECT_EQ(cube.get_index_count(), adjacency.corners.size());
+
+    for (unsigned int v = 0; v < cube.get_vertex_count(); ++v) {
+        unsigned int previous_corner = 0u;
+        for (unsigned int corner : adjacency.get_corners(v)) {
+            EXPECT_EQ(v, cube.get_indices()[corner]);
+            EXPECT_LE(previous_corner, corner);
+            previous_corner = corner;
+        }
+    }
+}
+
+TEST_F(Assets_Mesh, smooth_normal_computation) {
+    using namespace Math;
+
+    // The smooth normals of a symmetric cube point away from the center.
+    Mesh cube = create_shared_vertex_cube();
+    MeshUtils::compute_normals(cube.get_ID(), MeshUtils::NormalWeighting::Angle);
+    EXPECT_EQ(0, MeshTests::normals_correspond_to_winding_order(cube.get_ID()));
+    for (unsigned int v = 0; v < cube.get_vertex_count(); ++v)
+        EXPECT_NORMAL_EQ(normalize(cube.get_positions()[v]), cube.get_normals()[v], 0.00001);
+
+    // Area weighted normals of the sphere should approximate the direction from the center to the vertex.
+    // The poles and the texcoord seam are ignored, as the revolved sphere duplicates those vertices
+    // and each duplicate only sees part of its neighbourhood.
+    Mesh sphere = MeshCreation::revolved_sphere(32, 32);
+    MeshUtils::compute_normals(sphere.get_ID(), MeshUtils::NormalWeighting::Area);
+    for (unsigned int v = 0; v < sphere.get_vertex_count(); ++v) {
+        Vector3f direction = normalize(sphere.get_positions()[v]);
+        bool is_pole = abs(direction.y) > 0.99f;
+        bool is_seam = abs(direction.x) < 0.00001f && direction.z > 0.0f;
+        if (!is_pole && !is_seam)
+            EXPECT_NORMAL_EQ(direction, sphere.get_normals()[v], 0.01);
+    }
+}
+
+TEST_F(Assets_Mesh, crease_normal_computation) {
+    using namespace Math;
+
+    Mesh cube = create_shared_vertex_cube();
+
+    { // A crease angle below 90 degrees should split the shared vertices into one vertex pr side.
+        Mesh hard_cube = MeshUtils::compute_normals_with_creases(cube.get_ID(), degrees_to_radians(45.0f));
+        EXPECT_EQ(24u, hard_cube.get_vertex_count());
+        EXPECT_EQ(12u, hard_cube.get_primitive_count());
+        EXPECT_FALSE(MeshTests::has_invalid_indices(hard_cube.get_ID()));
+        EXPECT_EQ(0, MeshTests::normals_correspond_to_winding_order(hard_cube.get_ID()));
+        for (Vector3ui primitive : hard_cube.get_primitive_iterable()) {
+            Vector3f p0 = hard_cube.get_positions()[primitive.x];
+            Vector3f p1 = hard_cube.get_positions()[primitive.y];
+            Vector3f p2 = hard_cube.get_positions()[primitive.z];
+            Vector3f primitive_normal = normalize(cross(p1 - p0, p2 - p0));
+            for (int i = 0; i < 3; ++i)
+                EXPECT_NORMAL_EQ(primitive_normal, hard_cube.get_normals()[primitive[i]], 0.00001);
+        }
+    }
+
+    { // A crease angle above 90 degrees keeps the cube smooth.
+        Mesh smooth_cube = MeshUtils::compute_normals_with_creases(cube.get_ID(), degrees_to_radians(100.0f), MeshUtils::NormalWeighting::Angle);
+        EXPECT_EQ(8u, smooth_cube.get_vertex_count());
+        for (unsigned int v = 0; v < smooth_cube.get_vertex_count(); ++v)
+            EXPECT_NORMAL_EQ(normalize(smooth_cube.get_positions()[v]), smooth_cube.get_normals()[v], 0.00001);
+    }
+}
+
+inline bool tangents_are_valid(Mesh mesh) {
+    using namespace Math;
+    for (unsigned int v = 0; v < mesh.get_vertex_count(); ++v) {
+        Vector4f tangent = mesh.get_tangents()[v];
+        Vector3f tangent3 = Vector3f(tangent.x, tangent.y, tangent.z);
+        if (abs(magnitude(tangent3) - 1.0f) > 0.0001f || abs(dot(tangent3, mesh.get_normals()[v])) > 0.0001f || abs(tangent.w) != 1.0f)
+            return false;
+    }
+    return true;
+}
+
+TEST_F(Assets_Mesh, tangent_computation) {
+    using namespace Math;
+
+    // Tangents on a sphere point along the direction of increasing u, which is along the circumference.
+    Mesh sphere = MeshCreation::revolved_sphere(16, 16);
+    Mesh tangent_sphere = MeshUtils::compute_tangents(sphere.get_ID());
+    EXPECT_NE(sphere.get_ID(), tangent_sphere.get_ID());
+    EXPECT_EQ(sphere.get_vertex_count(), tangent_sphere.get_vertex_count());
+    EXPECT_TRUE(tangent_sphere.get_flags().is_set(MeshFlag::Tangent));
+    EXPECT_TRUE(tangents_are_valid(tangent_sphere));
+
+    for (Vector3ui primitive : tangent_sphere.get_primitive_iterable()) {
+        Vector3f p0 = tangent_sphere.get_positions()[primitive.x];
+        Vector3f p1 = tangent_sphere.get_positions()[primitive.y];
+        Vector3f p2 = tangent_sphere.get_positions()[primitive.z];
+        Vector2f uv0 = tangent_sphere.get_texcoords()[primitive.x];
+        Vector2f uv1 = tangent_sphere.get_texcoords()[primitive.y];
+        Vector2f uv2 = tangent_sphere.get_texcoords()[primitive.z];
+        Vector2f uv_edge1 = uv1 - uv0, uv_edge2 = uv2 - uv0;
+        float determinant = uv_edge1.x * uv_edge2.y - uv_edge2.x * uv_edge1.y;
+        if (determinant == 0.0f)
+            continue;
+        Vector3f primitive_tangent = ((p1 - p0) * uv_edge2.y - (p2 - p0) * uv_edge1.y) / determinant;
+        for (int c = 0; c < 3; ++c) {
+            Vector4f tangent = tangent_sphere.get_tangents()[primitive[c]];
+            EXPECT_LT(0.0f, dot(Vector3f(tangent.x, tangent.y, tangent.z), primitive_tangent));
+        }
+    }
+
+    // Computing tangents again on a mesh with a tangent buffer updates the tangents in place.
+    Meshes::UID recomputed_sphere_ID = MeshUtils::compute_tangents(tangent_sphere.get_ID());
+    EXPECT_EQ(tangent_sphere.get_ID(), recomputed_sphere_ID);
+}
+
+TEST_F(Assets_Mesh, tangent_computation_with_mirrored_texcoords) {
+    using namespace Math;
+
+    // Two quads in the xy-plane, where the texcoords of the right quad mirror the left one around x = 1.
+    Mesh mesh = Meshes::create("MirroredQuads", 4, 6, MeshFlag::AllBuffers);
+    for (unsigned int v = 0; v < 6; ++v) {
+        float x = float(v % 3), y = float(v / 3);
+        mesh.get_positions()[v] = Vector3f(x, y, 0.0f);
+        mesh.get_normals()[v] = Vector3f::forward();
+        mesh.get_texcoords()[v] = Vector2f(x <= 1.0f ? x : 2.0f - x, y);
+    }
+    mesh.get_primitives()[0] = Vector3ui(0, 1, 4); mesh.get_primitives()[1] = Vector3ui(0, 4, 3);
+    mesh.get_primitives()[2] = Vector3ui(1, 2, 5); mesh.get_primitives()[3] = Vector3ui(1, 5, 4);
+
+    Mesh tangent_mesh = MeshUtils::compute_tangents(mesh.get_ID());
+
+    // The two vertices on the mirror line are split.
+    EXPECT_EQ(8u, tangent_mesh.get_vertex_count());
+    EXPECT_FALSE(MeshTests::has_invalid_indices(tangent_mesh.get_ID()));
+    EXPECT_TRUE(tangents_are_valid(tangent_mesh));
+
+    for (unsigned int p = 0; p < 4; ++p) {
+        Vector3ui primitive = tangent_mesh.get_primitives()[p];
+        bool is_mirrored = p >= 2;
+        for (int c = 0; c < 3; ++c) {
+            Vector4f tangent = tangent_mesh.get_tangents()[primitive[c]];
+            EXPECT_EQ(is_mirrored ? -1.0f : 1.0f, tangent.w);
+            EXPECT_FLOAT_EQ(is_mirrored ? -1.0f : 1.0f, tangent.x);
+        }
+    }
+}
+
 } // NS Assets
 } // NS Cogwheel
 
@@ -0,0 +1,110 @@
+// Test Cogwheel mesh validation.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_MESH_VALIDATION_TEST_H_
+#define _COGWHEEL_ASSETS_MESH_VALIDATION_TEST_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Assets/MeshValidation.h>
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+namespace Cogwheel {
+namespace Assets {
+
+class Assets_MeshValidation : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Meshes::allocate(8u);
+    }
+    virtual void TearDown() {
+        Meshes::deallocate();
+    }
+};
+
+TEST_F(Assets_MeshValidation, created_meshes_are_valid) {
+    MeshCreation::plane(3);
+    MeshCreation::cube(3);
+    MeshCreation::cylinder(3, 3);
+
+    std::vector<MeshTests::ValidationReport> reports = MeshTests::validate_all();
+    EXPECT_EQ(3u, reports.size());
+    for (MeshTests::ValidationReport report : reports)
+        EXPECT_TRUE(report.is_valid());
+}
+
+TEST_F(Assets_MeshValidation, detect_issues) {
+    using namespace Math;
+
+    // Three primitives share the edge between vertex 0 and 1, where the last one is inverted.
+    // Primitive 3 is degenerate and vertex 6 is unreferenced and invalid.
+    Mesh mesh = Meshes::create("Broken", 4, 7, { MeshFlag::Position, MeshFlag::Normal });
+    mesh.get_primitives()[0] = Vector3ui(0, 1, 2);
+    mesh.get_primitives()[1] = Vector3ui(1, 0, 3);
+    mesh.get_primitives()[2] = Vector3ui(0, 1, 4);
+    mesh.get_primitives()[3] = Vector3ui(5, 5, 2);
+    mesh.get_positions()[0] = Vector3f(0, 0, 0);
+    mesh.get_positions()[1] = Vector3f(1, 0, 0);
+    mesh.get_positions()[2] = Vector3f(0, 1, 0);
+    mesh.get_positions()[3] = Vector3f(0, -1, 0);
+    mesh.get_positions()[4] = Vector3f(0.5f, 0, 1);
+    mesh.get_positions()[5] = Vector3f(2, 2, 2);
+    mesh.get_positions()[6] = Vector3f(std::numeric_limits<float>::quiet_NaN(), 0, 0);
+    for (unsigned int v = 0; v < 7; ++v)
+        mesh.get_normals()[v] = Vector3f(0, 0, 1);
+
+    { // Only count the issues.
+        MeshTests::ValidationReport report = MeshTests::validate(mesh.get_ID());
+        EXPECT_FALSE(report.is_valid());
+        EXPECT_EQ(0u, report.invalid_indices.count);
+        EXPECT_EQ(1u, report.degenerate_primitives.count);
+        EXPECT_EQ(2u, report.inverted_primitives.count);
+        EXPECT_EQ(1u, report.non_finite_vertices.count);
+        EXPECT_EQ(1u, report.unreferenced_vertices.count);
+        EXPECT_EQ(1u, report.non_manifold_edges.count);
+        EXPECT_TRUE(report.inverted_primitives.indices.empty());
+        EXPECT_TRUE(report.non_manifold_edges.indices.empty());
+    }
+
+    MeshTests::ValidationReport report = MeshTests::validate(mesh.get_ID(), 0.000001f, 8u);
+    EXPECT_EQ(std::vector<unsigned int>({ 3 }), report.degenerate_primitives.indices);
+    EXPECT_EQ(std::vector<unsigned int>({ 2, 3 }), report.inverted_primitives.indices);
+    EXPECT_EQ(std::vector<unsigned int>({ 6 }), report.non_finite_vertices.indices);
+    EXPECT_EQ(std::vector<unsigned int>({ 6 }), report.unreferenced_vertices.indices);
+    EXPECT_EQ(std::vector<unsigned int>({ 0, 1 }), report.non_manifold_edges.indices);
+}
+
+TEST_F(Assets_MeshValidation, reported_issues_are_capped) {
+    using namespace Math;
+
+    // Enough primitives to span multiple chunks, all with out of bounds indices.
+    const unsigned int primitive_count = 40000u;
+    Mesh mesh = Meshes::create("Invalid", primitive_count, 3, MeshFlag::Position);
+    for (unsigned int p = 0; p < primitive_count; ++p)
+        mesh.get_primitives()[p] = Vector3ui(0, 1, 3);
+    mesh.get_positions()[0] = Vector3f(0, 0, 0);
+    mesh.get_positions()[1] = Vector3f(1, 0, 0);
+    mesh.get_positions()[2] = Vector3f(0, 1, 0);
+
+    MeshTests::ValidationReport report = MeshTests::validate(mesh.get_ID(), 0.000001f, 3u);
+    EXPECT_EQ(primitive_count, report.invalid_indices.count);
+    EXPECT_EQ(std::vector<unsigned int>({ 0, 1, 2 }), report.invalid_indices.indices);
+
+    // Edge checks are skipped for meshes with invalid indices.
+    EXPECT_EQ(0u, report.unreferenced_vertices.count);
+    EXPECT_EQ(0u, report.degenerate_primitives.count);
+}
+
+} // NS Assets
+} // NS Cogwheel
+
+#endif // _COGWHEEL_ASSETS_MESH_VALIDATION_TEST_H_
@@ -0,0 +1,107 @@
+// Test Cogwheel mesh welding.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_ASSETS_MESH_WELDING_TEST_H_
+#define _COGWHEEL_ASSETS_MESH_WELDING_TEST_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Assets/MeshWelding.h>
+
+#include <gtest/gtest.h>
+
+namespace Cogwheel {
+namespace Assets {
+
+class Assets_MeshWelding : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Meshes::allocate(8u);
+    }
+    virtual void TearDown() {
+        Meshes::deallocate();
+    }
+};
+
+TEST_F(Assets_MeshWelding, weld_triangle_soup) {
+    using namespace Math;
+
+    Mesh cube = MeshCreation::cube(1, MeshFlag::Position);
+    unsigned int index_count = cube.get_index_count();
+    Mesh soup = Meshes::create("Soup", 0, index_count, MeshFlag::Position);
+    MeshUtils::expand_indexed_buffer(cube.get_primitives(), cube.get_primitive_count(), cube.get_positions(), soup.get_positions());
+
+    MeshUtils::WeldedMesh welded = MeshUtils::weld(soup.get_ID());
+    Mesh welded_mesh = welded.mesh_ID;
+    EXPECT_EQ(8u, welded_mesh.get_vertex_count());
+    EXPECT_EQ(index_count - 8u, welded.removed_vertex_count);
+    EXPECT_EQ(cube.get_primitive_count(), welded_mesh.get_primitive_count());
+    EXPECT_EQ(0u, welded.removed_primitive_count);
+
+    // The welded primitives reference the same positions as the soup.
+    for (unsigned int i = 0; i < index_count; ++i)
+        EXPECT_EQ(soup.get_positions()[i], welded_mesh.get_positions()[welded_mesh.get_indices()[i]]);
+
+    // The welded vertices keep the order of their first occurrence.
+    EXPECT_EQ(soup.get_positions()[0], welded_mesh.get_positions()[0]);
+    EXPECT_EQ(Vector3ui(0, 1, 2), welded_mesh.get_primitives()[0]);
+}
+
+TEST_F(Assets_MeshWelding, attributes_prevent_welding) {
+    Mesh cube = MeshCreation::cube(1, { MeshFlag::Position, MeshFlag::Normal });
+    unsigned int vertex_count = cube.get_vertex_count();
+
+    // The normals of the cube's faces differ, so no vertices are welded.
+    MeshUtils::WeldedMesh hard_welded = MeshUtils::weld(cube.get_ID());
+    EXPECT_EQ(0u, hard_welded.removed_vertex_count);
+    EXPECT_EQ(vertex_count, Meshes::get_vertex_count(hard_welded.mesh_ID));
+
+    // Perpendicular unit normals are sqrt(2) apart, so a normal epsilon of 1.5 welds the corners.
+    MeshUtils::WeldedMesh soft_welded = MeshUtils::weld(cube.get_ID(), 0.0f, 1.5f);
+    EXPECT_EQ(vertex_count - 8u, soft_welded.removed_vertex_count);
+    EXPECT_EQ(8u, Meshes::get_vertex_count(soft_welded.mesh_ID));
+}
+
+TEST_F(Assets_MeshWelding, position_epsilon) {
+    using namespace Math;
+
+    // Two triangles sharing an edge, where the shared vertices are slightly offset.
+    Mesh mesh = Meshes::create("Quad", 2, 6, MeshFlag::Position);
+    mesh.get_primitives()[0] = Vector3ui(0, 1, 2);
+    mesh.get_primitives()[1] = Vector3ui(3, 4, 5);
+    mesh.get_positions()[0] = Vector3f(0, 0, 0);
+    mesh.get_positions()[1] = Vector3f(1, 0, 0);
+    mesh.get_positions()[2] = Vector3f(1, 1, 0);
+    mesh.get_positions()[3] = Vector3f(0.0f, 0.0004f, 0.0f);
+    mesh.get_positions()[4] = Vector3f(1.0004f, 1.0f, 0.0f);
+    mesh.get_positions()[5] = Vector3f(0, 1, 0);
+
+    { // The offset is above the epsilon.
+        MeshUtils::WeldedMesh welded = MeshUtils::weld(mesh.get_ID(), 0.0001f);
+        EXPECT_EQ(0u, welded.removed_vertex_count);
+    }
+
+    MeshUtils::WeldedMesh welded = MeshUtils::weld(mesh.get_ID(), 0.001f);
+    EXPECT_EQ(2u, welded.removed_vertex_count);
+    Mesh welded_mesh = welded.mesh_ID;
+    EXPECT_EQ(Vector3ui(0, 1, 2), welded_mesh.get_primitives()[0]);
+    EXPECT_EQ(Vector3ui(0, 2, 3), welded_mesh.get_primitives()[1]);
+    EXPECT_EQ(Vector3f(0, 1, 0), welded_mesh.get_positions()[3]);
+
+    // Welding everything into a point removes all primitives.
+    MeshUtils::WeldedMesh collapsed = MeshUtils::weld(mesh.get_ID(), 10.0f);
+    EXPECT_EQ(1u, Meshes::get_vertex_count(collapsed.mesh_ID));
+    EXPECT_EQ(2u, collapsed.removed_primitive_count);
+    EXPECT_EQ(0u, Meshes::get_primitive_count(collapsed.mesh_ID));
+}
+
+} // NS Assets
+} // NS Cogwheel
+
+#endif // _COGWHEEL_ASSETS_MESH_WELDING_TEST_H_
@@ -0,0 +1,60 @@
+// Test Cogwheel memory mapped file.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_CORE_MEMORY_MAPPED_FILE_TEST_H_
+#define _COGWHEEL_CORE_MEMORY_MAPPED_FILE_TEST_H_
+
+#include <Cogwheel/Core/MemoryMappedFile.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+namespace Cogwheel {
+namespace Core {
+
+GTEST_TEST(Core_MemoryMappedFile, map_file) {
+    const char* path = "memory_mapped_file_test.bin";
+    const char content[] = "Cogwheel memory mapped file";
+    FILE* file = fopen(path, "wb");
+    ASSERT_NE(nullptr, file);
+    fwrite(content, 1, sizeof(content), file);
+    fclose(file);
+
+    EXPECT_NE(0u, MemoryMappedFile::get_modification_time(path));
+
+    MemoryMappedFile mapped_file = MemoryMappedFile(path);
+    EXPECT_TRUE(mapped_file.is_open());
+    EXPECT_EQ(sizeof(content), mapped_file.get_size());
+    EXPECT_EQ(0, memcmp(content, mapped_file.get_data(), sizeof(content)));
+
+    // Ownership of the mapping is transferred on move.
+    MemoryMappedFile moved_file = std::move(mapped_file);
+    EXPECT_FALSE(mapped_file.is_open());
+    EXPECT_TRUE(moved_file.is_open());
+    EXPECT_EQ(0, memcmp(content, moved_file.get_data(), sizeof(content)));
+
+    moved_file.close();
+    EXPECT_FALSE(moved_file.is_open());
+    remove(path);
+}
+
+GTEST_TEST(Core_MemoryMappedFile, missing_file) {
+    const char* path = "memory_mapped_file_test_missing.bin";
+    MemoryMappedFile mapped_file = MemoryMappedFile(path);
+    EXPECT_FALSE(mapped_file.is_open());
+    EXPECT_EQ(nullptr, mapped_file.get_data());
+    EXPECT_EQ(0u, MemoryMappedFile::get_modification_time(path));
+}
+
+} // NS Core
+} // NS Cogwheel
+
+#endif // _COGWHEEL_CORE_MEMORY_MAPPED_FILE_TEST_H_
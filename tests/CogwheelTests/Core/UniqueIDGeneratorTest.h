@@ -14,6 +14,7 @@
 #include <gtest/gtest.h>
 
 #include <set>
+#include <vector>
 
 namespace Cogwheel {
 namespace Core {
@@ -263,6 +264,27 @@ GTEST_TEST(Core_UniqueIDGenerator, iterator) {
     }
 }
 
+GTEST_TEST(Core_UniqueIDGenerator, reserve_with_free_entries) {
+    UIDGenerator gen = UIDGenerator(8u);
+    UID id0 = gen.generate();
+    UID id1 = gen.generate();
+
+    // Reserve while there are still free entries and fill the generator.
+    gen.reserve(16u);
+    std::set<UID> generated_IDs = { id0, id1 };
+    while (gen.capacity() == 16u && generated_IDs.size() < 14u)
+        generated_IDs.insert(gen.generate());
+    EXPECT_EQ(16u, gen.capacity());
+
+    // Test that every ID is iterated over exactly once.
+    std::vector<UID> iterated_IDs;
+    for (UID id : gen)
+        iterated_IDs.push_back(id);
+    EXPECT_EQ(generated_IDs.size(), iterated_IDs.size());
+    for (UID id : iterated_IDs)
+        EXPECT_TRUE(generated_IDs.find(id) != generated_IDs.end());
+}
+
 } // NS Core
 } // NS Cogwheel
 
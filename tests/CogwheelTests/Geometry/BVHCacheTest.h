@@ -0,0 +1,148 @@
+// Test Cogwheel on disk cache of mesh bounding volume hierarchies.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_BVH_CACHE_TEST_H_
+#define _COGWHEEL_GEOMETRY_BVH_CACHE_TEST_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Core/MemoryMappedFile.h>
+#include <Cogwheel/Geometry/BVHCache.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace Cogwheel {
+namespace Geometry {
+
+class Geometry_BVHCache : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Assets::Meshes::allocate(2u);
+    }
+    virtual void TearDown() {
+        Assets::Meshes::deallocate();
+    }
+
+    static void expect_equal_BVHs(const BVH8& expected_bvh, const BVH8& bvh) {
+        ASSERT_EQ(expected_bvh.get_nodes().size(), bvh.get_nodes().size());
+        ASSERT_EQ(expected_bvh.get_triangle_packs().size(), bvh.get_triangle_packs().size());
+        EXPECT_EQ(0, memcmp(expected_bvh.get_nodes().data(), bvh.get_nodes().data(), sizeof(BVH8::Node) * bvh.get_nodes().size()));
+        EXPECT_EQ(0, memcmp(expected_bvh.get_triangle_packs().data(), bvh.get_triangle_packs().data(), sizeof(TrianglePack) * bvh.get_triangle_packs().size()));
+        EXPECT_EQ(expected_bvh.get_statistics().max_depth, bvh.get_statistics().max_depth);
+        EXPECT_EQ(expected_bvh.get_statistics().leaf_count, bvh.get_statistics().leaf_count);
+    }
+};
+
+TEST_F(Geometry_BVHCache, store_and_load) {
+    using namespace Math;
+
+    Assets::Meshes::UID sphere_ID = Assets::MeshCreation::revolved_sphere(16, 8);
+    BVH::BuildSettings settings = BVH::BuildSettings::default_settings();
+    BVH bvh = BVH(sphere_ID, settings);
+    BVH8 bvh8 = BVH8(bvh, sphere_ID);
+    unsigned long long mesh_hash = BVHCache::compute_mesh_hash(sphere_ID);
+
+    std::string path = BVHCache::get_path(".", mesh_hash);
+    ASSERT_TRUE(BVHCache::store(path, bvh8, bvh.get_bounds(), settings, mesh_hash));
+
+    BVH8 loaded_bvh8;
+    AABB loaded_bounds;
+    ASSERT_TRUE(BVHCache::load(path, settings, mesh_hash, loaded_bvh8, loaded_bounds));
+    expect_equal_BVHs(bvh8, loaded_bvh8);
+    EXPECT_EQ(bvh.get_bounds().minimum, loaded_bounds.minimum);
+    EXPECT_EQ(bvh.get_bounds().maximum, loaded_bounds.maximum);
+
+    remove(path.c_str());
+}
+
+TEST_F(Geometry_BVHCache, reject_mismatches) {
+    using namespace Math;
+
+    Assets::Meshes::UID sphere_ID = Assets::MeshCreation::revolved_sphere(16, 8);
+    BVH::BuildSettings settings = BVH::BuildSettings::default_settings();
+    BVH8 bvh8 = BVH8(sphere_ID, settings);
+    unsigned long long mesh_hash = BVHCache::compute_mesh_hash(sphere_ID);
+    std::string path = BVHCache::get_path(".", mesh_hash);
+    ASSERT_TRUE(BVHCache::store(path, bvh8, AABB(Vector3f(-1.0f), Vector3f(1.0f)), settings, mesh_hash));
+
+    BVH8 loaded_bvh8;
+    AABB loaded_bounds;
+
+    // Other build settings.
+    EXPECT_FALSE(BVHCache::load(path, BVH::BuildSettings::morton_settings(), mesh_hash, loaded_bvh8, loaded_bounds));
+    BVH::BuildSettings spatial_split_settings = settings;
+    spatial_split_settings.spatial_splits = true;
+    EXPECT_FALSE(BVHCache::load(path, spatial_split_settings, mesh_hash, loaded_bvh8, loaded_bounds));
+
+    // Other mesh.
+    EXPECT_FALSE(BVHCache::load(path, settings, mesh_hash + 1, loaded_bvh8, loaded_bounds));
+
+    // Corrupted nodes.
+    {
+        Core::MemoryMappedFile file = Core::MemoryMappedFile(path);
+        ASSERT_TRUE(file.is_open());
+        std::vector<unsigned char> data(file.get_data(), file.get_data() + file.get_size());
+        file.close();
+        data[data.size() - 8] ^= 0x1;
+        FILE* corrupted_file = fopen(path.c_str(), "wb");
+        fwrite(data.data(), 1, data.size(), corrupted_file);
+        fclose(corrupted_file);
+    }
+    EXPECT_FALSE(BVHCache::load(path, settings, mesh_hash, loaded_bvh8, loaded_bounds));
+    EXPECT_TRUE(loaded_bvh8.is_empty());
+
+    remove(path.c_str());
+}
+
+TEST_F(Geometry_BVHCache, mesh_hash) {
+    using namespace Assets;
+
+    Meshes::UID plane_ID = MeshCreation::plane(2);
+    unsigned long long mesh_hash = BVHCache::compute_mesh_hash(plane_ID);
+    EXPECT_EQ(mesh_hash, BVHCache::compute_mesh_hash(MeshCreation::plane(2)));
+
+    Meshes::get_positions(plane_ID)[4].y = 0.5f;
+    EXPECT_NE(mesh_hash, BVHCache::compute_mesh_hash(plane_ID));
+}
+
+TEST_F(Geometry_BVHCache, load_cached) {
+    using namespace Math;
+
+    Assets::Meshes::UID sphere_ID = Assets::MeshCreation::revolved_sphere(16, 8);
+    BVH::BuildSettings settings = BVH::BuildSettings::default_settings();
+    std::string path = BVHCache::get_path(".", BVHCache::compute_mesh_hash(sphere_ID));
+    remove(path.c_str());
+
+    // The first load builds the hierarchy and stores it.
+    AABB bounds;
+    BVH8 bvh8 = BVHCache::load_cached(".", sphere_ID, settings, bounds);
+    expect_equal_BVHs(BVH8(sphere_ID, settings), bvh8);
+    EXPECT_NE(0u, Core::MemoryMappedFile::get_modification_time(path));
+
+    // Replace the cached hierarchy with the torus' hierarchy to verify that the next load uses the cache.
+    Assets::Meshes::UID torus_ID = Assets::MeshCreation::torus(16, 8, 0.2f);
+    BVH8 torus_bvh8 = BVH8(torus_ID, settings);
+    ASSERT_TRUE(BVHCache::store(path, torus_bvh8, bounds, settings, BVHCache::compute_mesh_hash(sphere_ID)));
+    expect_equal_BVHs(torus_bvh8, BVHCache::load_cached(".", sphere_ID, settings, bounds));
+
+    // Other settings rebuild the hierarchy and replace the cache.
+    BVH::BuildSettings morton_settings = BVH::BuildSettings::morton_settings();
+    expect_equal_BVHs(BVH8(sphere_ID, morton_settings), BVHCache::load_cached(".", sphere_ID, morton_settings, bounds));
+    expect_equal_BVHs(BVH8(sphere_ID, morton_settings), BVHCache::load_cached(".", sphere_ID, morton_settings, bounds));
+
+    remove(path.c_str());
+}
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_BVH_CACHE_TEST_H_
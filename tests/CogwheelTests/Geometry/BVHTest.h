@@ -0,0 +1,231 @@
+// Test Cogwheel bounding volume hierarchy.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_BVH_TEST_H_
+#define _COGWHEEL_GEOMETRY_BVH_TEST_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Geometry/BVH.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace Cogwheel {
+namespace Geometry {
+
+class Geometry_BVH : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Assets::Meshes::allocate(8u);
+    }
+    virtual void TearDown() {
+        Assets::Meshes::deallocate();
+    }
+
+    static bool contains(Math::AABB outer, Math::AABB inner) {
+        for (int a = 0; a < 3; ++a)
+            if (inner.minimum[a] < outer.minimum[a] || outer.maximum[a] < inner.maximum[a])
+                return false;
+        return true;
+    }
+
+    static std::vector<Math::AABB> compute_primitive_bounds(Assets::Mesh mesh) {
+        std::vector<Math::AABB> bounds(mesh.get_primitive_count());
+        for (unsigned int p = 0; p < mesh.get_primitive_count(); ++p) {
+            Math::Vector3ui primitive = mesh.get_primitives()[p];
+            bounds[p] = Math::AABB(mesh.get_positions()[primitive.x], mesh.get_positions()[primitive.x]);
+            bounds[p].grow_to_contain(mesh.get_positions()[primitive.y]);
+            bounds[p].grow_to_contain(mesh.get_positions()[primitive.z]);
+        }
+        return bounds;
+    }
+
+    // Tests that children are contained in their parents, that every primitive is referenced
+    // and that the union of the leaves referencing a primitive contains the primitive.
+    static void validate(const BVH& bvh, const std::vector<Math::AABB>& primitive_bounds) {
+        const std::vector<BVHNode>& nodes = bvh.get_nodes();
+        const std::vector<unsigned int>& primitive_indices = bvh.get_primitive_indices();
+
+        std::vector<Math::AABB> referenced_bounds(primitive_bounds.size(), Math::AABB::invalid());
+        unsigned int leaf_count = 0;
+        for (const BVHNode& node : nodes) {
+            if (node.is_leaf()) {
+                ++leaf_count;
+                for (unsigned int i = node.first_index; i < node.first_index + node.primitive_count; ++i)
+                    referenced_bounds[primitive_indices[i]].grow_to_contain(node.get_bounds());
+            } else {
+                EXPECT_TRUE(contains(node.get_bounds(), nodes[node.first_index].get_bounds()));
+                EXPECT_TRUE(contains(node.get_bounds(), nodes[node.first_index + 1].get_bounds()));
+            }
+        }
+
+        for (size_t p = 0; p < primitive_bounds.size(); ++p)
+            EXPECT_TRUE(contains(referenced_bounds[p], primitive_bounds[p]));
+
+        BVH::Statistics statistics = bvh.get_statistics();
+        EXPECT_EQ(nodes.size(), statistics.node_count);
+        EXPECT_EQ(leaf_count, statistics.leaf_count);
+        EXPECT_EQ(2 * leaf_count - 1, statistics.node_count);
+        EXPECT_EQ(primitive_indices.size(), statistics.reference_count);
+        EXPECT_EQ(primitive_bounds.size(), statistics.primitive_count);
+        EXPECT_FLOAT_EQ(bvh.compute_SAH_cost(), statistics.SAH_cost);
+    }
+};
+
+TEST_F(Geometry_BVH, SAH_build) {
+    Assets::Mesh sphere = Assets::MeshCreation::revolved_sphere(32, 16);
+    BVH bvh = BVH(sphere.get_ID());
+    validate(bvh, compute_primitive_bounds(sphere));
+
+    BVH::Statistics statistics = bvh.get_statistics();
+    EXPECT_EQ(sphere.get_primitive_count(), statistics.reference_count);
+    EXPECT_EQ(0u, statistics.spatial_split_count);
+    EXPECT_LE(statistics.max_leaf_size, 4u);
+    EXPECT_GE(statistics.build_time_in_seconds, 0.0);
+}
+
+TEST_F(Geometry_BVH, morton_build) {
+    Assets::Mesh sphere = Assets::MeshCreation::revolved_sphere(32, 16);
+    BVH::BuildSettings settings = BVH::BuildSettings::morton_settings();
+    BVH bvh = BVH(sphere.get_ID(), settings);
+    validate(bvh, compute_primitive_bounds(sphere));
+
+    BVH::Statistics statistics = bvh.get_statistics();
+    EXPECT_EQ(sphere.get_primitive_count(), statistics.reference_count);
+    EXPECT_LE(statistics.max_leaf_size, settings.max_leaf_size);
+
+    // The SAH build should be at least as good as the Morton build.
+    EXPECT_LE(BVH(sphere.get_ID()).get_statistics().SAH_cost, statistics.SAH_cost);
+}
+
+TEST_F(Geometry_BVH, spatial_splits) {
+    using namespace Math;
+
+    // Long thin diagonal triangles have large overlapping bounds, which spatial splits can separate.
+    const unsigned int triangle_count = 64;
+    Assets::Mesh mesh = Assets::Meshes::create("Diagonals", triangle_count, triangle_count * 3, Assets::MeshFlag::Position);
+    for (unsigned int t = 0; t < triangle_count; ++t) {
+        float offset = t * 0.1f;
+        mesh.get_primitives()[t] = Vector3ui(t * 3, t * 3 + 1, t * 3 + 2);
+        mesh.get_positions()[t * 3] = Vector3f(offset, 0, 0);
+        mesh.get_positions()[t * 3 + 1] = Vector3f(offset + 10.0f, 10.0f, 0.0f);
+        mesh.get_positions()[t * 3 + 2] = Vector3f(offset + 10.05f, 10.0f, 0.0f);
+    }
+
+    BVH::BuildSettings settings = BVH::BuildSettings::default_settings();
+    settings.spatial_splits = true;
+    settings.spatial_split_budget = 2.0f;
+    BVH bvh = BVH(mesh.get_ID(), settings);
+    validate(bvh, compute_primitive_bounds(mesh));
+
+    BVH::Statistics statistics = bvh.get_statistics();
+    EXPECT_LT(0u, statistics.spatial_split_count);
+    EXPECT_LT(triangle_count, statistics.reference_count);
+    EXPECT_LE(statistics.reference_count, triangle_count + triangle_count * settings.spatial_split_budget);
+    EXPECT_LT(statistics.SAH_cost, BVH(mesh.get_ID()).get_statistics().SAH_cost);
+
+    // Hierarchies with spatial splits can't be refit and are left unchanged.
+    std::vector<AABB> primitive_bounds = compute_primitive_bounds(mesh);
+    primitive_bounds[0] = AABB(Vector3f(-1.0f), Vector3f(0.0f));
+    unsigned int moved_primitive = 0;
+    EXPECT_FALSE(bvh.refit(primitive_bounds.data(), &moved_primitive, &moved_primitive + 1));
+    EXPECT_EQ(statistics.SAH_cost, bvh.get_statistics().SAH_cost);
+    EXPECT_EQ(statistics.reference_count, bvh.get_statistics().reference_count);
+}
+
+TEST_F(Geometry_BVH, spatial_splits_are_deterministic) {
+    using namespace Math;
+
+    // Enough overlapping diagonal triangles for the subtrees to be built in parallel and for the split budget to run out.
+    const unsigned int triangle_count = 16384;
+    Assets::Mesh mesh = Assets::Meshes::create("Diagonals", triangle_count, triangle_count * 3, Assets::MeshFlag::Position);
+    for (unsigned int t = 0; t < triangle_count; ++t) {
+        Vector3f offset = Vector3f(t * 0.1f, 0.0f, 0.0f);
+        mesh.get_primitives()[t] = Vector3ui(t * 3, t * 3 + 1, t * 3 + 2);
+        mesh.get_positions()[t * 3] = offset;
+        mesh.get_positions()[t * 3 + 1] = offset + Vector3f(10.0f, 10.0f, 0.0f);
+        mesh.get_positions()[t * 3 + 2] = offset + Vector3f(10.05f, 10.0f, 0.0f);
+    }
+
+    BVH::BuildSettings settings = BVH::BuildSettings::default_settings();
+    settings.spatial_splits = true;
+    settings.spatial_split_budget = 1.5f;
+    BVH bvh = BVH(mesh.get_ID(), settings);
+    BVH::Statistics statistics = bvh.get_statistics();
+    EXPECT_LT(0u, statistics.spatial_split_count);
+    EXPECT_LE(statistics.reference_count, triangle_count + triangle_count * settings.spatial_split_budget);
+
+    // Rebuilding produces the exact same layout.
+    for (int b = 0; b < 3; ++b) {
+        BVH rebuilt_bvh = BVH(mesh.get_ID(), settings);
+        EXPECT_EQ(statistics.spatial_split_count, rebuilt_bvh.get_statistics().spatial_split_count);
+        ASSERT_EQ(bvh.get_nodes().size(), rebuilt_bvh.get_nodes().size());
+        EXPECT_TRUE(bvh.get_primitive_indices() == rebuilt_bvh.get_primitive_indices());
+        for (size_t n = 0; n < bvh.get_nodes().size(); ++n) {
+            const BVHNode& node = bvh.get_nodes()[n];
+            const BVHNode& rebuilt_node = rebuilt_bvh.get_nodes()[n];
+            EXPECT_EQ(node.first_index, rebuilt_node.first_index);
+            EXPECT_EQ(node.primitive_count, rebuilt_node.primitive_count);
+            EXPECT_EQ(node.get_bounds(), rebuilt_node.get_bounds());
+        }
+    }
+}
+
+TEST_F(Geometry_BVH, build_over_bounds) {
+    using namespace Math;
+
+    std::vector<AABB> bounds;
+    for (int z = 0; z < 4; ++z)
+        for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 4; ++x)
+                bounds.push_back(AABB(Vector3f(float(x), float(y), float(z)), Vector3f(x + 0.5f, y + 0.5f, z + 0.5f)));
+
+    BVH bvh = BVH(bounds.data(), bounds.data() + bounds.size());
+    validate(bvh, bounds);
+    EXPECT_EQ(AABB(Vector3f(0.0f), Vector3f(3.5f)), bvh.get_bounds());
+
+    BVH empty_bvh = BVH(bounds.data(), bounds.data());
+    EXPECT_TRUE(empty_bvh.is_empty());
+    EXPECT_EQ(0u, empty_bvh.get_statistics().node_count);
+}
+
+TEST_F(Geometry_BVH, refit) {
+    using namespace Math;
+
+    std::vector<AABB> bounds;
+    for (int z = 0; z < 4; ++z)
+        for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 4; ++x)
+                bounds.push_back(AABB(Vector3f(float(x), float(y), float(z)), Vector3f(x + 0.5f, y + 0.5f, z + 0.5f)));
+    BVH bvh = BVH(bounds.data(), bounds.data() + bounds.size());
+    std::vector<BVHNode> nodes_before_refit = bvh.get_nodes();
+
+    // Move a few primitives, including one outside the original bounds.
+    unsigned int moved_primitives[] = { 0, 21, 63 };
+    for (unsigned int p : moved_primitives)
+        bounds[p] = AABB(bounds[p].minimum + Vector3f(0.25f, 1.0f, 0.5f), bounds[p].maximum + Vector3f(0.25f, 1.0f, 0.5f));
+    EXPECT_TRUE(bvh.refit(bounds.data(), moved_primitives, moved_primitives + 3));
+    validate(bvh, bounds);
+    EXPECT_EQ(AABB(Vector3f(0.0f), Vector3f(3.75f, 4.5f, 4.0f)), bvh.get_bounds());
+
+    // The topology is unchanged.
+    const std::vector<BVHNode>& nodes = bvh.get_nodes();
+    ASSERT_EQ(nodes_before_refit.size(), nodes.size());
+    for (size_t n = 0; n < nodes.size(); ++n) {
+        EXPECT_EQ(nodes_before_refit[n].first_index, nodes[n].first_index);
+        EXPECT_EQ(nodes_before_refit[n].primitive_count, nodes[n].primitive_count);
+    }
+}
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_BVH_TEST_H_
@@ -0,0 +1,210 @@
+// Test Cogwheel two level bounding volume hierarchy over the models in the scene.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_SCENE_BVH_TEST_H_
+#define _COGWHEEL_GEOMETRY_SCENE_BVH_TEST_H_
+
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Core/MemoryMappedFile.h>
+#include <Cogwheel/Geometry/BVHCache.h>
+#include <Cogwheel/Geometry/SceneBVH.h>
+
+#include <gtest/gtest.h>
+
+#include <Expects.h>
+#include <SceneTestUtils.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace Cogwheel {
+namespace Geometry {
+
+class Geometry_SceneBVH : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Assets::Materials::allocate(1u);
+        Assets::Meshes::allocate(8u);
+        Assets::MeshModels::allocate(8u);
+        Scene::LightSources::allocate(1u);
+        Scene::SceneNodes::allocate(8u);
+        Scene::SceneRoots::allocate(1u);
+    }
+    virtual void TearDown() {
+        Assets::Materials::deallocate();
+        Assets::Meshes::deallocate();
+        Assets::MeshModels::deallocate();
+        Scene::LightSources::deallocate();
+        Scene::SceneNodes::deallocate();
+        Scene::SceneRoots::deallocate();
+    }
+
+    // Rays from random points above the scene towards random points on the ground.
+    static std::vector<Math::Ray> create_random_rays(unsigned int ray_count, float scene_size) {
+        using namespace Math;
+
+        std::minstd_rand rng(19349663);
+        std::uniform_real_distribution<float> distribution(-2.0f, scene_size + 2.0f);
+        std::vector<Ray> rays(ray_count);
+        for (unsigned int r = 0; r < ray_count; ++r) {
+            Vector3f origin = Vector3f(distribution(rng), 5.0f, distribution(rng));
+            Vector3f target = Vector3f(distribution(rng), -1.0f, distribution(rng));
+            rays[r] = Ray(origin, normalize(target - origin));
+        }
+        return rays;
+    }
+
+    // Tests the scene hierarchy against tracing every model in the scene.
+    static void test_against_all_models(const SceneBVH& scene_bvh, const std::vector<Math::Ray>& rays) {
+        using namespace Assets;
+        using namespace Math;
+
+        std::vector<BVH8> mesh_BVHs(Meshes::capacity());
+        for (Meshes::UID mesh_ID : Meshes::get_iterable())
+            mesh_BVHs[mesh_ID] = BVH8(mesh_ID);
+
+        for (Ray ray : rays) {
+            SceneRayHit expected_hit = { MeshModels::UID::invalid_UID(), RayHit::miss() };
+            for (MeshModel model : MeshModels::get_iterable()) {
+                Transform world_to_object = model.get_scene_node().get_global_transform().inverse();
+                Ray object_ray = Ray(world_to_object * ray.origin, world_to_object.rotation * ray.direction * world_to_object.scale);
+                RayHit hit = mesh_BVHs[model.get_mesh().get_ID()].closest_hit(object_ray, expected_hit.hit.t);
+                if (hit.is_hit()) {
+                    expected_hit.model_ID = model.get_ID();
+                    expected_hit.hit = hit;
+                }
+            }
+
+            SceneRayHit hit = scene_bvh.closest_hit(ray);
+            EXPECT_EQ(expected_hit.is_hit(), hit.is_hit());
+            EXPECT_EQ(expected_hit.is_hit(), scene_bvh.any_hit(ray));
+            if (expected_hit.is_hit() && hit.is_hit()) {
+                EXPECT_EQ(expected_hit.model_ID, hit.model_ID);
+                EXPECT_FLOAT_EQ_EPS(expected_hit.hit.t, hit.hit.t, 0.0001f);
+                EXPECT_FALSE(scene_bvh.any_hit(ray, hit.hit.t * 0.99f));
+            }
+        }
+    }
+};
+
+TEST_F(Geometry_SceneBVH, closest_hit) {
+    TestUtils::create_model_grid(6);
+
+    SceneBVH scene_bvh;
+    scene_bvh.handle_updates();
+    EXPECT_EQ(36u, scene_bvh.get_statistics().model_count);
+    EXPECT_EQ(2u, scene_bvh.get_statistics().mesh_count);
+    EXPECT_EQ(1u, scene_bvh.get_statistics().rebuild_count);
+
+    test_against_all_models(scene_bvh, create_random_rays(256, 20.0f));
+}
+
+TEST_F(Geometry_SceneBVH, refit_moved_models) {
+    using namespace Math;
+
+    std::vector<Scene::SceneNodes::UID> node_IDs = TestUtils::create_model_grid(6);
+    SceneBVH scene_bvh;
+    scene_bvh.handle_updates();
+    TestUtils::reset_change_notifications();
+
+    // Nudge a few models. Only those are refit and the top level is not rebuilt.
+    for (int n = 0; n < 3; ++n) {
+        Transform transform = Scene::SceneNodes::get_global_transform(node_IDs[n * 7]);
+        transform.translation.y += 0.5f;
+        Scene::SceneNodes::set_global_transform(node_IDs[n * 7], transform);
+    }
+    scene_bvh.handle_updates();
+    EXPECT_EQ(3u, scene_bvh.get_statistics().refit_model_count);
+    EXPECT_EQ(1u, scene_bvh.get_statistics().refit_count);
+    EXPECT_EQ(1u, scene_bvh.get_statistics().rebuild_count);
+    test_against_all_models(scene_bvh, create_random_rays(256, 20.0f));
+    TestUtils::reset_change_notifications();
+
+    // Nothing changed, so the update does nothing.
+    scene_bvh.handle_updates();
+    EXPECT_EQ(0u, scene_bvh.get_statistics().refit_model_count);
+    EXPECT_EQ(1u, scene_bvh.get_statistics().refit_count);
+}
+
+TEST_F(Geometry_SceneBVH, rebuild_on_degradation) {
+    using namespace Math;
+
+    std::vector<Scene::SceneNodes::UID> node_IDs = TestUtils::create_model_grid(6);
+    SceneBVH scene_bvh;
+    scene_bvh.handle_updates();
+    TestUtils::reset_change_notifications();
+
+    // Shuffle the models, which leaves the bounds of most leaves spanning the scene after a refit.
+    std::vector<Transform> transforms;
+    for (Scene::SceneNodes::UID node_ID : node_IDs)
+        transforms.push_back(Scene::SceneNodes::get_global_transform(node_ID));
+    std::shuffle(transforms.begin(), transforms.end(), std::minstd_rand(83492791));
+    for (size_t n = 0; n < node_IDs.size(); ++n)
+        Scene::SceneNodes::set_global_transform(node_IDs[n], transforms[n]);
+    scene_bvh.handle_updates();
+    EXPECT_EQ(2u, scene_bvh.get_statistics().rebuild_count);
+    EXPECT_EQ(scene_bvh.get_statistics().rebuild_SAH_cost, scene_bvh.get_statistics().SAH_cost);
+    test_against_all_models(scene_bvh, create_random_rays(256, 20.0f));
+}
+
+TEST_F(Geometry_SceneBVH, create_and_destroy_models) {
+    using namespace Assets;
+
+    TestUtils::create_model_grid(2);
+    SceneBVH scene_bvh;
+    scene_bvh.handle_updates();
+    TestUtils::reset_change_notifications();
+
+    std::vector<MeshModels::UID> model_IDs;
+    for (MeshModels::UID model_ID : MeshModels::get_iterable())
+        model_IDs.push_back(model_ID);
+    MeshModels::destroy(model_IDs[0]);
+    MeshModels::destroy(model_IDs[3]);
+    scene_bvh.handle_updates();
+    EXPECT_EQ(2u, scene_bvh.get_statistics().model_count);
+    EXPECT_EQ(2u, scene_bvh.get_statistics().rebuild_count);
+    test_against_all_models(scene_bvh, create_random_rays(128, 4.0f));
+    TestUtils::reset_change_notifications();
+
+    MeshModels::destroy(model_IDs[1]);
+    MeshModels::destroy(model_IDs[2]);
+    scene_bvh.handle_updates();
+    EXPECT_TRUE(scene_bvh.is_empty());
+    EXPECT_EQ(0u, scene_bvh.get_statistics().mesh_count);
+    EXPECT_FALSE(scene_bvh.closest_hit(Math::Ray(Math::Vector3f(0.0f, 5.0f, 0.0f), -Math::Vector3f::up())).is_hit());
+}
+
+TEST_F(Geometry_SceneBVH, cached_mesh_BVHs) {
+    TestUtils::create_model_grid(2);
+
+    SceneBVH::Settings settings = SceneBVH::Settings::default_settings();
+    settings.cache_directory = ".";
+
+    // The first hierarchy stores the mesh BVHs in the cache and the second loads them.
+    for (int i = 0; i < 2; ++i) {
+        SceneBVH scene_bvh = SceneBVH(settings);
+        scene_bvh.handle_updates();
+        EXPECT_EQ(2u, scene_bvh.get_statistics().mesh_count);
+        test_against_all_models(scene_bvh, create_random_rays(128, 4.0f));
+    }
+
+    for (Assets::Meshes::UID mesh_ID : Assets::Meshes::get_iterable()) {
+        std::string path = BVHCache::get_path(".", BVHCache::compute_mesh_hash(mesh_ID));
+        EXPECT_NE(0u, Core::MemoryMappedFile::get_modification_time(path));
+        remove(path.c_str());
+    }
+}
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_SCENE_BVH_TEST_H_
@@ -0,0 +1,156 @@
+// Test Cogwheel hierarchy over the world space bounds of the models in the scene.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_SCENE_BOUNDS_TEST_H_
+#define _COGWHEEL_GEOMETRY_SCENE_BOUNDS_TEST_H_
+
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Geometry/SceneBounds.h>
+#include <Cogwheel/Math/Conversions.h>
+#include <Cogwheel/Scene/Camera.h>
+
+#include <gtest/gtest.h>
+
+#include <SceneTestUtils.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace Cogwheel {
+namespace Geometry {
+
+class Geometry_SceneBounds : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Assets::Materials::allocate(1u);
+        Assets::Meshes::allocate(2u);
+        Assets::MeshModels::allocate(128u);
+        Scene::LightSources::allocate(1u);
+        Scene::SceneNodes::allocate(128u);
+        Scene::SceneRoots::allocate(1u);
+    }
+    virtual void TearDown() {
+        Assets::Materials::deallocate();
+        Assets::Meshes::deallocate();
+        Assets::MeshModels::deallocate();
+        Scene::LightSources::deallocate();
+        Scene::SceneNodes::deallocate();
+        Scene::SceneRoots::deallocate();
+    }
+
+    static Math::Matrix4x4f view_projection_matrix(Math::Transform camera_transform) {
+        using namespace Math;
+
+        Matrix4x4f projection_matrix, inverse_projection_matrix;
+        Scene::CameraUtils::compute_perspective_projection(0.5f, 100.0f, 1.0f, 1.0f, projection_matrix, inverse_projection_matrix);
+        return projection_matrix * to_matrix4x4(invert(camera_transform));
+    }
+
+    static std::vector<Assets::MeshModels::UID> cull(const SceneBounds& scene_bounds, Math::Transform camera_transform) {
+        std::vector<Assets::MeshModels::UID> visible_model_IDs;
+        scene_bounds.cull(view_projection_matrix(camera_transform), visible_model_IDs);
+        std::sort(visible_model_IDs.begin(), visible_model_IDs.end());
+        return visible_model_IDs;
+    }
+
+    // Culls the models one by one.
+    static std::vector<Assets::MeshModels::UID> brute_force_cull(Math::Transform camera_transform) {
+        using namespace Assets;
+
+        Math::Frustum frustum = Math::Frustum::from_view_projection_matrix(view_projection_matrix(camera_transform));
+        std::vector<MeshModels::UID> visible_model_IDs;
+        for (MeshModel model : MeshModels::get_iterable()) {
+            Math::Transform transform = model.get_scene_node().get_global_transform();
+            Math::AABB mesh_bounds = model.get_mesh().get_bounds();
+            Math::AABB bounds = Math::AABB::invalid();
+            for (int c = 0; c < 8; ++c)
+                bounds.grow_to_contain(transform * Math::Vector3f(c & 1 ? mesh_bounds.maximum.x : mesh_bounds.minimum.x,
+                                                                  c & 2 ? mesh_bounds.maximum.y : mesh_bounds.minimum.y,
+                                                                  c & 4 ? mesh_bounds.maximum.z : mesh_bounds.minimum.z));
+            if (frustum.intersects(bounds))
+                visible_model_IDs.push_back(model.get_ID());
+        }
+        std::sort(visible_model_IDs.begin(), visible_model_IDs.end());
+        return visible_model_IDs;
+    }
+};
+
+TEST_F(Geometry_SceneBounds, frustum_planes) {
+    using namespace Math;
+
+    // Camera at the origin looking along +z.
+    Frustum frustum = Frustum::from_view_projection_matrix(view_projection_matrix(Transform::identity()));
+    EXPECT_TRUE(frustum.intersects(AABB(Vector3f(-0.1f, -0.1f, 5.0f), Vector3f(0.1f, 0.1f, 5.2f))));
+    EXPECT_TRUE(frustum.intersects(AABB(Vector3f(-1.0f, -1.0f, 90.0f), Vector3f(1.0f, 1.0f, 110.0f))));
+    EXPECT_FALSE(frustum.intersects(AABB(Vector3f(-0.1f, -0.1f, -5.2f), Vector3f(0.1f, 0.1f, -5.0f))));
+    EXPECT_FALSE(frustum.intersects(AABB(Vector3f(-0.1f, -0.1f, 0.0f), Vector3f(0.1f, 0.1f, 0.4f))));
+    EXPECT_FALSE(frustum.intersects(AABB(Vector3f(-1.0f, -1.0f, 101.0f), Vector3f(1.0f, 1.0f, 102.0f))));
+    EXPECT_FALSE(frustum.intersects(AABB(Vector3f(10.0f, -0.1f, 5.0f), Vector3f(11.0f, 0.1f, 5.2f))));
+    EXPECT_FALSE(frustum.intersects(AABB(Vector3f(-0.1f, -11.0f, 5.0f), Vector3f(0.1f, -10.0f, 5.2f))));
+}
+
+TEST_F(Geometry_SceneBounds, cull) {
+    using namespace Math;
+
+    TestUtils::create_model_grid(10);
+    SceneBounds scene_bounds;
+    scene_bounds.handle_updates();
+    EXPECT_EQ(100u, scene_bounds.get_statistics().model_count);
+
+    Transform camera_transforms[] = {
+        Transform(Vector3f(18.0f, 2.0f, -10.0f)),
+        Transform(Vector3f(-6.0f, 3.0f, -6.0f), Quaternionf::look_in(normalize(Vector3f(1.0f, -0.2f, 1.0f)))),
+        Transform(Vector3f(18.0f, 1.0f, 18.0f), Quaternionf::look_in(Vector3f(-1.0f, 0.0f, 0.0f))),
+        Transform(Vector3f(18.0f, 1.0f, 50.0f)) // Looking away from the grid.
+    };
+    for (Transform camera_transform : camera_transforms) {
+        std::vector<Assets::MeshModels::UID> visible_model_IDs = cull(scene_bounds, camera_transform);
+        EXPECT_EQ(brute_force_cull(camera_transform), visible_model_IDs);
+    }
+    EXPECT_LT(0u, cull(scene_bounds, camera_transforms[0]).size());
+    EXPECT_GT(100u, cull(scene_bounds, camera_transforms[0]).size());
+    EXPECT_EQ(0u, cull(scene_bounds, camera_transforms[3]).size());
+
+    // Everything is visible from far behind the grid.
+    EXPECT_EQ(100u, cull(scene_bounds, Transform(Vector3f(18.0f, 10.0f, -60.0f))).size());
+}
+
+TEST_F(Geometry_SceneBounds, update_moved_and_destroyed_models) {
+    using namespace Math;
+
+    std::vector<Scene::SceneNodes::UID> node_IDs = TestUtils::create_model_grid(4);
+    TestUtils::reset_change_notifications();
+    SceneBounds scene_bounds; // Created after the notifications were reset, so the models are added on construction.
+    EXPECT_EQ(16u, scene_bounds.get_statistics().model_count);
+
+    Transform camera_transform = Transform(Vector3f(0.0f, 0.0f, -10.0f));
+    std::vector<Assets::MeshModels::UID> visible_model_IDs = cull(scene_bounds, camera_transform);
+    EXPECT_EQ(brute_force_cull(camera_transform), visible_model_IDs);
+
+    // Move the model in front of the camera out of view.
+    Scene::SceneNodes::set_global_transform(node_IDs[0], Transform(Vector3f(0.0f, 0.0f, -20.0f)));
+    scene_bounds.handle_updates();
+    EXPECT_EQ(1u, scene_bounds.get_statistics().refit_model_count);
+    std::vector<Assets::MeshModels::UID> moved_visible_model_IDs = cull(scene_bounds, camera_transform);
+    EXPECT_EQ(brute_force_cull(camera_transform), moved_visible_model_IDs);
+    EXPECT_EQ(visible_model_IDs.size() - 1, moved_visible_model_IDs.size());
+    TestUtils::reset_change_notifications();
+
+    // Destroy every visible model.
+    for (Assets::MeshModels::UID model_ID : moved_visible_model_IDs)
+        Assets::MeshModels::destroy(model_ID);
+    scene_bounds.handle_updates();
+    EXPECT_EQ(0u, cull(scene_bounds, camera_transform).size());
+}
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_SCENE_BOUNDS_TEST_H_
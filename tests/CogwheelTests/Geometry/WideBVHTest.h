@@ -0,0 +1,195 @@
+// Test Cogwheel wide bounding volume hierarchy and ray traversal.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_GEOMETRY_WIDE_BVH_TEST_H_
+#define _COGWHEEL_GEOMETRY_WIDE_BVH_TEST_H_
+
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Geometry/WideBVH.h>
+
+#include <gtest/gtest.h>
+
+#include <Expects.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace Cogwheel {
+namespace Geometry {
+
+class Geometry_WideBVH : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Assets::Meshes::allocate(8u);
+    }
+    virtual void TearDown() {
+        Assets::Meshes::deallocate();
+    }
+
+    // Brute force closest hit, see Moller and Trumbore, Fast, Minimum Storage Ray/Triangle Intersection, 1997.
+    static RayHit brute_force_closest_hit(Assets::Mesh mesh, Math::Ray ray) {
+        using namespace Math;
+
+        RayHit hit = RayHit::miss();
+        for (unsigned int p = 0; p < mesh.get_primitive_count(); ++p) {
+            Vector3ui primitive = mesh.get_primitives()[p];
+            Vector3f v0 = mesh.get_positions()[primitive.x];
+            Vector3f e1 = mesh.get_positions()[primitive.y] - v0;
+            Vector3f e2 = mesh.get_positions()[primitive.z] - v0;
+            Vector3f pvec = cross(ray.direction, e2);
+            float determinant = dot(e1, pvec);
+            if (determinant == 0.0f)
+                continue;
+            float inverse_determinant = 1.0f / determinant;
+            Vector3f tvec = ray.origin - v0;
+            float u = dot(tvec, pvec) * inverse_determinant;
+            Vector3f qvec = cross(tvec, e1);
+            float v = dot(ray.direction, qvec) * inverse_determinant;
+            float t = dot(e2, qvec) * inverse_determinant;
+            if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && 0.0f <= t && t < hit.t) {
+                RayHit new_hit = { t, u, v, p };
+                hit = new_hit;
+            }
+        }
+        return hit;
+    }
+
+    // Rays from random points around the unit cube towards random points inside it.
+    static std::vector<Math::Ray> create_random_rays(unsigned int ray_count) {
+        using namespace Math;
+
+        std::minstd_rand rng(73856093);
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        std::vector<Ray> rays(ray_count);
+        for (unsigned int r = 0; r < ray_count; ++r) {
+            Vector3f origin = Vector3f(distribution(rng), distribution(rng), distribution(rng)) * 3.0f;
+            Vector3f target = Vector3f(distribution(rng), distribution(rng), distribution(rng)) * 0.5f;
+            rays[r] = Ray(origin, normalize(target - origin));
+        }
+        return rays;
+    }
+
+    template <int Width>
+    static void test_against_brute_force(Assets::Mesh mesh) {
+        WideBVH<Width> bvh = WideBVH<Width>(mesh.get_ID());
+
+        std::vector<Math::Ray> rays = create_random_rays(256);
+        for (Math::Ray ray : rays) {
+            RayHit expected_hit = brute_force_closest_hit(mesh, ray);
+            RayHit hit = bvh.closest_hit(ray);
+            EXPECT_EQ(expected_hit.is_hit(), hit.is_hit());
+            if (expected_hit.is_hit() && hit.is_hit()) {
+                EXPECT_FLOAT_EQ_EPS(expected_hit.t, hit.t, 0.0001f);
+                EXPECT_EQ(expected_hit.is_hit(), bvh.any_hit(ray));
+                EXPECT_FALSE(bvh.any_hit(ray, hit.t * 0.99f));
+            }
+        }
+
+        // Packets produce the same hits as single rays.
+        std::vector<float> t_maxs(rays.size(), std::numeric_limits<float>::infinity());
+        std::vector<RayHit> hits(rays.size());
+        std::unique_ptr<bool[]> occlusions = std::unique_ptr<bool[]>(new bool[rays.size()]);
+        bvh.closest_hit(rays.data(), t_maxs.data(), int(rays.size()), hits.data());
+        bvh.any_hit(rays.data(), t_maxs.data(), int(rays.size()), occlusions.get());
+        for (size_t r = 0; r < rays.size(); ++r) {
+            RayHit hit = bvh.closest_hit(rays[r]);
+            EXPECT_EQ(hit.primitive_index, hits[r].primitive_index);
+            EXPECT_EQ(hit.t, hits[r].t);
+            EXPECT_EQ(hit.is_hit(), occlusions[r]);
+        }
+    }
+};
+
+TEST_F(Geometry_WideBVH, collapse) {
+    Assets::Mesh sphere = Assets::MeshCreation::revolved_sphere(32, 16);
+    BVH bvh = BVH(sphere.get_ID());
+    BVH4 bvh4 = BVH4(bvh, sphere.get_ID());
+    BVH8 bvh8 = BVH8(bvh, sphere.get_ID());
+
+    // Every primitive is referenced exactly once.
+    std::vector<int> primitive_reference_counts(sphere.get_primitive_count(), 0);
+    for (TrianglePack pack : bvh8.get_triangle_packs())
+        for (int lane = 0; lane < TrianglePack::width; ++lane)
+            if (pack.primitive_indices[lane] != RayHit::no_primitive)
+                ++primitive_reference_counts[pack.primitive_indices[lane]];
+    for (int reference_count : primitive_reference_counts)
+        EXPECT_EQ(1, reference_count);
+
+    EXPECT_EQ(bvh.get_statistics().leaf_count, bvh4.get_statistics().leaf_count);
+    EXPECT_EQ(bvh.get_statistics().leaf_count, bvh8.get_statistics().leaf_count);
+    EXPECT_LT(bvh8.get_statistics().node_count, bvh4.get_statistics().node_count);
+    EXPECT_LT(bvh4.get_statistics().node_count, bvh.get_statistics().node_count);
+    EXPECT_LT(2.0f, bvh4.get_statistics().average_child_count);
+    EXPECT_LE(bvh4.get_statistics().average_child_count, 4.0f);
+    EXPECT_LE(bvh8.get_statistics().average_child_count, 8.0f);
+}
+
+TEST_F(Geometry_WideBVH, BVH4_closest_hit) {
+    test_against_brute_force<4>(Assets::MeshCreation::revolved_sphere(32, 16));
+    test_against_brute_force<4>(Assets::MeshCreation::torus(32, 16, 0.1f));
+}
+
+TEST_F(Geometry_WideBVH, BVH8_closest_hit) {
+    test_against_brute_force<8>(Assets::MeshCreation::revolved_sphere(32, 16));
+    test_against_brute_force<8>(Assets::MeshCreation::torus(32, 16, 0.1f));
+}
+
+TEST_F(Geometry_WideBVH, watertight) {
+    using namespace Math;
+
+    // Rays through the shared edges and vertices inside a tessellated plane must hit it.
+    // The plane spans [-4, 4] along x and z with a vertex at every integer coordinate.
+    Assets::Mesh plane = Assets::MeshCreation::plane(8);
+    BVH8 bvh = BVH8(plane.get_ID());
+    for (int z = -3; z <= 3; ++z)
+        for (int x = -3; x <= 3; ++x) {
+            Vector3f targets[3] = { Vector3f(float(x), 0.0f, float(z)), Vector3f(x + 0.5f, 0.0f, float(z)), Vector3f(x + 0.5f, 0.0f, z + 0.5f) };
+            for (Vector3f target : targets) {
+                Ray ray = Ray(target + Vector3f(0.1f, 1.0f, 0.2f), normalize(Vector3f(-0.1f, -1.0f, -0.2f)));
+                EXPECT_TRUE(bvh.closest_hit(ray).is_hit());
+                EXPECT_TRUE(bvh.any_hit(ray));
+            }
+        }
+}
+
+TEST_F(Geometry_WideBVH, triangle_soup) {
+    // Triangle soups have no index buffer and store their triangles as consecutive vertices.
+    Assets::Mesh sphere = Assets::MeshCreation::revolved_sphere(16, 8);
+    Assets::Mesh soup = Assets::Meshes::create("Soup", 0, sphere.get_index_count(), Assets::MeshFlag::Position);
+    Math::Vector3f* positions = Assets::MeshUtils::expand_indexed_buffer(sphere.get_primitives(), sphere.get_primitive_count(), sphere.get_positions());
+    std::copy(positions, positions + sphere.get_index_count(), soup.get_positions());
+    delete[] positions;
+
+    BVH8 sphere_bvh = BVH8(sphere.get_ID());
+    BVH8 soup_bvh = BVH8(soup.get_ID());
+    for (Math::Ray ray : create_random_rays(64)) {
+        RayHit expected_hit = sphere_bvh.closest_hit(ray);
+        RayHit hit = soup_bvh.closest_hit(ray);
+        EXPECT_EQ(expected_hit.primitive_index, hit.primitive_index);
+        EXPECT_EQ(expected_hit.t, hit.t);
+    }
+}
+
+TEST_F(Geometry_WideBVH, empty_mesh) {
+    Assets::Mesh mesh = Assets::Meshes::create("Empty", 0, 0, Assets::MeshFlag::Position);
+    BVH4 bvh = BVH4(mesh.get_ID());
+    EXPECT_TRUE(bvh.is_empty());
+
+    Math::Ray ray = Math::Ray(Math::Vector3f::zero(), Math::Vector3f::forward());
+    EXPECT_FALSE(bvh.closest_hit(ray).is_hit());
+    EXPECT_FALSE(bvh.any_hit(ray));
+}
+
+} // NS Geometry
+} // NS Cogwheel
+
+#endif // _COGWHEEL_GEOMETRY_WIDE_BVH_TEST_H_
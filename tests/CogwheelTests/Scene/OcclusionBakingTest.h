@@ -0,0 +1,213 @@
+// Test Cogwheel ambient occlusion and bent normal baking.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_SCENE_OCCLUSION_BAKING_TEST_H_
+#define _COGWHEEL_SCENE_OCCLUSION_BAKING_TEST_H_
+
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Scene/OcclusionBaking.h>
+
+#include <gtest/gtest.h>
+
+namespace Cogwheel {
+namespace Scene {
+
+class Scene_OcclusionBaking : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Assets::Images::allocate(4u);
+        Assets::Materials::allocate(1u);
+        Assets::Meshes::allocate(2u);
+        Assets::MeshModels::allocate(2u);
+        SceneNodes::allocate(4u);
+        SceneRoots::allocate(1u);
+    }
+    virtual void TearDown() {
+        Assets::Images::deallocate();
+        Assets::Materials::deallocate();
+        Assets::Meshes::deallocate();
+        Assets::MeshModels::deallocate();
+        SceneNodes::deallocate();
+        SceneRoots::deallocate();
+    }
+
+    static OcclusionBaking::Settings test_settings() {
+        OcclusionBaking::Settings settings = OcclusionBaking::Settings::default_settings();
+        settings.size = Math::Vector2ui(16u, 16u);
+        settings.sample_count = 64u;
+        return settings;
+    }
+
+    // Creates a unit plane at y = 0 and returns its model ID.
+    static Assets::MeshModels::UID create_ground(Assets::Meshes::UID plane_ID) {
+        using namespace Assets;
+
+        Materials::Data material_data = {};
+        Materials::UID material_ID = Materials::create("Material", material_data);
+        SceneNodes::UID node_ID = SceneNodes::create("Ground", Math::Transform::identity());
+        return MeshModels::create(node_ID, plane_ID, material_ID);
+    }
+
+    // Creates a downward facing occluder of size four by four at height 0.25, centered at x.
+    static void create_occluder(Assets::Meshes::UID plane_ID, float x) {
+        using namespace Math;
+
+        Quaternionf rotation = Quaternionf::from_angle_axis(PI<float>(), Vector3f::right());
+        SceneNodes::UID node_ID = SceneNodes::create("Occluder", Transform(Vector3f(x, 0.25f, 0.0f), rotation, 4.0f));
+        Assets::MeshModels::create(node_ID, plane_ID, Assets::MeshModels::get_material_ID(*Assets::MeshModels::begin()));
+    }
+
+    static Math::RGBA get_pixel(Assets::Images::UID image_ID, unsigned int x, unsigned int y) {
+        return Assets::Images::get_pixel(image_ID, Math::Vector2ui(x, y));
+    }
+};
+
+TEST_F(Scene_OcclusionBaking, unoccluded_plane) {
+    using namespace Assets;
+
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", Math::RGB::black());
+    Meshes::UID plane_ID = MeshCreation::plane(1);
+    MeshModels::UID ground_ID = create_ground(plane_ID);
+    RayQuery ray_query = RayQuery(scene_ID);
+
+    OcclusionBaking::Result result = OcclusionBaking::bake(ray_query, ground_ID, test_settings());
+    ASSERT_TRUE(Images::has(result.ambient_occlusion_ID));
+    ASSERT_TRUE(Images::has(result.bent_normals_ID));
+    EXPECT_EQ(PixelFormat::I8, Images::get_pixel_format(result.ambient_occlusion_ID));
+    EXPECT_EQ(PixelFormat::RGB24, Images::get_pixel_format(result.bent_normals_ID));
+    EXPECT_EQ(16u, Images::get_width(result.ambient_occlusion_ID));
+    EXPECT_EQ(16u, Images::get_height(result.ambient_occlusion_ID));
+
+    // The plane is only occluded by rays below its horizon, which aren't traced.
+    for (unsigned int y = 0; y < 16; ++y)
+        for (unsigned int x = 0; x < 16; ++x) {
+            EXPECT_FLOAT_EQ(1.0f, get_pixel(result.ambient_occlusion_ID, x, y).r);
+
+            // The bent normal is the normal of the plane, mapped to [0, 1].
+            Math::RGBA bent_normal = get_pixel(result.bent_normals_ID, x, y);
+            EXPECT_NEAR(0.5f, bent_normal.r, 0.05f);
+            EXPECT_LT(0.95f, bent_normal.g);
+            EXPECT_NEAR(0.5f, bent_normal.b, 0.05f);
+        }
+}
+
+TEST_F(Scene_OcclusionBaking, occluded_plane) {
+    using namespace Assets;
+
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", Math::RGB::black());
+    Meshes::UID plane_ID = MeshCreation::plane(1);
+    MeshModels::UID ground_ID = create_ground(plane_ID);
+    create_occluder(plane_ID, 0.0f);
+    RayQuery ray_query = RayQuery(scene_ID);
+
+    // Only rays close to the horizon escape between the planes.
+    OcclusionBaking::Settings settings = test_settings();
+    OcclusionBaking::Result result = OcclusionBaking::bake(ray_query, ground_ID, settings);
+    EXPECT_GT(0.1f, get_pixel(result.ambient_occlusion_ID, 8, 8).r);
+
+    // Occluders further away than the max distance are ignored.
+    settings.max_distance = 0.2f;
+    result = OcclusionBaking::bake(ray_query, ground_ID, settings);
+    EXPECT_FLOAT_EQ(1.0f, get_pixel(result.ambient_occlusion_ID, 8, 8).r);
+}
+
+TEST_F(Scene_OcclusionBaking, bent_normals_point_away_from_occluders) {
+    using namespace Assets;
+
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", Math::RGB::black());
+    Meshes::UID plane_ID = MeshCreation::plane(1);
+    MeshModels::UID ground_ID = create_ground(plane_ID);
+    create_occluder(plane_ID, 2.0f); // Covers the positive x half space.
+    RayQuery ray_query = RayQuery(scene_ID);
+
+    OcclusionBaking::Result result = OcclusionBaking::bake(ray_query, ground_ID, test_settings());
+    float ambient_occlusion = get_pixel(result.ambient_occlusion_ID, 8, 8).r;
+    EXPECT_LT(0.3f, ambient_occlusion);
+    EXPECT_GT(0.7f, ambient_occlusion);
+
+    Math::RGBA bent_normal = get_pixel(result.bent_normals_ID, 8, 8);
+    EXPECT_GT(0.4f, bent_normal.r);
+    EXPECT_LT(0.5f, bent_normal.g);
+    EXPECT_NEAR(0.5f, bent_normal.b, 0.05f);
+}
+
+TEST_F(Scene_OcclusionBaking, dilation) {
+    using namespace Assets;
+
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", Math::RGB::black());
+    Meshes::UID plane_ID = MeshCreation::plane(1);
+    // Shrink the texcoords to [0.25, 0.75], which covers texel 4 to 11 in each dimension.
+    Math::Vector2f* texcoords = Meshes::get_texcoords(plane_ID);
+    for (unsigned int v = 0; v < Meshes::get_vertex_count(plane_ID); ++v)
+        texcoords[v] = texcoords[v] * 0.5f + 0.25f;
+    MeshModels::UID ground_ID = create_ground(plane_ID);
+    RayQuery ray_query = RayQuery(scene_ID);
+
+    // Uncovered texels have zero length bent normals.
+    OcclusionBaking::Settings settings = test_settings();
+    settings.dilation_texel_count = 0u;
+    OcclusionBaking::Result result = OcclusionBaking::bake(ray_query, ground_ID, settings);
+    EXPECT_LT(0.95f, get_pixel(result.bent_normals_ID, 4, 8).g);
+    EXPECT_NEAR(0.5f, get_pixel(result.bent_normals_ID, 3, 8).g, 0.01f);
+    EXPECT_LT(0.95f, get_pixel(result.bent_normals_ID, 11, 11).g);
+    EXPECT_NEAR(0.5f, get_pixel(result.bent_normals_ID, 12, 12).g, 0.01f);
+
+    // Dilate two texels into the uncovered texels.
+    settings.dilation_texel_count = 2u;
+    result = OcclusionBaking::bake(ray_query, ground_ID, settings);
+    EXPECT_LT(0.95f, get_pixel(result.bent_normals_ID, 2, 8).g);
+    EXPECT_NEAR(0.5f, get_pixel(result.bent_normals_ID, 1, 8).g, 0.01f);
+    EXPECT_LT(0.95f, get_pixel(result.bent_normals_ID, 13, 13).g);
+    EXPECT_NEAR(0.5f, get_pixel(result.bent_normals_ID, 14, 14).g, 0.01f);
+}
+
+TEST_F(Scene_OcclusionBaking, triangle_soup) {
+    using namespace Assets;
+
+    // Expand the plane to a triangle soup, which stores its triangles as consecutive vertices.
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", Math::RGB::black());
+    Mesh plane = MeshCreation::plane(1);
+    Mesh soup = Meshes::create("Soup", 0u, plane.get_index_count(), MeshFlag::AllBuffers);
+    for (unsigned int p = 0; p < plane.get_primitive_count(); ++p)
+        for (int v = 0; v < 3; ++v) {
+            unsigned int vertex_index = plane.get_primitives()[p][v];
+            soup.get_positions()[3 * p + v] = plane.get_positions()[vertex_index];
+            soup.get_normals()[3 * p + v] = plane.get_normals()[vertex_index];
+            soup.get_texcoords()[3 * p + v] = plane.get_texcoords()[vertex_index];
+        }
+    soup.compute_bounds();
+    MeshModels::UID ground_ID = create_ground(soup.get_ID());
+    RayQuery ray_query = RayQuery(scene_ID);
+
+    OcclusionBaking::Result result = OcclusionBaking::bake(ray_query, ground_ID, test_settings());
+    ASSERT_TRUE(Images::has(result.ambient_occlusion_ID));
+    for (unsigned int y = 0; y < 16; ++y)
+        for (unsigned int x = 0; x < 16; ++x) {
+            EXPECT_FLOAT_EQ(1.0f, get_pixel(result.ambient_occlusion_ID, x, y).r);
+            EXPECT_LT(0.95f, get_pixel(result.bent_normals_ID, x, y).g);
+        }
+}
+
+TEST_F(Scene_OcclusionBaking, mesh_without_texcoords) {
+    using namespace Assets;
+
+    SceneRoots::UID scene_ID = SceneRoots::create("Scene", Math::RGB::black());
+    Meshes::UID plane_ID = MeshCreation::plane(1, { MeshFlag::Position, MeshFlag::Normal });
+    MeshModels::UID ground_ID = create_ground(plane_ID);
+    RayQuery ray_query = RayQuery(scene_ID);
+
+    OcclusionBaking::Result result = OcclusionBaking::bake(ray_query, ground_ID, test_settings());
+    EXPECT_EQ(Images::UID::invalid_UID(), result.ambient_occlusion_ID);
+    EXPECT_EQ(Images::UID::invalid_UID(), result.bent_normals_ID);
+}
+
+} // NS Scene
+} // NS Cogwheel
+
+#endif // _COGWHEEL_SCENE_OCCLUSION_BAKING_TEST_H_
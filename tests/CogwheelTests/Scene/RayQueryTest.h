@@ -0,0 +1,186 @@
+// Test Cogwheel scene ray queries.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_SCENE_RAY_QUERY_TEST_H_
+#define _COGWHEEL_SCENE_RAY_QUERY_TEST_H_
+
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Scene/RayQuery.h>
+
+#include <gtest/gtest.h>
+
+#include <Expects.h>
+#include <SceneTestUtils.h>
+
+namespace Cogwheel {
+namespace Scene {
+
+class Scene_RayQuery : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Assets::Materials::allocate(1u);
+        Assets::Meshes::allocate(2u);
+        Assets::MeshModels::allocate(2u);
+        LightSources::allocate(1u);
+        SceneNodes::allocate(4u);
+        SceneRoots::allocate(1u);
+    }
+    virtual void TearDown() {
+        Assets::Materials::deallocate();
+        Assets::Meshes::deallocate();
+        Assets::MeshModels::deallocate();
+        LightSources::deallocate();
+        SceneNodes::deallocate();
+        SceneRoots::deallocate();
+    }
+
+    // Creates a scene with a two by two unit plane at y = 0 and another at y = 1, which is offset by one along x.
+    static SceneRoots::UID create_scene(Assets::MeshModels::UID* model_IDs) {
+        using namespace Assets;
+        using namespace Math;
+
+        SceneRoots::UID scene_ID = SceneRoots::create("Scene", RGB::black());
+        SceneNodes::UID root_ID = SceneRoots::get_root_node(scene_ID);
+
+        Meshes::UID plane_ID = MeshCreation::plane(2);
+        Materials::Data material_data = {};
+        Materials::UID material_ID = Materials::create("Material", material_data);
+
+        SceneNodes::UID lower_node_ID = SceneNodes::create("Lower", Transform::identity());
+        SceneNodes::set_parent(lower_node_ID, root_ID);
+        model_IDs[0] = MeshModels::create(lower_node_ID, plane_ID, material_ID);
+
+        SceneNodes::UID upper_node_ID = SceneNodes::create("Upper", Transform(Vector3f(1.0f, 1.0f, 0.0f)));
+        SceneNodes::set_parent(upper_node_ID, root_ID);
+        model_IDs[1] = MeshModels::create(upper_node_ID, plane_ID, material_ID);
+
+        return scene_ID;
+    }
+
+    static Math::Ray downward_ray(float x, float z) {
+        return Math::Ray(Math::Vector3f(x, 3.0f, z), -Math::Vector3f::up());
+    }
+};
+
+TEST_F(Scene_RayQuery, closest_hit) {
+    using namespace Math;
+
+    Assets::MeshModels::UID model_IDs[2];
+    RayQuery query = RayQuery(create_scene(model_IDs));
+    query.handle_updates();
+
+    // Only the lower plane.
+    RayQuery::Hit hit = query.closest_hit(downward_ray(-0.5f, 0.25f));
+    EXPECT_TRUE(hit.is_hit());
+    EXPECT_EQ(model_IDs[0], hit.model_ID);
+    EXPECT_FLOAT_EQ(3.0f, hit.distance);
+
+    // The barycentric coordinates interpolate the hit triangle's vertices to the intersection point.
+    Assets::Mesh mesh = Assets::MeshModels::get_mesh_ID(hit.model_ID);
+    ASSERT_LT(hit.primitive_index, mesh.get_primitive_count());
+    Vector3ui primitive = mesh.get_primitives()[hit.primitive_index];
+    Vector3f* positions = mesh.get_positions();
+    Vector3f position = positions[primitive.x] * (1.0f - hit.barycentric.x - hit.barycentric.y) +
+        positions[primitive.y] * hit.barycentric.x + positions[primitive.z] * hit.barycentric.y;
+    EXPECT_FLOAT_EQ_EPS(-0.5f, position.x, 0.0001f);
+    EXPECT_FLOAT_EQ_EPS(0.25f, position.z, 0.0001f);
+
+    // Both planes, where the upper is closest.
+    hit = query.closest_hit(downward_ray(0.5f, 0.25f));
+    EXPECT_EQ(model_IDs[1], hit.model_ID);
+    EXPECT_FLOAT_EQ(2.0f, hit.distance);
+
+    // Only the lower plane is within reach.
+    hit = query.closest_hit(Ray(Vector3f(0.5f, 0.5f, 0.25f), -Vector3f::up()));
+    EXPECT_EQ(model_IDs[0], hit.model_ID);
+    EXPECT_FLOAT_EQ(0.5f, hit.distance);
+
+    // Outside both planes.
+    EXPECT_FALSE(query.closest_hit(downward_ray(3.0f, 0.0f)).is_hit());
+    EXPECT_FALSE(query.closest_hit(Ray(Vector3f(0.0f, 3.0f, 0.0f), Vector3f::up())).is_hit());
+}
+
+TEST_F(Scene_RayQuery, any_hit) {
+    Assets::MeshModels::UID model_IDs[2];
+    RayQuery query = RayQuery(create_scene(model_IDs));
+    query.handle_updates();
+
+    EXPECT_TRUE(query.any_hit(downward_ray(-0.5f, 0.0f)));
+    EXPECT_TRUE(query.any_hit(downward_ray(-0.5f, 0.0f), 3.5f));
+    EXPECT_FALSE(query.any_hit(downward_ray(-0.5f, 0.0f), 2.5f));
+    EXPECT_TRUE(query.any_hit(downward_ray(0.5f, 0.0f), 2.5f));
+    EXPECT_FALSE(query.any_hit(downward_ray(3.0f, 0.0f)));
+}
+
+TEST_F(Scene_RayQuery, batched_queries) {
+    using namespace Math;
+
+    Assets::MeshModels::UID model_IDs[2];
+    RayQuery query = RayQuery(create_scene(model_IDs));
+    query.handle_updates();
+
+    const int ray_count = 64;
+    Ray rays[ray_count];
+    float t_maxs[ray_count];
+    for (int r = 0; r < ray_count; ++r) {
+        rays[r] = downward_ray(-1.5f + r * 0.06f, 0.5f);
+        t_maxs[r] = (r % 3 == 0) ? 2.5f : std::numeric_limits<float>::infinity();
+    }
+
+    RayQuery::Hit hits[ray_count];
+    bool occlusions[ray_count];
+    query.closest_hit(rays, t_maxs, ray_count, hits);
+    query.any_hit(rays, t_maxs, ray_count, occlusions);
+    for (int r = 0; r < ray_count; ++r) {
+        RayQuery::Hit expected_hit = query.closest_hit(rays[r], t_maxs[r]);
+        EXPECT_EQ(expected_hit.model_ID, hits[r].model_ID);
+        EXPECT_EQ(expected_hit.primitive_index, hits[r].primitive_index);
+        EXPECT_EQ(expected_hit.distance, hits[r].distance);
+        EXPECT_EQ(expected_hit.is_hit(), occlusions[r]);
+    }
+}
+
+TEST_F(Scene_RayQuery, created_after_notifications_are_reset) {
+    Assets::MeshModels::UID model_IDs[2];
+    SceneRoots::UID scene_ID = create_scene(model_IDs);
+    TestUtils::reset_change_notifications();
+
+    RayQuery query = RayQuery(scene_ID);
+    EXPECT_EQ(scene_ID, query.get_scene_ID());
+    EXPECT_EQ(model_IDs[1], query.closest_hit(downward_ray(0.5f, 0.0f)).model_ID);
+}
+
+TEST_F(Scene_RayQuery, sync_with_scene_changes) {
+    using namespace Math;
+
+    Assets::MeshModels::UID model_IDs[2];
+    RayQuery query = RayQuery(create_scene(model_IDs));
+    query.handle_updates();
+    TestUtils::reset_change_notifications();
+
+    // Lift the upper plane.
+    SceneNodes::UID upper_node_ID = Assets::MeshModels::get_scene_node_ID(model_IDs[1]);
+    SceneNodes::set_global_transform(upper_node_ID, Transform(Vector3f(1.0f, 2.0f, 0.0f)));
+    query.handle_updates();
+    EXPECT_FLOAT_EQ(1.0f, query.closest_hit(downward_ray(0.5f, 0.0f)).distance);
+    TestUtils::reset_change_notifications();
+
+    // Remove the upper plane.
+    Assets::MeshModels::destroy(model_IDs[1]);
+    query.handle_updates();
+    RayQuery::Hit hit = query.closest_hit(downward_ray(0.5f, 0.0f));
+    EXPECT_EQ(model_IDs[0], hit.model_ID);
+    EXPECT_FLOAT_EQ(3.0f, hit.distance);
+}
+
+} // NS Scene
+} // NS Cogwheel
+
+#endif // _COGWHEEL_SCENE_RAY_QUERY_TEST_H_
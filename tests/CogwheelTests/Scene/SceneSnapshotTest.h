@@ -0,0 +1,203 @@
+// Test Cogwheel double buffered scene snapshots.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_SCENE_SCENE_SNAPSHOT_TEST_H_
+#define _COGWHEEL_SCENE_SCENE_SNAPSHOT_TEST_H_
+
+#include <Cogwheel/Scene/SceneSnapshot.h>
+
+#include <gtest/gtest.h>
+
+#include <SceneTestUtils.h>
+
+#include <atomic>
+#include <thread>
+
+namespace Cogwheel {
+namespace Scene {
+
+class Scene_SceneSnapshot : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Assets::Materials::allocate(2u);
+        Assets::Meshes::allocate(1u);
+        Assets::MeshModels::allocate(2u);
+        LightSources::allocate(2u);
+        SceneNodes::allocate(2u);
+        SceneRoots::allocate(1u);
+    }
+    virtual void TearDown() {
+        Assets::Materials::deallocate();
+        Assets::Meshes::deallocate();
+        Assets::MeshModels::deallocate();
+        LightSources::deallocate();
+        SceneNodes::deallocate();
+        SceneRoots::deallocate();
+    }
+
+    // Captures a snapshot and resets the change notifications, as is done at the end of a tick.
+    static void end_tick(SceneSnapshotBuffer& snapshots) {
+        snapshots.capture();
+        TestUtils::reset_change_notifications();
+    }
+};
+
+TEST_F(Scene_SceneSnapshot, copy_scene_state) {
+    using namespace Assets;
+
+    SceneNodes::UID node_ID = SceneNodes::create("Node", Math::Transform(Math::Vector3f(1, 2, 3)));
+    Materials::UID material_ID = Materials::create("Material", Materials::Data::create_metal(Math::RGB(0.5f), 0.25f, 0.75f));
+    Meshes::UID mesh_ID = Meshes::create("Mesh", 3u, 3u);
+    MeshModels::UID model_ID = MeshModels::create(node_ID, mesh_ID, material_ID);
+    LightSources::UID light_ID = LightSources::create_sphere_light(node_ID, Math::RGB(10.0f), 0.5f);
+
+    SceneSnapshotBuffer snapshots;
+    EXPECT_EQ(nullptr, snapshots.acquire());
+    snapshots.release(nullptr);
+
+    end_tick(snapshots);
+    EXPECT_EQ(1u, snapshots.get_frame_count());
+
+    const SceneSnapshot* snapshot = snapshots.acquire();
+    ASSERT_NE(nullptr, snapshot);
+    EXPECT_EQ(0u, snapshot->get_frame_number());
+
+    EXPECT_TRUE(snapshot->has_node(node_ID));
+    EXPECT_EQ(Math::Vector3f(1, 2, 3), snapshot->get_global_transform(node_ID).translation);
+
+    ASSERT_EQ(1u, snapshot->get_model_IDs().size());
+    EXPECT_EQ(model_ID, snapshot->get_model_IDs()[0]);
+    EXPECT_TRUE(snapshot->has_model(model_ID));
+    EXPECT_EQ(node_ID, snapshot->get_model(model_ID).scene_node_ID);
+    EXPECT_EQ(mesh_ID, snapshot->get_model(model_ID).mesh_ID);
+    EXPECT_EQ(material_ID, snapshot->get_model(model_ID).material_ID);
+
+    EXPECT_TRUE(snapshot->has_material(material_ID));
+    EXPECT_EQ(Math::RGB(0.5f), snapshot->get_material(material_ID).tint);
+    EXPECT_EQ(0.25f, snapshot->get_material(material_ID).roughness);
+    EXPECT_EQ(1.0f, snapshot->get_material(material_ID).metallic);
+
+    ASSERT_EQ(1u, snapshot->get_light_IDs().size());
+    EXPECT_EQ(light_ID, snapshot->get_light_IDs()[0]);
+    EXPECT_EQ(LightSources::Type::Sphere, snapshot->get_light(light_ID).type);
+    EXPECT_EQ(Math::RGB(10.0f), snapshot->get_light(light_ID).color);
+    EXPECT_EQ(0.5f, snapshot->get_light(light_ID).radius);
+
+    snapshots.release(snapshot);
+}
+
+TEST_F(Scene_SceneSnapshot, acquired_snapshot_is_immutable) {
+    SceneNodes::UID node_ID = SceneNodes::create("Node", Math::Transform::identity());
+    SceneSnapshotBuffer snapshots;
+    end_tick(snapshots);
+
+    const SceneSnapshot* snapshot = snapshots.acquire();
+
+    // Build the next frame while the snapshot is held.
+    SceneNodes::set_global_transform(node_ID, Math::Transform(Math::Vector3f(1, 0, 0)));
+    end_tick(snapshots);
+    EXPECT_EQ(0u, snapshot->get_frame_number());
+    EXPECT_EQ(Math::Vector3f::zero(), snapshot->get_global_transform(node_ID).translation);
+    snapshots.release(snapshot);
+
+    snapshot = snapshots.acquire();
+    EXPECT_EQ(1u, snapshot->get_frame_number());
+    EXPECT_EQ(Math::Vector3f(1, 0, 0), snapshot->get_global_transform(node_ID).translation);
+    snapshots.release(snapshot);
+}
+
+TEST_F(Scene_SceneSnapshot, changes_are_applied_to_both_snapshots) {
+    using namespace Assets;
+
+    SceneNodes::UID node_ID = SceneNodes::create("Node", Math::Transform::identity());
+    Materials::UID material_ID = Materials::create("Material", Materials::Data::create_dielectric(Math::RGB::white(), 1.0f, 0.04f));
+    Meshes::UID mesh_ID = Meshes::create("Mesh", 3u, 3u);
+    MeshModels::UID model_ID = MeshModels::create(node_ID, mesh_ID, material_ID);
+
+    SceneSnapshotBuffer snapshots;
+    end_tick(snapshots);
+    end_tick(snapshots);
+
+    // Change the scene in a single tick.
+    SceneNodes::set_global_transform(node_ID, Math::Transform(Math::Vector3f(0, 1, 0)));
+    Materials::set_roughness(material_ID, 0.5f);
+    LightSources::UID light_ID = LightSources::create_directional_light(node_ID, Math::RGB(2.0f));
+    end_tick(snapshots);
+
+    // Both snapshots should contain the changes, even though nothing changed in the last tick.
+    end_tick(snapshots);
+    for (int i = 0; i < 2; ++i) {
+        const SceneSnapshot* snapshot = snapshots.acquire();
+        EXPECT_EQ(Math::Vector3f(0, 1, 0), snapshot->get_global_transform(node_ID).translation);
+        EXPECT_EQ(0.5f, snapshot->get_material(material_ID).roughness);
+        ASSERT_EQ(1u, snapshot->get_light_IDs().size());
+        EXPECT_EQ(Math::RGB(2.0f), snapshot->get_light(light_ID).color);
+        EXPECT_EQ(0.0f, snapshot->get_light(light_ID).radius);
+        snapshots.release(snapshot);
+        end_tick(snapshots);
+    }
+
+    // Destroy the model and light.
+    MeshModels::destroy(model_ID);
+    LightSources::destroy(light_ID);
+    end_tick(snapshots);
+    for (int i = 0; i < 2; ++i) {
+        const SceneSnapshot* snapshot = snapshots.acquire();
+        EXPECT_FALSE(snapshot->has_model(model_ID));
+        EXPECT_EQ(0u, snapshot->get_model_IDs().size());
+        EXPECT_FALSE(snapshot->has_light(light_ID));
+        EXPECT_EQ(0u, snapshot->get_light_IDs().size());
+        EXPECT_TRUE(snapshot->has_node(node_ID));
+        snapshots.release(snapshot);
+        end_tick(snapshots);
+    }
+}
+
+TEST_F(Scene_SceneSnapshot, concurrent_render_thread) {
+    static const int node_count = 64;
+    static const int frame_count = 200;
+
+    SceneNodes::reserve(node_count);
+    SceneNodes::UID node_IDs[node_count];
+    for (int n = 0; n < node_count; ++n)
+        node_IDs[n] = SceneNodes::create("Node", Math::Transform::identity());
+
+    SceneSnapshotBuffer snapshots;
+    std::atomic<bool> done(false);
+    std::atomic<int> inconsistent_snapshot_count(0);
+    std::thread render_thread([&] {
+        while (!done) {
+            const SceneSnapshot* snapshot = snapshots.acquire();
+            if (snapshot != nullptr) {
+                // All nodes are moved to the frame number in every frame.
+                float frame_number = float(snapshot->get_frame_number());
+                for (int n = 0; n < node_count; ++n)
+                    if (snapshot->get_global_transform(node_IDs[n]).translation.x != frame_number)
+                        ++inconsistent_snapshot_count;
+            }
+            snapshots.release(snapshot);
+        }
+    });
+
+    for (int f = 0; f < frame_count; ++f) {
+        for (int n = 0; n < node_count; ++n)
+            SceneNodes::set_global_transform(node_IDs[n], Math::Transform(Math::Vector3f(float(f), 0, 0)));
+        end_tick(snapshots);
+    }
+    done = true;
+    render_thread.join();
+
+    EXPECT_EQ(0, inconsistent_snapshot_count.load());
+    EXPECT_EQ((unsigned int)frame_count, snapshots.get_frame_count());
+}
+
+} // NS Scene
+} // NS Cogwheel
+
+#endif // _COGWHEEL_SCENE_SCENE_SNAPSHOT_TEST_H_
@@ -13,6 +13,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 namespace Cogwheel {
 namespace Scene {
 
@@ -41,6 +43,13 @@ protected:
             && almost_equal(lhs.rotation, rhs.rotation)
             && almost_equal(lhs.scale, rhs.scale);
     }
+
+    // Comparison with an absolute tolerance, for transforms computed by different, but equivalent, sequences of operations.
+    static bool nearly_equal_transforms(Transform lhs, Transform rhs) {
+        return magnitude(lhs.translation - rhs.translation) < 0.0001f
+            && fabsf(dot(lhs.rotation.imaginary(), rhs.rotation.imaginary()) + lhs.rotation.real() * rhs.rotation.real()) > 0.99999f
+            && fabsf(lhs.scale - rhs.scale) < 0.0001f;
+    }
 };
 
 TEST_F(Scene_Transform, identity_as_default) {
@@ -314,6 +323,175 @@ TEST_F(Scene_Transform, Transform_changed_notification) {
     }
 }
 
+TEST_F(Scene_Transform, depths) {
+    //    n0     n5
+    //   /  \    |
+    // n1    n2  n6
+    //       |
+    //       n3
+    //       |
+    //       n4
+    SceneNode nodes[7];
+    for (int i = 0; i < 7; ++i)
+        nodes[i] = SceneNodes::create("n");
+    nodes[1].set_parent(nodes[0]);
+    nodes[2].set_parent(nodes[0]);
+    nodes[4].set_parent(nodes[3]); // Set before n3 is attached to the hierarchy.
+    nodes[3].set_parent(nodes[2]);
+    nodes[6].set_parent(nodes[5]);
+
+    unsigned int expected_depths[] = { 0, 1, 1, 2, 3, 0, 1 };
+    for (int i = 0; i < 7; ++i)
+        EXPECT_EQ(expected_depths[i], SceneNodes::get_depth(nodes[i].get_ID())) << "n" << i;
+
+    // The depths are updated when the hierarchy changes.
+    nodes[0].set_parent(nodes[6]);
+    unsigned int reparented_depths[] = { 2, 3, 3, 4, 5, 0, 1 };
+    for (int i = 0; i < 7; ++i)
+        EXPECT_EQ(reparented_depths[i], SceneNodes::get_depth(nodes[i].get_ID())) << "n" << i;
+}
+
+TEST_F(Scene_Transform, deferred_local_transforms) {
+    // Builds two identical chains of nodes and edits the transforms of one immediately and the other deferred.
+    SceneNode immediate_nodes[4], deferred_nodes[4];
+    for (int i = 0; i < 4; ++i) {
+        Transform transform = Transform(Vector3f(float(i), 1.0f, 0.0f), Quaternionf::from_angle_axis(0.3f * i, Vector3f::up()), 1.0f + 0.5f * i);
+        immediate_nodes[i] = SceneNodes::create("immediate", transform);
+        deferred_nodes[i] = SceneNodes::create("deferred", transform);
+        if (i > 0) {
+            immediate_nodes[i].set_parent(immediate_nodes[i - 1]);
+            deferred_nodes[i].set_parent(deferred_nodes[i - 1]);
+        }
+    }
+    SceneNodes::reset_change_notifications();
+
+    Transform root_local = Transform(Vector3f(3, 2, 1), Quaternionf::from_angle_axis(degrees_to_radians(45.0f), Vector3f::forward()));
+    Transform overridden_local = Transform(Vector3f(9, 9, 9));
+    Transform leaf_local = Transform(Vector3f(-1, 0, 2), Quaternionf::from_angle_axis(degrees_to_radians(-30.0f), Vector3f::right()), 2.0f);
+
+    // The edits of the leaf is applied relative to the updated transform of the root.
+    deferred_nodes[2].set_local_transform_deferred(overridden_local);
+    deferred_nodes[3].set_local_transform_deferred(leaf_local);
+    deferred_nodes[0].set_local_transform_deferred(root_local);
+    deferred_nodes[2].set_local_transform_deferred(Transform::identity()); // Overrides the first edit.
+    EXPECT_TRUE(SceneNodes::has_deferred_transforms());
+    EXPECT_TRUE(SceneNodes::get_changed_nodes().is_empty());
+
+    immediate_nodes[0].set_local_transform(root_local);
+    immediate_nodes[2].set_local_transform(Transform::identity());
+    immediate_nodes[3].set_local_transform(leaf_local);
+
+    SceneNodes::propagate_deferred_transforms();
+    EXPECT_FALSE(SceneNodes::has_deferred_transforms());
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_PRED2(compare_transforms, immediate_nodes[i].get_global_transform(), deferred_nodes[i].get_global_transform());
+        EXPECT_EQ(SceneNodes::Change::Transform, deferred_nodes[i].get_changes());
+    }
+}
+
+TEST_F(Scene_Transform, deferred_transforms_of_wide_hierarchy) {
+    // A root with enough children to update the level in parallel, each with a child of its own.
+    SceneNode root = SceneNodes::create("root");
+    std::vector<SceneNode> children, grandchildren;
+    for (int i = 0; i < 2000; ++i) {
+        SceneNode child = SceneNodes::create("child", Transform(Vector3f(float(i), 0, 0)));
+        child.set_parent(root);
+        children.push_back(child);
+        SceneNode grandchild = SceneNodes::create("grandchild", Transform(Vector3f(float(i), 1, 0)));
+        grandchild.set_parent(child);
+        grandchildren.push_back(grandchild);
+    }
+    SceneNodes::reset_change_notifications();
+
+    Transform root_local = Transform(Vector3f(0, 0, 5), Quaternionf::from_angle_axis(degrees_to_radians(90.0f), Vector3f::up()));
+    root.set_local_transform_deferred(root_local);
+    children[7].set_local_transform_deferred(Transform(Vector3f(0, 3, 0)));
+    SceneNodes::propagate_deferred_transforms();
+
+    Core::Iterable<SceneNodes::ChangedIterator> changed_nodes = SceneNodes::get_changed_nodes();
+    EXPECT_EQ(4001, changed_nodes.end() - changed_nodes.begin());
+
+    for (int i = 0; i < 2000; ++i) {
+        Transform child_local = i == 7 ? Transform(Vector3f(0, 3, 0)) : Transform(Vector3f(float(i), 0, 0));
+        Vector3f child_position = (root_local * child_local).translation;
+        EXPECT_LT(magnitude(child_position - children[i].get_global_transform().translation), 0.001f);
+        Vector3f grandchild_position = (root_local * child_local * Transform(Vector3f(0, 1, 0))).translation;
+        EXPECT_LT(magnitude(grandchild_position - grandchildren[i].get_global_transform().translation), 0.001f);
+    }
+}
+
+TEST_F(Scene_Transform, batched_transforms) {
+    // Builds two identical hierarchies and edits the transforms of one immediately and the other as a batch.
+    //    n0
+    //   /  \
+    // n1    n2
+    //       |
+    //       n3
+    //       |
+    //       n4
+    SceneNode immediate_nodes[5], batched_nodes[5], untouched_node = SceneNodes::create("untouched");
+    int parents[5] = { -1, 0, 0, 2, 3 };
+    for (int i = 0; i < 5; ++i) {
+        Transform transform = Transform(Vector3f(float(i), 1.0f, 0.0f), Quaternionf::from_angle_axis(0.3f * i, Vector3f::up()), 1.0f + 0.5f * i);
+        immediate_nodes[i] = SceneNodes::create("immediate", transform);
+        batched_nodes[i] = SceneNodes::create("batched", transform);
+        if (parents[i] >= 0) {
+            immediate_nodes[i].set_parent(immediate_nodes[parents[i]]);
+            batched_nodes[i].set_parent(batched_nodes[parents[i]]);
+        }
+    }
+    SceneNodes::reset_change_notifications();
+
+    Transform n0_transform = Transform(Vector3f(3, 2, 1), Quaternionf::from_angle_axis(degrees_to_radians(45.0f), Vector3f::forward()));
+    Transform n3_transform = Transform(Vector3f(-1, 0, 2), Quaternionf::from_angle_axis(degrees_to_radians(-30.0f), Vector3f::right()), 2.0f);
+
+    { // Global transforms. The descendant is listed before its ancestor and n3 is edited twice.
+        SceneNodes::UID node_IDs[] = { batched_nodes[3].get_ID(), batched_nodes[0].get_ID(), batched_nodes[3].get_ID() };
+        Transform transforms[] = { Transform::identity(), n0_transform, n3_transform };
+        SceneNodes::set_global_transforms(node_IDs, transforms, 3);
+
+        immediate_nodes[0].set_global_transform(n0_transform);
+        immediate_nodes[3].set_global_transform(n3_transform);
+
+        for (int i = 0; i < 5; ++i)
+            EXPECT_PRED2(nearly_equal_transforms, immediate_nodes[i].get_global_transform(), batched_nodes[i].get_global_transform());
+        EXPECT_PRED2(compare_transforms, n3_transform, batched_nodes[3].get_global_transform());
+    }
+
+    { // Every node in the batched hierarchy has a single change notification.
+        int batched_node_change_count = 0;
+        for (SceneNodes::UID node_ID : SceneNodes::get_changed_nodes()) {
+            EXPECT_NE(untouched_node.get_ID(), node_ID);
+            EXPECT_EQ(SceneNodes::Change::Transform, SceneNodes::get_changes(node_ID));
+            for (int i = 0; i < 5; ++i)
+                if (node_ID == batched_nodes[i].get_ID())
+                    ++batched_node_change_count;
+        }
+        EXPECT_EQ(5, batched_node_change_count);
+    }
+
+    SceneNodes::reset_change_notifications();
+
+    { // Local transforms of a subtree.
+        SceneNodes::UID node_IDs[] = { batched_nodes[4].get_ID(), batched_nodes[2].get_ID() };
+        Transform transforms[] = { n0_transform, n3_transform };
+        SceneNodes::set_local_transforms(node_IDs, transforms, 2);
+
+        immediate_nodes[2].set_local_transform(n3_transform);
+        immediate_nodes[4].set_local_transform(n0_transform);
+
+        for (int i = 0; i < 5; ++i)
+            EXPECT_PRED2(nearly_equal_transforms, immediate_nodes[i].get_global_transform(), batched_nodes[i].get_global_transform());
+
+        // Only the subtree has changed.
+        EXPECT_EQ(SceneNodes::Change::None, batched_nodes[0].get_changes());
+        EXPECT_EQ(SceneNodes::Change::None, batched_nodes[1].get_changes());
+        for (int i = 2; i < 5; ++i)
+            EXPECT_EQ(SceneNodes::Change::Transform, batched_nodes[i].get_changes());
+    }
+}
+
 } // NS Core
 } // NS Cogwheel
 
@@ -0,0 +1,60 @@
+// Helpers for setting up test scenes.
+// ------------------------------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License.
+// See LICENSE.txt for more detail.
+// ------------------------------------------------------------------------------------------------
+
+#ifndef _COGWHEEL_TESTS_SCENE_TEST_UTILS_H_
+#define _COGWHEEL_TESTS_SCENE_TEST_UTILS_H_
+
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshCreation.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Scene/LightSource.h>
+#include <Cogwheel/Scene/SceneNode.h>
+#include <Cogwheel/Scene/SceneRoot.h>
+
+#include <vector>
+
+namespace Cogwheel {
+namespace TestUtils {
+
+// Resets the change notifications of the scene and its assets, as is done at the end of a tick.
+// All the managers must have been allocated.
+inline void reset_change_notifications() {
+    Assets::Materials::reset_change_notifications();
+    Assets::Meshes::reset_change_notifications();
+    Assets::MeshModels::reset_change_notifications();
+    Scene::LightSources::reset_change_notifications();
+    Scene::SceneNodes::reset_change_notifications();
+    Scene::SceneRoots::reset_change_notifications();
+}
+
+// Creates a grid of spheres and tori of radius one spaced four units apart in the xz plane.
+// Returns the scene nodes of the models in row major order.
+inline std::vector<Scene::SceneNodes::UID> create_model_grid(int grid_size) {
+    using namespace Assets;
+    using namespace Math;
+
+    Meshes::UID mesh_IDs[2] = { MeshCreation::revolved_sphere(16, 8), MeshCreation::torus(16, 8, 0.2f) };
+    Materials::Data material_data = {};
+    Materials::UID material_ID = Materials::create("Material", material_data);
+
+    std::vector<Scene::SceneNodes::UID> node_IDs;
+    for (int z = 0; z < grid_size; ++z)
+        for (int x = 0; x < grid_size; ++x) {
+            Transform transform = Transform(Vector3f(x * 4.0f, 0.0f, z * 4.0f), Quaternionf::from_angle_axis(0.3f * (x + z), Vector3f::up()));
+            Scene::SceneNodes::UID node_ID = Scene::SceneNodes::create("Node", transform);
+            MeshModels::create(node_ID, mesh_IDs[(x + z) % 2], material_ID);
+            node_IDs.push_back(node_ID);
+        }
+    return node_IDs;
+}
+
+} // NS TestUtils
+} // NS Cogwheel
+
+#endif // _COGWHEEL_TESTS_SCENE_TEST_UTILS_H_
@@ -11,14 +11,26 @@
 #include <Assets/ImageTest.h>
 #include <Assets/InfiniteAreaLightTest.h>
 #include <Assets/MaterialTest.h>
+#include <Assets/MeshClusteringTest.h>
+#include <Assets/MeshDeduplicationTest.h>
 #include <Assets/MeshTest.h>
 #include <Assets/MeshModelTest.h>
+#include <Assets/MeshSimplificationTest.h>
+#include <Assets/MeshValidationTest.h>
+#include <Assets/MeshWeldingTest.h>
 #include <Assets/TextureTest.h>
 
 #include <Core/ArrayTest.h>
 #include <Core/BitmaskTest.h>
+#include <Core/MemoryMappedFileTest.h>
 #include <Core/UniqueIDGeneratorTest.h>
 
+#include <Geometry/BVHCacheTest.h>
+#include <Geometry/BVHTest.h>
+#include <Geometry/SceneBoundsTest.h>
+#include <Geometry/SceneBVHTest.h>
+#include <Geometry/WideBVHTest.h>
+
 #include <Input/KeyboardTest.h>
 
 #include <Math/Distribution1DTest.h>
@@ -33,8 +45,11 @@
 
 #include <Scene/CameraTest.h>
 #include <Scene/LightSourceTest.h>
+#include <Scene/OcclusionBakingTest.h>
+#include <Scene/RayQueryTest.h>
 #include <Scene/SceneNodeTest.h>
 #include <Scene/SceneRootTest.h>
+#include <Scene/SceneSnapshotTest.h>
 #include <Scene/TransformTest.h>
 
 // NOTE
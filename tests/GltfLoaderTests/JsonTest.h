@@ -0,0 +1,169 @@
+// Test the glTF JSON parser.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _GLTF_LOADER_JSON_TEST_H_
+#define _GLTF_LOADER_JSON_TEST_H_
+
+#include <GltfLoader/Json.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+namespace GltfLoader {
+namespace Json {
+
+inline bool parse(const std::string& text, Value& root) {
+    std::string error;
+    return parse(text.data(), text.length(), root, error);
+}
+
+inline bool parses(const std::string& text) {
+    Value root;
+    return parse(text, root);
+}
+
+TEST(GltfLoader_Json, document) {
+    Value root;
+    std::string error;
+    std::string text = "\xEF\xBB\xBF { \"array\" : [1, true, null, \"str\"], \"object\": {\"bool\": false} } ";
+    ASSERT_TRUE(parse(text.data(), text.length(), root, error)) << error;
+
+    EXPECT_TRUE(root.is_object());
+    EXPECT_EQ(2u, root.size());
+    const Value& array = root["array"];
+    EXPECT_TRUE(array.is_array());
+    EXPECT_EQ(4u, array.size());
+    EXPECT_EQ(1, array[0].as_int());
+    EXPECT_TRUE(array[1].as_bool());
+    EXPECT_TRUE(array[2].is_null());
+    EXPECT_EQ("str", array[3].as_string());
+    EXPECT_FALSE(root["object"]["bool"].as_bool(true));
+
+    // Missing values and values of the wrong type are null or the default value.
+    EXPECT_TRUE(root["missing"]["deeper"][3].is_null());
+    EXPECT_TRUE(array[-1].is_null());
+    EXPECT_TRUE(array[4].is_null());
+    EXPECT_EQ(7, root["missing"].as_int(7));
+    EXPECT_EQ(7, array[3].as_int(7));
+    EXPECT_FALSE(root.has("missing"));
+    EXPECT_TRUE(root.has("array"));
+}
+
+TEST(GltfLoader_Json, string_escapes) {
+    Value root;
+    ASSERT_TRUE(parse("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"", root));
+    EXPECT_EQ("\"\\/\b\f\n\r\t", root.as_string());
+
+    // Unicode escapes are encoded as UTF-8 with one to three bytes.
+    ASSERT_TRUE(parse("\"\\u0041\\u00e9\\u20AC\"", root));
+    EXPECT_EQ("A\xC3\xA9\xE2\x82\xAC", root.as_string());
+
+    // Unescaped UTF-8 is copied as is.
+    ASSERT_TRUE(parse("\"A\xC3\xA9\xE2\x82\xAC\"", root));
+    EXPECT_EQ("A\xC3\xA9\xE2\x82\xAC", root.as_string());
+
+    EXPECT_FALSE(parses("\"\\x\""));
+    EXPECT_FALSE(parses("\"\\u12g4\""));
+    EXPECT_FALSE(parses("\"\\u12\""));
+    EXPECT_FALSE(parses("\"tab\tin string\""));
+    EXPECT_FALSE(parses("\"unterminated"));
+    EXPECT_FALSE(parses("\"escaped quote\\\""));
+}
+
+TEST(GltfLoader_Json, surrogate_pairs) {
+    Value root;
+    // U+1F600 is encoded as a surrogate pair in JSON and as four bytes in UTF-8.
+    ASSERT_TRUE(parse("\"\\ud83d\\ude00\"", root));
+    EXPECT_EQ("\xF0\x9F\x98\x80", root.as_string());
+    ASSERT_TRUE(parse("\"\\uD800\\uDC00\\uDBFF\\uDFFF\"", root));
+    EXPECT_EQ("\xF0\x90\x80\x80\xF4\x8F\xBF\xBF", root.as_string());
+
+    // High surrogates must be followed by a low surrogate.
+    EXPECT_FALSE(parses("\"\\ud800\""));
+    EXPECT_FALSE(parses("\"\\ud800x\""));
+    EXPECT_FALSE(parses("\"\\ud800\\u0041\""));
+    EXPECT_FALSE(parses("\"\\ud800\\ud800\""));
+}
+
+TEST(GltfLoader_Json, numbers) {
+    Value root;
+    ASSERT_TRUE(parse("0", root));
+    EXPECT_TRUE(root.is_number());
+    EXPECT_EQ(0.0, root.as_number());
+    ASSERT_TRUE(parse("-0", root));
+    EXPECT_EQ(0.0, root.as_number());
+    ASSERT_TRUE(parse("1.5", root));
+    EXPECT_EQ(1.5, root.as_number());
+    ASSERT_TRUE(parse("-2.5e1", root));
+    EXPECT_EQ(-25.0, root.as_number());
+    ASSERT_TRUE(parse("1E+2", root));
+    EXPECT_EQ(100.0, root.as_number());
+    ASSERT_TRUE(parse("25e-2", root));
+    EXPECT_EQ(0.25, root.as_number());
+    ASSERT_TRUE(parse("0.125", root));
+    EXPECT_EQ(0.125, root.as_number());
+    ASSERT_TRUE(parse("4294967296", root));
+    EXPECT_EQ(4294967296.0, root.as_number());
+    ASSERT_TRUE(parse("[7,-3]", root));
+    EXPECT_EQ(7, root[0].as_int());
+    EXPECT_EQ(-3, root[1].as_int());
+
+    // strtod accepts more than the JSON grammar.
+    const char* invalid_numbers[] = { "-", "+1", ".5", "1.", "1.e2", "1e", "1e+", "01", "-01", "0x10", "inf", "-inf", "NaN", "1,5" };
+    for (const char* number : invalid_numbers)
+        EXPECT_FALSE(parses(number)) << number;
+
+    // The document isn't null terminated, so numbers must stop at the end of the document.
+    std::string error;
+    ASSERT_TRUE(parse("123456", 3, root, error));
+    EXPECT_EQ(123.0, root.as_number());
+}
+
+TEST(GltfLoader_Json, depth_limit) {
+    std::string shallow = std::string(64, '[') + std::string(64, ']');
+    EXPECT_TRUE(parses(shallow));
+
+    // Deeply nested documents are rejected instead of overflowing the stack.
+    std::string deep_arrays = std::string(100000, '[') + std::string(100000, ']');
+    EXPECT_FALSE(parses(deep_arrays));
+    std::string deep_objects;
+    for (int i = 0; i < 100000; ++i)
+        deep_objects += "{\"a\":";
+    EXPECT_FALSE(parses(deep_objects));
+}
+
+TEST(GltfLoader_Json, trailing_garbage) {
+    EXPECT_TRUE(parses("{} \t\r\n"));
+
+    Value root;
+    std::string error;
+    EXPECT_FALSE(parse("{} x", 4, root, error));
+    EXPECT_NE(std::string::npos, error.find("trailing"));
+
+    const char* invalid_documents[] = { "[1] 2", "1 2", "{}}", "[]]", "\"a\"\"b\"", "true false", "null,", "" };
+    for (const char* document : invalid_documents)
+        EXPECT_FALSE(parses(document)) << document;
+}
+
+TEST(GltfLoader_Json, malformed_documents) {
+    const char* invalid_documents[] = { "{", "[", "[1,]", "[,1]", "{\"a\" 1}", "{\"a\":}", "{\"a\":1,}", "{a:1}", "{1:1}",
+                                        "nul", "tru", "falsey", "[1 2]" };
+    for (const char* document : invalid_documents) {
+        Value root;
+        std::string error;
+        EXPECT_FALSE(parse(document, strlen(document), root, error)) << document;
+        EXPECT_FALSE(error.empty()) << document;
+    }
+}
+
+} // NS Json
+} // NS GltfLoader
+
+#endif // _GLTF_LOADER_JSON_TEST_H_
@@ -0,0 +1,104 @@
+// Test glTF uri decoding.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _GLTF_LOADER_URI_TEST_H_
+#define _GLTF_LOADER_URI_TEST_H_
+
+#include <GltfLoader/Uri.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace GltfLoader {
+
+inline bool decode_base64(const std::string& payload, std::string& decoded) {
+    std::vector<unsigned char> data;
+    bool valid = decode_data_uri("data:application/octet-stream;base64," + payload, data);
+    decoded = std::string(data.begin(), data.end());
+    return valid;
+}
+
+TEST(GltfLoader_Uri, percent_decoding) {
+    EXPECT_EQ("textures/brick wall.png", decode_uri("textures/brick%20wall.png"));
+    EXPECT_EQ("a%b.png", decode_uri("a%25b.png"));
+    EXPECT_EQ("\xC3\xA9.png", decode_uri("%c3%A9.png"));
+
+    // Malformed escapes are left as is.
+    EXPECT_EQ("100%", decode_uri("100%"));
+    EXPECT_EQ("%zz.png", decode_uri("%zz.png"));
+}
+
+TEST(GltfLoader_Uri, data_uri_detection) {
+    EXPECT_TRUE(is_data_uri("data:application/octet-stream;base64,AAAA"));
+    EXPECT_FALSE(is_data_uri("buffer.bin"));
+    EXPECT_FALSE(is_data_uri("folder/data:file.bin"));
+
+    // Only base64 encoded data uris are supported.
+    std::vector<unsigned char> data;
+    EXPECT_FALSE(decode_data_uri("data:text/plain,hello", data));
+    EXPECT_FALSE(decode_data_uri("data:application/octet-stream;base64", data));
+}
+
+TEST(GltfLoader_Uri, base64_padding) {
+    std::string decoded;
+    EXPECT_TRUE(decode_base64("", decoded));
+    EXPECT_EQ("", decoded);
+
+    // Padded payloads.
+    EXPECT_TRUE(decode_base64("QUJD", decoded));
+    EXPECT_EQ("ABC", decoded);
+    EXPECT_TRUE(decode_base64("QUI=", decoded));
+    EXPECT_EQ("AB", decoded);
+    EXPECT_TRUE(decode_base64("QQ==", decoded));
+    EXPECT_EQ("A", decoded);
+    EXPECT_TRUE(decode_base64("QUJDREVGRw==", decoded));
+    EXPECT_EQ("ABCDEFG", decoded);
+
+    // Unpadded payloads.
+    EXPECT_TRUE(decode_base64("QUI", decoded));
+    EXPECT_EQ("AB", decoded);
+    EXPECT_TRUE(decode_base64("QQ", decoded));
+    EXPECT_EQ("A", decoded);
+
+    // A single trailing character can't encode a byte.
+    EXPECT_FALSE(decode_base64("Q", decoded));
+    EXPECT_FALSE(decode_base64("QUJDR", decoded));
+
+    // Too much or too little padding.
+    EXPECT_FALSE(decode_base64("QQ===", decoded));
+    EXPECT_FALSE(decode_base64("QQ=", decoded));
+    EXPECT_FALSE(decode_base64("QUJD=", decoded));
+    EXPECT_FALSE(decode_base64("Q===", decoded));
+}
+
+TEST(GltfLoader_Uri, base64_all_byte_values) {
+    std::string decoded;
+    ASSERT_TRUE(decode_base64("AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+P0BBQkNERUZHSElKS0xNTk9QUVJTVFVWV1hZWltcXV5fYGFiY2RlZmdoaWprbG1ub3BxcnN0dXZ3eHl6e3x9fn+AgYKDhIWGh4iJiouMjY6PkJGSk5SVlpeYmZqbnJ2en6ChoqOkpaanqKmqq6ytrq+wsbKztLW2t7i5uru8vb6/wMHCw8TFxsfIycrLzM3Oz9DR0tPU1dbX2Nna29zd3t/g4eLj5OXm5+jp6uvs7e7v8PHy8/T19vf4+fr7/P3+/w==", decoded));
+    ASSERT_EQ(256u, decoded.length());
+    for (int i = 0; i < 256; ++i)
+        EXPECT_EQ(i, (unsigned char)decoded[i]);
+}
+
+TEST(GltfLoader_Uri, base64_invalid_characters) {
+    std::string decoded;
+    EXPECT_FALSE(decode_base64("QU!D", decoded));
+    EXPECT_FALSE(decode_base64("QUJ QUJD", decoded));
+    EXPECT_FALSE(decode_base64("QUJD\nQUJ", decoded));
+    EXPECT_FALSE(decode_base64("QUJD-_==", decoded)); // The url safe alphabet isn't base64.
+    EXPECT_FALSE(decode_base64("Q!", decoded)); // Invalid character in the trailing partial group.
+
+    // Padding is only allowed at the end.
+    EXPECT_FALSE(decode_base64("QQ==QUJD", decoded));
+    EXPECT_FALSE(decode_base64("Q=JD", decoded));
+}
+
+} // NS GltfLoader
+
+#endif // _GLTF_LOADER_URI_TEST_H_
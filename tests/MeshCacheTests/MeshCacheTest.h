@@ -0,0 +1,331 @@
+// Test MeshCache.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _MESH_CACHE_MESH_CACHE_TEST_H_
+#define _MESH_CACHE_MESH_CACHE_TEST_H_
+
+#include <MeshCache/MeshCache.h>
+
+#include <Cogwheel/Assets/Image.h>
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshModel.h>
+#include <Cogwheel/Assets/Texture.h>
+#include <Cogwheel/Core/Renderer.h>
+#include <Cogwheel/Scene/Camera.h>
+#include <Cogwheel/Scene/LightSource.h>
+#include <Cogwheel/Scene/SceneRoot.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace MeshCache {
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Scene;
+
+class MeshCacheFixture : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Cogwheel::Core::Renderers::allocate(1u);
+        Images::allocate(4u);
+        Textures::allocate(4u);
+        Materials::allocate(4u);
+        Meshes::allocate(4u);
+        SceneNodes::allocate(8u);
+        MeshModels::allocate(8u);
+        Cameras::allocate(2u);
+        LightSources::allocate(2u);
+        SceneRoots::allocate(2u);
+    }
+    virtual void TearDown() {
+        SceneRoots::deallocate();
+        LightSources::deallocate();
+        Cameras::deallocate();
+        MeshModels::deallocate();
+        SceneNodes::deallocate();
+        Meshes::deallocate();
+        Materials::deallocate();
+        Textures::deallocate();
+        Images::deallocate();
+        Cogwheel::Core::Renderers::deallocate();
+        remove(cache_path);
+    }
+
+    const char* cache_path = "mesh_cache_test.meshcache";
+    const char* source_path = "mesh_cache_test.obj";
+    const unsigned long long source_modification_time = 42;
+};
+
+inline Meshes::UID create_quad(const std::string& name, float z) {
+    Mesh quad = Meshes::create(name, 2, 4, MeshFlag::AllBuffers);
+    quad.get_primitives()[0] = Vector3ui(0, 1, 2);
+    quad.get_primitives()[1] = Vector3ui(0, 2, 3);
+    Vector2f corners[] = { Vector2f(0, 0), Vector2f(1, 0), Vector2f(1, 1), Vector2f(0, 1) };
+    for (int v = 0; v < 4; ++v) {
+        quad.get_positions()[v] = Vector3f(corners[v].x, corners[v].y, z);
+        quad.get_normals()[v] = Vector3f(0, 0, 1);
+        quad.get_texcoords()[v] = corners[v];
+    }
+    quad.compute_bounds();
+    return quad.get_ID();
+}
+
+inline SceneNodes::UID find_child(SceneNodes::UID parent_ID, const std::string& name) {
+    for (SceneNodes::UID child_ID : SceneNodes::get_children_IDs(parent_ID))
+        if (SceneNodes::get_name(child_ID) == name)
+            return child_ID;
+    return SceneNodes::UID::invalid_UID();
+}
+
+inline std::vector<MeshModels::UID> get_models(SceneNodes::UID node_ID) {
+    std::vector<MeshModels::UID> model_IDs;
+    for (MeshModels::UID model_ID : MeshModels::get_iterable())
+        if (MeshModels::get_scene_node_ID(model_ID) == node_ID)
+            model_IDs.push_back(model_ID);
+    return model_IDs;
+}
+
+inline void expect_equal_meshes(Meshes::UID expected_ID, Meshes::UID actual_ID) {
+    Mesh expected = expected_ID, actual = actual_ID;
+    EXPECT_EQ(expected.get_name(), actual.get_name());
+    ASSERT_EQ(expected.get_primitive_count(), actual.get_primitive_count());
+    ASSERT_EQ(expected.get_vertex_count(), actual.get_vertex_count());
+    EXPECT_TRUE(expected.get_flags() == actual.get_flags());
+    EXPECT_EQ(0, memcmp(expected.get_primitives(), actual.get_primitives(), sizeof(Vector3ui) * expected.get_primitive_count()));
+    EXPECT_EQ(0, memcmp(expected.get_positions(), actual.get_positions(), sizeof(Vector3f) * expected.get_vertex_count()));
+    EXPECT_EQ(0, memcmp(expected.get_normals(), actual.get_normals(), sizeof(Vector3f) * expected.get_vertex_count()));
+    EXPECT_EQ(0, memcmp(expected.get_texcoords(), actual.get_texcoords(), sizeof(Vector2f) * expected.get_vertex_count()));
+    EXPECT_EQ(expected.get_bounds().minimum, actual.get_bounds().minimum);
+    EXPECT_EQ(expected.get_bounds().maximum, actual.get_bounds().maximum);
+}
+
+// Creates a root with a textured model, an instance of the same mesh without a material and a grandchild with another mesh.
+inline SceneNodes::UID create_test_hierarchy() {
+    Images::UID image_ID = Images::create2D("checker", PixelFormat::RGBA32, 2.2f, Vector2ui(2, 2));
+    for (unsigned int p = 0; p < 4; ++p)
+        Images::set_pixel(image_ID, RGBA(float(p % 2), float(p / 2), 0.5f, 1.0f), p);
+    Textures::UID texture_ID = Textures::create2D(image_ID, MagnificationFilter::None);
+
+    Materials::Data material_data = Materials::Data::create_dielectric(RGB(0.25f, 0.5f, 0.75f), 0.3f, 0.04f);
+    material_data.tint_texture_ID = texture_ID;
+    Materials::UID material_ID = Materials::create("textured", material_data);
+
+    Meshes::UID quad_ID = create_quad("quad", 0.0f);
+    Meshes::UID raised_quad_ID = create_quad("raised_quad", 1.0f);
+
+    SceneNodes::UID root_ID = SceneNodes::create("root", Transform(Vector3f(1, 2, 3)));
+    SceneNodes::UID textured_ID = SceneNodes::create("textured", Transform(Vector3f(0, 1, 0)));
+    SceneNodes::set_parent(textured_ID, root_ID);
+    SceneNodes::UID untextured_ID = SceneNodes::create("no_material", Transform(Vector3f(0, 2, 0)));
+    SceneNodes::set_parent(untextured_ID, root_ID);
+    SceneNodes::UID grandchild_ID = SceneNodes::create("grandchild", Transform(Vector3f(0, 3, 0), Quaternionf::from_angle_axis(0.5f, Vector3f::up())));
+    SceneNodes::set_parent(grandchild_ID, textured_ID);
+
+    MeshModels::create(textured_ID, quad_ID, material_ID);
+    MeshModels::create(untextured_ID, quad_ID, Materials::UID::invalid_UID());
+    MeshModels::create(grandchild_ID, raised_quad_ID, material_ID);
+
+    return root_ID;
+}
+
+TEST_F(MeshCacheFixture, store_and_load) {
+    SceneNodes::UID root_ID = create_test_hierarchy();
+    SceneNodes::UID textured_ID = find_child(root_ID, "textured");
+    SceneNodes::UID untextured_ID = find_child(root_ID, "no_material");
+    SceneNodes::UID grandchild_ID = find_child(textured_ID, "grandchild");
+    ASSERT_TRUE(store(cache_path, root_ID, source_path, source_modification_time));
+
+    SceneNodes::UID loaded_root_ID = load(cache_path, source_path, source_modification_time);
+    ASSERT_TRUE(SceneNodes::has(loaded_root_ID));
+    EXPECT_NE(root_ID, loaded_root_ID);
+
+    // Hierarchy.
+    EXPECT_EQ("root", SceneNodes::get_name(loaded_root_ID));
+    EXPECT_EQ(SceneNodes::get_global_transform(root_ID), SceneNodes::get_global_transform(loaded_root_ID));
+    EXPECT_EQ(2u, SceneNodes::get_children_IDs(loaded_root_ID).size());
+    SceneNodes::UID loaded_textured_ID = find_child(loaded_root_ID, "textured");
+    SceneNodes::UID loaded_untextured_ID = find_child(loaded_root_ID, "no_material");
+    ASSERT_TRUE(SceneNodes::has(loaded_textured_ID));
+    ASSERT_TRUE(SceneNodes::has(loaded_untextured_ID));
+    SceneNodes::UID loaded_grandchild_ID = find_child(loaded_textured_ID, "grandchild");
+    ASSERT_TRUE(SceneNodes::has(loaded_grandchild_ID));
+    EXPECT_EQ(SceneNodes::get_global_transform(grandchild_ID), SceneNodes::get_global_transform(loaded_grandchild_ID));
+    EXPECT_EQ(SceneNodes::get_local_transform(grandchild_ID), SceneNodes::get_local_transform(loaded_grandchild_ID));
+
+    // Models and meshes. Shared meshes and materials are still shared after loading.
+    std::vector<MeshModels::UID> textured_models = get_models(loaded_textured_ID);
+    std::vector<MeshModels::UID> untextured_models = get_models(loaded_untextured_ID);
+    std::vector<MeshModels::UID> grandchild_models = get_models(loaded_grandchild_ID);
+    ASSERT_EQ(1u, textured_models.size());
+    ASSERT_EQ(1u, untextured_models.size());
+    ASSERT_EQ(1u, grandchild_models.size());
+
+    Meshes::UID loaded_quad_ID = MeshModels::get_mesh_ID(textured_models[0]);
+    EXPECT_NE(MeshModels::get_mesh_ID(get_models(textured_ID)[0]), loaded_quad_ID);
+    expect_equal_meshes(MeshModels::get_mesh_ID(get_models(textured_ID)[0]), loaded_quad_ID);
+    expect_equal_meshes(MeshModels::get_mesh_ID(get_models(grandchild_ID)[0]), MeshModels::get_mesh_ID(grandchild_models[0]));
+    EXPECT_EQ(loaded_quad_ID, MeshModels::get_mesh_ID(untextured_models[0]));
+
+    // Materials and textures. Models without a material are loaded without one.
+    EXPECT_EQ(Materials::UID::invalid_UID(), MeshModels::get_material_ID(untextured_models[0]));
+    Materials::UID original_material_ID = MeshModels::get_material_ID(get_models(textured_ID)[0]);
+    Materials::UID loaded_material_ID = MeshModels::get_material_ID(textured_models[0]);
+    ASSERT_TRUE(Materials::has(loaded_material_ID));
+    EXPECT_NE(original_material_ID, loaded_material_ID);
+    EXPECT_EQ(loaded_material_ID, MeshModels::get_material_ID(grandchild_models[0]));
+    EXPECT_EQ("textured", Materials::get_name(loaded_material_ID));
+    EXPECT_EQ(Materials::get_tint(original_material_ID), Materials::get_tint(loaded_material_ID));
+    EXPECT_EQ(Materials::get_roughness(original_material_ID), Materials::get_roughness(loaded_material_ID));
+    EXPECT_EQ(Materials::get_specularity(original_material_ID), Materials::get_specularity(loaded_material_ID));
+
+    Textures::UID loaded_texture_ID = Materials::get_tint_texture_ID(loaded_material_ID);
+    ASSERT_TRUE(Textures::has(loaded_texture_ID));
+    EXPECT_EQ(MagnificationFilter::None, Textures::get_magnification_filter(loaded_texture_ID));
+    Images::UID original_image_ID = Textures::get_image_ID(Materials::get_tint_texture_ID(original_material_ID));
+    Images::UID loaded_image_ID = Textures::get_image_ID(loaded_texture_ID);
+    EXPECT_EQ("checker", Images::get_name(loaded_image_ID));
+    EXPECT_EQ(PixelFormat::RGBA32, Images::get_pixel_format(loaded_image_ID));
+    EXPECT_EQ(2.2f, Images::get_gamma(loaded_image_ID));
+    for (unsigned int p = 0; p < 4; ++p)
+        EXPECT_EQ(Images::get_pixel(original_image_ID, p), Images::get_pixel(loaded_image_ID, p));
+}
+
+TEST_F(MeshCacheFixture, corrupt_checksum) {
+    SceneNodes::UID root_ID = create_test_hierarchy();
+    ASSERT_TRUE(store(cache_path, root_ID, source_path, source_modification_time));
+
+    // Flip a bit in the last byte, which is part of the checksummed content.
+    FILE* file = fopen(cache_path, "r+b");
+    ASSERT_NE(nullptr, file);
+    fseek(file, -1, SEEK_END);
+    int last_byte = fgetc(file);
+    fseek(file, -1, SEEK_END);
+    fputc(last_byte ^ 1, file);
+    fclose(file);
+
+    EXPECT_EQ(SceneNodes::UID::invalid_UID(), load(cache_path, source_path, source_modification_time));
+
+    // Nothing is created from a rejected cache.
+    unsigned int model_count = 0;
+    for (MeshModels::UID model_ID : MeshModels::get_iterable())
+        ++model_count;
+    EXPECT_EQ(3u, model_count);
+}
+
+TEST_F(MeshCacheFixture, source_mismatch) {
+    SceneNodes::UID root_ID = create_test_hierarchy();
+    ASSERT_TRUE(store(cache_path, root_ID, source_path, source_modification_time));
+
+    EXPECT_EQ(SceneNodes::UID::invalid_UID(), load(cache_path, "other_source.obj", source_modification_time));
+    EXPECT_EQ(SceneNodes::UID::invalid_UID(), load(cache_path, source_path, source_modification_time + 1));
+    EXPECT_EQ(SceneNodes::UID::invalid_UID(), load("mesh_cache_test_missing.meshcache", source_path, source_modification_time));
+    EXPECT_TRUE(SceneNodes::has(load(cache_path, source_path, source_modification_time)));
+}
+
+TEST_F(MeshCacheFixture, store_and_load_scene) {
+    Images::UID environment_image_ID = Images::create2D("sky", PixelFormat::RGBA32, 2.2f, Vector2ui(4, 2));
+    for (unsigned int p = 0; p < 8; ++p)
+        Images::set_pixel(environment_image_ID, RGBA(p / 8.0f, 0.5f, 1.0f - p / 8.0f, 1.0f), p);
+    Textures::UID environment_map_ID = Textures::create2D(environment_image_ID, MagnificationFilter::Linear, MinificationFilter::None);
+    SceneRoots::UID scene_ID = SceneRoots::create("scene", environment_map_ID, RGB(0.5f, 0.75f, 1.0f));
+    SceneNodes::UID root_ID = SceneRoots::get_root_node(scene_ID);
+    SceneNodes::set_parent(create_test_hierarchy(), root_ID);
+
+    SceneNodes::UID lamp_ID = SceneNodes::create("lamp", Transform(Vector3f(0, 4, 0)));
+    SceneNodes::set_parent(lamp_ID, root_ID);
+    LightSources::create_sphere_light(lamp_ID, RGB(10.0f, 8.0f, 6.0f), 0.25f);
+    SceneNodes::UID sun_ID = SceneNodes::create("sun", Transform(Vector3f::zero(), Quaternionf::from_angle_axis(0.7f, Vector3f::right())));
+    SceneNodes::set_parent(sun_ID, root_ID);
+    LightSources::create_directional_light(sun_ID, RGB(2.0f, 2.0f, 1.5f));
+
+    // Cameras are assigned to the first renderer, so one must exist when the scene is loaded.
+    Cogwheel::Core::Renderers::UID renderer_ID = Cogwheel::Core::Renderers::create("renderer");
+    Matrix4x4f projection_matrix, inverse_projection_matrix;
+    CameraUtils::compute_perspective_projection(0.1f, 100.0f, 0.8f, 1.5f, projection_matrix, inverse_projection_matrix);
+    Cameras::UID camera_ID = Cameras::create("camera", scene_ID, projection_matrix, inverse_projection_matrix, renderer_ID);
+    Cameras::set_transform(camera_ID, Transform(Vector3f(0, 1, -5), Quaternionf::from_angle_axis(0.2f, Vector3f::up())));
+    Cameras::set_viewport(camera_ID, Rectf(0.25f, 0.0f, 0.75f, 1.0f));
+    Cameras::set_z_index(camera_ID, 3);
+    CameraEffects::Settings effects_settings = Cameras::get_effects_settings(camera_ID);
+    effects_settings.exposure.log_lumiance_bias = 1.5f;
+    effects_settings.bloom.threshold = 4.0f;
+    Cameras::set_effects_settings(camera_ID, effects_settings);
+
+    ASSERT_TRUE(store_scene(cache_path, scene_ID));
+
+    SceneRoots::UID loaded_scene_ID = load_scene(cache_path);
+    ASSERT_TRUE(SceneRoots::has(loaded_scene_ID));
+    EXPECT_NE(scene_ID, loaded_scene_ID);
+
+    // Environment.
+    EXPECT_EQ(SceneRoots::get_environment_tint(scene_ID), SceneRoots::get_environment_tint(loaded_scene_ID));
+    Textures::UID loaded_environment_map_ID = SceneRoots::get_environment_map(loaded_scene_ID);
+    ASSERT_TRUE(Textures::has(loaded_environment_map_ID));
+    EXPECT_NE(environment_map_ID, loaded_environment_map_ID);
+    EXPECT_EQ(MinificationFilter::None, Textures::get_minification_filter(loaded_environment_map_ID));
+    Images::UID loaded_environment_image_ID = Textures::get_image_ID(loaded_environment_map_ID);
+    EXPECT_EQ("sky", Images::get_name(loaded_environment_image_ID));
+    EXPECT_EQ(Images::get_width(environment_image_ID), Images::get_width(loaded_environment_image_ID));
+    EXPECT_EQ(Images::get_height(environment_image_ID), Images::get_height(loaded_environment_image_ID));
+    for (unsigned int p = 0; p < 8; ++p)
+        EXPECT_EQ(Images::get_pixel(environment_image_ID, p), Images::get_pixel(loaded_environment_image_ID, p));
+
+    // Hierarchy. The lights are loaded onto the loaded nodes.
+    SceneNodes::UID loaded_root_ID = SceneRoots::get_root_node(loaded_scene_ID);
+    EXPECT_EQ("scene", SceneNodes::get_name(loaded_root_ID));
+    EXPECT_EQ(3u, SceneNodes::get_children_IDs(loaded_root_ID).size());
+    EXPECT_TRUE(SceneNodes::has(find_child(find_child(loaded_root_ID, "root"), "textured")));
+    SceneNodes::UID loaded_lamp_ID = find_child(loaded_root_ID, "lamp");
+    SceneNodes::UID loaded_sun_ID = find_child(loaded_root_ID, "sun");
+    ASSERT_TRUE(SceneNodes::has(loaded_lamp_ID));
+    ASSERT_TRUE(SceneNodes::has(loaded_sun_ID));
+    EXPECT_EQ(SceneNodes::get_global_transform(sun_ID), SceneNodes::get_global_transform(loaded_sun_ID));
+
+    // Lights.
+    unsigned int loaded_light_count = 0;
+    for (LightSources::UID light_ID : LightSources::get_iterable()) {
+        SceneNodes::UID node_ID = LightSources::get_node_ID(light_ID);
+        if (node_ID == loaded_lamp_ID) {
+            ASSERT_EQ(LightSources::Type::Sphere, LightSources::get_type(light_ID));
+            EXPECT_EQ(RGB(10.0f, 8.0f, 6.0f), LightSources::get_sphere_light_power(light_ID));
+            EXPECT_EQ(0.25f, LightSources::get_sphere_light_radius(light_ID));
+            ++loaded_light_count;
+        } else if (node_ID == loaded_sun_ID) {
+            ASSERT_EQ(LightSources::Type::Directional, LightSources::get_type(light_ID));
+            EXPECT_EQ(RGB(2.0f, 2.0f, 1.5f), LightSources::get_directional_light_radiance(light_ID));
+            ++loaded_light_count;
+        }
+    }
+    EXPECT_EQ(2u, loaded_light_count);
+
+    // Cameras.
+    Cameras::UID loaded_camera_ID = Cameras::UID::invalid_UID();
+    for (Cameras::UID camera_ID : Cameras::get_iterable())
+        if (Cameras::get_scene_ID(camera_ID) == loaded_scene_ID)
+            loaded_camera_ID = camera_ID;
+    ASSERT_TRUE(Cameras::has(loaded_camera_ID));
+    EXPECT_EQ("camera", Cameras::get_name(loaded_camera_ID));
+    EXPECT_EQ(Cameras::get_transform(camera_ID), Cameras::get_transform(loaded_camera_ID));
+    EXPECT_EQ(projection_matrix, Cameras::get_projection_matrix(loaded_camera_ID));
+    EXPECT_EQ(inverse_projection_matrix, Cameras::get_inverse_projection_matrix(loaded_camera_ID));
+    EXPECT_EQ(Rectf(0.25f, 0.0f, 0.75f, 1.0f), Cameras::get_viewport(loaded_camera_ID));
+    EXPECT_EQ(3, Cameras::get_z_index(loaded_camera_ID));
+    CameraEffects::Settings loaded_effects_settings = Cameras::get_effects_settings(loaded_camera_ID);
+    EXPECT_EQ(1.5f, loaded_effects_settings.exposure.log_lumiance_bias);
+    EXPECT_EQ(4.0f, loaded_effects_settings.bloom.threshold);
+}
+
+} // NS MeshCache
+
+#endif // _MESH_CACHE_MESH_CACHE_TEST_H_
@@ -0,0 +1,112 @@
+// Test the PLY loader.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _SCAN_LOADER_PLY_LOADER_TEST_H_
+#define _SCAN_LOADER_PLY_LOADER_TEST_H_
+
+#include <ScanLoader/PlyLoader.h>
+
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshModel.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace PlyLoader {
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Scene;
+
+// The quads files contain the same mesh in ASCII and both binary formats:
+// Five vertices with float x and y, double z, an unsupported red channel and texcoords,
+// a quad face and a triangle face, followed by an unsupported edge element.
+class ScanLoader_PlyLoader : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Materials::allocate(2u);
+        Meshes::allocate(2u);
+        MeshModels::allocate(2u);
+        SceneNodes::allocate(2u);
+    }
+    virtual void TearDown() {
+        Materials::deallocate();
+        Meshes::deallocate();
+        MeshModels::deallocate();
+        SceneNodes::deallocate();
+    }
+};
+
+inline void expect_quads(Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+    ASSERT_EQ(5u, mesh.get_vertex_count());
+    EXPECT_TRUE(mesh.get_flags() == MeshFlags({ MeshFlag::Position, MeshFlag::Normal, MeshFlag::Texcoord }));
+
+    Vector3f expected_positions[] = { Vector3f(0, 0, 0), Vector3f(1, 0, 0), Vector3f(1, 1, 0), Vector3f(0, 1, 0), Vector3f(2, 0, 0) };
+    Vector2f expected_texcoords[] = { Vector2f(0, 0), Vector2f(1, 0), Vector2f(1, 1), Vector2f(0, 1), Vector2f(1, 0.5f) };
+    for (unsigned int v = 0; v < 5; ++v) {
+        EXPECT_EQ(expected_positions[v], mesh.get_positions()[v]) << v;
+        EXPECT_EQ(expected_texcoords[v], mesh.get_texcoords()[v]) << v;
+        // The file has no normals, so they are computed.
+        EXPECT_FLOAT_EQ(1.0f, mesh.get_normals()[v].z) << v;
+    }
+
+    // The quad is triangulated as a fan.
+    ASSERT_EQ(3u, mesh.get_primitive_count());
+    EXPECT_EQ(Vector3ui(0, 1, 2), mesh.get_primitives()[0]);
+    EXPECT_EQ(Vector3ui(0, 2, 3), mesh.get_primitives()[1]);
+    EXPECT_EQ(Vector3ui(1, 4, 2), mesh.get_primitives()[2]);
+
+    EXPECT_EQ(Vector3f(0, 0, 0), mesh.get_bounds().minimum);
+    EXPECT_EQ(Vector3f(2, 1, 0), mesh.get_bounds().maximum);
+}
+
+TEST_F(ScanLoader_PlyLoader, ascii) {
+    Meshes::UID mesh_ID = load_mesh(SCAN_LOADER_TEST_DATA_ROOT "quads_ascii.ply");
+    ASSERT_TRUE(Meshes::has(mesh_ID));
+    EXPECT_EQ("quads_ascii", Meshes::get_name(mesh_ID));
+    expect_quads(mesh_ID);
+}
+
+TEST_F(ScanLoader_PlyLoader, binary_little_endian) {
+    Meshes::UID mesh_ID = load_mesh(SCAN_LOADER_TEST_DATA_ROOT "quads_binary_little_endian.ply");
+    ASSERT_TRUE(Meshes::has(mesh_ID));
+    expect_quads(mesh_ID);
+}
+
+TEST_F(ScanLoader_PlyLoader, binary_big_endian) {
+    Meshes::UID mesh_ID = load_mesh(SCAN_LOADER_TEST_DATA_ROOT "quads_binary_big_endian.ply");
+    ASSERT_TRUE(Meshes::has(mesh_ID));
+    expect_quads(mesh_ID);
+}
+
+TEST_F(ScanLoader_PlyLoader, scene_node) {
+    SceneNodes::UID node_ID = load(SCAN_LOADER_TEST_DATA_ROOT "quads_ascii.ply");
+    ASSERT_TRUE(SceneNodes::has(node_ID));
+    EXPECT_EQ("quads_ascii", SceneNodes::get_name(node_ID));
+
+    MeshModel model = *MeshModels::get_iterable().begin();
+    EXPECT_EQ(node_ID, model.get_scene_node().get_ID());
+    EXPECT_EQ(3u, model.get_mesh().get_primitive_count());
+    EXPECT_TRUE(Materials::has(model.get_material().get_ID()));
+}
+
+TEST_F(ScanLoader_PlyLoader, invalid_files) {
+    EXPECT_EQ(Meshes::UID::invalid_UID(), load_mesh(SCAN_LOADER_TEST_DATA_ROOT "missing.ply"));
+    EXPECT_EQ(SceneNodes::UID::invalid_UID(), load(SCAN_LOADER_TEST_DATA_ROOT "missing.ply"));
+    EXPECT_EQ(Meshes::UID::invalid_UID(), load_mesh(SCAN_LOADER_TEST_DATA_ROOT "quads.stl"));
+
+    EXPECT_TRUE(Meshes::get_iterable().is_empty());
+}
+
+} // NS PlyLoader
+
+#endif // _SCAN_LOADER_PLY_LOADER_TEST_H_
@@ -0,0 +1,161 @@
+// Test the STL loader.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _SCAN_LOADER_STL_LOADER_TEST_H_
+#define _SCAN_LOADER_STL_LOADER_TEST_H_
+
+#include <ScanLoader/StlLoader.h>
+
+#include <Cogwheel/Assets/Material.h>
+#include <Cogwheel/Assets/Mesh.h>
+#include <Cogwheel/Assets/MeshModel.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace StlLoader {
+
+using namespace Cogwheel::Assets;
+using namespace Cogwheel::Math;
+using namespace Cogwheel::Scene;
+
+// The quads files contain the same four triangles in ASCII and binary:
+// * Two triangles forming the unit quad in the xy plane. One of them uses -0 for a coordinate.
+// * A degenerate triangle with two identical corners.
+// * A triangle to the right of the quad, whose top corner is 1.0000001 instead of 1.
+class ScanLoader_StlLoader : public ::testing::Test {
+protected:
+    // Per-test set-up and tear-down logic.
+    virtual void SetUp() {
+        Materials::allocate(2u);
+        Meshes::allocate(2u);
+        MeshModels::allocate(2u);
+        SceneNodes::allocate(2u);
+    }
+    virtual void TearDown() {
+        Materials::deallocate();
+        Meshes::deallocate();
+        MeshModels::deallocate();
+        SceneNodes::deallocate();
+    }
+
+    const std::string ascii_path = SCAN_LOADER_TEST_DATA_ROOT "quads.stl";
+    const std::string binary_path = SCAN_LOADER_TEST_DATA_ROOT "quads_binary.stl";
+};
+
+inline unsigned int count_vertices_at(Mesh mesh, Vector3f position) {
+    unsigned int count = 0;
+    for (unsigned int v = 0; v < mesh.get_vertex_count(); ++v)
+        count += mesh.get_positions()[v] == position ? 1 : 0;
+    return count;
+}
+
+inline void expect_triangle_soup(Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+    ASSERT_EQ(4u, mesh.get_primitive_count());
+    ASSERT_EQ(12u, mesh.get_vertex_count());
+    for (unsigned int t = 0; t < 4; ++t)
+        EXPECT_EQ(Vector3ui(3 * t, 3 * t + 1, 3 * t + 2), mesh.get_primitives()[t]);
+
+    // All triangles are kept and each triangle has its own corners.
+    EXPECT_EQ(Vector3f(1, 0, 0), mesh.get_positions()[1]);
+    EXPECT_EQ(Vector3f(0, 1, 0), mesh.get_positions()[5]);
+    EXPECT_EQ(Vector3f(1.0000001f, 1, 0), mesh.get_positions()[11]);
+
+    // The degenerate triangle has neither a facet normal nor an area, so its normal defaults to up.
+    for (unsigned int v = 0; v < 12; ++v)
+        EXPECT_EQ(Vector3f(0, 0, 1), mesh.get_normals()[v]) << v;
+
+    EXPECT_EQ(Vector3f(0, 0, 0), mesh.get_bounds().minimum);
+    EXPECT_EQ(Vector3f(2, 1, 0), mesh.get_bounds().maximum);
+}
+
+inline void expect_welded(Meshes::UID mesh_ID) {
+    Mesh mesh = mesh_ID;
+    // The degenerate triangle is removed.
+    ASSERT_EQ(3u, mesh.get_primitive_count());
+
+    // Corners are only welded if their positions are identical. -0 and 0 are identical, but 1.0000001 and 1 aren't.
+    ASSERT_EQ(6u, mesh.get_vertex_count());
+    EXPECT_EQ(1u, count_vertices_at(mesh, Vector3f(0, 0, 0)));
+    EXPECT_EQ(1u, count_vertices_at(mesh, Vector3f(1, 0, 0)));
+    EXPECT_EQ(1u, count_vertices_at(mesh, Vector3f(1, 1, 0)));
+    EXPECT_EQ(1u, count_vertices_at(mesh, Vector3f(0, 1, 0)));
+    EXPECT_EQ(1u, count_vertices_at(mesh, Vector3f(2, 0, 0)));
+    EXPECT_EQ(1u, count_vertices_at(mesh, Vector3f(1.0000001f, 1, 0)));
+
+    // The vertices are ordered by their first occurrence in the file.
+    EXPECT_EQ(Vector3f(0, 0, 0), mesh.get_positions()[0]);
+    EXPECT_EQ(Vector3f(1, 0, 0), mesh.get_positions()[1]);
+    EXPECT_EQ(Vector3f(1, 1, 0), mesh.get_positions()[2]);
+    EXPECT_EQ(Vector3f(0, 1, 0), mesh.get_positions()[3]);
+    EXPECT_EQ(Vector3ui(0, 1, 2), mesh.get_primitives()[0]);
+    EXPECT_EQ(Vector3ui(0, 2, 3), mesh.get_primitives()[1]);
+    EXPECT_EQ(Vector3ui(1, 4, 5), mesh.get_primitives()[2]);
+
+    // The welded vertices get smooth normals, which are all up for a flat mesh.
+    for (unsigned int v = 0; v < 6; ++v) {
+        Vector3f normal = mesh.get_normals()[v];
+        EXPECT_FLOAT_EQ(1.0f, normal.z) << v;
+    }
+
+    EXPECT_EQ(Vector3f(0, 0, 0), mesh.get_bounds().minimum);
+    EXPECT_EQ(Vector3f(2, 1, 0), mesh.get_bounds().maximum);
+}
+
+TEST_F(ScanLoader_StlLoader, ascii) {
+    Meshes::UID mesh_ID = load_mesh(ascii_path);
+    ASSERT_TRUE(Meshes::has(mesh_ID));
+    EXPECT_EQ("quads", Meshes::get_name(mesh_ID));
+    expect_triangle_soup(mesh_ID);
+}
+
+TEST_F(ScanLoader_StlLoader, binary) {
+    Meshes::UID mesh_ID = load_mesh(binary_path);
+    ASSERT_TRUE(Meshes::has(mesh_ID));
+    EXPECT_EQ("quads_binary", Meshes::get_name(mesh_ID));
+    expect_triangle_soup(mesh_ID);
+}
+
+TEST_F(ScanLoader_StlLoader, ascii_welding) {
+    Meshes::UID mesh_ID = load_mesh(ascii_path, true);
+    ASSERT_TRUE(Meshes::has(mesh_ID));
+    expect_welded(mesh_ID);
+}
+
+TEST_F(ScanLoader_StlLoader, binary_welding) {
+    Meshes::UID mesh_ID = load_mesh(binary_path, true);
+    ASSERT_TRUE(Meshes::has(mesh_ID));
+    expect_welded(mesh_ID);
+}
+
+TEST_F(ScanLoader_StlLoader, scene_node) {
+    SceneNodes::UID node_ID = load(ascii_path);
+    ASSERT_TRUE(SceneNodes::has(node_ID));
+    EXPECT_EQ("quads", SceneNodes::get_name(node_ID));
+
+    MeshModel model = *MeshModels::get_iterable().begin();
+    EXPECT_EQ(node_ID, model.get_scene_node().get_ID());
+    EXPECT_EQ(4u, model.get_mesh().get_primitive_count());
+    EXPECT_TRUE(Materials::has(model.get_material().get_ID()));
+}
+
+TEST_F(ScanLoader_StlLoader, invalid_files) {
+    EXPECT_EQ(Meshes::UID::invalid_UID(), load_mesh(SCAN_LOADER_TEST_DATA_ROOT "missing.stl"));
+    EXPECT_EQ(SceneNodes::UID::invalid_UID(), load(SCAN_LOADER_TEST_DATA_ROOT "missing.stl"));
+
+    // Neither binary nor ASCII.
+    EXPECT_EQ(Meshes::UID::invalid_UID(), load_mesh(SCAN_LOADER_TEST_DATA_ROOT "quads_ascii.ply"));
+
+    EXPECT_TRUE(Meshes::get_iterable().is_empty());
+}
+
+} // NS StlLoader
+
+#endif // _SCAN_LOADER_STL_LOADER_TEST_H_
@@ -0,0 +1,172 @@
+// Test the scan loader text parsing utilities.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#ifndef _SCAN_LOADER_TEXT_PARSING_TEST_H_
+#define _SCAN_LOADER_TEXT_PARSING_TEST_H_
+
+#include <ScanLoader/TextParsing.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+namespace ScanLoader {
+namespace TextParsing {
+
+// Parses a single double from the text and returns the number of characters consumed, or -1 if parsing failed.
+inline int parse_double(const std::string& text, double& value) {
+    const char* c = text.data();
+    return parse_double(c, text.data() + text.length(), value) ? int(c - text.data()) : -1;
+}
+
+TEST(ScanLoader_TextParsing, parse_double) {
+    double value;
+    EXPECT_EQ(1, parse_double("2", value));
+    EXPECT_EQ(2.0, value);
+    EXPECT_EQ(5, parse_double("  -.5", value));
+    EXPECT_EQ(-0.5, value);
+    EXPECT_EQ(2, parse_double("5.", value));
+    EXPECT_EQ(5.0, value);
+    EXPECT_EQ(4, parse_double("+2.5", value));
+    EXPECT_EQ(2.5, value);
+    EXPECT_EQ(2, parse_double("+0", value));
+    EXPECT_EQ(0.0, value);
+    EXPECT_FALSE(std::signbit(value));
+    EXPECT_EQ(2, parse_double("-0", value));
+    EXPECT_EQ(0.0, value);
+    EXPECT_TRUE(std::signbit(value));
+
+    // Numbers that fit in the mantissa and the table of powers of ten are parsed exactly, like strtod.
+    const char* exact_numbers[] = { "0.1", "3.14159", "-273.15", "0.000123", "123456789.125", "9007199254740993" };
+    for (const char* number : exact_numbers) {
+        EXPECT_NE(-1, parse_double(number, value));
+        EXPECT_EQ(strtod(number, nullptr), value) << number;
+    }
+
+    // Parsing stops at the first character that isn't part of the number.
+    EXPECT_EQ(3, parse_double("1.5,2", value));
+    EXPECT_EQ(1.5, value);
+
+    const char* invalid_numbers[] = { "", " ", ".", "-", "+", "+-1", "e5", "-e5", "x1", "nan", "inf" };
+    for (const char* number : invalid_numbers)
+        EXPECT_EQ(-1, parse_double(number, value)) << number;
+}
+
+TEST(ScanLoader_TextParsing, parse_double_exponents) {
+    double value;
+    EXPECT_EQ(3, parse_double("1e3", value));
+    EXPECT_EQ(1000.0, value);
+    EXPECT_EQ(4, parse_double("1E-3", value));
+    EXPECT_EQ(0.001, value);
+    EXPECT_EQ(6, parse_double("2.5e+2", value));
+    EXPECT_EQ(250.0, value);
+    EXPECT_EQ(7, parse_double("-1.5e03", value));
+    EXPECT_EQ(-1500.0, value);
+    EXPECT_EQ(4, parse_double("0e99", value));
+    EXPECT_EQ(0.0, value);
+
+    // Exponents beyond the table of powers of ten.
+    EXPECT_EQ(5, parse_double("1e-30", value));
+    EXPECT_DOUBLE_EQ(1e-30, value);
+    EXPECT_EQ(6, parse_double("1.5e40", value));
+    EXPECT_DOUBLE_EQ(1.5e40, value);
+    EXPECT_EQ(5, parse_double("1e400", value));
+    EXPECT_TRUE(std::isinf(value));
+    EXPECT_EQ(6, parse_double("1e-400", value));
+    EXPECT_EQ(0.0, value);
+    EXPECT_EQ(22, parse_double("1e99999999999999999999", value));
+    EXPECT_TRUE(std::isinf(value));
+
+    // An incomplete exponent isn't part of the number.
+    EXPECT_EQ(1, parse_double("1e", value));
+    EXPECT_EQ(1.0, value);
+    EXPECT_EQ(1, parse_double("1e+", value));
+    EXPECT_EQ(1.0, value);
+    EXPECT_EQ(1, parse_double("1e 5", value));
+    EXPECT_EQ(1.0, value);
+    EXPECT_EQ(1, parse_double("1ex", value));
+    EXPECT_EQ(1.0, value);
+}
+
+TEST(ScanLoader_TextParsing, parse_double_long_mantissa) {
+    double value;
+    // Digits beyond the first 19 significant digits are below the precision of a double and are ignored.
+    std::string long_integer = "123456789012345678901234";
+    EXPECT_EQ(int(long_integer.length()), parse_double(long_integer, value));
+    EXPECT_DOUBLE_EQ(1.23456789012345678901234e23, value);
+
+    std::string long_fraction = "3.14159265358979323846264338327950288";
+    EXPECT_EQ(int(long_fraction.length()), parse_double(long_fraction, value));
+    EXPECT_DOUBLE_EQ(3.14159265358979323846, value);
+
+    // Leading zeros aren't significant.
+    std::string small_number = "0.000000000000000000000012345678901234567890123";
+    EXPECT_EQ(int(small_number.length()), parse_double(small_number, value));
+    EXPECT_DOUBLE_EQ(1.2345678901234567890123e-23, value);
+
+    std::string long_with_exponent = "-98765432109876543210987e-10";
+    EXPECT_EQ(int(long_with_exponent.length()), parse_double(long_with_exponent, value));
+    EXPECT_DOUBLE_EQ(-9876543210987.6543210987, value);
+
+    // The mantissa doesn't overflow on 19 nines.
+    EXPECT_EQ(19, parse_double("9999999999999999999", value));
+    EXPECT_DOUBLE_EQ(9999999999999999999.0, value);
+}
+
+TEST(ScanLoader_TextParsing, parse_int) {
+    std::string text = " 42 -7 +3 x";
+    const char* c = text.data();
+    const char* end = text.data() + text.length();
+    long long value;
+    EXPECT_TRUE(parse_int(c, end, value));
+    EXPECT_EQ(42, value);
+    EXPECT_TRUE(parse_int(c, end, value));
+    EXPECT_EQ(-7, value);
+    EXPECT_TRUE(parse_int(c, end, value));
+    EXPECT_EQ(3, value);
+    EXPECT_FALSE(parse_int(c, end, value));
+    EXPECT_EQ('x', *skip_spaces(c, end));
+
+    // Integers that are too large are clamped.
+    std::string large_integers = "9223372036854775807 9223372036854775808 -123456789012345678901234567890";
+    c = large_integers.data();
+    end = large_integers.data() + large_integers.length();
+    EXPECT_TRUE(parse_int(c, end, value));
+    EXPECT_EQ(9223372036854775807ll, value);
+    EXPECT_TRUE(parse_int(c, end, value));
+    EXPECT_EQ(9223372036854775807ll, value);
+    EXPECT_TRUE(parse_int(c, end, value));
+    EXPECT_EQ(-9223372036854775807ll, value);
+    EXPECT_EQ(end, c);
+}
+
+TEST(ScanLoader_TextParsing, lines_and_tokens) {
+    std::string text = "solid name\r\n  facet normal 0 0 1\n\t \nendsolid";
+    const char* end = text.data() + text.length();
+    const char* line = text.data();
+    EXPECT_TRUE(starts_with_token(line, end, "solid"));
+    EXPECT_FALSE(starts_with_token(line, end, "sol"));
+
+    line = next_line(line, end);
+    EXPECT_TRUE(starts_with_token(line, end, "facet"));
+    EXPECT_FALSE(is_blank_line(line, end));
+
+    line = next_line(line, end);
+    EXPECT_TRUE(is_blank_line(line, end));
+
+    line = next_line(line, end);
+    EXPECT_TRUE(starts_with_token(line, end, "endsolid"));
+    EXPECT_EQ(end, next_line(line, end));
+}
+
+} // NS TextParsing
+} // NS ScanLoader
+
+#endif // _SCAN_LOADER_TEXT_PARSING_TEST_H_
@@ -0,0 +1,18 @@
+// ScanLoader unit tests.
+// ---------------------------------------------------------------------------
+// Copyright (C) 2015-2016, Cogwheel. See AUTHORS.txt for authors
+//
+// This program is open source and distributed under the New BSD License. See
+// LICENSE.txt for more detail.
+// ---------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include <PlyLoaderTest.h>
+#include <StlLoaderTest.h>
+#include <TextParsingTest.h>
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}